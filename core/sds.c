@@ -120,7 +120,8 @@ struct chunk_s
 	struct chunk_position_s position;
 	gsize size;
 	guint32 score;
-	gchar hexhash[STRLEN_CHUNKHASH];
+	/* Large enough for the longest hash a rawx may compute (sha256) */
+	gchar hexhash[STRLEN_SHA256];
 	guint8 flag_success : 1;  /* only used during an upload */
 	gchar url[];
 };
@@ -219,6 +220,16 @@ _chunks_pack (GString *gs, GSList *chunks)
 	g_string_append_c (gs, ']');
 }
 
+/* The chunks uploaded by other clients may be hashed with any algorithm the
+ * rawx supports, whose hexadecimal digests have different lengths: 16 for
+ * xxh64, 32 for md5 and 64 for sha256. */
+static gboolean
+_chunk_hash_is_valid(const char *h)
+{
+	const gsize len = strlen(h);
+	return (len == 16 || len == 32 || len == 64) && oio_str_ishexa(h, len);
+}
+
 static GError *
 _chunks_load (GSList **out, struct json_object *jtab)
 {
@@ -241,9 +252,8 @@ _chunks_load (GSList **out, struct json_object *jtab)
 		if (err) continue;
 
 		const char *h = json_object_get_string(jhash);
-		if (!oio_str_ishexa(h, 2*sizeof(chunk_hash_t)))
-			err = SYSERR("JSON: invalid chunk hash: not hexa of %"G_GSIZE_FORMAT,
-					2*sizeof(chunk_hash_t));
+		if (!_chunk_hash_is_valid(h))
+			err = SYSERR("JSON: invalid chunk hash: [%s]", h);
 		else {
 			struct chunk_s *c = _load_one_chunk(jreal_url ? jreal_url : jurl, jsize, jpos, jscore);
 			g_strlcpy (c->hexhash, h, sizeof(c->hexhash));
@@ -1558,6 +1568,11 @@ _sds_upload_add_headers(struct oio_sds_ul_s *ul, struct http_put_dest_s *dest)
 	http_put_dest_add_header (dest, RAWX_HEADER_PREFIX "content-id",
 			"%s", ul->hexid);
 
+	/* The chunks are hashed with MD5 (see checksum_chunk), so is the rawx
+	 * whatever the default algorithm of the namespace */
+	http_put_dest_add_header (dest, RAWX_HEADER_PREFIX "chunk-hash-algo",
+			"md5");
+
 	struct oio_url_s *url = oio_url_dup(ul->dst->url);
 	gchar version[21];
 	g_sprintf(version, "%"G_GINT64_FORMAT, ul->version);
@@ -19,10 +19,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string.h>
 
 #include <glib.h>
+#include <json.h>
 
 #include <core/oio_core.h>
 #include <core/url_ext.h>
 #include <metautils/lib/metautils_resolv.h>
+#include <events/events_variables.h>
 
 #include "oio_events_queue.h"
 #include "oio_events_queue_internals.h"
@@ -39,8 +41,82 @@ oio_events_queue__destroy (struct oio_events_queue_s *self)
 	EVTQ_CALL(self,destroy)(self);
 }
 
+static gboolean
+_coalesce_rules_match (const char *rules, const char *type, gsize type_len)
+{
+	for (const char *p = rules; *p ;) {
+		const char *end = strchr(p, ',');
+		const gsize len = end ? (gsize)(end - p) : strlen(p);
+		if (len == type_len && !memcmp(p, type, len))
+			return TRUE;
+		if (!end)
+			break;
+		p = end + 1;
+	}
+	return FALSE;
+}
+
+/* If the type of the event is listed in the coalescing rules, returns the
+ * key that makes it collapse with the other events of the same type about
+ * the same container. An event about an object (i.e. with a content ID or
+ * a path) only collapses with the events about the same object. */
+static gchar *
+_coalesce_key (const char *msg)
+{
+	const char *rules = oio_events_common_coalesce;
+	if (!oio_str_is_set(rules))
+		return NULL;
+
+	static const char prefix[] = "{\"event\":\"";
+	if (!g_str_has_prefix(msg, prefix))
+		return NULL;
+	const char *type = msg + sizeof(prefix) - 1;
+	const char *type_end = strchr(type, '"');
+	if (!type_end)
+		return NULL;
+	const gsize type_len = type_end - type;
+	if (!_coalesce_rules_match(rules, type, type_len))
+		return NULL;
+
+	gchar *key = NULL;
+	struct json_object *jbody = json_tokener_parse(msg);
+	struct json_object *jurl = NULL, *jid = NULL, *jobj = NULL;
+	if (jbody
+			&& json_object_object_get_ex(jbody, "url", &jurl)
+			&& json_object_is_type(jurl, json_type_object)
+			&& json_object_object_get_ex(jurl, "id", &jid)
+			&& json_object_is_type(jid, json_type_string)) {
+		if (!json_object_object_get_ex(jurl, "content", &jobj))
+			json_object_object_get_ex(jurl, "path", &jobj);
+		if (!jobj) {
+			key = g_strdup_printf("%.*s|%s", (int)type_len, type,
+					json_object_get_string(jid));
+		} else if (json_object_is_type(jobj, json_type_string)) {
+			key = g_strdup_printf("%.*s|%s|%s", (int)type_len, type,
+					json_object_get_string(jid),
+					json_object_get_string(jobj));
+		}
+	}
+	if (jbody)
+		json_object_put(jbody);
+	return key;
+}
+
 void
 oio_events_queue__send (struct oio_events_queue_s *self, gchar *msg)
+{
+	EXTRA_ASSERT (msg != NULL);
+	gchar *key = NULL;
+	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,send_overwritable)
+			&& (key = _coalesce_key(msg))) {
+		EVTQ_CALL(self,send_overwritable)(self,key,msg,TRUE);
+	} else {
+		EVTQ_CALL(self,send)(self,msg);
+	}
+}
+
+void
+oio_events_queue_forward (struct oio_events_queue_s *self, gchar *msg)
 {
 	EXTRA_ASSERT (msg != NULL);
 	EVTQ_CALL(self,send)(self,msg);
@@ -53,7 +129,7 @@ oio_events_queue__send_overwritable(struct oio_events_queue_s *self,
 	EXTRA_ASSERT (msg != NULL);
 	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,send_overwritable)
 			&& key && *key) {
-		EVTQ_CALL(self,send_overwritable)(self,key,msg);
+		EVTQ_CALL(self,send_overwritable)(self,key,msg,FALSE);
 	} else {
 		EVTQ_CALL(self,send)(self,msg);
 		g_free(key);  // safe if key is NULL
@@ -82,6 +158,15 @@ oio_events_queue__set_buffering (struct oio_events_queue_s *self,
 	EVTQ_CALL(self,set_buffering)(self,delay);
 }
 
+guint64
+oio_events_queue__get_coalesced (struct oio_events_queue_s *self)
+{
+	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,get_coalesced)) {
+		EVTQ_CALL(self,get_coalesced)(self);
+	}
+	return 0;
+}
+
 GError *
 oio_events_queue__run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending))
@@ -174,6 +259,48 @@ oio_event__init (GString *gs, const char *type, struct oio_url_s *url)
 	}
 }
 
+gboolean
+oio_event__hash_container (const char *msg, guint32 *phash)
+{
+	static const char url_prefix[] = "\"url\":{";
+	static const char id_prefix[] = "\"id\":\"";
+
+	const char *start = strstr(msg, url_prefix);
+	if (!start)
+		return FALSE;
+	start += sizeof(url_prefix) - 1;
+
+	/* The "url" object is flat, its end is the first brace out of a
+	 * string. */
+	const char *end = start;
+	for (gboolean in_string = FALSE; *end ;++end) {
+		if (in_string) {
+			if (*end == '\\' && end[1])
+				++end;
+			else if (*end == '"')
+				in_string = FALSE;
+		} else if (*end == '"') {
+			in_string = TRUE;
+		} else if (*end == '}') {
+			break;
+		}
+	}
+
+	const char *id = g_strstr_len(start, end - start, id_prefix);
+	if (!id)
+		return FALSE;
+	id += sizeof(id_prefix) - 1;
+
+	guint32 h = 5381;
+	const char *p;
+	for (p = id; p < end && *p != '"' ;++p)
+		h = (h << 5) + h + g_ascii_toupper(*p);
+	if (p == id || p >= end)
+		return FALSE;
+	*phash = h;
+	return TRUE;
+}
+
 GString*
 oio_event__create(const char *type, struct oio_url_s *url)
 {
@@ -41,6 +41,11 @@ gint64 oio_events_queue__get_health(struct oio_events_queue_s *self);
 void oio_events_queue__set_buffering (struct oio_events_queue_s *self,
 		gint64 delay);
 
+/* How many events have been saved by the buffering stage, because they
+ * have been coalesced with a more recent event. The events explicitly sent
+ * as overwritable are not counted. */
+guint64 oio_events_queue__get_coalesced (struct oio_events_queue_s *self);
+
 GError * oio_events_queue__run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
 
@@ -56,6 +61,11 @@ GString* oio_event__create (const char *type, struct oio_url_s *url);
 GString* oio_event__create_with_id(const char *type, struct oio_url_s *url,
 		const char *request_id);
 
+/* Hash the container ID found in the "url" object of the JSON formatted
+ * event. Returns FALSE if there is none. The hash only depends on the
+ * container ID, so that all the services agree on it. */
+gboolean oio_event__hash_container (const char *msg, guint32 *phash);
+
 /* -------------------------------------------------------------------------- */
 
 /* find the appropriate implementation of event queue for the configuration
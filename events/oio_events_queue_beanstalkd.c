@@ -47,10 +47,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 static void _q_destroy (struct oio_events_queue_s *self);
 static void _q_send (struct oio_events_queue_s *self, gchar *msg);
-static void _q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg);
+static void _q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced);
 static gboolean _q_is_stalled (struct oio_events_queue_s *self);
 static gint64 _q_get_health(struct oio_events_queue_s *self);
 
+static guint64 _q_get_coalesced(struct oio_events_queue_s *self);
 static void _q_set_buffering (struct oio_events_queue_s *self, gint64 v);
 static GError * _q_run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
@@ -63,6 +65,7 @@ static struct oio_events_queue_vtable_s vtable_BEANSTALKD =
 	.is_stalled = _q_is_stalled,
 	.get_health = _q_get_health,
 	.set_buffering = _q_set_buffering,
+	.get_coalesced = _q_get_coalesced,
 	.run = _q_run
 };
 
@@ -81,6 +84,7 @@ struct _queue_BEANSTALKD_s
 	gint64 pending_events;
 
 	struct oio_events_queue_buffer_s buffer;
+	struct oio_events_queue_spill_s spill;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -103,6 +107,13 @@ oio_events_queue_factory__create_beanstalkd (const char *endpoint,
 	self->endpoint = g_strdup (endpoint);
 
 	oio_events_queue_buffer_init(&(self->buffer));
+	oio_events_queue_spill_init(&(self->spill));
+
+	GError *err = oio_events_queue_spill_open(&(self->spill), self->endpoint);
+	if (err) {
+		_q_destroy((struct oio_events_queue_s*) self);
+		return err;
+	}
 
 	*out = (struct oio_events_queue_s*) self;
 	return NULL;
@@ -158,6 +169,7 @@ retry:
 			iov ++;
 			iovcount --;
 		} else {
+			iov[0].iov_base = ((guint8*)iov[0].iov_base) + w;
 			iov[0].iov_len -= w;
 			w = 0;
 		}
@@ -192,28 +204,41 @@ _send_and_read_reply (int fd, struct iovec *iov, unsigned int iovcount,
 	return NULL;
 }
 
+/* Reads the next CRLF-terminated line of the replies stream. The bytes
+ * received past that line are kept in <rbuf> for the next call. */
 static GError *
-_put_job (int fd, gchar *msg, size_t msglen)
+_read_line (int fd, GString *rbuf, gchar *dst, gsize dst_len)
 {
-	gchar buf[256];
+	const int timeout =
+		oio_events_beanstalkd_timeout / G_TIME_SPAN_MILLISECOND;
 
-	/* send the request */
-	gsize len = g_snprintf (buf, sizeof(buf),
-			"put %u %u %u %"G_GSIZE_FORMAT"\r\n",
-			oio_events_beanstalkd_default_prio,
-			(guint) oio_events_beanstalkd_default_delay,
-			(guint) oio_events_beanstalkd_default_ttr,
-			msglen);
-	struct iovec iov[3] = {};
-	iov[0].iov_base = buf;
-	iov[0].iov_len = len;
-	iov[1].iov_base = msg;
-	iov[1].iov_len = msglen;
-	iov[2].iov_base = "\r\n";
-	iov[2].iov_len = 2;
-	GError *err = _send_and_read_reply(fd, iov, 3, buf, sizeof(buf));
-	if (err) return err;
+	for (;;) {
+		gchar *eol = strstr(rbuf->str, "\r\n");
+		if (eol) {
+			const gsize len = eol - rbuf->str;
+			g_strlcpy(dst, rbuf->str, MIN(dst_len, len + 1));
+			g_string_erase(rbuf, 0, len + 2);
+			return NULL;
+		}
+		if (rbuf->len >= dst_len)
+			return BADREQ("Reply line too long");
+
+		gchar tmp[1024];
+		GError *err = NULL;
+		int r = sock_to_read (fd, timeout, tmp, sizeof(tmp), &err);
+		if (r < 0) {
+			g_prefix_error(&err, "Read error: ");
+			return err;
+		}
+		if (r == 0)
+			return NETERR("EOF");
+		g_string_append_len(rbuf, tmp, r);
+	}
+}
 
+static GError *
+_parse_put_reply (const gchar *buf)
+{
 	/* No need to retry, the event has been saved ... or explicitely
 	 * dropped. */
 	const char * const replies_ok[] = { "INSERTED", "BURIED", "DRAINING", NULL };
@@ -221,8 +246,88 @@ _put_job (int fd, gchar *msg, size_t msglen)
 		if (g_str_has_prefix(buf, *pmsg))
 			return NULL;
 	}
+	return _match_common_error((gchar*)buf);
+}
+
+/* Writes all the jobs of <batch> back-to-back, then reads the replies in
+ * the same order. The jobs to be retried are moved to <retry>, the others
+ * are consumed (saved or dropped). Returns FALSE if the connection must be
+ * reset. */
+static gboolean
+_put_jobs (struct _queue_BEANSTALKD_s *q, int fd, GPtrArray *batch,
+		GQueue *retry)
+{
+	const guint count = batch->len;
+	gchar headers[count][64];
+	struct iovec iov[3 * count];
+
+	for (guint i=0; i<count ;++i) {
+		gchar *msg = batch->pdata[i];
+		const size_t msglen = strlen(msg);
+		gsize len = g_snprintf (headers[i], sizeof(headers[i]),
+				"put %u %u %u %"G_GSIZE_FORMAT"\r\n",
+				oio_events_beanstalkd_default_prio,
+				(guint) oio_events_beanstalkd_default_delay,
+				(guint) oio_events_beanstalkd_default_ttr,
+				msglen);
+		iov[3*i].iov_base = headers[i];
+		iov[3*i].iov_len = len;
+		iov[3*i+1].iov_base = msg;
+		iov[3*i+1].iov_len = msglen;
+		iov[3*i+2].iov_base = "\r\n";
+		iov[3*i+2].iov_len = 2;
+	}
 
-	return _match_common_error(buf);
+	GError *err = NULL;
+	if (!_send(fd, iov, 3 * count))
+		err = NETERR("Send error: (%d) %s", errno, strerror(errno));
+
+	gboolean healthy = TRUE;
+	GString *rbuf = g_string_sized_new(256);
+	guint i = 0;
+	for (; !err && i<count ;++i) {
+		gchar line[256];
+		if ((err = _read_line(fd, rbuf, line, sizeof(line))))
+			break;
+
+		gchar *msg = batch->pdata[i];
+		GError *e = _parse_put_reply(line);
+		if (intercept_errors)
+			(*intercept_errors) (e);
+		if (!e) {
+			g_free(msg);
+			continue;
+		}
+
+		healthy = FALSE;
+		if (CODE_IS_RETRY(e->code)) {
+			g_queue_push_tail(retry, msg);
+		} else {
+			const size_t msglen = strlen(msg);
+			GRID_WARN("Unrecoverable error with beanstalkd at [%s]: (%d) %s",
+					q->endpoint, e->code, e->message);
+			GRID_NOTICE("dropped %d %.*s",
+					(int)msglen, (int)MIN(msglen,2048), msg);
+			g_free(msg);
+		}
+		g_clear_error(&e);
+	}
+	g_string_free(rbuf, TRUE);
+
+	if (err) {
+		/* No reply for the remaining jobs, they are sent again later */
+		if (intercept_errors)
+			(*intercept_errors) (err);
+		GRID_WARN("BEANSTALK error to %s: (%d) %s", q->endpoint,
+				err->code, err->message);
+		g_clear_error(&err);
+		healthy = FALSE;
+		for (; i<count ;++i)
+			g_queue_push_tail(retry, batch->pdata[i]);
+	}
+
+	g_ptr_array_set_size(batch, 0);
+	return healthy;
 }
 
 static GError *
@@ -336,7 +441,8 @@ static GError *
 _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 {
 	struct _queue_BEANSTALKD_s *q = (struct _queue_BEANSTALKD_s *)self;
-	gchar *saved = NULL;
+	GQueue retry = G_QUEUE_INIT;
+	GPtrArray *batch = g_ptr_array_new();
 	int fd = -1;
 	guint attempts_connect = 0, attempts_check = 0, attempts_put = 0;
 	gint64 last_flush = 0, last_check = 0;
@@ -344,7 +450,8 @@ _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_BEANSTALKD);
 	EXTRA_ASSERT (running != NULL);
 
-	while ((*running)(0 < g_async_queue_length(q->queue))) {
+	while ((*running)(0 < g_async_queue_length(q->queue)
+				|| !g_queue_is_empty(&retry))) {
 
 		const gint64 now = oio_ext_monotonic_time();
 
@@ -400,48 +507,51 @@ _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 			_flush_buffered(self, q);
 		}
 
-		/* find an event, prefering the last that failed */
-		gchar *msg = saved;
-		saved = NULL;
-		if (!msg) msg = g_async_queue_timeout_pop (q->queue, G_TIME_SPAN_SECOND);
-		if (!msg) continue;
+		/* Bring back the spilled events, once the queue has room for them */
+		oio_events_queue_spill_replay(&(q->spill), q->queue);
+
+		/* Fill the window of jobs, prefering the ones that failed. Only wait
+		 * for the first event. */
+		const guint window = MAX(1, oio_events_beanstalkd_window);
+		while (batch->len < window) {
+			gchar *msg = g_queue_pop_head(&retry);
+			if (!msg) {
+				msg = batch->len > 0 ? g_async_queue_try_pop (q->queue)
+					: g_async_queue_timeout_pop (q->queue, G_TIME_SPAN_SECOND);
+			}
+			if (!msg)
+				break;
+			if (*msg)
+				g_ptr_array_add(batch, msg);
+			else
+				g_free(msg);
+		}
+		if (!batch->len)
+			continue;
 
-		/* forward the event as a beanstalkd job */
-		if (*msg) {
-			const size_t msglen = strlen(msg);
-			GError *err = _put_job (fd, msg, msglen);
-			if (intercept_errors)
-				(*intercept_errors) (err);
-			if (!err) {
-				attempts_put = 0;
+		/* forward the events as beanstalkd jobs */
+		const guint retried = g_queue_get_length(&retry);
+		if (_put_jobs (q, fd, batch, &retry)) {
+			attempts_put = 0;
+		} else {
+			if (g_queue_get_length(&retry) > retried) {
+				EXPO_BACKOFF(250 * G_TIME_SPAN_MILLISECOND, attempts_put, 4);
 			} else {
-				if (CODE_IS_RETRY(err->code) || CODE_IS_NETWORK_ERROR(err->code)) {
-					saved = msg;
-					msg = NULL;
-					EXPO_BACKOFF(250 * G_TIME_SPAN_MILLISECOND, attempts_put, 4);
-				} else {
-					GRID_WARN("Unrecoverable error with beanstalkd at [%s]: (%d) %s",
-							q->endpoint, err->code, err->message);
-					GRID_NOTICE("dropped %d %.*s",
-							(int)msglen, (int)MIN(msglen,2048), msg);
-					attempts_put = 0;
-				}
-				g_clear_error (&err);
-				sock_set_linger(fd, 1, 1);
-				metautils_pclose (&fd);
+				attempts_put = 0;
 			}
+			sock_set_linger(fd, 1, 1);
+			metautils_pclose (&fd);
 		}
-
-		oio_str_clean (&msg);
 	}
 
 	if (fd >= 0)
 		sock_set_linger(fd, 1, 1);
 	metautils_pclose (&fd);
 
-	if (saved)
-		g_async_queue_push (q->queue, saved);
-	saved = NULL;
+	gchar *msg;
+	while ((msg = g_queue_pop_head(&retry)))
+		g_async_queue_push (q->queue, msg);
+	g_ptr_array_free(batch, TRUE);
 	return NULL;
 }
 
@@ -455,6 +565,7 @@ _q_destroy (struct oio_events_queue_s *self)
 	oio_str_clean (&q->endpoint);
 	oio_str_clean (&q->tube);
 	oio_events_queue_buffer_clean(&(q->buffer));
+	oio_events_queue_spill_clean(&(q->spill));
 	q->vtable = NULL;
 	g_free (q);
 }
@@ -464,14 +575,23 @@ _q_send (struct oio_events_queue_s *self, gchar *msg)
 {
 	struct _queue_BEANSTALKD_s *q = (struct _queue_BEANSTALKD_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_BEANSTALKD);
-	g_async_queue_push (q->queue, msg);
+	oio_events_queue_spill_push(&(q->spill), q->queue, msg);
 }
 
 static void
-_q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg)
+_q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced)
 {
 	struct _queue_BEANSTALKD_s *q = (struct _queue_BEANSTALKD_s*) self;
-	oio_events_queue_buffer_put(&(q->buffer), key, msg);
+	oio_events_queue_buffer_put(&(q->buffer), key, msg, coalesced);
+}
+
+static guint64
+_q_get_coalesced(struct oio_events_queue_s *self)
+{
+	struct _queue_BEANSTALKD_s *q = (struct _queue_BEANSTALKD_s*) self;
+	EXTRA_ASSERT(q != NULL && q->vtable == &vtable_BEANSTALKD);
+	return oio_events_queue_buffer_get_coalesced(&(q->buffer));
 }
 
 static gboolean
@@ -56,9 +56,20 @@ oio_events_queue_buffer_maybe_flush(struct oio_events_queue_buffer_s *buf,
 }
 
 void oio_events_queue_buffer_put(struct oio_events_queue_buffer_s *buf,
-		gchar *key, gchar *msg)
+		gchar *key, gchar *msg, gboolean coalesced)
 {
 	g_mutex_lock(&(buf->msg_by_key_lock));
+	if (coalesced && lru_tree_get(buf->msg_by_key, key))
+		buf->coalesced ++;
 	lru_tree_insert(buf->msg_by_key, key, msg);
 	g_mutex_unlock(&(buf->msg_by_key_lock));
 }
+
+guint64
+oio_events_queue_buffer_get_coalesced(struct oio_events_queue_buffer_s *buf)
+{
+	g_mutex_lock(&(buf->msg_by_key_lock));
+	const guint64 coalesced = buf->coalesced;
+	g_mutex_unlock(&(buf->msg_by_key_lock));
+	return coalesced;
+}
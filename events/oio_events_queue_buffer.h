@@ -27,14 +27,24 @@ struct oio_events_queue_buffer_s
 	struct lru_tree_s *msg_by_key;
 	GMutex msg_by_key_lock;
 	gint64 delay;
+
+	/* How many coalesced events have been overwritten by a more recent
+	 * one with the same key, before being sent. Changed under the lock. */
+	guint64 coalesced;
 };
 
 void oio_events_queue_buffer_init(struct oio_events_queue_buffer_s *buf);
 void oio_events_queue_buffer_clean(struct oio_events_queue_buffer_s *buf);
 void oio_events_queue_buffer_set_delay(struct oio_events_queue_buffer_s *buf,
 		gint64 new_delay);
+/** Buffers `msg` under `key`, overwriting any event with the same key.
+ *  The overwrite is counted only if `coalesced`, i.e. if the key has been
+ *  computed by the coalescing rules instead of being given by the caller. */
 void oio_events_queue_buffer_put(struct oio_events_queue_buffer_s *buf,
-		gchar *key, gchar *msg);
+		gchar *key, gchar *msg, gboolean coalesced);
+
+guint64 oio_events_queue_buffer_get_coalesced(
+		struct oio_events_queue_buffer_s *buf);
 
 /** Flush at most `max` events older than the configured delay. Each flushed
  *  event is passed to `send` then removed from the buffer. `send` is
@@ -47,10 +47,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 static void _q_destroy (struct oio_events_queue_s *self);
 static void _q_send (struct oio_events_queue_s *self, gchar *msg);
-static void _q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg);
+static void _q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced);
 static gboolean _q_is_stalled (struct oio_events_queue_s *self);
 static gint64 _q_get_health(struct oio_events_queue_s *self);
 
+static guint64 _q_get_coalesced(struct oio_events_queue_s *self);
 static void _q_set_buffering (struct oio_events_queue_s *self, gint64 v);
 static GError * _q_run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
@@ -63,6 +65,7 @@ static struct oio_events_queue_vtable_s vtable_FANOUT =
 	.is_stalled = _q_is_stalled,
 	.get_health = _q_get_health,
 	.set_buffering = _q_set_buffering,
+	.get_coalesced = _q_get_coalesced,
 	.run = _q_run
 };
 
@@ -134,6 +137,25 @@ _flush_buffered(struct oio_events_queue_s *self, struct _queue_FANOUT_s *q)
 	oio_events_queue_send_buffered(self, &q->buffer, MAX(1, avail / 2));
 }
 
+/* Each output is run by its own thread and has its own queue, so pushing
+ * an event never blocks the dispatch towards the other outputs. */
+static struct oio_events_queue_s *
+_pick_output(struct _queue_FANOUT_s *q, const char *msg, guint *next)
+{
+	guint32 h = 0;
+	if (oio_events_fanout_hash && oio_event__hash_container(msg, &h))
+		return q->output_tab[h % q->output_nb];
+
+	/* Round-robin among the outputs that are not stalled, so that a slow
+	 * endpoint gets less events instead of piling them up. */
+	for (guint i=0; i<q->output_nb ;++i) {
+		struct oio_events_queue_s *out = q->output_tab[(*next)++ % q->output_nb];
+		if (!oio_events_queue__is_stalled(out))
+			return out;
+	}
+	return q->output_tab[(*next)++ % q->output_nb];
+}
+
 static GError *
 _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 {
@@ -178,11 +200,10 @@ _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 		if (!msg)
 			continue;
 
-		/* forward the event as a beanstalkd job */
+		/* forward the event to one of the outputs */
 		if (*msg) {
-			struct oio_events_queue_s *out =
-				q->output_tab[ next_output++ % q->output_nb ];
-			oio_events_queue__send(out, msg);
+			struct oio_events_queue_s *out = _pick_output(q, msg, &next_output);
+			oio_events_queue_forward(out, msg);
 			msg = NULL;
 		}
 
@@ -229,10 +250,19 @@ _q_send (struct oio_events_queue_s *self, gchar *msg)
 }
 
 static void
-_q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg)
+_q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced)
+{
+	struct _queue_FANOUT_s *q = (struct _queue_FANOUT_s*) self;
+	oio_events_queue_buffer_put(&(q->buffer), key, msg, coalesced);
+}
+
+static guint64
+_q_get_coalesced(struct oio_events_queue_s *self)
 {
 	struct _queue_FANOUT_s *q = (struct _queue_FANOUT_s*) self;
-	oio_events_queue_buffer_put(&(q->buffer), key, msg);
+	EXTRA_ASSERT(q != NULL && q->vtable == &vtable_FANOUT);
+	return oio_events_queue_buffer_get_coalesced(&(q->buffer));
 }
 
 static gboolean
@@ -241,9 +271,19 @@ _q_is_stalled (struct oio_events_queue_s *self)
 	struct _queue_FANOUT_s *q = (struct _queue_FANOUT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_FANOUT);
 	const int l = g_async_queue_length (q->queue);
-	if (l <= 0)
-		return FALSE;
-	return ((guint)l) >= oio_events_common_max_pending;
+	if (l > 0 && ((guint)l) >= oio_events_common_max_pending)
+		return TRUE;
+
+	/* When hashing, the events of a stalled output cannot go elsewhere.
+	 * Otherwise, the other outputs take them. */
+	guint stalled = 0;
+	for (guint i=0; i<q->output_nb ;++i) {
+		if (oio_events_queue__is_stalled(q->output_tab[i]))
+			stalled ++;
+	}
+	if (oio_events_fanout_hash)
+		return stalled > 0;
+	return stalled >= q->output_nb;
 }
 
 static gint64
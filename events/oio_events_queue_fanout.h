@@ -20,7 +20,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 struct oio_events_queue_s;
 
-/* Spreads the events over multiple output queues. */
+/* Spreads the events over multiple output queues, each one run by its own
+ * thread. The events of a container either go to any output that is not
+ * stalled, or always to the same output (events.fanout.hash). */
 GError * oio_events_queue_factory__create_fanout (
 		struct oio_events_queue_s **subv, guint sublen,
 		struct oio_events_queue_s **out);
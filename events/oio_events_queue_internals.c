@@ -28,7 +28,7 @@ oio_events_queue_send_buffered(struct oio_events_queue_s *self,
 	guint sent = 0;
 	gboolean __send(gpointer key, gpointer msg, gpointer u UNUSED) {
 		g_free(key);
-		oio_events_queue__send(self, (gchar*)msg);
+		oio_events_queue_forward(self, (gchar*)msg);
 		sent++;
 		return TRUE;
 	}
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/internals.h>
 
 #include "oio_events_queue_buffer.h"
+#include "oio_events_queue_spill.h"
 
 struct oio_events_queue_s;
 
@@ -29,11 +30,12 @@ struct oio_events_queue_vtable_s
 	void (*destroy) (struct oio_events_queue_s *self);
 	void (*send) (struct oio_events_queue_s *self, gchar *msg);
 	void (*send_overwritable)(struct oio_events_queue_s *self,
-			gchar *key, gchar *msg);
+			gchar *key, gchar *msg, gboolean coalesced);
 	gboolean (*is_stalled) (struct oio_events_queue_s *self);
 	gint64 (*get_health) (struct oio_events_queue_s *self);
 	void (*set_max_pending) (struct oio_events_queue_s *self, guint v);
 	void (*set_buffering) (struct oio_events_queue_s *self, gint64 v);
+	guint64 (*get_coalesced) (struct oio_events_queue_s *self);
 	GError * (*run) (struct oio_events_queue_s *self, gboolean (*) (gboolean));
 };
 
@@ -45,4 +47,8 @@ struct oio_events_queue_abstract_s
 void oio_events_queue_send_buffered(struct oio_events_queue_s *self,
 		struct oio_events_queue_buffer_s *buffer, guint max);
 
+/* Sends the event as is, without any coalescing. For the events that have
+ * already been through the buffer of a queue, or of an upstream queue. */
+void oio_events_queue_forward(struct oio_events_queue_s *self, gchar *msg);
+
 #endif /*OIO_SDS__sqlx__oio_events_queue_internals_h*/
@@ -0,0 +1,347 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2017 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <glib.h>
+
+#include <core/oio_core.h>
+#include <core/internals.h>
+#include <events/events_variables.h>
+#include "oio_events_queue_spill.h"
+
+/* Each segment is a sequence of records, a record being the length of the
+ * event (32 bits, big endian) followed by the event itself. */
+#define SPILL_SUFFIX ".spill"
+
+/* A longer record denotes a corrupted segment */
+#define SPILL_RECORD_MAX (64 * 1024 * 1024)
+
+static void
+_segment_name(guint64 seq, gchar *dst, gsize len)
+{
+	g_snprintf(dst, len, "%016" G_GINT64_MODIFIER "X" SPILL_SUFFIX, seq);
+}
+
+static gboolean
+_spill_is_empty(struct oio_events_queue_spill_s *spill)
+{
+	return spill->rseq == spill->wseq && spill->roff >= spill->wsize;
+}
+
+/* Remove the segment being read. If it is also the segment being appended,
+ * the next append will start a new segment. */
+static void
+_spill_drop_head(struct oio_events_queue_spill_s *spill)
+{
+	gchar name[64];
+	struct stat st;
+
+	_segment_name(spill->rseq, name, sizeof(name));
+	if (0 == fstatat(spill->dirfd, name, &st, 0))
+		spill->total = MAX(0, spill->total - st.st_size);
+	if (0 != unlinkat(spill->dirfd, name, 0) && errno != ENOENT)
+		GRID_WARN("Failed to remove the events spill segment %s/%s: (%d) %s",
+				spill->dir, name, errno, strerror(errno));
+	if (spill->rfd >= 0)
+		close(spill->rfd);
+	spill->rfd = -1;
+
+	if (spill->rseq == spill->wseq) {
+		if (spill->wfd >= 0)
+			close(spill->wfd);
+		spill->wfd = -1;
+		spill->wseq ++;
+		spill->wsize = 0;
+	}
+	spill->rseq ++;
+	spill->roff = 0;
+}
+
+static GError *
+_spill_append(struct oio_events_queue_spill_s *spill, const gchar *msg)
+{
+	const gsize len = strlen(msg);
+	const gint64 reclen = sizeof(guint32) + len;
+
+	if (spill->total + reclen > oio_events_common_spill_max_size)
+		return BUSY("Events spill full (%" G_GINT64_FORMAT " bytes)",
+				spill->total);
+
+	if (spill->wfd >= 0 && spill->wsize > 0
+			&& spill->wsize + reclen > (gint64)oio_events_common_spill_segment_size) {
+		close(spill->wfd);
+		spill->wfd = -1;
+		spill->wseq ++;
+		spill->wsize = 0;
+	}
+
+	if (spill->wfd < 0) {
+		gchar name[64];
+		_segment_name(spill->wseq, name, sizeof(name));
+		spill->wfd = openat(spill->dirfd, name,
+				O_WRONLY|O_CREAT|O_TRUNC|O_APPEND|O_CLOEXEC, 0644);
+		if (spill->wfd < 0)
+			return SYSERR("open(%s/%s) failed: (%d) %s",
+					spill->dir, name, errno, strerror(errno));
+	}
+
+	guint32 hdr = GUINT32_TO_BE((guint32)len);
+	struct iovec iov[2] = {
+		{.iov_base = &hdr, .iov_len = sizeof(hdr)},
+		{.iov_base = (void*) msg, .iov_len = len},
+	};
+	const ssize_t w = writev(spill->wfd, iov, 2);
+	if (w != reclen) {
+		const int errsv = w < 0 ? errno : ENOSPC;
+		/* Never append after a partial record: the reader will drop the
+		 * end of this segment and continue with the next one. */
+		if (w > 0)
+			spill->total += w;
+		close(spill->wfd);
+		spill->wfd = -1;
+		spill->wseq ++;
+		spill->wsize = 0;
+		return SYSERR("write(%s) failed: (%d) %s",
+				spill->dir, errsv, strerror(errsv));
+	}
+
+	spill->wsize += reclen;
+	spill->total += reclen;
+	return NULL;
+}
+
+static gchar *
+_spill_read(struct oio_events_queue_spill_s *spill)
+{
+	while (!_spill_is_empty(spill)) {
+		gchar name[64];
+		_segment_name(spill->rseq, name, sizeof(name));
+
+		if (spill->rfd < 0) {
+			spill->rfd = openat(spill->dirfd, name, O_RDONLY|O_CLOEXEC);
+			if (spill->rfd < 0) {
+				if (errno != ENOENT)
+					GRID_WARN("open(%s/%s) failed: (%d) %s",
+							spill->dir, name, errno, strerror(errno));
+				_spill_drop_head(spill);
+				continue;
+			}
+		}
+
+		guint32 hdr = 0;
+		ssize_t r = pread(spill->rfd, &hdr, sizeof(hdr), spill->roff);
+		if (r == sizeof(hdr)) {
+			const guint32 len = GUINT32_FROM_BE(hdr);
+			if (len <= SPILL_RECORD_MAX) {
+				gchar *msg = g_malloc(len + 1);
+				r = pread(spill->rfd, msg, len, spill->roff + sizeof(hdr));
+				if (r == (ssize_t)len) {
+					msg[len] = '\0';
+					spill->roff += sizeof(hdr) + len;
+					return msg;
+				}
+				g_free(msg);
+			}
+		}
+
+		/* A clean end of segment is only expected on a segment that is not
+		 * appended anymore. Anything else is a partial or corrupted record,
+		 * and the remainder of the segment cannot be trusted. */
+		if (r != 0 || spill->rseq == spill->wseq)
+			GRID_WARN("Events spill segment %s/%s truncated at offset %"
+					G_GINT64_FORMAT, spill->dir, name, spill->roff);
+		_spill_drop_head(spill);
+	}
+	return NULL;
+}
+
+void
+oio_events_queue_spill_init(struct oio_events_queue_spill_s *spill)
+{
+	memset(spill, 0, sizeof(*spill));
+	g_mutex_init(&(spill->lock));
+	spill->dirfd = spill->rfd = spill->wfd = -1;
+	spill->rseq = spill->wseq = 1;
+}
+
+void
+oio_events_queue_spill_clean(struct oio_events_queue_spill_s *spill)
+{
+	if (spill->rfd >= 0)
+		close(spill->rfd);
+	if (spill->wfd >= 0)
+		close(spill->wfd);
+	/* Also releases the lock on the directory */
+	if (spill->dirfd >= 0)
+		close(spill->dirfd);
+	spill->dirfd = spill->rfd = spill->wfd = -1;
+	oio_str_clean(&(spill->dir));
+	g_mutex_clear(&(spill->lock));
+}
+
+GError *
+oio_events_queue_spill_open(struct oio_events_queue_spill_s *spill,
+		const char *name)
+{
+	EXTRA_ASSERT(spill->dir == NULL);
+	if (!oio_str_is_set(oio_events_common_spill_dir))
+		return NULL;
+
+	gchar *sane = g_strdup(name);
+	for (gchar *p = sane; *p; ++p) {
+		if (!g_ascii_isalnum(*p) && *p != '.' && *p != '-')
+			*p = '_';
+	}
+	gchar *dir = g_build_filename(oio_events_common_spill_dir, sane, NULL);
+	g_free(sane);
+
+	GError *err = NULL;
+	int fd = -1;
+	if (0 != g_mkdir_with_parents(dir, 0755)) {
+		err = SYSERR("mkdir(%s) failed: (%d) %s", dir, errno, strerror(errno));
+	} else if (0 > (fd = open(dir, O_RDONLY|O_DIRECTORY|O_CLOEXEC))) {
+		err = SYSERR("open(%s) failed: (%d) %s", dir, errno, strerror(errno));
+	} else if (0 != flock(fd, LOCK_EX|LOCK_NB)) {
+		err = BUSY("Events spill %s already in use: (%d) %s",
+				dir, errno, strerror(errno));
+	}
+	if (err) {
+		if (fd >= 0)
+			close(fd);
+		g_free(dir);
+		return err;
+	}
+
+	/* Look for the segments left by a previous process */
+	guint64 first = G_MAXUINT64, last = 0;
+	gint64 total = 0;
+	GDir *gdir = g_dir_open(dir, 0, NULL);
+	if (gdir) {
+		const gchar *bn;
+		while ((bn = g_dir_read_name(gdir))) {
+			gchar *end = NULL;
+			const guint64 seq = g_ascii_strtoull(bn, &end, 16);
+			if (!seq || !end || strcmp(end, SPILL_SUFFIX))
+				continue;
+			struct stat st;
+			if (0 == fstatat(fd, bn, &st, 0))
+				total += st.st_size;
+			first = MIN(first, seq);
+			last = MAX(last, seq);
+		}
+		g_dir_close(gdir);
+	}
+
+	spill->dir = dir;
+	spill->dirfd = fd;
+	spill->total = total;
+	if (last > 0) {
+		/* The last segment may end with a partial record, never append to
+		 * it. */
+		spill->rseq = first;
+		spill->wseq = last + 1;
+		spill->spilling = TRUE;
+		GRID_NOTICE("Events spill %s: %" G_GINT64_FORMAT " bytes to replay",
+				dir, total);
+	}
+	return NULL;
+}
+
+void
+oio_events_queue_spill_push(struct oio_events_queue_spill_s *spill,
+		GAsyncQueue *queue, gchar *msg)
+{
+	if (!spill->dir) {
+		g_async_queue_push(queue, msg);
+		return;
+	}
+
+	g_mutex_lock(&(spill->lock));
+	if (_spill_is_empty(spill)
+			&& g_async_queue_length(queue) < (gint)oio_events_common_spill_watermark) {
+		g_async_queue_push(queue, msg);
+	} else {
+		GError *err = _spill_append(spill, msg);
+		if (!err) {
+			if (!spill->spilling) {
+				spill->spilling = TRUE;
+				GRID_NOTICE("Events queue over its watermark, spilling in %s",
+						spill->dir);
+			}
+			g_free(msg);
+		} else {
+			/* The order of the events is lost, but not the event itself.
+			 * The queue will soon report it is stalled. */
+			const gint64 now = oio_ext_monotonic_time();
+			if (now - spill->last_warn > G_TIME_SPAN_SECOND) {
+				spill->last_warn = now;
+				GRID_WARN("Events spill %s failed: (%d) %s",
+						spill->dir, err->code, err->message);
+			}
+			g_clear_error(&err);
+			g_async_queue_push(queue, msg);
+		}
+	}
+	g_mutex_unlock(&(spill->lock));
+}
+
+guint
+oio_events_queue_spill_replay(struct oio_events_queue_spill_s *spill,
+		GAsyncQueue *queue)
+{
+	if (!spill->dir)
+		return 0;
+
+	const gint low = oio_events_common_spill_watermark / 2;
+	guint count = 0;
+
+	g_mutex_lock(&(spill->lock));
+	while (g_async_queue_length(queue) <= low) {
+		gchar *msg = _spill_read(spill);
+		if (!msg)
+			break;
+		g_async_queue_push(queue, msg);
+		count ++;
+	}
+	if (_spill_is_empty(spill)) {
+		if (spill->wsize > 0)
+			_spill_drop_head(spill);
+		if (spill->spilling) {
+			spill->spilling = FALSE;
+			GRID_NOTICE("Events spill %s fully replayed", spill->dir);
+		}
+	}
+	g_mutex_unlock(&(spill->lock));
+	return count;
+}
+
+gint64
+oio_events_queue_spill_size(struct oio_events_queue_spill_s *spill)
+{
+	g_mutex_lock(&(spill->lock));
+	const gint64 total = spill->total;
+	g_mutex_unlock(&(spill->lock));
+	return total;
+}
@@ -0,0 +1,78 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2017 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OIO_SDS__sqlx__oio_events_queue_spill_h
+# define OIO_SDS__sqlx__oio_events_queue_spill_h 1
+
+#include <glib.h>
+
+/* Overflow of an events queue on the local disk. Once the in-RAM queue holds
+ * more than `events.common.spill.watermark` events, the new events are
+ * appended to a sequence of segment files instead, and they are replayed in
+ * the in-RAM queue, in order, as soon as it drains. The segments left at
+ * exit are replayed by the next process opening the same directory. */
+struct oio_events_queue_spill_s
+{
+	GMutex lock;
+
+	/* NULL when the spill is disabled */
+	gchar *dir;
+	int dirfd;
+
+	/* The segment being read, and the position of the next record */
+	guint64 rseq;
+	int rfd;
+	gint64 roff;
+
+	/* The segment being appended */
+	guint64 wseq;
+	int wfd;
+	gint64 wsize;
+
+	/* Sum of the sizes of all the segments present in the directory */
+	gint64 total;
+
+	/* Set while events are on the disk, to log the transitions only */
+	gboolean spilling;
+	gint64 last_warn;
+};
+
+void oio_events_queue_spill_init(struct oio_events_queue_spill_s *spill);
+void oio_events_queue_spill_clean(struct oio_events_queue_spill_s *spill);
+
+/** Enable the spill in a subdirectory of `events.common.spill.dir` named
+ *  after `name`. Does nothing if that variable is empty. The directory is
+ *  locked for the life of the queue, so two queues cannot share it. */
+GError * oio_events_queue_spill_open(struct oio_events_queue_spill_s *spill,
+		const char *name);
+
+/** Push `msg` in `queue`, or append it to the spill if the queue reached its
+ *  watermark or if older events are still on the disk. Takes the ownership
+ *  of `msg`. */
+void oio_events_queue_spill_push(struct oio_events_queue_spill_s *spill,
+		GAsyncQueue *queue, gchar *msg);
+
+/** Move the oldest events from the disk to `queue`, until the queue reaches
+ *  half its watermark. Returns how many events have been moved. */
+guint oio_events_queue_spill_replay(struct oio_events_queue_spill_s *spill,
+		GAsyncQueue *queue);
+
+/** How many bytes of events are currently stored on the disk. */
+gint64 oio_events_queue_spill_size(struct oio_events_queue_spill_s *spill);
+
+#endif /*OIO_SDS__sqlx__oio_events_queue_spill_h*/
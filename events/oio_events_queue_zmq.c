@@ -43,14 +43,34 @@ struct event_s
 
 	/* and then the payload */
 	guint16 size;
+	guint8 klass; /* size class in the slab, 0 if not recyclable */
 	gint64 last_sent;
+
+	/* links in the queue of pending events, by order of last_sent */
+	struct event_s *prev;
+	struct event_s *next;
+
 	guint8 message[];
 };
 
+/* Recycles the event_s of the ZMQ2AGENT thread, by classes of sizes, so
+ * that the events flow does not cost a malloc/free per event. */
+#define SLAB_CLASS_MIN  9  /* 512 bytes */
+#define SLAB_CLASS_MAX  17 /* 128kiB, beyond the max size of a message */
+#define SLAB_CLASS_KEEP 256
+
+struct event_slab_s
+{
+	struct event_s *free[SLAB_CLASS_MAX + 1];
+	guint count[SLAB_CLASS_MAX + 1];
+};
+
 static void _q_destroy (struct oio_events_queue_s *self);
 static void _q_send (struct oio_events_queue_s *self, gchar *msg);
-static void _q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg);
+static void _q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced);
 static gboolean _q_is_stalled (struct oio_events_queue_s *self);
+static guint64 _q_get_coalesced(struct oio_events_queue_s *self);
 static void _q_set_buffering(struct oio_events_queue_s *self, gint64 v);
 static GError * _q_run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
@@ -62,6 +82,7 @@ static struct oio_events_queue_vtable_s vtable_AGENT =
 	.send_overwritable = _q_send_overwritable,
 	.is_stalled = _q_is_stalled,
 	.set_buffering = _q_set_buffering,
+	.get_coalesced = _q_get_coalesced,
 	.run = _q_run
 };
 
@@ -98,11 +119,18 @@ struct _queue_AGENT_s
 	guint64 counter_ack_notfound;
 
 	struct oio_events_queue_buffer_s buffer;
+	struct oio_events_queue_spill_s spill;
 };
 
 struct _zmq2agent_ctx_s
 {
-	GList *pending_events;
+	/* The events waiting for an ACK, indexed by their unique header, and
+	 * queued from the least to the most recently sent. */
+	GHashTable *pending_index;
+	struct event_s *pending_head;
+	struct event_s *pending_tail;
+	struct event_slab_s slab;
+
 	struct _queue_AGENT_s *q;
 	const guint32 r;
 	void *zpull;
@@ -134,6 +162,14 @@ oio_events_queue_factory__create_zmq (const char *zurl,
 	self->max_recv_per_round = 32;
 	self->procid = getpid();
 	oio_events_queue_buffer_init(&(self->buffer));
+	oio_events_queue_spill_init(&(self->spill));
+
+	GError *err = oio_events_queue_spill_open(&(self->spill), self->url);
+	if (err) {
+		_q_destroy((struct oio_events_queue_s *) self);
+		return err;
+	}
+
 	*out = (struct oio_events_queue_s *) self;
 	return NULL;
 }
@@ -155,6 +191,7 @@ _q_destroy (struct oio_events_queue_s *self)
 	g_async_queue_unref (q->queue);
 	oio_str_clean (&q->url);
 	oio_events_queue_buffer_clean(&(q->buffer));
+	oio_events_queue_spill_clean(&(q->spill));
 	g_free (q);
 }
 
@@ -163,14 +200,23 @@ _q_send (struct oio_events_queue_s *self, gchar *msg)
 {
 	struct _queue_AGENT_s *q = (struct _queue_AGENT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
-	g_async_queue_push (q->queue, msg);
+	oio_events_queue_spill_push(&(q->spill), q->queue, msg);
 }
 
 	static void
-_q_send_overwritable(struct oio_events_queue_s *self, gchar *key, gchar *msg)
+_q_send_overwritable(struct oio_events_queue_s *self,
+		gchar *key, gchar *msg, gboolean coalesced)
 {
 	struct _queue_AGENT_s *q = (struct _queue_AGENT_s*) self;
-	oio_events_queue_buffer_put(&(q->buffer), key, msg);
+	oio_events_queue_buffer_put(&(q->buffer), key, msg, coalesced);
+}
+
+static guint64
+_q_get_coalesced(struct oio_events_queue_s *self)
+{
+	struct _queue_AGENT_s *q = (struct _queue_AGENT_s*) self;
+	EXTRA_ASSERT(q != NULL && q->vtable == &vtable_AGENT);
+	return oio_events_queue_buffer_get_coalesced(&(q->buffer));
 }
 
 static gboolean
@@ -187,6 +233,112 @@ _q_is_stalled (struct oio_events_queue_s *self)
 
 #define more ZMQ_SNDMORE|ZMQ_MORE
 
+static struct event_s *
+_slab_alloc (struct event_slab_s *slab, gsize len)
+{
+	const gsize total = sizeof(struct event_s) + len;
+	guint8 klass = SLAB_CLASS_MIN;
+	while (klass <= SLAB_CLASS_MAX && (1UL << klass) < total)
+		klass ++;
+
+	struct event_s *evt;
+	if (klass > SLAB_CLASS_MAX) {
+		klass = 0;
+		evt = g_malloc(total);
+	} else if ((evt = slab->free[klass])) {
+		slab->free[klass] = evt->next;
+		slab->count[klass] --;
+	} else {
+		evt = g_malloc(1UL << klass);
+	}
+	evt->klass = klass;
+	evt->prev = evt->next = NULL;
+	return evt;
+}
+
+static void
+_slab_free (struct event_slab_s *slab, struct event_s *evt)
+{
+	const guint8 klass = evt->klass;
+	if (!klass || slab->count[klass] >= SLAB_CLASS_KEEP) {
+		g_free(evt);
+	} else {
+		evt->next = slab->free[klass];
+		slab->free[klass] = evt;
+		slab->count[klass] ++;
+	}
+}
+
+static void
+_slab_clean (struct event_slab_s *slab)
+{
+	for (guint i=0; i<=SLAB_CLASS_MAX ;++i) {
+		while (slab->free[i]) {
+			struct event_s *evt = slab->free[i];
+			slab->free[i] = evt->next;
+			g_free(evt);
+		}
+		slab->count[i] = 0;
+	}
+}
+
+/* The header is the unique key of the event */
+static guint
+_evt_hash (gconstpointer k)
+{
+	const guint8 *b = k;
+	guint h = 5381;
+	for (guint i=0; i<HEADER_SIZE ;++i)
+		h = ((h << 5) + h) ^ b[i];
+	return h;
+}
+
+static gboolean
+_evt_equal (gconstpointer k0, gconstpointer k1)
+{
+	return 0 == memcmp(k0, k1, HEADER_SIZE);
+}
+
+static void
+_pending_unlink (struct _zmq2agent_ctx_s *ctx, struct event_s *evt)
+{
+	if (evt->prev)
+		evt->prev->next = evt->next;
+	else
+		ctx->pending_head = evt->next;
+	if (evt->next)
+		evt->next->prev = evt->prev;
+	else
+		ctx->pending_tail = evt->prev;
+	evt->prev = evt->next = NULL;
+}
+
+static void
+_pending_push (struct _zmq2agent_ctx_s *ctx, struct event_s *evt)
+{
+	evt->next = NULL;
+	evt->prev = ctx->pending_tail;
+	if (ctx->pending_tail)
+		ctx->pending_tail->next = evt;
+	else
+		ctx->pending_head = evt;
+	ctx->pending_tail = evt;
+}
+
+static void
+_pending_clean (struct _zmq2agent_ctx_s *ctx)
+{
+	while (ctx->pending_head) {
+		struct event_s *evt = ctx->pending_head;
+		_pending_unlink(ctx, evt);
+		g_free(evt);
+	}
+	if (ctx->pending_index)
+		g_hash_table_destroy(ctx->pending_index);
+	ctx->pending_index = NULL;
+	_slab_clean(&ctx->slab);
+}
+
 static gboolean
 _zmq2agent_send_event (time_t now, struct _zmq2agent_ctx_s  *ctx,
 		struct event_s *evt, const char *dbg)
@@ -228,7 +380,7 @@ _zmq2agent_manage_event (guint32 r, struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg
 	if (!ctx->zagent) return TRUE;
 
 	const size_t len = zmq_msg_size(msg);
-	struct event_s *evt = g_malloc (sizeof(struct event_s) + len);
+	struct event_s *evt = _slab_alloc (&ctx->slab, len);
 	memcpy (evt->message, zmq_msg_data(msg), len);
 	evt->last_sent = now;
 	evt->rand = r;
@@ -237,7 +389,8 @@ _zmq2agent_manage_event (guint32 r, struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg
 	evt->size = len;
 	evt->recv_time = evt->last_sent;
 
-	ctx->pending_events = g_list_prepend (ctx->pending_events, evt);
+	g_hash_table_add (ctx->pending_index, evt);
+	_pending_push (ctx, evt);
 	ctx->q->gauge_pending ++;
 
 	gchar strid[1+ 2*HEADER_SIZE];
@@ -248,13 +401,6 @@ _zmq2agent_manage_event (guint32 r, struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg
 	return _zmq2agent_send_event (now, ctx, evt, strid);
 }
 
-static gint
-_cmp (gconstpointer a, gconstpointer b)
-{
-	const struct event_s *e0 = a, *e1 = b;
-	return memcmp(e0, e1, HEADER_SIZE);
-}
-
 static void
 _zmq2agent_manage_ack (struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg)
 {
@@ -265,14 +411,15 @@ _zmq2agent_manage_ack (struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg)
 	void *d = zmq_msg_data (msg);
 	oio_str_bin2hex(d, HEADER_SIZE, strid, sizeof(strid));
 
-	GList *li = g_list_find_custom (ctx->pending_events, d, _cmp);
-	if (!li) {
+	struct event_s *evt = g_hash_table_lookup (ctx->pending_index, d);
+	if (!evt) {
 		GRID_INFO("EVT:OUT %s", strid);
 		++ ctx->q->counter_ack_notfound;
 	} else {
 		GRID_DEBUG("EVT:ACK %s", strid);
-		ctx->pending_events = g_list_remove_link (ctx->pending_events, li);
-		g_list_free_full (li, g_free);
+		g_hash_table_remove (ctx->pending_index, evt);
+		_pending_unlink (ctx, evt);
+		_slab_free (&ctx->slab, evt);
 		-- ctx->q->gauge_pending;
 		++ ctx->q->counter_ack;
 	}
@@ -285,13 +432,18 @@ _retry_events (struct _zmq2agent_ctx_s *ctx)
 	const time_t now = oio_ext_monotonic_seconds ();
 	const time_t oldest = now > 5 ? now - 5 : 0;
 
-	for (GList *l=g_list_last(ctx->pending_events); l ;l=l->prev) {
-		struct event_s *evt = l->data;
-		if (evt->last_sent < oldest) {
-			oio_str_bin2hex(evt, HEADER_SIZE, strid, sizeof(strid));
-			if (!_zmq2agent_send_event (now, ctx, evt, strid))
-				break;
+	/* The queue is ordered by last_sent, only its head may be resent */
+	struct event_s *evt;
+	while ((evt = ctx->pending_head) && evt->last_sent < oldest) {
+		oio_str_bin2hex(evt, HEADER_SIZE, strid, sizeof(strid));
+		const gboolean sent = _zmq2agent_send_event (now, ctx, evt, strid);
+		/* keep the order, even if the attempt failed */
+		if (evt->last_sent >= oldest) {
+			_pending_unlink (ctx, evt);
+			_pending_push (ctx, evt);
 		}
+		if (!sent)
+			break;
 	}
 }
 
@@ -415,6 +567,7 @@ _gq2zmq_worker (struct _gq2zmq_ctx_s *ctx)
 					&(ctx->q->buffer), MAX(1, max));
 			last_flush = now;
 		}
+		oio_events_queue_spill_replay(&(q->spill), ctx->queue);
 		gchar *tmp =
 			(gchar*) g_async_queue_timeout_pop (ctx->queue, G_TIME_SPAN_SECOND);
 		if (tmp && !_forward_event (ctx->zpush, tmp))
@@ -506,13 +659,14 @@ _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 
 	/* Runs the events worker */
 	zmq2agent.q = q;
+	zmq2agent.pending_index = g_hash_table_new (_evt_hash, _evt_equal);
 	zmq2agent.zpull = zpull;
 	zmq2agent.zagent = zagent;
 	_zmq2agent_worker (&zmq2agent);
 
 exit:
 	if (th_gq2zmq) g_thread_join (th_gq2zmq);
-	if (zmq2agent.pending_events) g_list_free_full (zmq2agent.pending_events, g_free);
+	_pending_clean (&zmq2agent);
 	if (zagent) zmq_close (zagent);
 	if (zpull) zmq_close (zpull);
 	if (zpush) zmq_close (zpush);
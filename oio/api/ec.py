@@ -26,7 +26,7 @@ from oio.common import exceptions
 from oio.common.exceptions import SourceReadError
 from oio.common.http import HeadersDict, parse_content_range, \
     ranges_from_http_header, headers_from_object_metadata
-from oio.common.utils import fix_ranges
+from oio.common.utils import fix_ranges, get_hasher
 from oio.api import io
 from oio.common.constants import CHUNK_HEADERS
 from oio.common import green
@@ -536,7 +536,7 @@ class EcChunkWriter(object):
         self.failed = False
         self.bytes_transferred = 0
         if chunk_checksum_algo:
-            self.checksum = hashlib.new(chunk_checksum_algo)
+            self.checksum = get_hasher(chunk_checksum_algo)
         else:
             self.checksum = None
         self.write_timeout = write_timeout or io.CHUNK_TIMEOUT
@@ -570,6 +570,8 @@ class EcChunkWriter(object):
                     CHUNK_HEADERS["metachunk_hash"])
         if kwargs.get('chunk_checksum_algo'):
             trailers = trailers + (CHUNK_HEADERS["chunk_hash"], )
+            hdrs[CHUNK_HEADERS["chunk_hash_algo"]] = \
+                kwargs['chunk_checksum_algo']
         hdrs["Trailer"] = ', '.join(trailers)
         with green.ConnectionTimeout(
                 connection_timeout or io.CONNECTION_TIMEOUT):
@@ -657,7 +659,7 @@ class EcMetachunkWriter(io.MetachunkWriter):
         self.global_checksum = global_checksum
         # Unlike plain replication, we cannot use the checksum returned
         # by rawx services, whe have to compute the checksum client-side.
-        self.checksum = hashlib.new(self.chunk_checksum_algo or 'md5')
+        self.checksum = get_hasher(self.chunk_checksum_algo)
         self.reqid = reqid
         self.connection_timeout = connection_timeout or io.CONNECTION_TIMEOUT
         self.write_timeout = write_timeout or io.CHUNK_TIMEOUT
@@ -25,6 +25,7 @@ from oio.common.exceptions import SourceReadError
 from oio.common.http import headers_from_object_metadata
 from oio.api import io
 from oio.common.constants import CHUNK_HEADERS
+from oio.common.utils import get_hasher
 from oio.common import green
 
 logger = logging.getLogger(__name__)
@@ -62,7 +63,7 @@ class ReplicatedMetachunkWriter(io.MetachunkWriter):
         bytes_transferred = 0
         meta_chunk = self.meta_chunk
         if self.chunk_checksum_algo:
-            meta_checksum = hashlib.new(self.chunk_checksum_algo)
+            meta_checksum = get_hasher(self.chunk_checksum_algo)
         else:
             meta_checksum = None
         pile = GreenPile(len(meta_chunk))
@@ -173,6 +174,10 @@ class ReplicatedMetachunkWriter(io.MetachunkWriter):
             hdrs = headers_from_object_metadata(self.sysmeta)
             hdrs[CHUNK_HEADERS["chunk_pos"]] = chunk["pos"]
             hdrs[CHUNK_HEADERS["chunk_id"]] = chunk_path
+            if self.chunk_checksum_algo:
+                # Let the rawx compute the same hash as us
+                hdrs[CHUNK_HEADERS["chunk_hash_algo"]] = \
+                    self.chunk_checksum_algo
             hdrs.update(self.headers)
 
             with green.ConnectionTimeout(self.connection_timeout):
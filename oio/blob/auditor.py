@@ -18,14 +18,13 @@ from oio.common.green import ratelimit
 
 from contextlib import closing
 from string import hexdigits
-import hashlib
 import time
 
 from oio.blob.utils import check_volume, read_chunk_metadata
 from oio.container.client import ContainerClient
 from oio.common.daemon import Daemon
 from oio.common import exceptions as exc
-from oio.common.utils import paths_gen
+from oio.common.utils import paths_gen, get_hasher
 from oio.common.easy_value import int_value
 from oio.common.logger import get_logger
 from oio.common.constants import STRLEN_CHUNKID
@@ -178,8 +177,9 @@ class BlobAuditorWorker(object):
                 raise exc.FaultyChunk(
                     'Missing extended attribute %s' % e)
             size = int(meta['chunk_size'])
-            md5_checksum = meta['chunk_hash'].lower()
-            reader = ChunkReader(f, size, md5_checksum)
+            checksum = meta['chunk_hash'].lower()
+            reader = ChunkReader(f, size, checksum,
+                                 meta.get('chunk_hash_algo'))
             with closing(reader):
                 for buf in reader:
                     buf_len = len(buf)
@@ -250,19 +250,20 @@ class BlobAuditor(Daemon):
 
 
 class ChunkReader(object):
-    def __init__(self, fp, size, md5_checksum):
+    def __init__(self, fp, size, checksum, hash_algo=None):
         self.fp = fp
         self.size = size
-        self.md5_checksum = md5_checksum
+        self.checksum = checksum
+        self.hash_algo = hash_algo
         self.bytes_read = 0
-        self.iter_md5 = None
+        self.iter_checksum = None
 
     def __iter__(self):
-        self.iter_md5 = hashlib.md5()
+        self.iter_checksum = get_hasher(self.hash_algo)
         while True:
             buf = self.fp.read()
             if buf:
-                self.iter_md5.update(buf)
+                self.iter_checksum.update(buf)
                 self.bytes_read += len(buf)
                 yield buf
             else:
@@ -270,11 +271,11 @@ class ChunkReader(object):
 
     def close(self):
         if self.fp:
-            self.md5_read = self.iter_md5.hexdigest()
+            checksum_read = self.iter_checksum.hexdigest()
             if self.bytes_read != self.size:
                 raise exc.FaultyChunk('Invalid size for chunk')
 
-            if self.md5_read != self.md5_checksum:
+            if checksum_read != self.checksum:
                 raise exc.CorruptedChunk(
                     'checksum does not match %s != %s'
-                    % (self.md5_read, self.md5_checksum))
+                    % (checksum_read, self.checksum))
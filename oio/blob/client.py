@@ -88,9 +88,11 @@ class BlobClient(object):
         storage_method = STORAGE_METHODS.load(chunk_method)
         checksum = meta['metachunk_hash' if storage_method.ec
                         else 'chunk_hash']
+        # The chunks without algorithm were hashed with MD5
         writer = ReplicatedMetachunkWriter(
             meta, [chunk], FakeChecksum(checksum),
-            storage_method, quorum=1)
+            storage_method, quorum=1,
+            chunk_checksum_algo=meta.get('chunk_hash_algo') or 'md5')
         writer.stream(data, None)
 
     @update_rawx_perfdata
@@ -24,7 +24,8 @@ from datetime import datetime
 from collections import OrderedDict
 
 from oio.common.constants import chunk_xattr_keys, OIO_VERSION, \
-    STRLEN_CHUNKID
+    STRLEN_CHUNKID, CHUNK_XATTR_CONTENT_FULLPATH_PREFIX, \
+    CHUNK_XATTR_PACKED_PREFIX
 from oio.common.utils import cid_from_name, paths_gen
 from oio.common.fullpath import decode_fullpath, decode_old_fullpath, \
     encode_fullpath
@@ -35,7 +36,8 @@ from oio.common.logger import get_logger
 from oio.common.easy_value import int_value, is_hexa, true_value
 from oio.container.client import ContainerClient
 from oio.content.factory import ContentFactory
-from oio.blob.utils import read_chunk_metadata, check_volume
+from oio.blob.utils import read_chunk_metadata, check_volume, \
+    decode_packed_xattr
 
 
 XATTR_CHUNK_ID = chunk_xattr_keys['chunk_id']
@@ -258,6 +260,7 @@ class BlobConverter(object):
     def convert_chunk(self, fd, chunk_id):
         meta, raw_meta = read_chunk_metadata(fd, chunk_id,
                                              check_chunk_id=False)
+        unpacked = self._unpack_xattr(raw_meta, chunk_id)
 
         links = meta.get('links', dict())
         for chunk_id2, fullpath2 in links.iteritems():
@@ -358,9 +361,28 @@ class BlobConverter(object):
                 str(new_fullpaths), str(xattr_to_remove))
         else:
             # for security, if there is an error, we don't delete old xattr
-            modify_xattr(fd, new_fullpaths, success, xattr_to_remove)
+            modify_xattr(fd, new_fullpaths, success, xattr_to_remove,
+                         unpacked=unpacked)
         return success, None
 
+    def _unpack_xattr(self, raw_meta, chunk_id):
+        """
+        Decode the xattr packed by the rawx, as read_chunk_metadata() does:
+        all the attributes of the chunk itself, only the fullpath of its
+        links.
+        """
+        unpacked = dict()
+        for k, v in raw_meta.iteritems():
+            if not k.startswith(CHUNK_XATTR_PACKED_PREFIX):
+                continue
+            packed_id = k[len(CHUNK_XATTR_PACKED_PREFIX):]
+            attrs = decode_packed_xattr(v, packed_id)
+            if packed_id != chunk_id.upper():
+                attrs = {f: p for f, p in attrs.items()
+                         if f.startswith(CHUNK_XATTR_CONTENT_FULLPATH_PREFIX)}
+            unpacked[k] = attrs
+        return unpacked
+
     def safe_convert_chunk(self, path, fd=None, chunk_id=None):
         if chunk_id is None:
             chunk_id = path.rsplit('/', 1)[-1]
@@ -13,11 +13,13 @@
 # You should have received a copy of the GNU Affero General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import struct
 
 from oio.common import exceptions as exc
 from oio.common.xattr import read_user_xattr
 from oio.common.constants import chunk_xattr_keys, chunk_xattr_keys_optional, \
-    volume_xattr_keys, CHUNK_XATTR_CONTENT_FULLPATH_PREFIX
+    volume_xattr_keys, CHUNK_XATTR_CONTENT_FULLPATH_PREFIX, \
+    CHUNK_XATTR_PACKED_PREFIX
 from oio.common.fullpath import decode_fullpath
 from oio.common.utils import cid_from_name
 
@@ -64,9 +66,66 @@ def check_volume_for_service_type(volume_path, required_type):
     return namespace, server_id
 
 
+# Tags of the packed xattr, mapped to the names of the legacy xattr
+PACKED_FULLPATH = 1
+packed_xattr_keys = {
+    PACKED_FULLPATH: None,
+    2: 'grid.content.size',
+    3: 'grid.content.nbchunk',
+    4: 'grid.content.storage_policy',
+    5: 'grid.content.chunk_method',
+    6: 'grid.content.mime_type',
+    7: 'grid.metachunk.size',
+    8: 'grid.metachunk.hash',
+    9: 'grid.chunk.size',
+    10: 'grid.chunk.hash',
+    11: 'grid.chunk.position',
+    12: 'grid.compression.metadata',
+    13: 'grid.compression.size',
+    14: 'grid.oio.version',
+    15: 'grid.chunk.hash_algo',
+}
+
+
+def decode_packed_xattr(packed, chunk_id):
+    """
+    Decode the attributes of the chunk `chunk_id` packed in a single
+    xattr by the rawx, as if they had been read from the legacy layout.
+    """
+    if not packed or ord(packed[0]) != 1:
+        raise exc.FaultyChunk('Invalid packed xattr version')
+    meta = {}
+    i = 1
+    while i < len(packed):
+        if i + 3 > len(packed):
+            raise exc.FaultyChunk('Truncated packed xattr')
+        tag, length = struct.unpack_from('>BH', packed, i)
+        i += 3
+        if i + length > len(packed):
+            raise exc.FaultyChunk('Truncated packed xattr')
+        value = packed[i:i+length]
+        i += length
+        if tag == PACKED_FULLPATH:
+            meta[CHUNK_XATTR_CONTENT_FULLPATH_PREFIX + chunk_id] = value
+        elif tag in packed_xattr_keys:
+            meta[packed_xattr_keys[tag]] = value
+    return meta
+
+
 def read_chunk_metadata(fd, chunk_id, check_chunk_id=True):
     chunk_id = chunk_id.upper()
     raw_meta = read_user_xattr(fd)
+    for k, v in raw_meta.items():
+        if k.startswith(CHUNK_XATTR_PACKED_PREFIX):
+            packed_id = k[len(CHUNK_XATTR_PACKED_PREFIX):]
+            packed = decode_packed_xattr(v, packed_id)
+            # Only the fullpath of the other chunks (links) matters
+            if packed_id == chunk_id:
+                raw_meta.update(packed)
+            else:
+                raw_meta.update({f: p for f, p in packed.items()
+                                 if f.startswith(
+                                     CHUNK_XATTR_CONTENT_FULLPATH_PREFIX)})
     raw_meta_copy = None
     meta = {}
     meta['links'] = dict()
@@ -69,6 +69,7 @@ CHUNK_HEADERS = {
     "container_id": "%scontainer-id" % CHUNK_METADATA_PREFIX,
     "chunk_id": "%schunk-id" % CHUNK_METADATA_PREFIX,
     "chunk_hash": "%schunk-hash" % CHUNK_METADATA_PREFIX,
+    "chunk_hash_algo": "%schunk-hash-algo" % CHUNK_METADATA_PREFIX,
     "chunk_size": "%schunk-size" % CHUNK_METADATA_PREFIX,
     "chunk_pos": "%schunk-pos" % CHUNK_METADATA_PREFIX,
     "content_id": "%scontent-id" % CHUNK_METADATA_PREFIX,
@@ -86,6 +87,7 @@ chunk_headers = CHUNK_HEADERS
 
 chunk_xattr_keys = {
     'chunk_hash': 'grid.chunk.hash',
+    'chunk_hash_algo': 'grid.chunk.hash_algo',
     'chunk_id': 'grid.chunk.id',
     'chunk_pos': 'grid.chunk.position',
     'chunk_size': 'grid.chunk.size',
@@ -102,9 +104,14 @@ chunk_xattr_keys = {
 
 CHUNK_XATTR_CONTENT_FULLPATH_PREFIX = 'oio.content.fullpath:'
 
+# All the attributes of a chunk packed in a single xattr, see
+# rawx-lib/src/attr_handler.c for the format.
+CHUNK_XATTR_PACKED_PREFIX = 'oio.packed:'
+
 chunk_xattr_keys_optional = {
         'content_chunksnb': True,
         'chunk_hash': True,
+        'chunk_hash_algo': True,
         'chunk_size': True,
         'metachunk_size': True,
         'metachunk_hash': True,
@@ -17,6 +17,7 @@ import os
 import grp
 import pwd
 import fcntl
+import hashlib
 from hashlib import sha256
 from random import getrandbits
 from io import RawIOBase
@@ -153,6 +154,22 @@ def cid_from_name(account, ref):
     return h.hexdigest().upper()
 
 
+def get_hasher(algo='md5'):
+    """
+    Get a hashlib-like object computing a chunk hash with `algo`,
+    one of the algorithms known by the rawx services.
+    xxh64 requires the `xxhash` module.
+    """
+    algo = (algo or 'md5').lower()
+    if algo == 'xxh64':
+        try:
+            import xxhash
+        except ImportError:
+            raise OioException('xxh64 chunk hashes require the xxhash module')
+        return xxhash.xxh64()
+    return hashlib.new(algo)
+
+
 def fix_ranges(ranges, length):
     if length is None or not ranges or ranges == []:
         return None
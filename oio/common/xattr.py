@@ -47,7 +47,22 @@ def read_user_xattr(fd):
     return meta
 
 
-def modify_xattr(fd, new_fullpaths, remove_old_xattr, xattr_to_remove):
+def modify_xattr(fd, new_fullpaths, remove_old_xattr, xattr_to_remove,
+                 unpacked=None):
+    """
+    :param unpacked: the attributes decoded from each packed xattr, by name
+        of packed xattr. They are written as legacy xattr and the packed
+        xattr are dropped, otherwise they would shadow the legacy xattr
+        written here.
+    """
+    for packed_key, attrs in (unpacked or {}).iteritems():
+        for key, value in attrs.iteritems():
+            xattr.setxattr(fd, 'user.' + key, value)
+        try:
+            xattr.removexattr(fd, 'user.' + packed_key)
+        except IOError:
+            pass
+
     for chunk_id, new_fullpath in new_fullpaths.iteritems():
         xattr.setxattr(
             fd,
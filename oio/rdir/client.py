@@ -360,8 +360,36 @@ class RdirClient(HttpApi):
         self._rdir_request(volume_id, 'DELETE', 'delete',
                            json=body, **kwargs)
 
+    def chunk_push_many(self, volume_id, chunks, headers=None):
+        """
+        Reference several chunks in the reverse directory, with a single
+        request and a single write on the database.
+
+        :param chunks: a list of dicts with at least 'container_id',
+            'content_id' and 'chunk_id' fields
+        :returns: a dict telling how many records 'succeeded', and the list
+            of the records that 'failed' (their 'index' in `chunks`, a
+            'status' and a 'message')
+        """
+        _resp, body = self._rdir_request(volume_id, 'POST', 'push',
+                                         create=True, json=list(chunks),
+                                         headers=headers)
+        return body
+
+    def chunk_delete_many(self, volume_id, chunks, **kwargs):
+        """
+        Unreference several chunks from the reverse directory, with a single
+        request and a single write on the database.
+
+        :returns: the same report as `chunk_push_many`
+        """
+        _resp, body = self._rdir_request(volume_id, 'DELETE', 'delete',
+                                         json=list(chunks), **kwargs)
+        return body
+
     def chunk_fetch(self, volume, limit=100, rebuild=False,
-                    container_id=None, max_attempts=3, **kwargs):
+                    container_id=None, max_attempts=3, by_mtime=False,
+                    max_mtime=None, **kwargs):
         """
         Fetch the list of chunks belonging to the specified volume.
 
@@ -374,12 +402,21 @@ class RdirClient(HttpApi):
         :keyword container_id: get only chunks belonging to
            the specified container
         :type container_id: `str`
+        :keyword by_mtime: list the chunks by increasing mtime, using
+           the mtime index of the volume (not with `container_id`)
+        :type by_mtime: `bool`
+        :keyword max_mtime: with `by_mtime`, the greatest mtime to list
+        :type max_mtime: `int`
         """
         req_body = {'limit': limit}
         if rebuild:
             req_body['rebuild'] = True
         if container_id:
             req_body['container_id'] = container_id
+        if by_mtime:
+            req_body['mtime_index'] = True
+            if max_mtime is not None:
+                req_body['max_mtime'] = int(max_mtime)
 
         while True:
             for i in range(max_attempts):
@@ -402,6 +439,8 @@ class RdirClient(HttpApi):
                 yield container, content, chunk, value
             if key is not None:
                 req_body['start_after'] = key
+                if by_mtime:
+                    req_body['start_after_mtime'] = value['mtime']
 
     def admin_incident_set(self, volume, date, **kwargs):
         body = {'date': int(float(date))}
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <httpd.h>
 #include <http_config.h>
+#include <ap_mpm.h>
 #include <apr_strings.h>
 #include <mod_dav.h>
 
@@ -94,6 +95,10 @@ dav_rawx_merge_server_config(apr_pool_t *p, void *base UNUSED, void *overrides)
 	newconf->hash_width = child->hash_width;
 	newconf->fsync_on_close = child->fsync_on_close;
 	newconf->fallocate = child->fallocate;
+	newconf->packed_xattr = child->packed_xattr;
+	newconf->direct_io = child->direct_io;
+	newconf->write_behind = child->write_behind;
+	newconf->copy_data = child->copy_data;
 	newconf->checksum_mode = child->checksum_mode;
 	memcpy(newconf->docroot, child->docroot, sizeof(newconf->docroot));
 	memcpy(newconf->ns_name, child->ns_name, sizeof(newconf->ns_name));
@@ -196,6 +201,45 @@ dav_rawx_cmd_gridconfig_fallocate(cmd_parms *cmd, void *config UNUSED, const cha
 	return NULL;
 }
 
+static const char *
+dav_rawx_cmd_gridconfig_packed_xattr(cmd_parms *cmd, void *config UNUSED, const char *arg1)
+{
+	dav_rawx_server_conf *conf =
+		ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	conf->packed_xattr = oio_str_parse_bool(arg1, FALSE);
+	return NULL;
+}
+
+static const char *
+dav_rawx_cmd_gridconfig_direct_io(cmd_parms *cmd, void *config UNUSED, const char *arg1)
+{
+	dav_rawx_server_conf *conf =
+		ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	conf->direct_io = oio_str_parse_bool(arg1, FALSE);
+	return NULL;
+}
+
+static const char *
+dav_rawx_cmd_gridconfig_write_behind(cmd_parms *cmd, void *config UNUSED, const char *arg1)
+{
+	dav_rawx_server_conf *conf =
+		ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	gint64 i64 = 0;
+	if (!oio_str_is_number(arg1, &i64) || i64 < 0)
+		return apr_pstrcat(cmd->temp_pool, "Invalid write-behind size: ", arg1, NULL);
+	conf->write_behind = i64;
+	return NULL;
+}
+
+static const char *
+dav_rawx_cmd_gridconfig_copy_data(cmd_parms *cmd, void *config UNUSED, const char *arg1)
+{
+	dav_rawx_server_conf *conf =
+		ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	conf->copy_data = oio_str_parse_bool(arg1, FALSE);
+	return NULL;
+}
+
 static const char *
 dav_rawx_cmd_gridconfig_dirrun(cmd_parms *cmd, void *config UNUSED, const char *arg1)
 {
@@ -317,10 +361,16 @@ _create_shm_if_needed(char *shm_path, server_rec *server, apr_pool_t *plog)
 	// Test if an SHM segment already exists
 	apr_pool_userdata_get((void**)&shm, SHM_HANDLE_KEY, ppool);
 	if (shm == NULL) {
-		DAV_DEBUG_POOL(plog, 0, "%s: Creating SHM segment at [%s]",
-				__FUNCTION__, shm_path);
+		// One slot of statistics per child process
+		int nb_slots = 0;
+		if (ap_mpm_query(AP_MPMQ_HARD_LIMIT_DAEMONS, &nb_slots) != APR_SUCCESS
+				|| nb_slots <= 0)
+			nb_slots = 1;
+
+		DAV_DEBUG_POOL(plog, 0, "%s: Creating SHM segment at [%s] for %d children",
+				__FUNCTION__, shm_path, nb_slots);
 		// Create a new SHM segment
-		rc = apr_shm_create(&shm, sizeof(struct shm_stats_s), shm_path, ppool);
+		rc = apr_shm_create(&shm, server_stat_shm_size(nb_slots), shm_path, ppool);
 		if (rc != APR_SUCCESS) {
 			char buff[256];
 			DAV_ERROR_POOL(plog, 0, "Failed to create the SHM segment at [%s]: %s",
@@ -330,7 +380,7 @@ _create_shm_if_needed(char *shm_path, server_rec *server, apr_pool_t *plog)
 		/* Init the SHM */
 		void *ptr_counter = apr_shm_baseaddr_get(shm);
 		if (ptr_counter)
-			memset(ptr_counter, 0, sizeof(struct shm_stats_s));
+			server_stat_shm_init(ptr_counter, nb_slots);
 		// Save the SHM handle in the process' pool, without cleanup callback
 		apr_pool_userdata_set(shm, SHM_HANDLE_KEY, NULL, ppool);
 		// Register the cleanup callback to be executed BEFORE pool cleanup
@@ -454,6 +504,10 @@ static const command_rec dav_rawx_cmds[] =
     AP_INIT_TAKE1("grid_fsync",       dav_rawx_cmd_gridconfig_fsync,       NULL, RSRC_CONF, "do fsync on file close"),
     AP_INIT_TAKE1("grid_fsync_dir",   dav_rawx_cmd_gridconfig_fsync_dir,   NULL, RSRC_CONF, "do fsync on chunk direcory after renaming .pending"),
     AP_INIT_TAKE1("grid_fallocate",   dav_rawx_cmd_gridconfig_fallocate,   NULL, RSRC_CONF, "call fallocate when receiving a chunk"),
+    AP_INIT_TAKE1("grid_packed_xattr", dav_rawx_cmd_gridconfig_packed_xattr, NULL, RSRC_CONF, "store the chunk attributes in a single xattr"),
+    AP_INIT_TAKE1("grid_direct_io",   dav_rawx_cmd_gridconfig_direct_io,   NULL, RSRC_CONF, "write the chunks with O_DIRECT"),
+    AP_INIT_TAKE1("grid_write_behind", dav_rawx_cmd_gridconfig_write_behind, NULL, RSRC_CONF, "flush the chunks being written every N bytes"),
+    AP_INIT_TAKE1("grid_copy_data",   dav_rawx_cmd_gridconfig_copy_data,   NULL, RSRC_CONF, "COPY the data of the chunks instead of linking them"),
     AP_INIT_TAKE1("grid_acl",         dav_rawx_cmd_gridconfig_acl,         NULL, RSRC_CONF, "enable acl (ignored)"),
     AP_INIT_TAKE1("grid_compression", dav_rawx_cmd_gridconfig_compression, NULL, RSRC_CONF, "enable compression ('yes', 'no')'"),
     AP_INIT_TAKE1("grid_checksum",    dav_rawx_cmd_gridconfig_checksum,    NULL, RSRC_CONF, "enable checksuming the body of PUT ('yes', 'no', 'smart')'"),
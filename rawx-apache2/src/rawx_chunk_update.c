@@ -319,6 +319,7 @@ _load_in_place_chunk_info(const dav_resource *r, const char *path, struct chunk_
 	str_replace_by_pooled_str(p, &(chunk->chunk_size));
 	str_replace_by_pooled_str(p, &(chunk->chunk_position));
 	str_replace_by_pooled_str(p, &(chunk->chunk_hash));
+	str_replace_by_pooled_str(p, &(chunk->chunk_hash_algo));
 
 	str_replace_by_pooled_str(p, &(chunk->oio_version));
 	str_replace_by_pooled_str(p, &(chunk->content_fullpath));
@@ -56,46 +56,68 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RAWX_STATNAME_REP_BREAD     "r7"
 #define RAWX_STATNAME_REP_BWRITTEN  "r8"
 
+#define RAWX_STATS_VERSION 2
+
+#define RAWX_STATS_CACHE_LINE 64
+
+#define RAWX_STATS_HIST_BUCKETS 9
+
+/* Upper bounds (in microseconds) of the buckets of the latency histograms,
+ * the last bucket holding the slower requests. */
+extern const apr_time_t rawx_stats_hist_bounds[RAWX_STATS_HIST_BUCKETS - 1];
+
+/* Made only of apr_uint64_t, the slots are summed as arrays of counters */
 struct rawx_stats_s {
 
-	apr_uint32_t req_all;
-	apr_uint32_t req_chunk_get;
-	apr_uint32_t req_chunk_put;
-	apr_uint32_t req_chunk_del;
-	apr_uint32_t req_stat;
-	apr_uint32_t req_info;
-	apr_uint32_t req_raw;
-	apr_uint32_t req_other;
-
-	apr_uint32_t rep_2XX;
-	apr_uint32_t rep_4XX;
-	apr_uint32_t rep_5XX;
-	apr_uint32_t rep_other;
-	apr_uint32_t rep_403;
-	apr_uint32_t rep_404;
-	apr_uint32_t rep_bread;
-	apr_uint32_t rep_bwritten;
-
-	apr_uint32_t time_all;
-	apr_uint32_t time_put;
-	apr_uint32_t time_get;
-	apr_uint32_t time_del;
-	apr_uint32_t time_stat;
-	apr_uint32_t time_info;
-	apr_uint32_t time_raw;
-	apr_uint32_t time_other;
+	apr_uint64_t req_all;
+	apr_uint64_t req_chunk_get;
+	apr_uint64_t req_chunk_put;
+	apr_uint64_t req_chunk_del;
+	apr_uint64_t req_stat;
+	apr_uint64_t req_info;
+	apr_uint64_t req_raw;
+	apr_uint64_t req_other;
+
+	apr_uint64_t rep_2XX;
+	apr_uint64_t rep_4XX;
+	apr_uint64_t rep_5XX;
+	apr_uint64_t rep_other;
+	apr_uint64_t rep_403;
+	apr_uint64_t rep_404;
+	apr_uint64_t rep_bread;
+	apr_uint64_t rep_bwritten;
+
+	apr_uint64_t time_all;
+	apr_uint64_t time_put;
+	apr_uint64_t time_get;
+	apr_uint64_t time_del;
+	apr_uint64_t time_stat;
+	apr_uint64_t time_info;
+	apr_uint64_t time_raw;
+	apr_uint64_t time_other;
+
+	apr_uint64_t hist_get[RAWX_STATS_HIST_BUCKETS];
+	apr_uint64_t hist_put[RAWX_STATS_HIST_BUCKETS];
+	apr_uint64_t hist_del[RAWX_STATS_HIST_BUCKETS];
 };
 
+/* The counters of one child. A slot starts on its own cache line, so that
+ * the children never write in the same lines. A slot outlives its child:
+ * the next child claiming it continues its counters, that never decrease. */
+struct rawx_stats_slot_s {
+	apr_uint32_t owner; /* pid of the child, 0 if free */
+	apr_uint32_t padding;
+	struct rawx_stats_s body;
+} __attribute__((aligned(RAWX_STATS_CACHE_LINE)));
+
 struct shm_stats_s {
 
 	struct {
 		apr_uint32_t version;
-		apr_uint32_t padding[3];
+		apr_uint32_t nb_slots;
 	} header;
 
-	struct rawx_stats_s body;
-
-	apr_uint64_t padding[16];
+	struct rawx_stats_slot_s slots[];
 };
 
 enum rawx_checksum_mode_e {
@@ -116,6 +138,12 @@ struct dav_rawx_server_conf_s {
 	unsigned int hash_width;
 	unsigned int fsync_on_close;
 	unsigned int fallocate;
+	unsigned int packed_xattr;
+	unsigned int direct_io;
+	/* Bytes written between two sync_file_range(), 0 to disable */
+	apr_uint64_t write_behind;
+	/* COPY writes a new file instead of a hard link */
+	unsigned int copy_data;
 	unsigned int enabled_compression;
 
 	char event_agent_addr[RAWX_EVENT_ADDR_SIZE];
@@ -126,11 +154,22 @@ struct dav_rawx_server_conf_s {
 	struct {
 		char path[128];
 		apr_shm_t *handle;
+		/* Claimed by the child, NULL in the master */
+		struct rawx_stats_slot_s *slot;
 	} shm;
 
 	void (*cleanup)(dav_rawx_server_conf *conf);
 };
 
+/* Size of the SHM segment for <nb_slots> children */
+apr_size_t server_stat_shm_size(apr_uint32_t nb_slots);
+
+/* Initiate the SHM segment at <base>, just created */
+void server_stat_shm_init(void *base, apr_uint32_t nb_slots);
+
+/* Sum the counters of all the children */
+void server_get_stats(dav_rawx_server_conf *conf, struct rawx_stats_s *total);
+
 apr_status_t server_init_master_stat(dav_rawx_server_conf *conf, apr_pool_t *pool, apr_pool_t *plog);
 
 void server_master_stat_fini(dav_rawx_server_conf *conf, apr_pool_t *plog);
@@ -139,7 +178,7 @@ apr_status_t server_init_child_stat(dav_rawx_server_conf *conf, apr_pool_t *pool
 
 apr_status_t server_child_stat_fini(dav_rawx_server_conf *conf, apr_pool_t *plog);
 
-void server_add_stat(dav_rawx_server_conf *conf, const char *n, apr_uint32_t value, apr_uint32_t duration);
+void server_add_stat(dav_rawx_server_conf *conf, const char *n, apr_uint64_t value, apr_time_t duration);
 
 void server_inc_stat(dav_rawx_server_conf *conf, const char *n, apr_time_t duration);
 
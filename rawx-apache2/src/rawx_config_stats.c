@@ -23,7 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #undef PACKAGE_TARNAME
 #undef PACKAGE_VERSION
 
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <apr.h>
 #include <apr_shm.h>
@@ -40,6 +44,79 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "rawx_internals.h"
 #include "rawx_config.h"
 
+const apr_time_t rawx_stats_hist_bounds[RAWX_STATS_HIST_BUCKETS - 1] = {
+	1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000
+};
+
+apr_size_t
+server_stat_shm_size(apr_uint32_t nb_slots)
+{
+	return sizeof(struct shm_stats_s)
+		+ nb_slots * sizeof(struct rawx_stats_slot_s);
+}
+
+void
+server_stat_shm_init(void *base, apr_uint32_t nb_slots)
+{
+	struct shm_stats_s *shm_stats = base;
+	memset(base, 0, server_stat_shm_size(nb_slots));
+	shm_stats->header.version = RAWX_STATS_VERSION;
+	shm_stats->header.nb_slots = nb_slots;
+}
+
+/* Claim a free slot, or the slot of a dead child. When none is available,
+ * share a slot with other children: the counters are updated atomically
+ * anyway, because of the threaded MPM. */
+static struct rawx_stats_slot_s *
+_claim_slot(struct shm_stats_s *shm_stats)
+{
+	const apr_uint32_t pid = getpid();
+	const apr_uint32_t nb = shm_stats->header.nb_slots;
+
+	if (!nb)
+		return NULL;
+
+	for (apr_uint32_t i = 0; i < nb; ++i) {
+		struct rawx_stats_slot_s *slot = shm_stats->slots + i;
+		apr_uint32_t owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+		if (owner == pid)
+			return slot;
+		if (owner && (kill(owner, 0) == 0 || errno != ESRCH))
+			continue;
+		if (__atomic_compare_exchange_n(&slot->owner, &owner, pid, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return slot;
+	}
+	return shm_stats->slots + (pid % nb);
+}
+
+static void
+_release_slot(struct rawx_stats_slot_s *slot)
+{
+	apr_uint32_t pid = getpid();
+	__atomic_compare_exchange_n(&slot->owner, &pid, 0, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void
+server_get_stats(dav_rawx_server_conf *conf, struct rawx_stats_s *total)
+{
+	memset(total, 0, sizeof(*total));
+
+	struct shm_stats_s *shm_stats = conf->shm.handle
+		? apr_shm_baseaddr_get(conf->shm.handle) : NULL;
+	if (!shm_stats || shm_stats->header.version != RAWX_STATS_VERSION)
+		return;
+
+	apr_uint64_t *dst = (apr_uint64_t*) total;
+	const apr_size_t nb_counters = sizeof(*total) / sizeof(apr_uint64_t);
+	for (apr_uint32_t i = 0; i < shm_stats->header.nb_slots; ++i) {
+		apr_uint64_t *src = (apr_uint64_t*) &(shm_stats->slots[i].body);
+		for (apr_size_t c = 0; c < nb_counters; ++c)
+			dst[c] += __atomic_load_n(src + c, __ATOMIC_RELAXED);
+	}
+}
+
 apr_status_t
 server_init_master_stat(dav_rawx_server_conf *conf, apr_pool_t *pool, apr_pool_t *plog)
 {
@@ -97,6 +174,13 @@ server_init_child_stat(dav_rawx_server_conf *conf, apr_pool_t *pool, apr_pool_t
 	}
 	DAV_DEBUG_POOL(plog, 0, "%s : SHM segment attached at [%s]", __FUNCTION__, conf->shm.path);
 
+	struct shm_stats_s *shm_stats = apr_shm_baseaddr_get(conf->shm.handle);
+	if (shm_stats && shm_stats->header.version == RAWX_STATS_VERSION)
+		conf->shm.slot = _claim_slot(shm_stats);
+	if (!conf->shm.slot)
+		DAV_ERROR_POOL(plog, 0, "%s : No statistics slot in the SHM segment at [%s]",
+				__FUNCTION__, conf->shm.path);
+
 	return APR_SUCCESS;
 }
 
@@ -108,6 +192,11 @@ server_child_stat_fini(dav_rawx_server_conf *conf, apr_pool_t *plog)
 
 	DAV_XDEBUG_POOL(plog, 0, "%s()", __FUNCTION__);
 
+	if (conf->shm.slot) {
+		_release_slot(conf->shm.slot);
+		conf->shm.slot = NULL;
+	}
+
 	/* Detaches the segment */
 	if (conf->shm.handle) {
 		rc = apr_shm_detach(conf->shm.handle);
@@ -123,72 +212,89 @@ server_child_stat_fini(dav_rawx_server_conf *conf, apr_pool_t *plog)
 	return APR_SUCCESS;
 }
 
+#define ADD(Field,V) __atomic_fetch_add(&(stats->Field), (V), __ATOMIC_RELAXED)
+
+static void
+_add_latency(apr_uint64_t *hist, apr_time_t duration)
+{
+	int i = 0;
+	while (i < RAWX_STATS_HIST_BUCKETS - 1 && duration > rawx_stats_hist_bounds[i])
+		i++;
+	__atomic_fetch_add(hist + i, 1, __ATOMIC_RELAXED);
+}
+
 void
-server_add_stat(dav_rawx_server_conf *conf, const char *n, apr_uint32_t value, apr_uint32_t duration)
+server_add_stat(dav_rawx_server_conf *conf, const char *n, apr_uint64_t value, apr_time_t duration)
 {
-	EXTRA_ASSERT(NULL != conf->shm.handle);
 	EXTRA_ASSERT(n && n[0] && n[1]);
 
-	struct shm_stats_s *shm_stats = apr_shm_baseaddr_get(conf->shm.handle);
-
-	if (!shm_stats)
+	if (!conf->shm.slot)
 		return;
 
+	struct rawx_stats_s *stats = &(conf->shm.slot->body);
+	const apr_uint64_t d = duration > 0 ? duration : 0;
+
 	switch (*n) {
 		case 'q':
 			switch (n[1]) {
 				case '0':
-					apr_atomic_add32(&(shm_stats->body.req_all), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_all), duration);
+					ADD(req_all, value);
+					if (d > 0)
+						ADD(time_all, d);
 					break;
 				case '1':
-					apr_atomic_add32(&(shm_stats->body.req_chunk_get), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_get), duration);
+					ADD(req_chunk_get, value);
+					if (d > 0) {
+						ADD(time_get, d);
+						_add_latency(stats->hist_get, d);
+					}
 					break;
 				case '2':
-					apr_atomic_add32(&(shm_stats->body.req_chunk_put), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_put), duration);
+					ADD(req_chunk_put, value);
+					if (d > 0) {
+						ADD(time_put, d);
+						_add_latency(stats->hist_put, d);
+					}
 					break;
 				case '3':
-					apr_atomic_add32(&(shm_stats->body.req_chunk_del), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_del), duration);
+					ADD(req_chunk_del, value);
+					if (d > 0) {
+						ADD(time_del, d);
+						_add_latency(stats->hist_del, d);
+					}
 					break;
 				case '4':
-					apr_atomic_add32(&(shm_stats->body.req_stat), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_stat), value);
+					ADD(req_stat, value);
+					if (d > 0)
+						ADD(time_stat, d);
 					break;
 				case '5':
-					apr_atomic_add32(&(shm_stats->body.req_info), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_info), value);
+					ADD(req_info, value);
+					if (d > 0)
+						ADD(time_info, d);
 					break;
 				case '6':
-					apr_atomic_add32(&(shm_stats->body.req_raw), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_raw), value);
+					ADD(req_raw, value);
+					if (d > 0)
+						ADD(time_raw, d);
 					break;
 				case '7':
-					apr_atomic_add32(&(shm_stats->body.req_other), value);
-					if (duration > 0)
-						apr_atomic_add32(&(shm_stats->body.time_other), value);
+					ADD(req_other, value);
+					if (d > 0)
+						ADD(time_other, d);
 					break;
 			}
 			break;
 		case 'r':
 			switch (n[1]) {
-				case '1': apr_atomic_add32(&(shm_stats->body.rep_2XX), value); break;
-				case '2': apr_atomic_add32(&(shm_stats->body.rep_4XX), value); break;
-				case '3': apr_atomic_add32(&(shm_stats->body.rep_5XX), value); break;
-				case '4': apr_atomic_add32(&(shm_stats->body.rep_other), value); break;
-				case '5': apr_atomic_add32(&(shm_stats->body.rep_403), value); break;
-				case '6': apr_atomic_add32(&(shm_stats->body.rep_404), value); break;
-				case '7': apr_atomic_add32(&(shm_stats->body.rep_bread), value); break;
-				case '8': apr_atomic_add32(&(shm_stats->body.rep_bwritten), value); break;
+				case '1': ADD(rep_2XX, value); break;
+				case '2': ADD(rep_4XX, value); break;
+				case '3': ADD(rep_5XX, value); break;
+				case '4': ADD(rep_other, value); break;
+				case '5': ADD(rep_403, value); break;
+				case '6': ADD(rep_404, value); break;
+				case '7': ADD(rep_bread, value); break;
+				case '8': ADD(rep_bwritten, value); break;
 			}
 			break;
 	}
@@ -223,7 +329,7 @@ server_inc_daverror_stat(dav_rawx_server_conf *conf, dav_error *derr)
 			server_inc_stat(conf, RAWX_STATNAME_REP_4XX, 0);
 			if (derr->status == 403)
 				server_inc_stat(conf, RAWX_STATNAME_REP_403, 0);
-			else if (derr->status == 403)
+			else if (derr->status == 404)
 				server_inc_stat(conf, RAWX_STATNAME_REP_404, 0);
 			return;
 		case 5:
@@ -148,6 +148,7 @@ send_chunk_event(const char *type, const dav_resource *resource)
 	_PAIR_AND_COMMA("chunk_size", resource->info->chunk.chunk_size);
 	_PAIR_AND_COMMA("chunk_position", resource->info->chunk.chunk_position);
 	_PAIR_AND_COMMA("chunk_hash", resource->info->chunk.chunk_hash);
+	_PAIR_AND_COMMA("chunk_hash_algo", resource->info->chunk.chunk_hash_algo);
 
 	_PAIR_AND_COMMA("oio_version", resource->info->chunk.oio_version);
 
@@ -23,6 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #undef PACKAGE_TARNAME
 #undef PACKAGE_VERSION
 
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
 #include <httpd.h>
 #include <http_log.h>
 #include <http_config.h>
@@ -31,16 +35,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mod_dav.h>
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
 
 #include <metautils/lib/metautils.h>
 #include <cluster/lib/gridcluster.h>
 #include <rawx-lib/src/rawx.h>
+#include <rawx-lib/src/checksum.h>
+#include <rawx-apache2/src/rawx_variables.h>
 
 #include "rawx_repo_core.h"
 #include "rawx_internals.h"
 #include "rawx_event.h"
 
 #define DEFAULT_BLOCK_SIZE 1048576
+
+/* Alignment of the buffer, the offsets and the sizes with O_DIRECT */
+#define DIRECT_IO_ALIGN 4096
+
+/* Bytes handed to the kernel at once by a COPY, then hashed */
+#define COPY_WINDOW (8 * 1024 * 1024)
+
+/* Bytes of the source read at once to hash a COPY */
+#define HASH_BUFFER (256 * 1024)
 #define DEFAULT_COMPRESSION_ALGO "ZLIB"
 
 static int errno2http(int err) {
@@ -74,9 +93,11 @@ _set_chunk_extended_attributes(dav_stream *stream, struct chunk_textinfo_s *cti)
 {
 	GError *ge = NULL;
 	dav_error *e = NULL;
+	dav_rawx_server_conf *conf = resource_get_server_config(stream->r);
 
-	if (!set_rawx_info_to_fd(fileno(stream->f), &ge, cti))
-		e = server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
+	if (!(conf->packed_xattr ? set_rawx_info_to_fd_packed : set_rawx_info_to_fd)(
+				stream->fd, &ge, cti))
+		e = server_create_and_stat_error(conf, stream->p,
 				HTTP_FORBIDDEN, 0, apr_pstrdup(stream->p, gerror_get_message(ge)));
 	if (ge)
 		g_clear_error (&ge);
@@ -89,17 +110,8 @@ _finalize_chunk_creation(dav_stream *stream)
 	dav_error *e = NULL;
 	int status = 0;
 
-	/* ensure to flush the FILE * buffer in system fd */
-	if (fflush(stream->f)) {
-		const int errsav = errno;
-		DAV_ERROR_REQ(stream->r->info->request, 0, "fflush error : %s", strerror(errno));
-		e = server_create_and_stat_error(
-				resource_get_server_config(stream->r), stream->p, errno2http(errsav), 0,
-				apr_pstrcat(stream->p, "fflush error : ", strerror(errno), NULL));
-	}
-
 	if (stream->fsync_on_close & FSYNC_ON_CHUNK) {
-		if (-1 == fsync(fileno(stream->f))) {
+		if (-1 == fsync(stream->fd)) {
 			const int errsav = errno;
 			DAV_ERROR_REQ(stream->r->info->request, 0, "fsync error : %s", strerror(errno));
 			e = server_create_and_stat_error(
@@ -108,7 +120,15 @@ _finalize_chunk_creation(dav_stream *stream)
 		}
 	}
 
-	fclose(stream->f);
+	if (0 != close(stream->fd) && !e) {
+		const int errsav = errno;
+		e = server_create_and_stat_error(
+				resource_get_server_config(stream->r), stream->p, errno2http(errsav), 0,
+				apr_pstrcat(stream->p, "close error : ", strerror(errsav), NULL));
+	}
+	stream->fd = -1;
+	if (e)
+		return e;
 
 	/* Finish: move pending file to final file */
 	status = rename(stream->pathname, stream->final_pathname);
@@ -137,16 +157,81 @@ _finalize_chunk_creation(dav_stream *stream)
 	return e;
 }
 
+/* Start the writeback of the range written since the last call, then wait
+ * for the range started at the previous call. At most two ranges of dirty
+ * pages are kept per upload, instead of letting the kernel flush the whole
+ * chunk at once. The errors are reported by the final fsync(). */
+static void
+_write_behind(dav_stream *stream)
+{
+	if (!stream->write_behind ||
+			(apr_uint64_t)(stream->written - stream->sync_next) < stream->write_behind)
+		return;
+#ifdef SYNC_FILE_RANGE_WRITE
+	const apr_off_t prev = stream->sync_prev, next = stream->sync_next;
+	(void) sync_file_range(stream->fd, next, stream->written - next,
+			SYNC_FILE_RANGE_WRITE);
+	if (next > prev)
+		(void) sync_file_range(stream->fd, prev, next - prev,
+				SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE
+				|SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+	stream->sync_prev = stream->sync_next;
+	stream->sync_next = stream->written;
+}
+
+/* Write the whole vector, resuming after the short writes.
+ * Returns 0 or an errno. */
+static int
+_write_all(dav_stream *stream, struct iovec *iov, int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t w = writev(stream->fd, iov, iovcnt);
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (w == 0)
+			return ENOSPC;
+		stream->written += w;
+		while (iovcnt > 0 && (size_t)w >= iov->iov_len) {
+			w -= iov->iov_len;
+			iov ++, iovcnt --;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (guint8*)iov->iov_base + w;
+			iov->iov_len -= w;
+		}
+	}
+	_write_behind(stream);
+	return 0;
+}
+
 static dav_error *
 _write_data_crumble_UNCOMP(dav_stream *stream)
 {
-	if (fwrite(stream->buffer, stream->buffer_offset, 1, stream->f) != 1) {
+	/* Only the tail of the chunk may be unaligned, and O_DIRECT refuses it */
+	if (stream->direct_io && (stream->buffer_offset % DIRECT_IO_ALIGN)) {
+		const int flags = fcntl(stream->fd, F_GETFL);
+		if (flags < 0 || 0 != fcntl(stream->fd, F_SETFL, flags & ~O_DIRECT)) {
+			return server_create_and_stat_error(
+					resource_get_server_config(stream->r), stream->p, errno2http(errno), 0,
+					"An error occurred while writing to a resource.");
+		}
+		stream->direct_io = FALSE;
+	}
+
+	struct iovec iov = {.iov_base = stream->buffer, .iov_len = stream->buffer_offset};
+	const int errsav = _write_all(stream, &iov, 1);
+	if (errsav) {
 		/* ### use something besides 500? */
 		return server_create_and_stat_error(
-				resource_get_server_config(stream->r), stream->p, errno2http(errno), 0,
+				resource_get_server_config(stream->r), stream->p, errno2http(errsav), 0,
 				"An error occurred while writing to a resource.");
 	}
 
+	stream->buffer_offset = 0;
 	return NULL;
 }
 
@@ -160,12 +245,15 @@ _write_data_crumble_COMP(dav_stream *stream, gulong *checksum)
 	rc = stream->comp_ctx.data_compressor(stream->buffer,
 			stream->buffer_offset, gba, checksum);
 	if (0 == rc) {
-		if (1 != fwrite(gba->data, gba->len, 1, stream->f)) {
+		struct iovec iov = {.iov_base = gba->data, .iov_len = gba->len};
+		const int errsav = _write_all(stream, &iov, 1);
+		if (errsav) {
 			e = server_create_and_stat_error(
-					resource_get_server_config(stream->r), stream->p, errno2http(errno), 0,
+					resource_get_server_config(stream->r), stream->p, errno2http(errsav), 0,
 					"An error occurred while writing to a resource.");
 		} else {
 			stream->compressed_size += gba->len;
+			stream->buffer_offset = 0;
 		}
 	} else {
 		e = server_create_and_stat_error(
@@ -213,8 +301,11 @@ resource_init_decompression(dav_resource *resource, dav_rawx_server_conf *conf)
 				sizeof(resource->info->compress_algo));
 		memcpy(resource->info->compress_algo, algo, MIN(strlen(algo),
 					sizeof(resource->info->compress_algo)));
-		init_compression_ctx(&(resource->info->comp_ctx), algo);
-		if (resource->info->comp_ctx.chunk_initiator(
+		if (!init_compression_ctx(&(resource->info->comp_ctx), algo)) {
+			r = server_create_and_stat_error(
+					resource_get_server_config(resource), resource->pool, HTTP_INTERNAL_SERVER_ERROR, 0,
+					"Unsupported chunk compression algorithm");
+		} else if (resource->info->comp_ctx.chunk_initiator(
 				&(resource->info->cp_chunk), resource->info->fullpath)) {
 			r = server_create_and_stat_error(
 					resource_get_server_config(resource), resource->pool, HTTP_INTERNAL_SERVER_ERROR, 0,
@@ -289,6 +380,7 @@ chunk_info_fields__glib2apr (apr_pool_t *pool, struct chunk_textinfo_s *cti)
 	REPLACE_FIELD(chunk_size);
 	REPLACE_FIELD(chunk_position);
 	REPLACE_FIELD(chunk_hash);
+	REPLACE_FIELD(chunk_hash_algo);
 
 	REPLACE_FIELD(oio_version);
 
@@ -330,6 +422,7 @@ request_load_chunk_info_from_headers(request_rec *request,
 	LAZY_LOAD_FIELD(chunk_size,             "chunk-size");
 	LAZY_LOAD_FIELD(chunk_position,         "chunk-pos");
 	LAZY_LOAD_FIELD(chunk_hash,             "chunk-hash");
+	LAZY_LOAD_FIELD(chunk_hash_algo,        "chunk-hash-algo");
 	LAZY_LOAD_FIELD(oio_version,            "oio-version");
 
 	if (!cti->content_fullpath) {
@@ -463,6 +556,9 @@ check_chunk_info(apr_pool_t *pool,
 
 	if (!_null_or_hexa1(chunk->chunk_id)) return "chunk-id";
 	if (!_null_or_hexa1(chunk->chunk_hash)) return "chunk-hash";
+	if (chunk->chunk_hash_algo
+			&& !chunk_checksum_algo_is_known(chunk->chunk_hash_algo))
+		return "chunk-hash-algo";
 
 	return check_chunk_content_fullpath(pool, chunk);
 }
@@ -576,6 +672,7 @@ request_fill_headers(request_rec *r, struct chunk_textinfo_s *chunk)
 	__set_header(r, "chunk-id",   chunk->chunk_id);
 	__set_header(r, "chunk-size", chunk->chunk_size);
 	__set_header(r, "chunk-hash", chunk->chunk_hash);
+	__set_header(r, "chunk-hash-algo", chunk->chunk_hash_algo);
 	__set_header(r, "chunk-pos",  chunk->chunk_position);
 
 	__set_header(r, "oio-version", chunk->oio_version);
@@ -662,6 +759,53 @@ rawx_repo_configure_hash_dir(request_rec *req, dav_resource_private *ctx)
 	return NULL;
 }
 
+dav_error *
+rawx_repo_stream_write(dav_stream *stream, const void *buf, apr_size_t len)
+{
+	/* Plain uploads: the small pieces are gathered in the buffer, then the
+	 * buffer and the current piece leave with a single writev(), so that
+	 * the big pieces are never copied. */
+	if (!stream->compression && !stream->direct_io) {
+		if (stream->buffer_offset + len < stream->buffer_size) {
+			memcpy(stream->buffer + stream->buffer_offset, buf, len);
+			stream->buffer_offset += len;
+			return NULL;
+		}
+		struct iovec iov[2] = {
+			{.iov_base = stream->buffer, .iov_len = stream->buffer_offset},
+			{.iov_base = (void*) buf, .iov_len = len},
+		};
+		const int first = stream->buffer_offset ? 0 : 1;
+		const int errsav = _write_all(stream, iov + first, 2 - first);
+		if (errsav) {
+			return server_create_and_stat_error(
+					resource_get_server_config(stream->r), stream->p, errno2http(errsav), 0,
+					"An error occurred while writing to a resource.");
+		}
+		stream->buffer_offset = 0;
+		return NULL;
+	}
+
+	/* Compressed or O_DIRECT uploads: full blocks of the (aligned) buffer */
+	apr_size_t copied = 0;
+	while (copied < len) {
+		const apr_size_t to_copy = MIN(len - copied,
+				stream->buffer_size - stream->buffer_offset);
+		memcpy(stream->buffer + stream->buffer_offset, buf + copied, to_copy);
+		copied += to_copy;
+		stream->buffer_offset += to_copy;
+
+		if (stream->buffer_offset >= stream->buffer_size) {
+			dav_error *e = stream->compression
+				? _write_data_crumble_COMP(stream, &(stream->compress_checksum))
+				: _write_data_crumble_UNCOMP(stream);
+			if (e)
+				return e;
+		}
+	}
+	return NULL;
+}
+
 dav_error *
 rawx_repo_write_last_data_crumble(dav_stream *stream)
 {
@@ -679,7 +823,19 @@ rawx_repo_write_last_data_crumble(dav_stream *stream)
 	}
 	/* write eof & checksum */
 	if (!e && stream->compression) {
-		if (stream->comp_ctx.eof_writer(stream->f, checksum, &(stream->compressed_size))) {
+		/* The EOF writers work on a FILE, the position is shared with <fd> */
+		int fd = dup(stream->fd);
+		FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+		int rc = -1;
+		if (f) {
+			rc = stream->comp_ctx.eof_writer(f, checksum, NULL,
+					&(stream->compressed_size));
+			if (fclose(f))
+				rc = -1;
+		} else if (fd >= 0) {
+			close(fd);
+		}
+		if (rc) {
 			/* ### use something besides 500? */
 			e = server_create_and_stat_error(
 					resource_get_server_config(stream->r), stream->p, HTTP_INTERNAL_SERVER_ERROR, 0,
@@ -701,8 +857,9 @@ _unlink_and_log(dav_stream *stream, const char *path)
 dav_error *
 rawx_repo_rollback_upload(dav_stream *stream)
 {
-	if (stream->f)
-		fclose(stream->f);
+	if (stream->fd >= 0)
+		close(stream->fd);
+	stream->fd = -1;
 
 	const int rc_final = _unlink_and_log(stream, stream->final_pathname);
 	const int rc_temp = _unlink_and_log(stream, stream->pathname);
@@ -740,6 +897,7 @@ rawx_repo_commit_upload(dav_stream *stream)
 	DUP(chunk_id);
 	DUP(chunk_size);
 	DUP(chunk_hash);
+	DUP(chunk_hash_algo);
 	DUP(chunk_position);
 	DUP(oio_version);
 	DUP(compression_metadata);
@@ -750,31 +908,38 @@ rawx_repo_commit_upload(dav_stream *stream)
 	request_overload_chunk_info_from_trailers (stream->r->info->request, &fake);
 
 	/* Sanitize the chunk hash */
-	if (stream->md5) {
-		const char *hex = g_checksum_get_string(stream->md5);
+	if (stream->checksum) {
+		const char *hex = chunk_checksum_get_string(stream->checksum);
+		const char *algo = chunk_checksum_get_name(stream->checksum);
 		if (!fake.chunk_hash) {
 			/* No checksum provided, let's save the checksum computed */
 			fake.chunk_hash = apr_pstrdup(stream->p, hex);
-			oio_str_upper(fake.chunk_hash);
-			DAV_DEBUG_REQ(stream->r->info->request, 0, "MD5 computed for %s",
-					stream->final_pathname);
+			DAV_DEBUG_REQ(stream->r->info->request, 0, "%s computed for %s",
+					algo, stream->final_pathname);
 		} else {
 			/* A checksum has been provided, let's check it matches the checksum
 			 * computed over the input */
 			if (0 != strcasecmp(fake.chunk_hash, hex)) {
 				return server_create_and_stat_error(
 						conf, stream->p, HTTP_BAD_REQUEST, 0,
-						apr_pstrcat(stream->p, "MD5 mismatch hdr=", fake.chunk_hash, " body=", hex, NULL));
+						apr_pstrcat(stream->p, "Checksum mismatch algo=", algo,
+							" hdr=", fake.chunk_hash, " body=", hex, NULL));
 			} else {
-				DAV_DEBUG_REQ(stream->r->info->request, 0, "MD5 match for %s",
-						stream->final_pathname);
+				DAV_DEBUG_REQ(stream->r->info->request, 0, "%s match for %s",
+						algo, stream->final_pathname);
 			}
 		}
+		fake.chunk_hash_algo = apr_pstrdup(stream->p, algo);
 	} else {
-		DAV_DEBUG_REQ(stream->r->info->request, 0, "No MD5 computed for %s",
+		DAV_DEBUG_REQ(stream->r->info->request, 0, "No checksum computed for %s",
 				stream->final_pathname);
 	}
 
+	/* MD5 is implicit, the attribute only names the other algorithms */
+	if (fake.chunk_hash_algo
+			&& !g_ascii_strcasecmp(fake.chunk_hash_algo, CHUNK_CHECKSUM_DEFAULT))
+		fake.chunk_hash_algo = NULL;
+
 	/* Ensure a (meta)chunk size */
 	if (!fake.chunk_size) {
 		fake.chunk_size = apr_psprintf(stream->r->pool, "%d", (int)stream->total_size);
@@ -782,7 +947,7 @@ rawx_repo_commit_upload(dav_stream *stream)
 
 	if (stream->compressed_size) {
 		char size[32];
-		apr_snprintf(size, 32, "%d", stream->compressed_size);
+		apr_snprintf(size, 32, "%" G_GUINT64_FORMAT, stream->compressed_size);
 		oio_str_replace(&(fake.compression_metadata), stream->metadata_compress);
 		oio_str_replace(&(fake.compression_size), size);
 	}
@@ -856,10 +1021,19 @@ rawx_repo_stream_create(const dav_resource *resource, dav_stream **result)
 	ds->final_pathname = apr_pstrcat(p, ctx->dirname, "/", ctx->hex_chunkid, NULL);
 	ds->pathname = apr_pstrcat(p, ctx->dirname, "/", ctx->hex_chunkid, ".pending", NULL);
 
+	/* The hash algorithm asked by the client, or the namespace's default */
+	const char *algo = ctx->chunk.chunk_hash_algo;
+	if (!algo)
+		algo = oio_rawx_chunk_hash_algo;
+	if (!chunk_checksum_algo_is_known(algo)) {
+		return server_create_and_stat_error(conf, p, HTTP_BAD_REQUEST, 0,
+				apr_pstrcat(p, "Unknown chunk hash algorithm: ", algo, NULL));
+	}
+
 	/* Create busy chunk file */
 	int fd;
 retry:
-	fd = open(ds->pathname, O_CREAT|O_EXCL|O_WRONLY, 0600);
+	fd = open(ds->pathname, O_CREAT|O_EXCL|O_WRONLY|O_CLOEXEC, 0600);
 	if (fd < 0) {
 		const int errsav = errno;
 		if (errno == ENOENT && retryable) {
@@ -877,32 +1051,29 @@ retry:
 
 	/* Check the final chunks hasn't been created meanwhile */
 	if (0 == access(ds->final_pathname, F_OK)) {
+		close(fd);
 		(void) unlink(ds->pathname);
 		return server_create_and_stat_error(resource_get_server_config(resource), p,
 				HTTP_FORBIDDEN, 0, "Chunk already present.");
 	}
 
-	/* Wrap it under a FILE */
-	if (!(ds->f = fdopen(fd, "w"))) {
-		DAV_DEBUG_REQ(resource->info->request, 0, "fdopen(%s) failed : %s",
-				ds->pathname, strerror(errno));
-		const int errsav = errno;
-		(void) unlink(ds->pathname);
-		return server_create_and_stat_error(resource_get_server_config(resource), p,
-				errno2http(errsav), 0, "FILE allocation error");
-	}
+	ds->fd = fd;
+	ds->write_behind = conf->write_behind;
 
-	/* Preallocate disk space for the chunk */
+	/* Preallocate disk space for the chunk, without changing its size: a
+	 * short upload must not leave a tail of zeroes. Only a lack of space is
+	 * an error, the preallocation is just a hint for the filesystem. */
 	apr_int64_t chunk_size = 0;
 	if (ctx->chunk.chunk_size != NULL && conf->fallocate &&
 			(chunk_size = apr_strtoi64(ctx->chunk.chunk_size, NULL, 10)) > 0 &&
-			(0 != posix_fallocate(fileno(ds->f), 0, (off_t)chunk_size))) {
+			0 != fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)chunk_size) &&
+			(errno == ENOSPC || errno == EDQUOT || errno == EFBIG)) {
 		const int errsav = errno;
-		DAV_DEBUG_REQ(resource->info->request, 0, "posix_fallocate(%s) failed : %s",
-				ds->pathname, strerror(errno));
+		DAV_DEBUG_REQ(resource->info->request, 0, "fallocate(%s) failed : %s",
+				ds->pathname, strerror(errsav));
 		dav_error *err = server_create_and_stat_error(conf, p,
 				errno2http(errsav), 0, "Space allocation error");
-		fclose(ds->f);
+		close(fd);
 		unlink(ds->pathname);
 		return err;
 	}
@@ -914,19 +1085,231 @@ retry:
 	}
 	ds->compression = FALSE;
 	ds->buffer_size = DEFAULT_BLOCK_SIZE;
-	ds->buffer = apr_pcalloc(p, ds->buffer_size);
 	ds->buffer_offset = 0;
 
+	/* O_DIRECT requires an aligned buffer. The filesystems that refuse it
+	 * (e.g. tmpfs) silently get the usual path. */
+	ds->direct_io = FALSE;
+	if (conf->direct_io && !ds->compression) {
+		const int flags = fcntl(fd, F_GETFL);
+		if (flags >= 0 && 0 == fcntl(fd, F_SETFL, flags | O_DIRECT)) {
+			ds->direct_io = TRUE;
+		} else {
+			DAV_DEBUG_REQ(resource->info->request, 0, "O_DIRECT(%s) failed : %s",
+					ds->pathname, strerror(errno));
+		}
+	}
+	if (ds->direct_io) {
+		guint8 *raw = apr_palloc(p, ds->buffer_size + DIRECT_IO_ALIGN);
+		ds->buffer = (void*) APR_ALIGN((apr_uintptr_t)raw, DIRECT_IO_ALIGN);
+	} else {
+		ds->buffer = apr_palloc(p, ds->buffer_size);
+	}
+
 	/* Trigger the checksum on the chunk */
-	ds->md5 = NULL;
+	ds->checksum = NULL;
 	if (conf->checksum_mode == CHECKSUM_ALWAYS) {
-		ds->md5 = g_checksum_new (G_CHECKSUM_MD5);
+		ds->checksum = chunk_checksum_new(algo);
 	} else if (conf->checksum_mode == CHECKSUM_SMART) {
 	   if (!oio_str_prefixed(ctx->chunk.content_chunk_method, STGPOL_DSPREFIX_EC, "/"))
-		   ds->md5 = g_checksum_new (G_CHECKSUM_MD5);
+		   ds->checksum = chunk_checksum_new(algo);
 	}
 
 	*result = ds;
 
 	return NULL;
 }
+
+/* Moves <len> bytes at <offset> of <in> to the current position of <out>,
+ * without crossing the user space. copy_file_range() lets the filesystem
+ * share or copy the extents itself, sendfile() (a splice through a pipe
+ * of the kernel) serves the kernels and the filesystems refusing it. */
+static int
+_copy_range(int in, int out, off_t offset, size_t len, gboolean *use_cfr)
+{
+	while (len > 0) {
+		ssize_t w;
+#ifdef __NR_copy_file_range
+		if (*use_cfr) {
+			loff_t off_in = offset;
+			w = syscall(__NR_copy_file_range, in, &off_in, out, NULL, len, 0);
+			if (w < 0 && (errno == ENOSYS || errno == EXDEV ||
+						errno == EINVAL || errno == EOPNOTSUPP)) {
+				*use_cfr = FALSE;
+				continue;
+			}
+		} else
+#endif
+		{
+			off_t off_in = offset;
+			w = sendfile(out, in, &off_in, len);
+		}
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (w == 0)  /* the source has been truncated meanwhile */
+			return EIO;
+		offset += w;
+		len -= w;
+	}
+	return 0;
+}
+
+/* Hashes <len> bytes at <offset> of <in>, read through <buf>. */
+static int
+_hash_range(int in, off_t offset, size_t len, guint8 *buf,
+		struct chunk_checksum_s *checksum)
+{
+	while (len > 0) {
+		ssize_t r = pread(in, buf, MIN(len, HASH_BUFFER), offset);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (r == 0)  /* the source has been truncated meanwhile */
+			return EIO;
+		chunk_checksum_update(checksum, buf, r);
+		offset += r;
+		len -= r;
+	}
+	return 0;
+}
+
+dav_error *
+rawx_repo_copy_chunk(const dav_resource *src, dav_resource *dst)
+{
+	apr_pool_t *p = dst->pool;
+	dav_rawx_server_conf *conf = resource_get_server_config(src);
+	struct chunk_textinfo_s cti = {0};
+	struct chunk_checksum_s *checksum = NULL;
+	GError *ge = NULL;
+	dav_error *e = NULL;
+	guint8 *buf = NULL;
+	struct stat st;
+	int in, retryable = 1;
+	gboolean created = FALSE;
+
+	dav_stream ds;
+	memset(&ds, 0, sizeof(ds));
+	ds.r = dst;
+	ds.p = p;
+	ds.fd = -1;
+	ds.fsync_on_close = conf->fsync_on_close;
+	ds.final_pathname = resource_get_pathname(dst);
+	ds.pathname = apr_pstrcat(p, ds.final_pathname, ".pending", NULL);
+
+	in = open(resource_get_pathname(src), O_RDONLY|O_CLOEXEC);
+	if (in < 0 || 0 != fstat(in, &st)) {
+		e = server_create_and_stat_error(conf, p, errno2http(errno), 0,
+				apr_pstrcat(p, "Source chunk error: ", strerror(errno), NULL));
+		goto end;
+	}
+	if (!get_rawx_info_from_fd(in, &ge, src->info->hex_chunkid, &cti)) {
+		e = server_create_and_stat_error(conf, p, HTTP_FORBIDDEN, 0,
+				apr_pstrdup(p, gerror_get_message(ge)));
+		goto end;
+	}
+
+retry:
+	ds.fd = open(ds.pathname, O_CREAT|O_EXCL|O_WRONLY|O_CLOEXEC, 0600);
+	if (ds.fd < 0) {
+		const int errsav = errno;
+		if (errsav == ENOENT && retryable) {
+			retryable = 0;
+			if (!(e = rawx_repo_ensure_directory(dst)))
+				goto retry;
+			goto end;
+		}
+		e = server_create_and_stat_error(conf, p, errno2http(errsav), 0,
+				"Chunk creation error");
+		goto end;
+	}
+	created = TRUE;
+
+	if (0 == access(ds.final_pathname, F_OK)) {
+		e = server_create_and_stat_error(conf, p, HTTP_CONFLICT, 0,
+				"Destination already exists");
+		goto end;
+	}
+
+	if (conf->fallocate && st.st_size > 0 &&
+			0 != fallocate(ds.fd, FALLOC_FL_KEEP_SIZE, 0, st.st_size) &&
+			(errno == ENOSPC || errno == EDQUOT || errno == EFBIG)) {
+		e = server_create_and_stat_error(conf, p, errno2http(errno), 0,
+				"Space allocation error");
+		goto end;
+	}
+
+	/* The hash of the uncompressed chunks is checked along the copy, each
+	 * window being read again from the page cache just filled. A read
+	 * beats a mapping, that would fault if the source was truncated. */
+	if (cti.chunk_hash && st.st_size > 0
+			&& conf->checksum_mode != CHECKSUM_NEVER
+			&& (conf->checksum_mode != CHECKSUM_SMART
+				|| !oio_str_prefixed(cti.content_chunk_method, STGPOL_DSPREFIX_EC, "/"))
+			&& !(cti.compression_metadata && strstr(cti.compression_metadata,
+					NS_COMPRESSION_OPTION "=" NS_COMPRESSION_ON))) {
+		const char *algo = cti.chunk_hash_algo
+				? cti.chunk_hash_algo : CHUNK_CHECKSUM_DEFAULT;
+		if (!(checksum = chunk_checksum_new(algo))) {
+			e = server_create_and_stat_error(conf, p, HTTP_NOT_IMPLEMENTED, 0,
+					apr_pstrcat(p, "Unknown chunk hash algo: ", algo, NULL));
+			goto end;
+		}
+		buf = apr_palloc(p, HASH_BUFFER);
+		posix_fadvise(in, 0, st.st_size, POSIX_FADV_SEQUENTIAL);
+	}
+
+	gboolean use_cfr = TRUE;
+	for (off_t off = 0; off < st.st_size;) {
+		const size_t len = MIN(COPY_WINDOW, st.st_size - off);
+		const int err = _copy_range(in, ds.fd, off, len, &use_cfr);
+		if (err) {
+			e = server_create_and_stat_error(conf, p, errno2http(err), 0,
+					apr_pstrcat(p, "Chunk copy error: ", strerror(err), NULL));
+			goto end;
+		}
+		const int herr = checksum ? _hash_range(in, off, len, buf, checksum) : 0;
+		if (herr) {
+			e = server_create_and_stat_error(conf, p, errno2http(herr), 0,
+					apr_pstrcat(p, "Chunk read error: ", strerror(herr), NULL));
+			goto end;
+		}
+		off += len;
+	}
+
+	if (checksum) {
+		const char *hex = chunk_checksum_get_string(checksum);
+		if (0 != strcasecmp(cti.chunk_hash, hex)) {
+			e = server_create_and_stat_error(conf, p, HTTP_CONFLICT, 0,
+					apr_pstrcat(p, "Checksum mismatch algo=",
+						chunk_checksum_get_name(checksum),
+						" xattr=", cti.chunk_hash, " body=", hex, NULL));
+			goto end;
+		}
+	}
+
+	/* Same attributes, but those naming the chunk */
+	oio_str_replace(&cti.chunk_id, dst->info->hex_chunkid);
+	oio_str_replace(&cti.content_fullpath, dst->info->chunk.content_fullpath);
+	if ((e = _set_chunk_extended_attributes(&ds, &cti)))
+		goto end;
+
+	e = _finalize_chunk_creation(&ds);
+
+end:
+	chunk_checksum_free(checksum);
+	if (in >= 0)
+		close(in);
+	if (ds.fd >= 0)
+		close(ds.fd);
+	if (e && created)
+		unlink(ds.pathname);
+	chunk_textinfo_free_content(&cti);
+	if (ge)
+		g_clear_error(&ge);
+	return e;
+}
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <metautils/lib/metautils.h>
 #include <rawx-lib/src/rawx.h>
 #include <rawx-lib/src/compression.h>
+#include <rawx-lib/src/checksum.h>
 
 #include "rawx_config.h"
 
@@ -65,7 +66,9 @@ struct dav_stream
 	const dav_resource *r;
 	apr_pool_t *p;
 	int fsync_on_close;
-	FILE *f;
+	int fd;
+	/* O_DIRECT is set on <fd>, <buffer> is aligned */
+	gboolean direct_io;
 	void *buffer;
 	apr_size_t buffer_size;
 	apr_size_t buffer_offset;
@@ -73,13 +76,19 @@ struct dav_stream
 	const char *final_pathname;
 
 	gulong compress_checksum;
-	guint32 compressed_size;
+	guint64 compressed_size;
 	char *metadata_compress;
 	struct compression_ctx_s comp_ctx;
 	gboolean compression;
 
-	GChecksum *md5;
+	struct chunk_checksum_s *checksum;
 	apr_size_t total_size;
+
+	/* Bytes written in <fd>, and the two last ranges of the write-behind */
+	apr_off_t written;
+	apr_off_t sync_prev;
+	apr_off_t sync_next;
+	apr_uint64_t write_behind;
 };
 
 #define RESOURCE_STAT_CHUNK_READ_ATTRS 0x01
@@ -113,6 +122,9 @@ dav_error * rawx_repo_check_request(request_rec *req, const char *root_dir, cons
 
 dav_error * rawx_repo_configure_hash_dir(request_rec *req, dav_resource_private *ctx);
 
+dav_error * rawx_repo_stream_write(dav_stream *stream,
+		const void *buf, apr_size_t len);
+
 dav_error * rawx_repo_write_last_data_crumble(dav_stream *stream);
 
 dav_error * rawx_repo_rollback_upload(dav_stream *stream);
@@ -121,4 +133,9 @@ dav_error * rawx_repo_commit_upload(dav_stream *stream);
 
 dav_error * rawx_repo_stream_create(const dav_resource *resource, dav_stream **result);
 
+/* Writes a new chunk <dst> with the data and the attributes of <src>, the
+ * data being moved by the kernel. The hash is verified on the way, as for
+ * an upload. */
+dav_error * rawx_repo_copy_chunk(const dav_resource *src, dav_resource *dst);
+
 #endif /*OIO_SDS__rawx_apache2__src__rawx_repo_core_h*/
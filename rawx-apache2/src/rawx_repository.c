@@ -629,9 +629,9 @@ dav_rawx_close_stream(dav_stream *stream, int commit)
 			RAWX_STATNAME_REQ_CHUNKPUT,
 			request_get_duration(stream->r->info->request));
 
-	if (stream->md5) {
-		g_checksum_free(stream->md5);
-		stream->md5 = NULL;
+	if (stream->checksum) {
+		chunk_checksum_free(stream->checksum);
+		stream->checksum = NULL;
 	}
 	return e;
 }
@@ -641,65 +641,13 @@ dav_rawx_write_stream(dav_stream *stream, const void *buf, apr_size_t bufsize)
 {
 	DAV_XDEBUG_POOL(stream->p, 0, "%s(%s)", __FUNCTION__, stream->pathname);
 
-	apr_size_t copied = 0;
-	gulong checksum = stream->compress_checksum;
-
-	while (copied < bufsize) {
-		apr_size_t to_copy = MIN(bufsize - copied,
-				stream->buffer_size - stream->buffer_offset);
-		memcpy(stream->buffer + stream->buffer_offset, buf + copied, to_copy);
-		copied += to_copy;
-		stream->buffer_offset += to_copy;
-
-		/* If buffer full, compress if needed and write to distant file */
-		if (stream->buffer_size - stream->buffer_offset <= 0){
-			size_t written = 0;
-			if (!stream->compression) {
-				written = fwrite(stream->buffer, stream->buffer_offset, 1,
-						stream->f);
-				if (written != 1) {
-					/* ### use something besides 500? */
-					return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
-							HTTP_INTERNAL_SERVER_ERROR, 0,
-							"An error occurred while writing to a "
-							"resource.");
-				}
-			} else {
-				GByteArray *gba = g_byte_array_new();
-				if (stream->comp_ctx.data_compressor(stream->buffer, stream->buffer_offset, gba,
-							&checksum)!=0) {
-					if (gba)
-						g_byte_array_free(gba, TRUE);
-					/* ### use something besides 500? */
-					return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
-							HTTP_INTERNAL_SERVER_ERROR, 0,
-							"An error occurred while compressing data.");
-				}
-				written = fwrite(gba->data, gba->len, 1, stream->f);
-				if (written != 1) {
-					if (gba)
-						g_byte_array_free(gba, TRUE);
-					/* ### use something besides 500? */
-					return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
-							HTTP_INTERNAL_SERVER_ERROR, 0,
-							"An error occurred while writing to a "
-							"resource.");
-				}
-				stream->compressed_size += gba->len;
-				if (gba)
-					g_byte_array_free(gba, TRUE);
-			}
-
-			memset(stream->buffer, 0, stream->buffer_size);
-			stream->buffer_offset = 0;
-		}
-	}
-
-	stream->compress_checksum = checksum;
+	dav_error *e = rawx_repo_stream_write(stream, buf, bufsize);
+	if (e)
+		return e;
 
 	/* update the hash and the stats */
-	if (stream->md5)
-		g_checksum_update(stream->md5, buf, bufsize);
+	if (stream->checksum)
+		chunk_checksum_update(stream->checksum, buf, bufsize);
 
 	/* update total_size */
 	stream->total_size += bufsize;
@@ -711,7 +659,7 @@ dav_rawx_seek_stream(dav_stream *stream, apr_off_t abs_pos)
 {
 	DAV_XDEBUG_POOL(stream->p, 0, "%s(%s)", __FUNCTION__, stream->pathname);
 
-	if (fseek(stream->f, abs_pos, SEEK_SET) != 0) {
+	if (lseek(stream->fd, abs_pos, SEEK_SET) < 0) {
 		/* ### should check whether apr_file_seek set abs_pos was set to the
 		 * correct position? */
 		/* ### use something besides 500? */
@@ -803,7 +751,8 @@ dav_rawx_deliver(const dav_resource *resource, ap_filter_t *output)
 		FILE *f = NULL;
 		f = fopen(path, "r");
 		/* Try to open the file but forbids a creation */
-		if (!set_rawx_info_to_fd(fileno(f), &error_local, &(ctx->chunk))) {
+		if (!update_rawx_info_to_fd(fileno(f), &error_local,
+					ctx->hex_chunkid, &(ctx->chunk), conf->packed_xattr)) {
 			fclose(f);
 			e = server_create_and_stat_error(conf, pool,
 					HTTP_FORBIDDEN, 0, apr_pstrdup(pool, gerror_get_message(error_local)));
@@ -859,24 +808,12 @@ dav_rawx_deliver(const dav_resource *resource, ap_filter_t *output)
 			e = server_create_and_stat_error(conf, pool, HTTP_FORBIDDEN, 0,
 					"Failed to send data to the client (timed out?)");
 			/* close file */
-			if (ctx->cp_chunk.fd) {
-				fclose(ctx->cp_chunk.fd);
-			}
+			block_compressed_chunk_clean(&ctx->cp_chunk);
 			goto end_deliver;
 		}
-		if (ctx->cp_chunk.buf){
-			g_free(ctx->cp_chunk.buf);
-			ctx->cp_chunk.buf = NULL;
-		}
-		if (ctx->cp_chunk.uncompressed_size){
-			g_free(ctx->cp_chunk.uncompressed_size);
-			ctx->cp_chunk.uncompressed_size = NULL;
-		}
 
-		/* close file */
-		if (ctx->cp_chunk.fd) {
-			fclose(ctx->cp_chunk.fd);
-		}
+		/* close file, free the buffers and the block index */
+		block_compressed_chunk_clean(&ctx->cp_chunk);
 
 		server_inc_stat(conf, RAWX_STATNAME_REP_2XX, 0);
 		server_add_stat(conf, RAWX_STATNAME_REP_BWRITTEN, resource->info->finfo.size, 0);
@@ -938,20 +875,32 @@ dav_rawx_copy_resource(const dav_resource *src, dav_resource *dst, int depth,
 
 	DAV_DEBUG_RES(src, 0, "Copying %s to %s", resource_get_pathname(src),
 			resource_get_pathname(dst));
-	status = apr_file_link(resource_get_pathname(src),
-			resource_get_pathname(dst));
 
-	if (status != APR_SUCCESS) {
-		e = server_create_and_stat_error(srv_conf,
-				pool, HTTP_INTERNAL_SERVER_ERROR, status,
-				apr_pstrcat(pool, "Failed to COPY this chunk: ",
-					apr_strerror(status, buff, sizeof(buff)), NULL));
-		goto end_copy;
+	/* A hard link shares the data (and the attributes) with the source. The
+	 * filesystem may refuse it, e.g. across mount points. */
+	gboolean linked = FALSE;
+	if (!srv_conf->copy_data) {
+		status = apr_file_link(resource_get_pathname(src),
+				resource_get_pathname(dst));
+		if (status == APR_SUCCESS) {
+			linked = TRUE;
+		} else if (!APR_STATUS_IS_EXDEV(status)
+				&& status != APR_FROM_OS_ERROR(EMLINK)
+				&& status != APR_FROM_OS_ERROR(EPERM)) {
+			e = server_create_and_stat_error(srv_conf,
+					pool, HTTP_INTERNAL_SERVER_ERROR, status,
+					apr_pstrcat(pool, "Failed to COPY this chunk: ",
+						apr_strerror(status, buff, sizeof(buff)), NULL));
+			goto end_copy;
+		}
 	}
 
 	GError *local_error = NULL;
-	if (!set_rawx_info_to_file(resource_get_pathname(dst), &local_error,
-			&(dst->info->chunk))) {
+	if (!linked) {
+		if ((e = rawx_repo_copy_chunk(src, dst)))
+			goto end_copy;
+	} else if (!(srv_conf->packed_xattr ? set_rawx_info_to_file_packed : set_rawx_info_to_file)(
+				resource_get_pathname(dst), &local_error, &(dst->info->chunk))) {
 		e = server_create_and_stat_error(srv_conf, pool,
 				HTTP_FORBIDDEN, 0,
 				apr_pstrdup(pool, gerror_get_message(local_error)));
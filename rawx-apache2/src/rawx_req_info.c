@@ -74,8 +74,24 @@ struct dav_resource_private {
 
 /* ------------------------------------------------------------------------- */
 
-#define STR_KV(Field,Name) apr_psprintf(pool, Name" %u\n", \
-		apr_atomic_read32(&stats->body.Field))
+#define STR_KV(Field,Name) apr_psprintf(pool, Name" %"APR_UINT64_T_FMT"\n", \
+		stats.Field)
+
+static const char *
+_gen_histogram(apr_pool_t *pool, const char *name, const apr_uint64_t *hist)
+{
+	const char *out = "";
+	for (int i = 0; i < RAWX_STATS_HIST_BUCKETS; ++i) {
+		if (i < RAWX_STATS_HIST_BUCKETS - 1)
+			out = apr_psprintf(pool, "%scounter req.hist.%s.%"APR_TIME_T_FMT
+					" %"APR_UINT64_T_FMT"\n", out, name,
+					rawx_stats_hist_bounds[i], hist[i]);
+		else
+			out = apr_psprintf(pool, "%scounter req.hist.%s.inf"
+					" %"APR_UINT64_T_FMT"\n", out, name, hist[i]);
+	}
+	return out;
+}
 
 /*
 RAWX{{
@@ -158,6 +174,16 @@ Sample exchange:
    counter rep.hits.404 0
    counter rep.bread 0
    counter rep.bwritten 0
+   counter req.hist.get.1000 0
+   [...]
+   counter req.hist.get.5000000 0
+   counter req.hist.get.inf 0
+   [... same for put and del ...]
+
+The counters are 64 bits wide, and summed over all the children. The
+``req.hist.<get|put|del>.<bound>`` counters are the latency histograms of
+the chunk requests: each counts the requests that lasted at most <bound>
+microseconds, and more than the previous bound.
 }}RAWX
 */
 static const char *
@@ -165,7 +191,8 @@ __gen_stats(const dav_resource *resource, apr_pool_t *pool)
 {
 	dav_rawx_server_conf *c = resource_get_server_config(resource);
 
-	struct shm_stats_s *stats = apr_shm_baseaddr_get(c->shm.handle);
+	struct rawx_stats_s stats;
+	server_get_stats(c, &stats);
 
 	return apr_pstrcat(pool,
 			STR_KV(time_all,       "counter req.time"),
@@ -195,6 +222,10 @@ __gen_stats(const dav_resource *resource, apr_pool_t *pool)
 			STR_KV(rep_bread,     "counter rep.bread"),
 			STR_KV(rep_bwritten,  "counter rep.bwritten"),
 
+			_gen_histogram(pool, "get", stats.hist_get),
+			_gen_histogram(pool, "put", stats.hist_put),
+			_gen_histogram(pool, "del", stats.hist_del),
+
 			apr_psprintf(pool, "config volume %s", c->docroot),
 			c->service_id[0] ? apr_psprintf(pool, "\nconfig service_id %s", c->service_id)
 				: NULL,
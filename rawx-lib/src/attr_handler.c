@@ -35,25 +35,25 @@ static volatile ssize_t longest_xattr = 2048;
 static volatile ssize_t longest_xattr_list = 16384;
 
 static gchar *
-_getxattr_from_fd(int fd, const char *attrname)
+_getxattr_from_fd_len(int fd, const char *attrname, gsize *plen)
 {
 	ssize_t size;
 	ssize_t s = longest_xattr;
-	gchar *buf = g_malloc0(s);
+	gchar *buf = g_malloc0(s + 1);
 retry:
 	size = fgetxattr(fd, attrname, buf, s);
-	if (size > 0)
-		return buf;
-	if (size == 0) {
-		*buf = 0;
+	if (size >= 0) {
+		buf[size] = 0;
+		if (plen)
+			*plen = size;
 		return buf;
 	}
 
 	if (errno == ERANGE) {
 		s = s*2;
 		longest_xattr = 1 + MAX(longest_xattr, s);
-		buf = g_realloc(buf, s);
-		memset(buf, 0, s);
+		buf = g_realloc(buf, s + 1);
+		memset(buf, 0, s + 1);
 		goto retry;
 	}
 
@@ -63,6 +63,144 @@ retry:
 	return NULL;
 }
 
+static gchar *
+_getxattr_from_fd(int fd, const char *attrname)
+{
+	return _getxattr_from_fd_len(fd, attrname, NULL);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The packed value starts with a version byte, followed by the attributes
+ * that are set, each as a tag byte, the length of the value (2 bytes, big
+ * endian) and the value itself. The IDs of the chunk and of the content are
+ * carried by the fullpath, as with the legacy layout. */
+#define PACKED_VERSION 0x01
+
+enum packed_tag_e {
+	PACKED_FULLPATH = 1,
+	PACKED_CONTENT_SIZE,
+	PACKED_CONTENT_NBCHUNK,
+	PACKED_CONTENT_STGPOL,
+	PACKED_CONTENT_CHUNKMETHOD,
+	PACKED_CONTENT_MIMETYPE,
+	PACKED_METACHUNK_SIZE,
+	PACKED_METACHUNK_HASH,
+	PACKED_CHUNK_SIZE,
+	PACKED_CHUNK_HASH,
+	PACKED_CHUNK_POS,
+	PACKED_CHUNK_METADATA_COMPRESS,
+	PACKED_CHUNK_COMPRESSED_SIZE,
+	PACKED_OIO_VERSION,
+	PACKED_CHUNK_HASH_ALGO,
+	PACKED_MAX
+};
+
+static gchar **
+_packed_field(struct chunk_textinfo_s *chunk, guint8 tag)
+{
+	switch (tag) {
+		case PACKED_FULLPATH: return &chunk->content_fullpath;
+		case PACKED_CONTENT_SIZE: return &chunk->content_size;
+		case PACKED_CONTENT_NBCHUNK: return &chunk->content_chunk_nb;
+		case PACKED_CONTENT_STGPOL: return &chunk->content_storage_policy;
+		case PACKED_CONTENT_CHUNKMETHOD: return &chunk->content_chunk_method;
+		case PACKED_CONTENT_MIMETYPE: return &chunk->content_mime_type;
+		case PACKED_METACHUNK_SIZE: return &chunk->metachunk_size;
+		case PACKED_METACHUNK_HASH: return &chunk->metachunk_hash;
+		case PACKED_CHUNK_SIZE: return &chunk->chunk_size;
+		case PACKED_CHUNK_HASH: return &chunk->chunk_hash;
+		case PACKED_CHUNK_POS: return &chunk->chunk_position;
+		case PACKED_CHUNK_METADATA_COMPRESS: return &chunk->compression_metadata;
+		case PACKED_CHUNK_COMPRESSED_SIZE: return &chunk->compression_size;
+		case PACKED_OIO_VERSION: return &chunk->oio_version;
+		case PACKED_CHUNK_HASH_ALGO: return &chunk->chunk_hash_algo;
+		default: return NULL;
+	}
+}
+
+static gchar *
+_packed_name(const char *hex_chunkid)
+{
+	return g_strconcat(ATTR_DOMAIN_OIO "." ATTR_NAME_PACKED ":",
+			hex_chunkid, NULL);
+}
+
+static GError *
+_packed_encode(struct chunk_textinfo_s *chunk, GByteArray *out)
+{
+	const guint8 version = PACKED_VERSION;
+	g_byte_array_append(out, &version, 1);
+	for (guint8 tag = 1; tag < PACKED_MAX; ++tag) {
+		const gchar *v = *_packed_field(chunk, tag);
+		if (!v)
+			continue;
+		const gsize len = strlen(v);
+		if (len > G_MAXUINT16)
+			return NEWERROR(EINVAL, "attribute too long (%u)", tag);
+		const guint8 hdr[3] = {tag, len >> 8, len & 0xFF};
+		g_byte_array_append(out, hdr, 3);
+		g_byte_array_append(out, (const guint8*) v, len);
+	}
+	return NULL;
+}
+
+static GError *
+_packed_decode(struct chunk_textinfo_s *chunk, const guint8 *v, gsize len)
+{
+	if (len < 1 || v[0] != PACKED_VERSION)
+		return NEWERROR(EINVAL, "invalid packed xattr version");
+	for (gsize i = 1; i < len;) {
+		if (i + 3 > len)
+			return NEWERROR(EINVAL, "truncated packed xattr");
+		const guint8 tag = v[i];
+		const gsize vlen = (v[i+1] << 8) | v[i+2];
+		i += 3;
+		if (i + vlen > len)
+			return NEWERROR(EINVAL, "truncated packed xattr");
+		/* Ignore the attributes introduced by later versions */
+		gchar **pfield = _packed_field(chunk, tag);
+		if (pfield)
+			oio_str_reuse(pfield, g_strndup((const gchar*) v + i, vlen));
+		i += vlen;
+	}
+	return NULL;
+}
+
+/* Fill the IDs of the content from the fullpath of the chunk */
+static gboolean
+_decode_fullpath(struct chunk_textinfo_s *chunk, GError **error)
+{
+	gchar **fullpath = g_strsplit(chunk->content_fullpath, "/", -1);
+	guint fullpath_len = g_strv_length(fullpath);
+	if (fullpath_len != 5) {
+		g_strfreev(fullpath);
+		GSETCODE(error, EINVAL, "invalid xattr fullpath");
+		return FALSE;
+	}
+
+	char *account = g_uri_unescape_string(fullpath[0], NULL);
+	char *container = g_uri_unescape_string(fullpath[1], NULL);
+	guint8 container_id[32];
+	char container_hexid[65];
+	// NS is unused
+	oio_str_hash_name(container_id, NULL, account, container);
+	oio_str_bin2hex(container_id, sizeof(container_id),
+			container_hexid, sizeof(container_hexid));
+	g_free(account);
+	g_free(container);
+
+	oio_str_replace(&chunk->container_id, container_hexid);
+	oio_str_reuse(&chunk->content_path,
+			g_uri_unescape_string(fullpath[2], NULL));
+	oio_str_reuse(&chunk->content_version,
+			g_uri_unescape_string(fullpath[3], NULL));
+	oio_str_reuse(&chunk->content_id,
+			g_uri_unescape_string(fullpath[4], NULL));
+	g_strfreev(fullpath);
+	return TRUE;
+}
+
 /* -------------------------------------------------------------------------- */
 
 #define SET(K,V) if (K) { \
@@ -115,6 +253,9 @@ set_rawx_info_to_fd(int fd, GError **error, struct chunk_textinfo_s *chunk)
 
 	SET(ATTR_NAME_CHUNK_SIZE, chunk->chunk_size);
 	SET(ATTR_NAME_CHUNK_HASH, chunk->chunk_hash);
+	SET(ATTR_NAME_CHUNK_HASH_ALGO, chunk->chunk_hash_algo);
+	if (chunk->chunk_hash && !chunk->chunk_hash_algo)
+		fremovexattr(fd, ATTR_DOMAIN "." ATTR_NAME_CHUNK_HASH_ALGO);
 	SET(ATTR_NAME_CHUNK_POS,  chunk->chunk_position);
 
 	SET(ATTR_NAME_CHUNK_METADATA_COMPRESS, chunk->compression_metadata);
@@ -122,6 +263,13 @@ set_rawx_info_to_fd(int fd, GError **error, struct chunk_textinfo_s *chunk)
 
 	SET(ATTR_NAME_OIO_VERSION, chunk->oio_version);
 
+	/* A packed value would hide the attributes just set */
+	if (chunk->chunk_id) {
+		gchar *packed = _packed_name(chunk->chunk_id);
+		fremovexattr(fd, packed);
+		g_free(packed);
+	}
+
 	return TRUE;
 
 error_set_attr:
@@ -129,6 +277,45 @@ error_set_attr:
 	return FALSE;
 }
 
+gboolean
+set_rawx_info_to_fd_packed(int fd, GError **error, struct chunk_textinfo_s *chunk)
+{
+	if (fd < 0) {
+		GSETCODE(error, EINVAL, "invalid FD");
+		return FALSE;
+	}
+
+	if (!chunk)
+		return TRUE;
+
+	if (!chunk->chunk_id) {
+		GSETCODE(error, EINVAL, "Missing chunk ID");
+		return FALSE;
+	}
+
+	oio_str_upper(chunk->container_id);
+	oio_str_upper(chunk->content_id);
+	oio_str_upper(chunk->chunk_hash);
+	oio_str_upper(chunk->metachunk_hash);
+
+	GByteArray *packed = g_byte_array_sized_new(512);
+	GError *err = _packed_encode(chunk, packed);
+	if (!err) {
+		gchar *name = _packed_name(chunk->chunk_id);
+		if (fsetxattr(fd, name, packed->data, packed->len, 0) < 0)
+			err = NEWERROR(errno, "setxattr error: (%d) %s",
+					errno, strerror(errno));
+		g_free(name);
+	}
+	g_byte_array_free(packed, TRUE);
+
+	if (err) {
+		g_propagate_error(error, err);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 gboolean
 set_rawx_info_to_file(const char *p, GError **error,
 		struct chunk_textinfo_s *chunk)
@@ -146,6 +333,23 @@ set_rawx_info_to_file(const char *p, GError **error,
 	}
 }
 
+gboolean
+set_rawx_info_to_file_packed(const char *p, GError **error,
+		struct chunk_textinfo_s *chunk)
+{
+	int fd = open(p, O_WRONLY);
+	if (fd < 0) {
+		GSETCODE(error, errno, "open() error: (%d) %s", errno, strerror(errno));
+		return FALSE;
+	} else {
+		gboolean rc = set_rawx_info_to_fd_packed(fd, error, chunk);
+		int errsav = errno;
+		metautils_pclose (&fd);
+		errno = errsav;
+		return rc;
+	}
+}
+
 gboolean
 set_compression_info_in_attr(const char *p, GError ** error, const char *v)
 {
@@ -157,10 +361,10 @@ set_compression_info_in_attr(const char *p, GError ** error, const char *v)
 }
 
 gboolean
-set_chunk_compressed_size_in_attr(const char *p, GError ** error, guint32 v)
+set_chunk_compressed_size_in_attr(const char *p, GError ** error, guint64 v)
 {
 	gchar buf[32] = "";
-	g_snprintf (buf, sizeof(buf), "%"G_GUINT32_FORMAT, v);
+	g_snprintf (buf, sizeof(buf), "%"G_GUINT64_FORMAT, v);
 	int rc = lsetxattr(p, ATTR_DOMAIN ATTR_NAME_CHUNK_COMPRESSED_SIZE,
 			buf, strlen(buf), 0);
 	if (rc < 0)
@@ -208,14 +412,31 @@ get_rawx_info_from_fd(int fd, GError **error, gchar *hex_chunkid,
 		return TRUE;
 	}
 
-	if (!GET(ATTR_NAME_CONTENT_STGPOL, chunk->content_storage_policy)) {
-		/* just one check to detect unsupported xattr */
-		if (errno == ENOTSUP) {
-			GSETCODE(error, errno, "xattr not supported");
+	/* The packed layout holds everything in a single value */
+	gsize packed_len = 0;
+	gchar *packed_name = _packed_name(hex_chunkid);
+	gchar *packed = _getxattr_from_fd_len(fd, packed_name, &packed_len);
+	g_free(packed_name);
+	if (packed) {
+		GError *err = _packed_decode(chunk, (guint8*) packed, packed_len);
+		g_free(packed);
+		if (err) {
+			g_propagate_error(error, err);
 			return FALSE;
 		}
+		oio_str_replace(&chunk->chunk_id, hex_chunkid);
+		if (!chunk->content_fullpath) {
+			GSETCODE(error, EINVAL, "missing fullpath in packed xattr");
+			return FALSE;
+		}
+		return _decode_fullpath(chunk, error);
+	} else if (errno == ENOTSUP) {
+		GSETCODE(error, errno, "xattr not supported");
+		return FALSE;
 	}
 
+	GET(ATTR_NAME_CONTENT_STGPOL, chunk->content_storage_policy);
+
 	gchar *attr_name_content_fullpath = g_strconcat(
 			ATTR_DOMAIN_OIO "." ATTR_NAME_CONTENT_FULLPATH ":", hex_chunkid,
 			NULL);
@@ -224,29 +445,8 @@ get_rawx_info_from_fd(int fd, GError **error, gchar *hex_chunkid,
 	if (chunk->content_fullpath) {
 		// New chunk
 		chunk->chunk_id = g_strdup(hex_chunkid);
-		gchar **fullpath = g_strsplit(chunk->content_fullpath, "/", -1);
-		guint fullpath_len = g_strv_length(fullpath);
-		if (fullpath_len != 5) {
-			GSETCODE(error, EINVAL, "invalid xattr fullpath");
+		if (!_decode_fullpath(chunk, error))
 			return FALSE;
-		}
-
-		char *account = g_uri_unescape_string(fullpath[0], NULL);
-		char *container = g_uri_unescape_string(fullpath[1], NULL);
-		guint8 container_id[32];
-		char container_hexid[65];
-		// NS is unused
-		oio_str_hash_name(container_id, NULL, account, container);
-		oio_str_bin2hex(container_id, sizeof(container_id),
-				container_hexid, sizeof(container_hexid));
-		g_free(account);
-		g_free(container);
-
-		chunk->container_id = g_strdup(container_hexid);
-		chunk->content_path = g_uri_unescape_string(fullpath[2], NULL);
-		chunk->content_version = g_uri_unescape_string(fullpath[3], NULL);
-		chunk->content_id = g_uri_unescape_string(fullpath[4], NULL);
-		g_strfreev(fullpath);
 	} else {
 		// Old chunk
 		GET(ATTR_NAME_CHUNK_ID,          chunk->chunk_id);
@@ -272,6 +472,7 @@ get_rawx_info_from_fd(int fd, GError **error, gchar *hex_chunkid,
 	GET(ATTR_NAME_CHUNK_SIZE, chunk->chunk_size);
 	GET(ATTR_NAME_CHUNK_POS,  chunk->chunk_position);
 	GET(ATTR_NAME_CHUNK_HASH, chunk->chunk_hash);
+	GET(ATTR_NAME_CHUNK_HASH_ALGO, chunk->chunk_hash_algo);
 
 	GET(ATTR_NAME_CHUNK_METADATA_COMPRESS, chunk->compression_metadata);
 	GET(ATTR_NAME_CHUNK_COMPRESSED_SIZE,   chunk->compression_size);
@@ -281,6 +482,35 @@ get_rawx_info_from_fd(int fd, GError **error, gchar *hex_chunkid,
 	return TRUE;
 }
 
+gboolean
+update_rawx_info_to_fd(int fd, GError **error, gchar *hex_chunkid,
+		struct chunk_textinfo_s *chunk, gboolean packed)
+{
+	struct chunk_textinfo_s old = {0};
+	if (!get_rawx_info_from_fd(fd, error, hex_chunkid, &old)) {
+		chunk_textinfo_free_content(&old);
+		return FALSE;
+	}
+
+	/* A shallow copy: the values belong either to the caller or to <old> */
+	struct chunk_textinfo_s merged = *chunk;
+	for (guint8 tag = 1; tag < PACKED_MAX; ++tag) {
+		/* A new hash comes with its own algorithm, if any */
+		if (tag == PACKED_CHUNK_HASH_ALGO && merged.chunk_hash)
+			continue;
+		gchar **pv = _packed_field(&merged, tag);
+		if (!*pv)
+			*pv = *_packed_field(&old, tag);
+	}
+	if (!merged.chunk_id)
+		merged.chunk_id = hex_chunkid;
+
+	gboolean rc = (packed ? set_rawx_info_to_fd_packed : set_rawx_info_to_fd)(
+			fd, error, &merged);
+	chunk_textinfo_free_content(&old);
+	return rc;
+}
+
 gboolean
 get_rawx_info_from_file(const char *p, GError **error, gchar *hex_chunkid,
 		struct chunk_textinfo_s *chunk)
@@ -304,6 +534,42 @@ get_compression_info_in_attr(const char *p, GError ** error, GHashTable *table)
 	EXTRA_ASSERT (p != NULL);
 	EXTRA_ASSERT (table != NULL);
 
+	/* The packed value, when present, hides the legacy attribute */
+	int fd = open(p, O_RDONLY);
+	if (fd < 0) {
+		GSETCODE(error, errno, "open() error: (%d) %s", errno, strerror(errno));
+		return FALSE;
+	}
+	gsize packed_len = 0;
+	gchar *hex_chunkid = g_path_get_basename(p);
+	gchar *packed_name = _packed_name(hex_chunkid);
+	gchar *packed = _getxattr_from_fd_len(fd, packed_name, &packed_len);
+	int errsav = errno;
+	g_free(packed_name);
+	g_free(hex_chunkid);
+	metautils_pclose(&fd);
+	if (packed) {
+		struct chunk_textinfo_s cti = {0};
+		GError *err = _packed_decode(&cti, (guint8*) packed, packed_len);
+		g_free(packed);
+		if (!err && cti.compression_metadata && *cti.compression_metadata) {
+			GHashTable *ht = metadata_unpack_string(
+					cti.compression_metadata, NULL);
+			metadata_merge(table, ht);
+			g_hash_table_destroy(ht);
+		}
+		chunk_textinfo_free_content(&cti);
+		if (err) {
+			g_propagate_error(error, err);
+			return FALSE;
+		}
+		return TRUE;
+	} else if (errsav != ENODATA) {
+		GSETCODE(error, errsav, "Failed to get compression attr: %s",
+				strerror(errsav));
+		return FALSE;
+	}
+
 	gchar buf[2048];
 	memset(buf, 0, sizeof(buf));
 
@@ -337,7 +603,12 @@ remove_fullpath_from_attr(const char *p, GError **error,
 		gchar *xname = g_strconcat(
 				ATTR_DOMAIN_OIO "." ATTR_NAME_CONTENT_FULLPATH ":", hex_chunkid,
 				NULL);
-		const int rc = fremovexattr(fd, xname);
+		int rc = fremovexattr(fd, xname);
+		g_free(xname);
+		/* The chunk has one of both layouts */
+		xname = _packed_name(hex_chunkid);
+		if (0 == fremovexattr(fd, xname))
+			rc = 0;
 		g_free(xname);
 		close(fd);
 		return rc != -1;
@@ -367,6 +638,7 @@ chunk_textinfo_free_content(struct chunk_textinfo_s *cti)
 	oio_str_clean (&cti->chunk_id);
 	oio_str_clean (&cti->chunk_size);
 	oio_str_clean (&cti->chunk_hash);
+	oio_str_clean (&cti->chunk_hash_algo);
 	oio_str_clean (&cti->chunk_position);
 
 	oio_str_clean (&cti->compression_metadata);
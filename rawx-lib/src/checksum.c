@@ -0,0 +1,301 @@
+/*
+OpenIO SDS rawx-lib
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <core/internals.h>
+
+#include "checksum.h"
+
+/* XXH64, after the reference specification by Yann Collet:
+ * https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ * The input is consumed by stripes of 32 bytes, on 4 independent
+ * accumulators that the compilers keep in registers. */
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_STRIPE 32
+
+struct xxh64_state_s
+{
+	guint64 total;
+	guint64 v[4];
+	guint8 mem[XXH_STRIPE];
+	guint memsize;
+	guint64 seed;
+};
+
+static inline guint64
+_rotl64(guint64 x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+_read64(const guint8 *p)
+{
+	guint64 v;
+	memcpy(&v, p, sizeof(v));
+	return GUINT64_FROM_LE(v);
+}
+
+static inline guint32
+_read32(const guint8 *p)
+{
+	guint32 v;
+	memcpy(&v, p, sizeof(v));
+	return GUINT32_FROM_LE(v);
+}
+
+static inline guint64
+_xxh64_round(guint64 acc, guint64 input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = _rotl64(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+_xxh64_merge(guint64 acc, guint64 val)
+{
+	acc ^= _xxh64_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void
+_xxh64_init(struct xxh64_state_s *st, guint64 seed)
+{
+	memset(st, 0, sizeof(*st));
+	st->seed = seed;
+	st->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+	st->v[1] = seed + XXH_PRIME64_2;
+	st->v[2] = seed;
+	st->v[3] = seed - XXH_PRIME64_1;
+}
+
+static const guint8 *
+_xxh64_stripes(guint64 *v, const guint8 *p, const guint8 *end)
+{
+	guint64 v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+	while (p + XXH_STRIPE <= end) {
+		v0 = _xxh64_round(v0, _read64(p));
+		v1 = _xxh64_round(v1, _read64(p + 8));
+		v2 = _xxh64_round(v2, _read64(p + 16));
+		v3 = _xxh64_round(v3, _read64(p + 24));
+		p += XXH_STRIPE;
+	}
+	v[0] = v0, v[1] = v1, v[2] = v2, v[3] = v3;
+	return p;
+}
+
+static void
+_xxh64_update(struct xxh64_state_s *st, const guint8 *p, gsize len)
+{
+	const guint8 *end = p + len;
+	st->total += len;
+
+	if (st->memsize + len < XXH_STRIPE) {
+		memcpy(st->mem + st->memsize, p, len);
+		st->memsize += len;
+		return;
+	}
+
+	if (st->memsize) {
+		const guint fill = XXH_STRIPE - st->memsize;
+		memcpy(st->mem + st->memsize, p, fill);
+		_xxh64_stripes(st->v, st->mem, st->mem + XXH_STRIPE);
+		p += fill;
+		st->memsize = 0;
+	}
+
+	p = _xxh64_stripes(st->v, p, end);
+	if (p < end) {
+		st->memsize = end - p;
+		memcpy(st->mem, p, st->memsize);
+	}
+}
+
+static guint64
+_xxh64_digest(const struct xxh64_state_s *st)
+{
+	guint64 h;
+
+	if (st->total >= XXH_STRIPE) {
+		const guint64 *v = st->v;
+		h = _rotl64(v[0], 1) + _rotl64(v[1], 7)
+			+ _rotl64(v[2], 12) + _rotl64(v[3], 18);
+		h = _xxh64_merge(h, v[0]);
+		h = _xxh64_merge(h, v[1]);
+		h = _xxh64_merge(h, v[2]);
+		h = _xxh64_merge(h, v[3]);
+	} else {
+		h = st->seed + XXH_PRIME64_5;
+	}
+	h += st->total;
+
+	const guint8 *p = st->mem, *end = st->mem + st->memsize;
+	for (; p + 8 <= end; p += 8) {
+		h ^= _xxh64_round(0, _read64(p));
+		h = _rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		h ^= (guint64)_read32(p) * XXH_PRIME64_1;
+		h = _rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * XXH_PRIME64_5;
+		h = _rotl64(h, 11) * XXH_PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+guint64
+oio_xxh64(const guint8 *buf, gsize len, guint64 seed)
+{
+	struct xxh64_state_s st;
+	_xxh64_init(&st, seed);
+	_xxh64_update(&st, buf, len);
+	return _xxh64_digest(&st);
+}
+
+/* -------------------------------------------------------------------------- */
+
+enum chunk_checksum_type_e
+{
+	CHUNK_CHECKSUM_GLIB,
+	CHUNK_CHECKSUM_XXH64,
+};
+
+struct chunk_checksum_algo_s
+{
+	const char *name;
+	enum chunk_checksum_type_e type;
+	GChecksumType glib_type;
+};
+
+static const struct chunk_checksum_algo_s algos[] =
+{
+	{"md5",    CHUNK_CHECKSUM_GLIB,  G_CHECKSUM_MD5},
+	{"sha256", CHUNK_CHECKSUM_GLIB,  G_CHECKSUM_SHA256},
+	{"xxh64",  CHUNK_CHECKSUM_XXH64, 0},
+	{NULL, 0, 0}
+};
+
+struct chunk_checksum_s
+{
+	const struct chunk_checksum_algo_s *algo;
+	GChecksum *glib;
+	struct xxh64_state_s xxh64;
+	gchar *hex;
+};
+
+static const struct chunk_checksum_algo_s *
+_find_algo(const char *name)
+{
+	if (!name)
+		return NULL;
+	for (const struct chunk_checksum_algo_s *a = algos; a->name; a++) {
+		if (!g_ascii_strcasecmp(a->name, name))
+			return a;
+	}
+	return NULL;
+}
+
+gboolean
+chunk_checksum_algo_is_known(const char *algo)
+{
+	return _find_algo(algo) != NULL;
+}
+
+const char *
+chunk_checksum_algo_name(guint i)
+{
+	return i < G_N_ELEMENTS(algos) ? algos[i].name : NULL;
+}
+
+struct chunk_checksum_s *
+chunk_checksum_new(const char *name)
+{
+	const struct chunk_checksum_algo_s *algo = _find_algo(name);
+	if (!algo)
+		return NULL;
+
+	struct chunk_checksum_s *cs = g_malloc0(sizeof(*cs));
+	cs->algo = algo;
+	if (algo->type == CHUNK_CHECKSUM_GLIB)
+		cs->glib = g_checksum_new(algo->glib_type);
+	else
+		_xxh64_init(&cs->xxh64, 0);
+	return cs;
+}
+
+void
+chunk_checksum_free(struct chunk_checksum_s *cs)
+{
+	if (!cs)
+		return;
+	if (cs->glib)
+		g_checksum_free(cs->glib);
+	g_free(cs->hex);
+	g_free(cs);
+}
+
+void
+chunk_checksum_update(struct chunk_checksum_s *cs,
+		const guint8 *buf, gsize len)
+{
+	EXTRA_ASSERT(cs->hex == NULL);
+	if (cs->glib)
+		g_checksum_update(cs->glib, buf, len);
+	else
+		_xxh64_update(&cs->xxh64, buf, len);
+}
+
+const char *
+chunk_checksum_get_string(struct chunk_checksum_s *cs)
+{
+	if (!cs->hex) {
+		if (cs->glib) {
+			cs->hex = g_ascii_strup(g_checksum_get_string(cs->glib), -1);
+		} else {
+			/* The canonical form of XXH64 is big endian */
+			cs->hex = g_strdup_printf("%016" G_GINT64_MODIFIER "X",
+					_xxh64_digest(&cs->xxh64));
+		}
+	}
+	return cs->hex;
+}
+
+const char *
+chunk_checksum_get_name(struct chunk_checksum_s *cs)
+{
+	return cs->algo->name;
+}
@@ -0,0 +1,57 @@
+/*
+OpenIO SDS rawx-lib
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OIO_SDS__rawx_lib__src__checksum_h
+# define OIO_SDS__rawx_lib__src__checksum_h 1
+
+#include <glib.h>
+
+/* The algorithm of the chunks without any explicit one */
+#define CHUNK_CHECKSUM_DEFAULT "md5"
+
+/* Hash of the body of a chunk, with one of the algorithms below.
+ * - "md5": the legacy one, still the default
+ * - "sha256"
+ * - "xxh64": non-cryptographic, an order of magnitude faster than MD5,
+ *   bundled because GLib does not provide it */
+struct chunk_checksum_s;
+
+/** Returns NULL if the algorithm is unknown. The names are case-insensitive. */
+struct chunk_checksum_s * chunk_checksum_new(const char *algo);
+
+void chunk_checksum_free(struct chunk_checksum_s *cs);
+
+void chunk_checksum_update(struct chunk_checksum_s *cs,
+		const guint8 *buf, gsize len);
+
+/** The digest in uppercase hexadecimal. The checksum cannot be updated
+ * anymore. The string belongs to `cs`. */
+const char * chunk_checksum_get_string(struct chunk_checksum_s *cs);
+
+/** The canonical (lowercase) name of the algorithm */
+const char * chunk_checksum_get_name(struct chunk_checksum_s *cs);
+
+gboolean chunk_checksum_algo_is_known(const char *algo);
+
+/** The name of the i-th known algorithm, NULL past the last one */
+const char * chunk_checksum_algo_name(guint i);
+
+/** One-shot XXH64, exposed for the tests */
+guint64 oio_xxh64(const guint8 *buf, gsize len, guint64 seed);
+
+#endif /*OIO_SDS__rawx_lib__src__checksum_h*/
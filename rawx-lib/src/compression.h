@@ -32,6 +32,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define SUCCESS_CODE 0
 
+/* The codecs of the blocks. All of them share the framing of the block
+ * compressed files (see zlib_compress.c), only the magic header differs. */
+struct block_codec_s {
+	const char *name;
+	const guint8 *magic; /* 8 bytes */
+	gsize (*bound) (gsize len);
+	/* <out_len> is the capacity of <out> on input, the size of the
+	 * result on output */
+	gboolean (*compress) (guint8 *out, gsize *out_len,
+			const guint8 *in, gsize in_len);
+	gboolean (*uncompress) (guint8 *out, gsize *out_len,
+			const guint8 *in, gsize in_len);
+};
+
+extern const struct block_codec_s block_codec_zlib;
+
+/* An entry of the block index that trails the compressed chunks: where the
+ * block starts in the file and in the uncompressed data. The last entry
+ * points to the EOF marker. */
+struct compressed_block_s {
+	guint64 uncompressed_offset;
+	guint64 compressed_offset;
+};
+
 struct compressed_chunk_s {
 	FILE *fd;
 	gchar* uncompressed_size;
@@ -45,13 +69,17 @@ struct compressed_chunk_s {
 	guint32 flags;
 	int method;
 	int level;
+	const struct block_codec_s *codec;
+	/* NULL for the chunks compressed without any block index */
+	struct compressed_block_s *index;
+	guint index_len;
 };
 
 /* Compression context definition */
 
-typedef int (*write_header_f)(FILE *fd, guint32 blocksize, gulong *checksum, guint32 *compressed_size);
+typedef int (*write_header_f)(FILE *fd, guint32 blocksize, gulong *checksum, guint64 *compressed_size);
 typedef int (*compress_data_f)(const void *buf, gsize bufsize, GByteArray *result, gulong *checksum);
-typedef int (*write_eof_f)(FILE *fd, gulong checksum, guint32 *compressed_size);
+typedef int (*write_eof_f)(FILE *fd, gulong checksum, GArray *index, guint64 *compressed_size);
 typedef int (*compressed_chunk_get_data_f)(struct compressed_chunk_s *chunk, gsize offset, guint8 *buf, gsize buf_len, GError **error);
 typedef int (*compressed_chunk_init_f)(struct compressed_chunk_s *chunk, const gchar *path);
 typedef int (*compressed_chunk_check_integrity_f)(struct compressed_chunk_s *chunk);
@@ -69,21 +97,39 @@ struct compression_ctx_s {
 
 gboolean init_compression_ctx(struct compression_ctx_s* comp_ctx, const gchar* algo_name);
 
-// ZLIB FUNCTIONS //
+// BLOCK COMPRESSED FILES //
 
-int zlib_write_compress_header(FILE *fd, guint32 blocksize, gulong *checksum, guint32 *compressed_size);
+int block_write_compress_header(const struct block_codec_s *codec, FILE *fd,
+		guint32 blocksize, gulong *checksum, guint64 *compressed_size);
 
-int zlib_write_compress_eof(FILE *fd, gulong checksum, guint32 *compressed_size);
+/* Writes the EOF marker and the checksum, then the block index when <index>
+ * (of struct compressed_block_s) is not NULL. The caller records an entry
+ * before each block, then one for the EOF marker. */
+int block_write_compress_eof(FILE *fd, gulong checksum, GArray *index,
+		guint64 *compressed_size);
 
-int zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gulong *checksum);
+int block_compress_chunk_part(const struct block_codec_s *codec,
+		const void *buf, gsize bufsize, GByteArray *result, gulong *checksum);
 
-int zlib_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, guint8 *buf, gsize buf_len, GError **error);
+int block_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, guint8 *buf, gsize buf_len, GError **error);
 
-int zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path);
+int block_compressed_chunk_init(const struct block_codec_s *codec,
+		struct compressed_chunk_s *chunk, const gchar *path);
 
-gboolean zlib_compressed_chunk_check_integrity(struct compressed_chunk_s *chunk);
+/* Releases what the chunk_initiator allocated, but not <chunk> itself */
+void block_compressed_chunk_clean(struct compressed_chunk_s *chunk);
 
-gboolean zlib_init_compress_checksum(gulong *checksum);
+gboolean block_compressed_chunk_check_integrity(struct compressed_chunk_s *chunk);
+
+gboolean block_init_compress_checksum(gulong *checksum);
+
+// ZLIB FUNCTIONS //
+
+int zlib_write_compress_header(FILE *fd, guint32 blocksize, gulong *checksum, guint64 *compressed_size);
+
+int zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gulong *checksum);
+
+int zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path);
 
 /***********************************************************************/
 
@@ -91,7 +137,7 @@ gboolean zlib_init_compress_checksum(gulong *checksum);
  * Compress a chunk file
  *
  * @param path the chunk file path to compress
- * @param algorithm the compression algorithm to use (LZO / ZLIB)
+ * @param algorithm the compression algorithm to use (ZLIB / LZ4 / ZSTD)
  * @param blocksize the compression blocksize
  * @param error a glib GError pointer
  *
@@ -101,7 +147,7 @@ gboolean zlib_init_compress_checksum(gulong *checksum);
 int compress_chunk(const gchar* path, const gchar* algorithm, const gint64 blocksize, gboolean preserve, GError ** error);
 
 gboolean compress_file(FILE *src, FILE *dst, struct compression_ctx_s * comp_ctx,
-		gint64 blocksize, gulong *checksum, guint32 *compressed_size);
+		gint64 blocksize, gulong *checksum, guint64 *compressed_size);
 
 /*
  * Uncompressing a chunk file
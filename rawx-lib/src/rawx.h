@@ -29,6 +29,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 # define ATTR_NAME_CONTENT_FULLPATH "content.fullpath"
 
+/* All the attributes of a chunk packed in one value, suffixed by the chunk
+ * ID like the fullpath. */
+# define ATTR_NAME_PACKED "packed"
+
 # define ATTR_NAME_CONTENT_CONTAINER "content.container"
 
 # define ATTR_NAME_CONTENT_ID      "content.id"
@@ -48,6 +52,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 # define ATTR_NAME_CHUNK_SIZE "chunk.size"
 # define ATTR_NAME_CHUNK_POS  "chunk.position"
 # define ATTR_NAME_CHUNK_HASH "chunk.hash"
+/* Absent for the legacy MD5, see checksum.h */
+# define ATTR_NAME_CHUNK_HASH_ALGO "chunk.hash_algo"
 
 # define ATTR_NAME_CHUNK_METADATA_COMPRESS "compression.metadata"
 # define ATTR_NAME_CHUNK_COMPRESSED_SIZE   "compression.size"
@@ -88,6 +94,7 @@ typedef struct chunk_textinfo_s
 	gchar *chunk_size;
 	gchar *chunk_position;
 	gchar *chunk_hash;
+	gchar *chunk_hash_algo;
 
 	gchar *compression_metadata;
 	gchar *compression_size;
@@ -105,14 +112,28 @@ gboolean set_rawx_info_to_file(const char *p, GError **error,
 gboolean set_rawx_info_to_fd(int fd, GError **error,
 		struct chunk_textinfo_s *chunk);
 
+/* Like set_rawx_info_to_fd(), but all the attributes are packed in a single
+ * extended attribute. Both layouts are understood by the readers, the packed
+ * one taking precedence. */
+gboolean set_rawx_info_to_file_packed(const char *p, GError **error,
+		struct chunk_textinfo_s *chunk);
+gboolean set_rawx_info_to_fd_packed(int fd, GError **error,
+		struct chunk_textinfo_s *chunk);
+
 gboolean set_compression_info_in_attr(const char *p, GError **error, const char *v);
-gboolean set_chunk_compressed_size_in_attr(const char *p, GError **error, guint32 v);
+gboolean set_chunk_compressed_size_in_attr(const char *p, GError **error, guint64 v);
 
 gboolean get_rawx_info_from_file(const char *p, GError **error, gchar *hex_chunkid,
 		struct chunk_textinfo_s *chunk);
 gboolean get_rawx_info_from_fd(int fd, GError **error, gchar *hex_chunkid,
 		struct chunk_textinfo_s *chunk);
 
+/* Sets the attributes of the chunk in the given layout, and keeps the ones
+ * already set that <chunk> does not carry, whatever their layout. Each
+ * layout hides the other, so that a partial update would lose them. */
+gboolean update_rawx_info_to_fd(int fd, GError **error, gchar *hex_chunkid,
+		struct chunk_textinfo_s *chunk, gboolean packed);
+
 gboolean get_compression_info_in_attr(const char *p, GError **error, GHashTable *table);
 
 gboolean remove_fullpath_from_attr(const char *p, GError **error,
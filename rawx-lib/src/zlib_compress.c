@@ -40,20 +40,68 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <errno.h>
 
+/* Block compressed files:
+ *   magic[8] | guint32 block size
+ *   then each block: gulong uncompressed size | gulong compressed size | data
+ *     (both sizes are equal when the block is stored uncompressed)
+ *   then guint32 0 (EOF marker) | gulong adler32 of the uncompressed data
+ *   then, optionally, the block index (see struct compressed_block_s):
+ *     (guint64 uncompressed offset | guint64 compressed offset) * count
+ *     guint32 count | index_magic[8]
+ * The index is little endian. The chunks written before the index still
+ * decompress, at the cost of a linear walk of the block headers to serve
+ * a range. */
+
 /* magic file header for zlib block compressed files */
-static const unsigned char magic[8] =
+static const guint8 magic_zlib[8] =
     { 0x00, 0xe9, 0x5a, 0x4c, 0x49, 0x42, 0xff, 0x1a };
 
-#define HEADER_SIZE (sizeof(magic) + sizeof(guint32))
+static const guint8 index_magic[8] =
+    { 0x00, 0xe9, 0x42, 0x49, 0x44, 0x58, 0xff, 0x1a };
+
+#define HEADER_SIZE (8 + sizeof(guint32))
+
+#define INDEX_FOOTER_SIZE (sizeof(guint32) + sizeof(index_magic))
+
+/* 1M entries already describe 1TiB with the smallest block size */
+#define INDEX_MAX_ENTRIES (1024 * 1024)
+
+static gsize
+_zlib_bound(gsize len)
+{
+	return compressBound(len);
+}
+
+static gboolean
+_zlib_compress(guint8 *out, gsize *out_len, const guint8 *in, gsize in_len)
+{
+	uLongf l = *out_len;
+	if (compress(out, &l, in, in_len) != Z_OK)
+		return FALSE;
+	*out_len = l;
+	return TRUE;
+}
 
-static uLong
-get_working_buffer_size(uLong uncompressed_size)
+static gboolean
+_zlib_uncompress(guint8 *out, gsize *out_len, const guint8 *in, gsize in_len)
 {
-	return compressBound(uncompressed_size);
+	uLongf l = *out_len;
+	int r = uncompress(out, &l, in, in_len);
+	if (r != Z_OK) {
+		GRID_DEBUG("zlib uncompress returned %d", r);
+		return FALSE;
+	}
+	*out_len = l;
+	return TRUE;
 }
 
+const struct block_codec_s block_codec_zlib = {
+	"ZLIB", magic_zlib, _zlib_bound, _zlib_compress, _zlib_uncompress
+};
+
 int
-zlib_write_compress_header(FILE *fd, guint32 blocksize, gulong *checksum, guint32 *compressed_size)
+block_write_compress_header(const struct block_codec_s *codec, FILE *fd,
+		guint32 blocksize, gulong *checksum, guint64 *compressed_size)
 {
 	gsize written = 0;
 
@@ -63,7 +111,7 @@ zlib_write_compress_header(FILE *fd, guint32 blocksize, gulong *checksum, guint3
 
 #define HEADER_APPEND(V, S) g_byte_array_append(headers,(guint8*)V, S);
 
-	headers = HEADER_APPEND(&magic, sizeof(magic)); /* char[8] */
+	headers = HEADER_APPEND(codec->magic, 8); /* char[8] */
 	headers = HEADER_APPEND(&blocksize, sizeof(blocksize)); /* guint32 */
 
 	written = fwrite(headers->data, headers->len, 1, fd);
@@ -87,8 +135,25 @@ end:
 	return status;
 }
 
+static void
+_append_index(GByteArray *out, GArray *index)
+{
+	for (guint i = 0; i < index->len; i++) {
+		struct compressed_block_s *blk =
+			&g_array_index(index, struct compressed_block_s, i);
+		guint64 u = GUINT64_TO_LE(blk->uncompressed_offset);
+		guint64 c = GUINT64_TO_LE(blk->compressed_offset);
+		g_byte_array_append(out, (guint8*)&u, sizeof(u));
+		g_byte_array_append(out, (guint8*)&c, sizeof(c));
+	}
+	guint32 count = GUINT32_TO_LE(index->len);
+	g_byte_array_append(out, (guint8*)&count, sizeof(count));
+	g_byte_array_append(out, index_magic, sizeof(index_magic));
+}
+
 int
-zlib_write_compress_eof(FILE *fd, gulong checksum, guint32 *compressed_size)
+block_write_compress_eof(FILE *fd, gulong checksum, GArray *index,
+		guint64 *compressed_size)
 {
 	guint32 eof_marker = 0;
 	gsize written = 0;
@@ -99,6 +164,9 @@ zlib_write_compress_eof(FILE *fd, gulong checksum, guint32 *compressed_size)
 	eof = g_byte_array_append(eof, (guint8*)&eof_marker, sizeof(guint32));
 	eof = g_byte_array_append(eof, (guint8*)&checksum, sizeof(gulong));
 
+	if (index)
+		_append_index(eof, index);
+
 	written = fwrite(eof->data, eof->len, 1, fd);
 
 	if (written != 1) {
@@ -119,11 +187,12 @@ end:
 }
 
 int
-zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gulong* checksum)
+block_compress_chunk_part(const struct block_codec_s *codec,
+		const void *buf, gsize bufsize, GByteArray *result, gulong* checksum)
 {
 	guint8* out = NULL;
 	gulong bufsize_ulong = bufsize;
-	gulong out_max;
+	gsize out_max;
 	int r = 0;
 
 	/* Sanity check */
@@ -132,7 +201,7 @@ zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gul
 		return 1;
 	}
 
-	out_max = get_working_buffer_size(bufsize);
+	out_max = codec->bound(bufsize);
 	out = g_malloc0(out_max);
 	*checksum = adler32(*checksum, buf, bufsize_ulong);
 
@@ -142,10 +211,9 @@ zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gul
 	}
 
 	/* compress block */
-	r = compress(out, &out_max, buf, bufsize_ulong);
-	if (r != Z_OK){
+	if (!codec->compress(out, &out_max, buf, bufsize)) {
 		/* this should NEVER happen */
-		GRID_ERROR("internal error - compression failed");
+		GRID_ERROR("internal error - %s compression failed", codec->name);
 		r = 2;
 		goto err;
 	}
@@ -157,12 +225,13 @@ zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gul
 
 	if (out_max < bufsize_ulong) {
 		/* write compressed block */
-		result = DATA_APPEND(&out_max, sizeof(gulong));
+		gulong out_max_ulong = out_max;
+		result = DATA_APPEND(&out_max_ulong, sizeof(gulong));
 		result = DATA_APPEND(out, out_max);
 	}
 	else {
 		/* not compressible - write uncompressed block */
-		result = DATA_APPEND(&bufsize, sizeof(gulong));
+		result = DATA_APPEND(&bufsize_ulong, sizeof(gulong));
 		result = DATA_APPEND(buf, bufsize);
 	}
 
@@ -174,8 +243,29 @@ err:
 	return r;
 }
 
+/* Returns the last block starting at or before <offset>, NULL if there is
+ * no index or if <offset> is past the last block. */
+static const struct compressed_block_s *
+_find_block(struct compressed_chunk_s *chunk, guint64 offset)
+{
+	if (!chunk->index || chunk->index_len < 2)
+		return NULL;
+	/* the last entry is the EOF marker */
+	guint lo = 0, hi = chunk->index_len - 1;
+	if (offset >= chunk->index[hi].uncompressed_offset)
+		return NULL;
+	while (hi - lo > 1) {
+		const guint mid = lo + (hi - lo) / 2;
+		if (chunk->index[mid].uncompressed_offset <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return chunk->index + lo;
+}
+
 static int
-_zlib_fill_decompressed_buffer(struct compressed_chunk_s * chunk, gsize to_skip)
+_fill_decompressed_buffer(struct compressed_chunk_s * chunk, gsize to_skip)
 {
 	gsize nb_read = 0;
 	gsize total_skipped = 0;
@@ -191,6 +281,26 @@ _zlib_fill_decompressed_buffer(struct compressed_chunk_s * chunk, gsize to_skip)
 	chunk->buf_offset = 0;
 	chunk->data_len = 0;
 
+	/* Jump over the blocks to skip instead of walking their headers. The
+	 * file is positioned at the start of the block following <read>. */
+	if (to_skip > 0 && chunk->index) {
+		const guint64 target = (guint64)chunk->read + to_skip;
+		const struct compressed_block_s *blk = _find_block(chunk, target);
+		if (!blk) {
+			/* past the last block */
+			chunk->read += to_skip;
+			return 0;
+		}
+		if (blk->uncompressed_offset > chunk->read) {
+			if (fseeko(chunk->fd, blk->compressed_offset, SEEK_SET)) {
+				GRID_DEBUG("Failed to seek to block: %s", strerror(errno));
+				return -1;
+			}
+			to_skip = target - blk->uncompressed_offset;
+			chunk->read = blk->uncompressed_offset;
+		}
+	}
+
 	while(1) {
 		/* read uncompressed size */
 		nb_read = 0;
@@ -267,7 +377,7 @@ _zlib_fill_decompressed_buffer(struct compressed_chunk_s * chunk, gsize to_skip)
 	}
 	else { /* in_len < chunk->data_len */
 		guint8* in;
-		gulong new_len;
+		gsize new_len;
 
 		/* place compressed block at the end of the buffer */
 		chunk->buf_len = chunk->data_len;
@@ -290,11 +400,11 @@ _zlib_fill_decompressed_buffer(struct compressed_chunk_s * chunk, gsize to_skip)
 
 		/* uncompress */
 		new_len = chunk->buf_len;
-		r = uncompress(chunk->buf, &new_len, in, in_len);
+		gboolean ok = chunk->codec->uncompress(chunk->buf, &new_len, in, in_len);
 		g_free(in);
 
-		if (r != Z_OK) {
-			GRID_DEBUG("zlib uncompress returned %d", r);
+		if (!ok || new_len != chunk->data_len) {
+			GRID_DEBUG("%s uncompress failed", chunk->codec->name);
 			r = -1;
 			goto err;
 		}
@@ -308,7 +418,7 @@ err:
 }
 
 gboolean
-zlib_compressed_chunk_check_integrity(struct compressed_chunk_s *chunk)
+block_compressed_chunk_check_integrity(struct compressed_chunk_s *chunk)
 {
 	gchar *eof_info = NULL;
 	gulong c;
@@ -349,7 +459,7 @@ end:
 }
 
 int
-zlib_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, guint8 *buf, gsize buf_len, GError **error)
+block_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, guint8 *buf, gsize buf_len, GError **error)
 {
 	gsize max_to_read;
 	gsize to_skip = 0;
@@ -357,14 +467,23 @@ zlib_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, g
 	(void) error;
 
 	if(offset > 0) {
-		to_skip = offset - (chunk->data_len - chunk->buf_offset);
-		chunk->buf_offset = MIN(chunk->data_len, chunk->buf_offset + offset);
+		/* Skip what remains in the current block, the rest is skipped
+		 * while refilling. */
+		const gsize left = chunk->buf ? chunk->data_len - chunk->buf_offset : 0;
+		if (offset < left) {
+			chunk->buf_offset += offset;
+			chunk->read += offset;
+		} else {
+			to_skip = offset - left;
+			chunk->buf_offset = chunk->data_len;
+			chunk->read += left;
+		}
 	}
 
 	if (!chunk->buf || !chunk->data_len || chunk->buf_offset >= chunk->data_len) {
 		int rf;
 
-		rf = _zlib_fill_decompressed_buffer(chunk, to_skip);
+		rf = _fill_decompressed_buffer(chunk, to_skip);
 		if (rf < 0) {
 			GRID_TRACE("An error occured while filling buffer");
 			return -1;
@@ -399,8 +518,58 @@ zlib_compressed_chunk_get_data(struct compressed_chunk_s *chunk, gsize offset, g
 	return max_to_read;
 }
 
+/* Loads the trailing block index, if any, then rewinds <ck->fd> right after
+ * the header. A missing or inconsistent index is not an error. */
+static void
+_load_block_index(struct compressed_chunk_s *ck)
+{
+	guint8 footer[INDEX_FOOTER_SIZE];
+	guint8 *raw = NULL;
+	guint32 count = 0;
+
+	if (fseeko(ck->fd, -(off_t)sizeof(footer), SEEK_END)
+			|| 1 != fread(footer, sizeof(footer), 1, ck->fd)
+			|| memcmp(footer + sizeof(guint32), index_magic, sizeof(index_magic)))
+		goto rewind;
+
+	memcpy(&count, footer, sizeof(count));
+	count = GUINT32_FROM_LE(count);
+	if (count < 2 || count > INDEX_MAX_ENTRIES)
+		goto rewind;
+
+	const gsize raw_len = count * 2 * sizeof(guint64);
+	raw = g_malloc(raw_len);
+	if (fseeko(ck->fd, -(off_t)(sizeof(footer) + raw_len), SEEK_END)
+			|| 1 != fread(raw, raw_len, 1, ck->fd))
+		goto rewind;
+
+	struct compressed_block_s *index = g_malloc(count * sizeof(*index));
+	for (guint32 i = 0; i < count; i++) {
+		guint64 u, c;
+		memcpy(&u, raw + i * 16, sizeof(u));
+		memcpy(&c, raw + i * 16 + 8, sizeof(c));
+		index[i].uncompressed_offset = GUINT64_FROM_LE(u);
+		index[i].compressed_offset = GUINT64_FROM_LE(c);
+		if (index[i].compressed_offset < HEADER_SIZE || (i > 0 &&
+				(index[i].uncompressed_offset <= index[i-1].uncompressed_offset
+				 || index[i].compressed_offset <= index[i-1].compressed_offset))) {
+			GRID_DEBUG("Inconsistent block index, ignored");
+			g_free(index);
+			goto rewind;
+		}
+	}
+	ck->index = index;
+	ck->index_len = count;
+
+rewind:
+	g_free(raw);
+	if (fseeko(ck->fd, HEADER_SIZE, SEEK_SET))
+		GRID_DEBUG("Failed to rewind the chunk: %s", strerror(errno));
+}
+
 int
-zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path)
+block_compressed_chunk_init(const struct block_codec_s *codec,
+		struct compressed_chunk_s *chunk, const gchar *path)
 {
 	int r = 0;
 	gsize nb_read;
@@ -451,11 +620,11 @@ zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path)
 
 	do { /* extract all headers */
 		#define GETNEXTPTR(Res,Ptr,Type) do { Res = *((Type *)Ptr); Ptr = ((char*)Ptr) + sizeof(Type); } while (0)
-		char *ptr = ((char*)headers + sizeof(magic));
+		char *ptr = ((char*)headers + 8);
 		GETNEXTPTR(ck.block_size, ptr, guint32);
 	} while (0);
 
-	if (memcmp(headers, magic, sizeof(magic)) != 0) {
+	if (memcmp(headers, codec->magic, 8) != 0) {
 		r = 4;
 		goto err;
 	}
@@ -466,6 +635,8 @@ zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path)
 
 	GRID_TRACE("ck.block_size : %d", ck.block_size);
 
+	_load_block_index(&ck);
+	ck.codec = codec;
 	ck.checksum = adler32(0,NULL,0);
 	memcpy(chunk, &ck, sizeof(ck));
 	GRID_TRACE("chunk->uncompressed_size = %s", chunk->uncompressed_size);
@@ -479,10 +650,48 @@ err:
 	return r;
 }
 
+void
+block_compressed_chunk_clean(struct compressed_chunk_s *chunk)
+{
+	if (!chunk)
+		return;
+	if (chunk->fd) {
+		fclose(chunk->fd);
+		chunk->fd = NULL;
+	}
+	g_free(chunk->buf);
+	chunk->buf = NULL;
+	g_free(chunk->uncompressed_size);
+	chunk->uncompressed_size = NULL;
+	g_free(chunk->index);
+	chunk->index = NULL;
+	chunk->index_len = 0;
+}
+
 gboolean
-zlib_init_compress_checksum(gulong* checksum)
+block_init_compress_checksum(gulong* checksum)
 {
-	GRID_TRACE("Init checksum in zlib context");
+	GRID_TRACE("Init checksum in block compression context");
 	*checksum = adler32(0,NULL,0);
 	return TRUE;
 }
+
+int
+zlib_write_compress_header(FILE *fd, guint32 blocksize, gulong *checksum, guint64 *compressed_size)
+{
+	return block_write_compress_header(&block_codec_zlib, fd, blocksize,
+			checksum, compressed_size);
+}
+
+int
+zlib_compress_chunk_part(const void *buf, gsize bufsize, GByteArray *result, gulong *checksum)
+{
+	return block_compress_chunk_part(&block_codec_zlib, buf, bufsize,
+			result, checksum);
+}
+
+int
+zlib_compressed_chunk_init(struct compressed_chunk_s *chunk, const gchar *path)
+{
+	return block_compressed_chunk_init(&block_codec_zlib, chunk, path);
+}
@@ -59,7 +59,7 @@ help(int argc, char **args)
 	g_printerr("\t -h : displays this help section;\n");
 	g_printerr("\t -v : verbose mode, increases debug output;\n");
 	g_printerr("\t -p : preserve mode (recommanded);\n");
-	g_printerr("\t -a : compression algorithm (lzo/zlib, default zlib)\n");
+	g_printerr("\t -a : compression algorithm (zlib/lz4/zstd, default zlib)\n");
 	g_printerr("\t -b : compression blocksize\n");
 }
 
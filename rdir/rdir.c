@@ -48,6 +48,13 @@ static GCond cond_bases;
 static GMutex lock_bases;
 static GTree *tree_bases = NULL;
 
+/* Shared by all the bases, created at the startup with the sizes kept
+ * aside, the variables possibly changing later. */
+static leveldb_cache_t *db_cache = NULL;
+static leveldb_filterpolicy_t *db_filter = NULL;
+static gint64 db_cache_size = 0;
+static gint64 db_bloom_bits_per_key = 0;
+
 #define OPT(N) _option(args, (N))
 
 #define CHECK_METHOD(M) do { \
@@ -64,6 +71,27 @@ static GTree *tree_bases = NULL;
 #define KEY_LOCK	 ADMIN_PREFIX "lock"
 #define KEY_INCIDENT ADMIN_PREFIX "incident_date"
 
+/* Marks the volumes whose counters are maintained, the counters themselves
+ * are stored under COUNTERS_PREFIX "<container id>" */
+#define KEY_COUNTERS ADMIN_PREFIX "counters"
+#define COUNTERS_PREFIX KEY_COUNTERS "|"
+
+/* Marks the volumes whose chunk records all have the current format */
+#define KEY_FORMAT ADMIN_PREFIX "format"
+
+/* Secondary index of the chunks, ordered by mtime. Each entry is an empty
+ * value at MTIME_PREFIX "<mtime, 16 hex digits>|<cid>|<content>|<chunk>".
+ * KEY_MTIME_INDEX marks the volumes whose index is complete. */
+#define MTIME_PREFIX "mtime|"
+#define MTIME_KEY_LEN (sizeof(MTIME_PREFIX "0123456789ABCDEF|") - 1)
+#define KEY_MTIME_INDEX ADMIN_PREFIX "mtime_index"
+
+/* The chunk records used to be JSON objects repeating the IDs already present
+ * in the key. They are now made of a version byte followed by the mtime as a
+ * varint (LEB128), and the IDs are decoded from the key. A JSON record always
+ * starts with '{', so both formats can be told apart. */
+#define RECORD_VERSION 0x01
+
 #define STRDUPA(Out, Src, Len) do { \
 	if (Src) { \
 		(Out) = alloca(1 + (Len)); \
@@ -242,6 +270,27 @@ struct rdir_base_s
 {
 	leveldb_t *base;
 	GThread *owner;
+
+	/* Serializes the writes, so that the counters are updated consistently
+	 * with the records. */
+	GMutex lock;
+	gboolean counters_checked;
+	gboolean counters_ready;
+
+	gboolean mtime_index_checked;
+	gboolean mtime_index_ready;
+
+	/* Progress of the migration of the chunk records to RECORD_VERSION */
+	gboolean format_checked;
+	gboolean format_ready;
+	GString *format_marker;
+};
+
+/* Chunks and chunks to rebuild, for one container */
+struct rdir_counter_s
+{
+	gint64 total;
+	gint64 to_rebuild;
 };
 
 struct rdir_record_s
@@ -264,6 +313,9 @@ _base_destroy(struct rdir_base_s *base)
 
 	base->owner = NULL;
 
+	if (base->format_marker)
+		g_string_free(base->format_marker, TRUE);
+	g_mutex_clear(&base->lock);
 	g_free(base);
 }
 
@@ -279,17 +331,13 @@ _record_to_key(struct rdir_record_s *rec)
 static void
 _record_encode(struct rdir_record_s *rec, GString *value)
 {
-	g_string_append_c(value, '{');
-	oio_str_gstring_append_json_pair(value, "container_id", rec->container);
-	g_string_append_c(value, ',');
-	oio_str_gstring_append_json_pair(value, "content_id", rec->content);
-	g_string_append_c(value, ',');
-	oio_str_gstring_append_json_pair(value, "chunk_id", rec->chunk);
-	if (rec->mtime > 0) {
-		g_string_append_c(value, ',');
-		oio_str_gstring_append_json_pair_int(value, "mtime", rec->mtime);
-	}
-	g_string_append_c(value, '}');
+	guint64 mtime = MAX(0, rec->mtime);
+	g_string_append_c(value, RECORD_VERSION);
+	do {
+		guint8 b = mtime & 0x7F;
+		mtime >>= 7;
+		g_string_append_c(value, mtime ? (b | 0x80) : b);
+	} while (mtime);
 }
 
 static GError *
@@ -324,8 +372,15 @@ _record_extract(struct rdir_record_s *rec, struct json_object *jrecord)
 	return err;
 }
 
+static gboolean
+_record_is_legacy(const char *value, size_t length)
+{
+	return length > 0 && value[0] == '{';
+}
+
 static GError *
-_record_parse(struct rdir_record_s *rec, const char *value, size_t length)
+_record_parse_legacy(struct rdir_record_s *rec,
+		const char *value, size_t length)
 {
 	GError *err = NULL;
 	struct json_object *jrecord = NULL;
@@ -337,6 +392,84 @@ _record_parse(struct rdir_record_s *rec, const char *value, size_t length)
 	return err;
 }
 
+/* Only decode the mtime of a record, the common case of the scans */
+static GError *
+_record_parse_mtime(const char *value, size_t length, gint64 *pmtime)
+{
+	if (_record_is_legacy(value, length)) {
+		struct rdir_record_s rec = {0};
+		GError *err = _record_parse_legacy(&rec, value, length);
+		if (!err)
+			*pmtime = rec.mtime;
+		return err;
+	}
+
+	if (length < 2 || (guint8)value[0] != RECORD_VERSION)
+		return SYSERR("Unknown record format");
+
+	guint64 mtime = 0;
+	for (size_t i = 1, shift = 0; i < length && shift < 64; i++, shift += 7) {
+		const guint8 b = value[i];
+		mtime |= ((guint64)(b & 0x7F)) << shift;
+		if (!(b & 0x80)) {
+			*pmtime = MIN(mtime, (guint64)G_MAXINT64);
+			return NULL;
+		}
+	}
+	return SYSERR("Truncated record");
+}
+
+/* Decode a whole record, the IDs being taken from the key */
+static GError *
+_record_parse(struct rdir_record_s *rec, const char *key, size_t keylen,
+		const char *value, size_t length)
+{
+	if (_record_is_legacy(value, length))
+		return _record_parse_legacy(rec, value, length);
+
+	const char *p = key + sizeof(CHUNK_PREFIX) - 1;
+	const char *end = key + keylen;
+	if (keylen < sizeof(CHUNK_PREFIX "?|?|?") - 1
+			|| memcmp(key, CHUNK_PREFIX, sizeof(CHUNK_PREFIX) - 1))
+		return SYSERR("Not a chunk key");
+	const char *s0 = memchr(p, '|', end - p);
+	const char *s1 = s0 ? memchr(s0 + 1, '|', end - s0 - 1) : NULL;
+	if (!s1)
+		return SYSERR("Malformed chunk key");
+
+	g_snprintf(rec->container, sizeof(rec->container), "%.*s",
+			(int)(s0 - p), p);
+	g_snprintf(rec->content, sizeof(rec->content), "%.*s",
+			(int)(s1 - s0 - 1), s0 + 1);
+	g_snprintf(rec->chunk, sizeof(rec->chunk), "%.*s",
+			(int)(end - s1 - 1), s1 + 1);
+	return _record_parse_mtime(value, length, &rec->mtime);
+}
+
+/* A volume whose format marker names records this rdir cannot decode has
+ * been migrated by a more recent release. Serving it would skip those records
+ * as malformed, so it is refused. */
+static GError *
+_db_check_format(leveldb_t *db)
+{
+	char *errmsg = NULL;
+	size_t length = 0;
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	char *value = leveldb_get(db, options,
+			KEY_FORMAT, sizeof(KEY_FORMAT)-1, &length, &errmsg);
+	leveldb_readoptions_destroy(options);
+	if (errmsg)
+		return _map_errno_to_gerror(errno, errmsg);
+
+	GError *err = NULL;
+	if (value && (length != 1 || value[0] != '0' + RECORD_VERSION))
+		err = NEWERROR(CODE_NOT_IMPLEMENTED,
+				"Unsupported records format [%.*s], expected [%c]",
+				(int)MIN(length, 16), value, '0' + RECORD_VERSION);
+	free(value);
+	return err;
+}
+
 static GError *
 _db_open(const char *volid, gboolean autocreate, leveldb_t **pdb)
 {
@@ -354,6 +487,13 @@ _db_open(const char *volid, gboolean autocreate, leveldb_t **pdb)
 	leveldb_options_t *options = leveldb_options_create();
 	leveldb_options_set_max_open_files(options, rdir_fd_per_base);
 	leveldb_options_set_create_if_missing(options, BOOL(autocreate));
+	leveldb_options_set_write_buffer_size(options, rdir_write_buffer_size);
+	leveldb_options_set_compression(options, rdir_compression
+			? leveldb_snappy_compression : leveldb_no_compression);
+	if (db_cache)
+		leveldb_options_set_cache(options, db_cache);
+	if (db_filter)
+		leveldb_options_set_filter_policy(options, db_filter);
 	db = leveldb_open(options, dbname, &errmsg);
 	leveldb_options_destroy(options);
 	g_free(dbname);
@@ -362,10 +502,18 @@ _db_open(const char *volid, gboolean autocreate, leveldb_t **pdb)
 		errsav = errno;
 		if (!errsav)
 			errsav = ENOENT;
+		*pdb = NULL;
+		return _map_errno_to_gerror(errsav, errmsg);
 	}
 
+	GError *err = _db_check_format(db);
+	if (err) {
+		leveldb_close(db);
+		db = NULL;
+		g_prefix_error(&err, "[%s] ", volid);
+	}
 	*pdb = db;
-	return db ? NULL : _map_errno_to_gerror(errsav, errmsg);
+	return err;
 }
 
 static GError *
@@ -393,6 +541,7 @@ retry:
 		}
 	} else {
 		b = g_malloc0(sizeof(*b));
+		g_mutex_init(&b->lock);
 		g_tree_replace(db_tree, g_strdup(volid), b);
 open:
 		b->owner = g_thread_self();
@@ -428,15 +577,11 @@ _db_get(const char *volid, gboolean autocreate, struct rdir_base_s **pbase)
 }
 
 static GError *
-_db_admin_get_incident(const char *volid, gint64 *pincident)
+_base_get_incident(struct rdir_base_s *base, gint64 *pincident)
 {
+	GError *err = NULL;
 	*pincident = 0;
 
-	struct rdir_base_s *base = NULL;
-	GError *err = _db_get(volid, FALSE, &base);
-	if (err)
-		return err;
-
 	leveldb_readoptions_t *options = leveldb_readoptions_create();
 	leveldb_readoptions_set_fill_cache(options, 1);
 	leveldb_readoptions_set_verify_checksums(options, 0);
@@ -453,12 +598,12 @@ _db_admin_get_incident(const char *volid, gint64 *pincident)
 
 	if (value) {
 		if (length > 32) {
-			err = SYSERR("Invalid incident date for [%s]", volid);
+			err = SYSERR("Invalid incident date");
 		} else {
 			gchar *v;
 			STRDUPA(v, value, length);
 			if (!oio_str_is_number(v, pincident))
-				err = SYSERR("Invalid incident date for [%s]", volid);
+				err = SYSERR("Invalid incident date");
 		}
 		free(value);
 	}
@@ -466,32 +611,699 @@ _db_admin_get_incident(const char *volid, gint64 *pincident)
 }
 
 static GError *
-_db_admin_set_incident(const char *volid, gint64 when)
+_db_admin_get_incident(const char *volid, gint64 *pincident)
 {
+	*pincident = 0;
+
 	struct rdir_base_s *base = NULL;
+	GError *err = _db_get(volid, FALSE, &base);
+	if (err)
+		return err;
+
+	if ((err = _base_get_incident(base, pincident)))
+		g_prefix_error(&err, "[%s] ", volid);
+	return err;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Shared by the counters and the rebuild fetch, so that the status tells
+ * exactly how many chunks the rebuilder will get. A chunk without mtime
+ * (0) might predate the incident, it is rebuilt. A malformed record, whose
+ * mtime is then negative, is skipped by the fetch: it is never rebuilt. */
+static gboolean
+_is_to_rebuild(gint64 mtime, gint64 incident)
+{
+	return incident > 0 && mtime >= 0 && mtime <= incident;
+}
+
+static void
+_counter_decode(struct rdir_counter_s *counter, const char *v, size_t len)
+{
+	gchar *s, *end = NULL;
+	STRDUPA(s, v, MIN(len, 64));
+	counter->total = g_ascii_strtoll(s, &end, 10);
+	counter->to_rebuild = (end && *end) ? g_ascii_strtoll(end, NULL, 10) : 0;
+}
+
+/* Extract the container ID from a chunk key, "chunk|<cid>|<content>|<chunk>" */
+static gboolean
+_key_to_cid(const char *key, size_t len, gchar *cid, gsize cidlen)
+{
+	if (len < sizeof(CHUNK_PREFIX "?|?|?")-1)
+		return FALSE;
+	g_snprintf(cid, cidlen, "%.*s",
+			(int)(len - sizeof(CHUNK_PREFIX) + 1),
+			key + sizeof(CHUNK_PREFIX) - 1);
+	char *colon = strchr(cid, '|');
+	if (!colon)
+		return FALSE;
+	*colon = 0;
+	return TRUE;
+}
+
+/* Count the chunks (if <with_total>) and the chunks to rebuild of each
+ * container of the volume, in <counters>. This is the only full scan of the
+ * volume, and it only happens once for each incident. */
+static void
+_base_scan_counters(struct rdir_base_s *base, gint64 incident,
+		gboolean with_total, GTree *counters)
+{
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(options, 0);
+	leveldb_readoptions_set_verify_checksums(options, 0);
+	leveldb_iterator_t *it = leveldb_create_iterator(base->base, options);
+	leveldb_readoptions_destroy(options);
+	leveldb_iter_seek(it, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+	for (; leveldb_iter_valid(it); leveldb_iter_next(it)) {
+		size_t len = 0;
+		const char *k0 = leveldb_iter_key(it, &len);
+		if (len < sizeof(CHUNK_PREFIX)-1
+				|| memcmp(k0, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1))
+			break;
+
+		gchar cid[128];
+		if (!_key_to_cid(k0, len, cid, sizeof(cid)))
+			continue;
+
+		gboolean to_rebuild = FALSE;
+		if (incident > 0) {
+			gint64 mtime = 0;
+			size_t vallen = 0;
+			const char *v0 = leveldb_iter_value(it, &vallen);
+			GError *err = _record_parse_mtime(v0, vallen, &mtime);
+			if (err) {
+				GRID_TRACE("malformed record [%.*s]: (%d) %s",
+						(int)len, k0, err->code, err->message);
+				g_clear_error(&err);
+				mtime = -1;
+			}
+			to_rebuild = _is_to_rebuild(mtime, incident);
+		}
+		if (!with_total && !to_rebuild)
+			continue;
+
+		struct rdir_counter_s *counter = g_tree_lookup(counters, cid);
+		if (!counter) {
+			counter = g_malloc0(sizeof(*counter));
+			g_tree_insert(counters, g_strdup(cid), counter);
+		}
+		if (with_total)
+			counter->total ++;
+		if (to_rebuild)
+			counter->to_rebuild ++;
+	}
+	leveldb_iter_destroy(it);
+}
+
+/* Count the chunks to rebuild of each container in <counters>, from the
+ * mtime index: only the entries up to the incident are read. */
+static void
+_base_scan_rebuild_by_mtime(struct rdir_base_s *base, gint64 incident,
+		GTree *counters)
+{
+	gchar bound[MTIME_KEY_LEN + 1];
+	g_snprintf(bound, sizeof(bound), MTIME_PREFIX "%016" G_GINT64_MODIFIER "X",
+			MAX(0, incident));
+	const gsize bound_len = MTIME_KEY_LEN - 1;
+
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(options, 0);
+	leveldb_readoptions_set_verify_checksums(options, 0);
+	leveldb_iterator_t *it = leveldb_create_iterator(base->base, options);
+	leveldb_readoptions_destroy(options);
+	leveldb_iter_seek(it, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1);
+	for (; leveldb_iter_valid(it); leveldb_iter_next(it)) {
+		size_t len = 0;
+		const char *k0 = leveldb_iter_key(it, &len);
+		if (len <= MTIME_KEY_LEN
+				|| memcmp(k0, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1)
+				|| memcmp(k0, bound, bound_len) > 0)
+			break;
+
+		gchar cid[128];
+		g_snprintf(cid, sizeof(cid), "%.*s",
+				(int)(len - MTIME_KEY_LEN), k0 + MTIME_KEY_LEN);
+		char *colon = strchr(cid, '|');
+		if (!colon)
+			continue;
+		*colon = 0;
+
+		struct rdir_counter_s *counter = g_tree_lookup(counters, cid);
+		if (!counter) {
+			counter = g_malloc0(sizeof(*counter));
+			g_tree_insert(counters, g_strdup(cid), counter);
+		}
+		counter->to_rebuild ++;
+	}
+	leveldb_iter_destroy(it);
+}
+
+/* Tell if the counters of the volume are maintained. They are on the volumes
+ * created since the counters exist, the older volumes get them at the first
+ * status request. */
+static GError *
+_base_check_counters(struct rdir_base_s *base)
+{
+	if (base->counters_checked)
+		return NULL;
+
+	char *errmsg = NULL;
+	size_t length = 0;
+	leveldb_readoptions_t *roptions = leveldb_readoptions_create();
+	char *value = leveldb_get(base->base, roptions,
+			KEY_COUNTERS, sizeof(KEY_COUNTERS)-1, &length, &errmsg);
+	if (errmsg) {
+		leveldb_readoptions_destroy(roptions);
+		return _map_errno_to_gerror(errno, errmsg);
+	}
+
+	if (value) {
+		free(value);
+		base->counters_ready = TRUE;
+	} else {
+		/* No chunk yet, the counters start now */
+		leveldb_iterator_t *it = leveldb_create_iterator(base->base, roptions);
+		leveldb_iter_seek(it, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+		gboolean empty = TRUE;
+		if (leveldb_iter_valid(it)) {
+			size_t keylen = 0;
+			const char *key = leveldb_iter_key(it, &keylen);
+			empty = keylen < sizeof(CHUNK_PREFIX)-1
+				|| memcmp(key, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+		}
+		leveldb_iter_destroy(it);
+
+		if (empty) {
+			leveldb_writeoptions_t *woptions = leveldb_writeoptions_create();
+			leveldb_put(base->base, woptions,
+					KEY_COUNTERS, sizeof(KEY_COUNTERS)-1, "1", 1, &errmsg);
+			leveldb_writeoptions_destroy(woptions);
+			if (errmsg) {
+				leveldb_readoptions_destroy(roptions);
+				return _map_errno_to_gerror(errno, errmsg);
+			}
+			base->counters_ready = TRUE;
+		}
+	}
+	leveldb_readoptions_destroy(roptions);
+
+	base->counters_checked = TRUE;
+	return NULL;
+}
+
+/* Build the key of the index entry of the chunk at <key> */
+static void
+_mtime_key(GString *out, gint64 mtime, const char *key, size_t keylen)
+{
+	g_string_printf(out, MTIME_PREFIX "%016" G_GINT64_MODIFIER "X|%.*s",
+			MAX(0, mtime),
+			(int)(keylen - sizeof(CHUNK_PREFIX) + 1),
+			key + sizeof(CHUNK_PREFIX) - 1);
+}
+
+/* Tell if the volume has a complete mtime index. The index starts with the
+ * volume if it is created empty, otherwise it is built at the first fetch
+ * that needs it. */
+static GError *
+_base_check_mtime_index(struct rdir_base_s *base)
+{
+	if (base->mtime_index_checked)
+		return NULL;
+
+	char *errmsg = NULL;
+	size_t length = 0;
+	leveldb_readoptions_t *roptions = leveldb_readoptions_create();
+	char *value = leveldb_get(base->base, roptions,
+			KEY_MTIME_INDEX, sizeof(KEY_MTIME_INDEX)-1, &length, &errmsg);
+	if (!errmsg && value) {
+		free(value);
+		base->mtime_index_ready = TRUE;
+	} else if (!errmsg && rdir_mtime_index) {
+		leveldb_iterator_t *it = leveldb_create_iterator(base->base, roptions);
+		leveldb_iter_seek(it, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+		gboolean empty = TRUE;
+		if (leveldb_iter_valid(it)) {
+			size_t keylen = 0;
+			const char *key = leveldb_iter_key(it, &keylen);
+			empty = keylen < sizeof(CHUNK_PREFIX)-1
+				|| memcmp(key, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+		}
+		leveldb_iter_destroy(it);
+
+		if (empty) {
+			leveldb_writeoptions_t *woptions = leveldb_writeoptions_create();
+			leveldb_put(base->base, woptions,
+					KEY_MTIME_INDEX, sizeof(KEY_MTIME_INDEX)-1, "1", 1,
+					&errmsg);
+			leveldb_writeoptions_destroy(woptions);
+			base->mtime_index_ready = !errmsg;
+		}
+	}
+	leveldb_readoptions_destroy(roptions);
+
+	if (errmsg)
+		return _map_errno_to_gerror(errno, errmsg);
+	base->mtime_index_checked = TRUE;
+	return NULL;
+}
+
+/* A set of changes applied atomically to a base. On the volumes, it also
+ * carries the changes of the counters and of the mtime index implied by the
+ * changes of chunks. */
+struct rdir_write_s
+{
+	struct rdir_base_s *base;
+	leveldb_writebatch_t *batch;
+	gboolean sync;
+
+	/* The chunks are counted as "to rebuild" against that date */
+	gint64 incident;
+
+	/* Maintain the mtime index along with the chunks */
+	gboolean indexed;
+
+	/* <container id> -> struct rdir_counter_s, the variations of the counters
+	 * brought by the batch. NULL when the counters are not maintained. */
+	GTree *deltas;
+
+	/* <chunk key> -> the mtime of the chunks written by the batch, or -1 for
+	 * the chunks removed by the batch. */
+	GHashTable *written;
+
+	/* Reset all the counters (resp. all the "to rebuild" counters) before
+	 * applying the variations. */
+	gboolean drop_all;
+	gboolean drop_rebuild;
+};
+
+/* Lock the base and prepare a batch of changes. <counted> tells if the
+ * counters must follow the changes (only for the volumes). Whatever the
+ * outcome, _write_end() must be called. */
+static GError *
+_write_begin(struct rdir_write_s *w, struct rdir_base_s *base,
+		gboolean counted)
+{
 	GError *err = NULL;
 
-	if ((err = _db_get(volid, FALSE, &base)))
-		return err;
+	memset(w, 0, sizeof(*w));
+	w->base = base;
+	w->batch = leveldb_writebatch_create();
+	g_mutex_lock(&base->lock);
+
+	if (!counted)
+		return NULL;
+
+	if (!(err = _base_check_counters(base)) && base->counters_ready
+			&& !(err = _base_get_incident(base, &w->incident)))
+		w->deltas = g_tree_new_full(metautils_strcmp3, NULL, g_free, g_free);
+	if (!err && !(err = _base_check_mtime_index(base)))
+		w->indexed = base->mtime_index_ready;
+	if (w->deltas || w->indexed)
+		w->written = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, g_free);
+	return err;
+}
+
+static void
+_write_end(struct rdir_write_s *w)
+{
+	if (w->written)
+		g_hash_table_destroy(w->written);
+	if (w->deltas)
+		g_tree_destroy(w->deltas);
+	leveldb_writebatch_destroy(w->batch);
+	g_mutex_unlock(&w->base->lock);
+	memset(w, 0, sizeof(*w));
+}
+
+/* Account the change of state of a chunk, from (present <was>, <old_mtime>)
+ * to (present <is>, <new_mtime>). */
+static void
+_write_account(struct rdir_write_s *w, const char *cid, GString *key,
+		gboolean was, gint64 old_mtime, gboolean is, gint64 new_mtime)
+{
+	if (w->deltas) {
+		struct rdir_counter_s *delta = g_tree_lookup(w->deltas, cid);
+		if (!delta) {
+			delta = g_malloc0(sizeof(*delta));
+			g_tree_insert(w->deltas, g_strdup(cid), delta);
+		}
+		delta->total += BOOL(is) - BOOL(was);
+		delta->to_rebuild +=
+			BOOL(is && _is_to_rebuild(new_mtime, w->incident))
+			- BOOL(was && _is_to_rebuild(old_mtime, w->incident));
+	}
+
+	if (key && w->written) {
+		gint64 *pmtime = g_malloc(sizeof(gint64));
+		*pmtime = is ? new_mtime : -1;
+		g_hash_table_replace(w->written, g_strdup(key->str), pmtime);
+	}
+}
+
+/* Get the current state of the chunk at <key>, as the batch would leave it */
+static GError *
+_write_lookup(struct rdir_write_s *w, GString *key,
+		gboolean *present, gint64 *mtime)
+{
+	gint64 *pmtime = g_hash_table_lookup(w->written, key->str);
+	if (pmtime) {
+		*present = *pmtime >= 0;
+		*mtime = MAX(0, *pmtime);
+		return NULL;
+	}
 
 	char *errmsg = NULL;
-	gchar buf[64];
-	gsize len = g_snprintf(buf, sizeof(buf), "%"G_GINT64_FORMAT, when);
+	size_t length = 0;
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_verify_checksums(options, 0);
+	char *value = leveldb_get(w->base->base, options,
+			key->str, key->len, &length, &errmsg);
+	leveldb_readoptions_destroy(options);
+	if (errmsg)
+		return _map_errno_to_gerror(errno, errmsg);
 
-	/* forward to the ... nope, this is too short to be insulated */
-	leveldb_writeoptions_t *woptions = leveldb_writeoptions_create();
-	leveldb_writeoptions_set_sync(woptions, 1);
-	leveldb_put(base->base, woptions,
-			KEY_INCIDENT, sizeof(KEY_INCIDENT)-1,
-			buf, len, &errmsg);
-	int errsav = errno;
-	leveldb_writeoptions_destroy(woptions);
+	*present = value != NULL;
+	*mtime = 0;
+	if (value) {
+		/* A malformed record is still counted in the total, but it is
+		 * neither to be rebuilt nor in the mtime index: it gets a negative
+		 * mtime, as in _base_scan_counters(). */
+		GError *err = _record_parse_mtime(value, length, mtime);
+		if (err)
+			*mtime = -1;
+		g_clear_error(&err);
+		free(value);
+	}
+	return NULL;
+}
+
+static void
+_write_index(struct rdir_write_s *w, const char *key, size_t keylen,
+		gint64 mtime, gboolean present)
+{
+	GString *ikey = g_string_sized_new(256);
+	_mtime_key(ikey, mtime, key, keylen);
+	if (present)
+		leveldb_writebatch_put(w->batch, ikey->str, ikey->len, "", 0);
+	else
+		leveldb_writebatch_delete(w->batch, ikey->str, ikey->len);
+	g_string_free(ikey, TRUE);
+}
+
+static GError *
+_write_chunk_put(struct rdir_write_s *w, struct rdir_record_s *rec)
+{
+	GError *err = NULL;
+	GString *key = _record_to_key(rec);
+	GString *value = g_string_sized_new(16);
+	_record_encode(rec, value);
+
+	if (w->written) {
+		gboolean present = FALSE;
+		gint64 mtime = 0;
+		if (!(err = _write_lookup(w, key, &present, &mtime))) {
+			_write_account(w, rec->container, key,
+					present, mtime, TRUE, rec->mtime);
+			if (w->indexed) {
+				if (present && mtime >= 0)
+					_write_index(w, key->str, key->len, mtime, FALSE);
+				_write_index(w, key->str, key->len, rec->mtime, TRUE);
+			}
+		}
+	}
+	if (!err)
+		leveldb_writebatch_put(w->batch,
+				key->str, key->len, value->str, value->len);
+
+	g_string_free(key, TRUE);
+	g_string_free(value, TRUE);
+	return err;
+}
+
+static GError *
+_write_chunk_delete(struct rdir_write_s *w, struct rdir_record_s *rec)
+{
+	GError *err = NULL;
+	GString *key = _record_to_key(rec);
+
+	if (w->written) {
+		gboolean present = FALSE;
+		gint64 mtime = 0;
+		if (!(err = _write_lookup(w, key, &present, &mtime)) && present) {
+			_write_account(w, rec->container, key, TRUE, mtime, FALSE, 0);
+			if (w->indexed && mtime >= 0)
+				_write_index(w, key->str, key->len, mtime, FALSE);
+		}
+	}
+	if (!err)
+		leveldb_writebatch_delete(w->batch, key->str, key->len);
+
+	g_string_free(key, TRUE);
+	return err;
+}
+
+static void
+_write_counter(struct rdir_write_s *w, const char *cid,
+		struct rdir_counter_s *counter)
+{
+	GString *key = g_string_sized_new(128);
+	g_string_printf(key, COUNTERS_PREFIX "%s", cid);
+	if (counter->total <= 0) {
+		leveldb_writebatch_delete(w->batch, key->str, key->len);
+	} else {
+		gchar buf[64];
+		gsize len = g_snprintf(buf, sizeof(buf),
+				"%" G_GINT64_FORMAT " %" G_GINT64_FORMAT,
+				counter->total, MAX(0, counter->to_rebuild));
+		leveldb_writebatch_put(w->batch, key->str, key->len, buf, len);
+	}
+	g_string_free(key, TRUE);
+}
+
+/* Add to the batch the new value of each counter touched by the batch. */
+static GError *
+_write_counters(struct rdir_write_s *w)
+{
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_verify_checksums(options, 0);
+
+	/* Reset the counters as asked, and apply the variations on the way */
+	if (w->drop_all || w->drop_rebuild) {
+		leveldb_iterator_t *it = leveldb_create_iterator(w->base->base, options);
+		leveldb_iter_seek(it, COUNTERS_PREFIX, sizeof(COUNTERS_PREFIX)-1);
+		for (; leveldb_iter_valid(it); leveldb_iter_next(it)) {
+			size_t keylen = 0, vallen = 0;
+			const char *key = leveldb_iter_key(it, &keylen);
+			if (keylen < sizeof(COUNTERS_PREFIX)-1
+					|| memcmp(key, COUNTERS_PREFIX, sizeof(COUNTERS_PREFIX)-1))
+				break;
+
+			gchar cid[128];
+			g_snprintf(cid, sizeof(cid), "%.*s",
+					(int)(keylen - sizeof(COUNTERS_PREFIX) + 1),
+					key + sizeof(COUNTERS_PREFIX) - 1);
+			struct rdir_counter_s counter = {0};
+			if (!w->drop_all) {
+				const char *val = leveldb_iter_value(it, &vallen);
+				_counter_decode(&counter, val, vallen);
+				counter.to_rebuild = 0;
+			}
+			struct rdir_counter_s *delta = g_tree_lookup(w->deltas, cid);
+			if (delta) {
+				counter.total += delta->total;
+				counter.to_rebuild += delta->to_rebuild;
+				g_tree_remove(w->deltas, cid);
+			}
+			_write_counter(w, cid, &counter);
+		}
+		leveldb_iter_destroy(it);
+	}
+
+	/* Then apply the variations on the other counters */
+	GError *err = NULL;
+	gboolean _on_delta(gpointer k, gpointer v, gpointer i UNUSED) {
+		struct rdir_counter_s *delta = v;
+		if (!delta->total && !delta->to_rebuild)
+			return FALSE;
+
+		struct rdir_counter_s counter = {0};
+		char *errmsg = NULL;
+		size_t vallen = 0;
+		gchar key[128 + sizeof(COUNTERS_PREFIX)];
+		gsize keylen = g_snprintf(key, sizeof(key), COUNTERS_PREFIX "%s",
+				(const char*)k);
+		char *val = leveldb_get(w->base->base, options,
+				key, keylen, &vallen, &errmsg);
+		if (errmsg) {
+			err = _map_errno_to_gerror(errno, errmsg);
+			return TRUE;
+		}
+		if (val) {
+			_counter_decode(&counter, val, vallen);
+			free(val);
+		}
+		counter.total += delta->total;
+		counter.to_rebuild += delta->to_rebuild;
+		_write_counter(w, k, &counter);
+		return FALSE;
+	}
+	g_tree_foreach(w->deltas, _on_delta, NULL);
+
+	leveldb_readoptions_destroy(options);
+	return err;
+}
+
+static GError *
+_write_commit(struct rdir_write_s *w)
+{
+	GError *err = NULL;
+	if (w->deltas && (err = _write_counters(w)))
+		return err;
+
+	char *errmsg = NULL;
+	leveldb_writeoptions_t *options = leveldb_writeoptions_create();
+	leveldb_writeoptions_set_sync(options, BOOL(w->sync));
+	leveldb_write(w->base->base, options, w->batch, &errmsg);
+	const int errsav = errno;
+	leveldb_writeoptions_destroy(options);
 
 	if (!errmsg)
 		return NULL;
 	return _map_errno_to_gerror(errsav, errmsg);
 }
 
+/* Build the counters of a volume that has none, with a full scan. */
+static GError *
+_write_build_counters(struct rdir_write_s *w)
+{
+	GError *err = NULL;
+	if ((err = _base_get_incident(w->base, &w->incident)))
+		return err;
+
+	w->deltas = g_tree_new_full(metautils_strcmp3, NULL, g_free, g_free);
+	w->drop_all = TRUE;
+	_base_scan_counters(w->base, w->incident, TRUE, w->deltas);
+	leveldb_writebatch_put(w->batch,
+			KEY_COUNTERS, sizeof(KEY_COUNTERS)-1, "1", 1);
+	if (!(err = _write_commit(w)))
+		w->base->counters_ready = TRUE;
+	return err;
+}
+
+/* Build the mtime index of a volume that has none, with a full scan. The
+ * base is locked by the caller, so the entries are written by slices to
+ * bound the memory, and the marker comes with the last slice. */
+static GError *
+_base_build_mtime_index(struct rdir_base_s *base)
+{
+	char *errmsg = NULL;
+	guint nb = 0;
+	GString *ikey = g_string_sized_new(256);
+	leveldb_writebatch_t *batch = leveldb_writebatch_create();
+	leveldb_writeoptions_t *woptions = leveldb_writeoptions_create();
+	leveldb_readoptions_t *roptions = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(roptions, 0);
+	leveldb_readoptions_set_verify_checksums(roptions, 0);
+	leveldb_iterator_t *it = leveldb_create_iterator(base->base, roptions);
+	leveldb_readoptions_destroy(roptions);
+
+	void _flush(gboolean force) {
+		if (errmsg || (!force && nb < 4096))
+			return;
+		leveldb_write(base->base, woptions, batch, &errmsg);
+		leveldb_writebatch_clear(batch);
+		nb = 0;
+	}
+
+	/* Drop the leftovers of a build that did not complete */
+	leveldb_iter_seek(it, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1);
+	for (; !errmsg && leveldb_iter_valid(it); leveldb_iter_next(it)) {
+		size_t keylen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen < sizeof(MTIME_PREFIX)-1
+				|| memcmp(key, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1))
+			break;
+		leveldb_writebatch_delete(batch, key, keylen);
+		nb ++;
+		_flush(FALSE);
+	}
+
+	leveldb_iter_seek(it, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+	for (; !errmsg && leveldb_iter_valid(it); leveldb_iter_next(it)) {
+		size_t keylen = 0, vallen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen < sizeof(CHUNK_PREFIX)-1
+				|| memcmp(key, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1))
+			break;
+
+		gint64 mtime = 0;
+		const char *val = leveldb_iter_value(it, &vallen);
+		GError *err = _record_parse_mtime(val, vallen, &mtime);
+		if (err) {
+			GRID_INFO("Malformed record at [%.*s]", (int)keylen, key);
+			g_clear_error(&err);
+			continue;
+		}
+		_mtime_key(ikey, mtime, key, keylen);
+		leveldb_writebatch_put(batch, ikey->str, ikey->len, "", 0);
+		nb ++;
+		_flush(FALSE);
+	}
+	leveldb_iter_destroy(it);
+
+	leveldb_writebatch_put(batch,
+			KEY_MTIME_INDEX, sizeof(KEY_MTIME_INDEX)-1, "1", 1);
+	_flush(TRUE);
+	const int errsav = errno;
+
+	leveldb_writeoptions_destroy(woptions);
+	leveldb_writebatch_destroy(batch);
+	g_string_free(ikey, TRUE);
+
+	if (errmsg)
+		return _map_errno_to_gerror(errsav, errmsg);
+	base->mtime_index_ready = TRUE;
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static GError *
+_db_admin_set_incident(const char *volid, gint64 when)
+{
+	struct rdir_base_s *base = NULL;
+	GError *err = NULL;
+
+	if ((err = _db_get(volid, FALSE, &base)))
+		return err;
+
+	gchar buf[64];
+	gsize len = g_snprintf(buf, sizeof(buf), "%"G_GINT64_FORMAT, when);
+
+	struct rdir_write_s w;
+	if (!(err = _write_begin(&w, base, TRUE))) {
+		w.sync = TRUE;
+		leveldb_writebatch_put(w.batch,
+				KEY_INCIDENT, sizeof(KEY_INCIDENT)-1, buf, len);
+		/* The chunks to rebuild are counted again for the new date. With
+		 * the mtime index, only the chunks to rebuild are read, instead of
+		 * the whole volume while the pushes wait for the lock. */
+		if (w.deltas) {
+			w.incident = when;
+			w.drop_rebuild = TRUE;
+			if (w.indexed)
+				_base_scan_rebuild_by_mtime(base, when, w.deltas);
+			else
+				_base_scan_counters(base, when, FALSE, w.deltas);
+		}
+		err = _write_commit(&w);
+	}
+	_write_end(&w);
+	return err;
+}
+
 static GError *
 _db_insert_generic(struct rdir_base_s *base, GString *key, GString *value)
 {
@@ -511,15 +1323,20 @@ _db_insert_generic(struct rdir_base_s *base, GString *key, GString *value)
 }
 
 static GError *
-_db_vol_push(const char *volid, gboolean autocreate, GString *key,
-			 GString *value)
+_db_vol_push(const char *volid, gboolean autocreate,
+		struct rdir_record_s *rec)
 {
 	struct rdir_base_s *base = NULL;
 	GError *err = _db_get(volid, autocreate, &base);
 	if (err)
 		return err;
 
-	return _db_insert_generic(base, key, value);
+	struct rdir_write_s w;
+	if (!(err = _write_begin(&w, base, TRUE))
+			&& !(err = _write_chunk_put(&w, rec)))
+		err = _write_commit(&w);
+	_write_end(&w);
+	return err;
 }
 
 static GError *
@@ -580,18 +1397,17 @@ _db_vol_fetch(const char *volid, GString *value,
 		if (keylen < prefix_len || 0 != memcmp(key, prefix, prefix_len))
 			break;
 
-		struct rdir_record_s rec = {0};
+		gint64 mtime = 0;
 		const char *val = leveldb_iter_value(it, &vallen);
-		err = _record_parse(&rec, val, vallen);
+		err = _record_parse_mtime(val, vallen, &mtime);
 		if (err) {
 			GRID_INFO("Malformed record at [%.*s]", (int)keylen, key);
 			g_clear_error(&err);
 			continue;
 		}
 
-		if (rebuild && incident_date > 0 && rec.mtime > incident_date) {
+		if (rebuild && !_is_to_rebuild(mtime, incident_date))
 			continue;
-		}
 
 		if (nb++ > 0)
 			g_string_append_c(value, ',');
@@ -604,7 +1420,7 @@ _db_vol_fetch(const char *volid, GString *value,
 		g_string_append_c(value, '"');
 		g_string_append_c(value, ',');
 		g_string_append_c(value, '{');
-		oio_str_gstring_append_json_pair_int(value, "mtime", rec.mtime);
+		oio_str_gstring_append_json_pair_int(value, "mtime", mtime);
 		g_string_append_c(value, '}');
 		g_string_append_c(value, ']');
 
@@ -616,6 +1432,121 @@ _db_vol_fetch(const char *volid, GString *value,
 	return NULL;
 }
 
+/* Fetch the chunks in the order of their mtime, up to <max_mtime>, thanks
+ * to the secondary index. The position is given by the chunk and its mtime,
+ * the mtime being looked for when not provided. */
+static GError *
+_db_vol_fetch_by_mtime(const char *volid, GString *value,
+		const char *start_after, gint64 start_after_mtime,
+		gint64 limit, gint64 max_mtime)
+{
+	struct rdir_base_s *base = NULL;
+	GError *err = NULL;
+
+	limit = CLAMP(limit, 1, 4096);
+
+	if ((err = _db_get(volid, FALSE, &base)))
+		return err;
+
+	g_mutex_lock(&base->lock);
+	if (!(err = _base_check_mtime_index(base)) && !base->mtime_index_ready) {
+		if (!rdir_mtime_index) {
+			err = BADREQ("mtime index disabled");
+		} else {
+			GRID_NOTICE("Building the mtime index of [%s]", volid);
+			err = _base_build_mtime_index(base);
+		}
+	}
+	g_mutex_unlock(&base->lock);
+	if (err)
+		return err;
+
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(options, 0);
+	leveldb_readoptions_set_verify_checksums(options, 0);
+
+	GString *seek = g_string_sized_new(256);
+	if (!start_after) {
+		g_string_append_static(seek, MTIME_PREFIX);
+	} else {
+		g_string_printf(seek, CHUNK_PREFIX "%s", start_after);
+		if (start_after_mtime < 0) {
+			char *errmsg = NULL;
+			size_t vallen = 0;
+			char *val = leveldb_get(base->base, options,
+					seek->str, seek->len, &vallen, &errmsg);
+			if (errmsg)
+				err = _map_errno_to_gerror(errno, errmsg);
+			else if (!val)
+				err = NEWERROR(CODE_NOT_FOUND,
+						"chunk not found, provide its mtime");
+			else
+				err = _record_parse_mtime(val, vallen, &start_after_mtime);
+			free(val);
+		}
+		if (!err) {
+			gchar *chunk_key = g_strndup(seek->str, seek->len);
+			_mtime_key(seek, start_after_mtime, chunk_key, strlen(chunk_key));
+			g_free(chunk_key);
+		}
+	}
+	if (err) {
+		leveldb_readoptions_destroy(options);
+		g_string_free(seek, TRUE);
+		return err;
+	}
+
+	/* The keys of the chunks beyond <max_mtime> compare greater */
+	gchar bound[MTIME_KEY_LEN + 1];
+	g_snprintf(bound, sizeof(bound), MTIME_PREFIX "%016" G_GINT64_MODIFIER "X",
+			MAX(0, max_mtime));
+	const gsize bound_len = MTIME_KEY_LEN - 1;
+
+	leveldb_iterator_t *it = leveldb_create_iterator(base->base, options);
+	leveldb_readoptions_destroy(options);
+	leveldb_iter_seek(it, seek->str, seek->len);
+	if (start_after && leveldb_iter_valid(it)) {
+		size_t keylen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen == seek->len && !memcmp(key, seek->str, keylen))
+			leveldb_iter_next(it);
+	}
+	g_string_free(seek, TRUE);
+
+	for (guint nb=0 ; leveldb_iter_valid(it) ; leveldb_iter_next(it)) {
+		size_t keylen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen <= MTIME_KEY_LEN
+				|| memcmp(key, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1)
+				|| memcmp(key, bound, bound_len) > 0)
+			break;
+
+		gchar hex[17];
+		memcpy(hex, key + sizeof(MTIME_PREFIX) - 1, 16);
+		hex[16] = '\0';
+
+		if (nb++ > 0)
+			g_string_append_c(value, ',');
+		g_string_append_c(value, '[');
+		g_string_append_c(value, '"');
+		oio_str_gstring_append_json_blob(value,
+				key + MTIME_KEY_LEN, keylen - MTIME_KEY_LEN);
+		g_string_append_c(value, '"');
+		g_string_append_c(value, ',');
+		g_string_append_c(value, '{');
+		oio_str_gstring_append_json_pair_int(value, "mtime",
+				g_ascii_strtoll(hex, NULL, 16));
+		g_string_append_c(value, '}');
+		g_string_append_c(value, ']');
+
+		if (nb >= limit)
+			break;
+	}
+
+	leveldb_iter_destroy(it);
+	return NULL;
+}
+
 static GError *
 _db_vol_delete_generic(struct rdir_base_s *base, GString *key)
 {
@@ -631,120 +1562,86 @@ _db_vol_delete_generic(struct rdir_base_s *base, GString *key)
 }
 
 static GError *
-_db_vol_delete(const char *volid, GString *key){
-	struct rdir_base_s *base = NULL;
-	GError *err = _db_get(volid, FALSE, &base);
-	if (err)
-		return err;
-	return _db_vol_delete_generic(base, key);
-}
-
-static void
-_dump_vol_status(GString *value, GTree *tree_containers, GTree *tree_to_rebuild)
-{
-	gboolean first = TRUE;
-	gboolean _on_container(gpointer k, gpointer v, gpointer i UNUSED) {
-		if (!first)
-			g_string_append_c(value, ',');
-		first = FALSE;
-		oio_str_gstring_append_json_quote(value, k);
-		g_string_append_c(value, ':');
-		g_string_append_c(value, '{');
-		oio_str_gstring_append_json_pair_int(value,
-				"total", GPOINTER_TO_INT(v)-1);
-		gpointer p = g_tree_lookup(tree_to_rebuild, k);
-		if (p) {
-			g_string_append_c(value, ',');
-			oio_str_gstring_append_json_pair_int(value,
-					"to_rebuild", GPOINTER_TO_INT(p)-1);
-		}
-		g_string_append_c(value, '}');
-		return FALSE;
-	}
-	g_tree_foreach(tree_containers, _on_container, NULL);
-}
-
-static GError *
+_db_vol_delete(const char *volid, struct rdir_record_s *rec)
+{
+	struct rdir_base_s *base = NULL;
+	GError *err = _db_get(volid, FALSE, &base);
+	if (err)
+		return err;
+
+	struct rdir_write_s w;
+	if (!(err = _write_begin(&w, base, TRUE))
+			&& !(err = _write_chunk_delete(&w, rec)))
+		err = _write_commit(&w);
+	_write_end(&w);
+	return err;
+}
+
+static GError *
 _db_vol_status(const char *volid, GString *value)
 {
-	static const char beacon[] = CHUNK_PREFIX;
 	gint64 nb_chunks = 0, nb_to_rebuild = 0, incident_date = 0;
 	struct rdir_base_s *base = NULL;
 	GError *err = NULL;
 
-	if ((err = _db_admin_get_incident(volid, &incident_date)))
-		return err;
-
 	if ((err = _db_get(volid, FALSE, &base)))
 		return err;
 
-	GTree *tree_containers =
-		g_tree_new_full(metautils_strcmp3, NULL, g_free, NULL);
-	GTree *tree_to_rebuild =
-		g_tree_new_full(metautils_strcmp3, NULL, g_free, NULL);
-
-	void count_chunk(const char *cid) {
-		gpointer p = g_tree_lookup(tree_containers, cid);
-		gint v = p ? GPOINTER_TO_INT(p) + 1 : 2;
-		g_tree_replace(tree_containers, g_strdup(cid), GINT_TO_POINTER(v));
+	/* The counters are read under the lock of the base, so that they are
+	 * consistent with each other and with the incident date. */
+	struct rdir_write_s w;
+	if (!(err = _write_begin(&w, base, TRUE))) {
+		if (!base->counters_ready) {
+			GRID_NOTICE("Counting the chunks of [%s]", volid);
+			err = _write_build_counters(&w);
+		}
 	}
-	void count_to_rebuild(const char *cid) {
-		gpointer p = g_tree_lookup(tree_to_rebuild, cid);
-		gint v = p ? GPOINTER_TO_INT(p) + 1 : 2;
-		g_tree_replace(tree_to_rebuild, g_strdup(cid), GINT_TO_POINTER(v));
+	if (!err)
+		err = _base_get_incident(base, &incident_date);
+	if (err) {
+		_write_end(&w);
+		return err;
 	}
 
-	/* Iterate over the chunk to count them and their containers */
+	GString *containers = g_string_sized_new(1024);
 	leveldb_readoptions_t *options = leveldb_readoptions_create();
-	leveldb_readoptions_set_fill_cache(options, 0);
 	leveldb_readoptions_set_verify_checksums(options, 0);
 	leveldb_iterator_t *it = leveldb_create_iterator(base->base, options);
 	leveldb_readoptions_destroy(options);
-	leveldb_iter_seek(it, beacon, sizeof(beacon)-1);
+	leveldb_iter_seek(it, COUNTERS_PREFIX, sizeof(COUNTERS_PREFIX)-1);
 	for (; leveldb_iter_valid(it); leveldb_iter_next(it)) {
-		size_t len = 0;
-		const char *k0 = leveldb_iter_key(it, &len);
-		if (*k0 != 'c' || len < sizeof(CHUNK_PREFIX "?|?|?")-1) {
-			/* not a chunk, for sure */
+		size_t keylen = 0, vallen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen < sizeof(COUNTERS_PREFIX)-1
+				|| memcmp(key, COUNTERS_PREFIX, sizeof(COUNTERS_PREFIX)-1))
 			break;
-		}
 
-		/* Insulate the name of its container */
-		gchar cid[128];
-		g_snprintf(cid, sizeof(cid), "%.*s",
-				(int)(len - sizeof(CHUNK_PREFIX) - 1),
-				k0 + sizeof(CHUNK_PREFIX) - 1);
-		char *colon = strchr(cid, '|');
-		if (!colon) continue;
-		*colon = 0;
-
-		/* count that chunk */
-		nb_chunks++;
-
-		/* count that chunk, for its container */
-		count_chunk(cid);
-
-		if (incident_date > 0) {
-			const char *v0 = leveldb_iter_value(it, &len);
-			struct json_object *jrecord = NULL;
-			err = JSON_parse_buffer((const guint8*)v0, len, &jrecord);
-			if (err) {
-				GRID_TRACE("malformed record [%s]: (%d) %s",
-						k0, err->code, err->message);
-				g_clear_error(&err);
-			} else {
-				json_object *jmtime = NULL;
-				if (json_object_object_get_ex(jrecord, "mtime", &jmtime)
-						&& json_object_is_type(jmtime, json_type_int)
-						&& json_object_get_int64(jmtime) <= incident_date) {
-					nb_to_rebuild++;
-					count_to_rebuild(cid);
-				}
-				json_object_put(jrecord);
-			}
+		struct rdir_counter_s counter = {0};
+		const char *val = leveldb_iter_value(it, &vallen);
+		_counter_decode(&counter, val, vallen);
+		if (incident_date <= 0)
+			counter.to_rebuild = 0;
+		nb_chunks += counter.total;
+		nb_to_rebuild += counter.to_rebuild;
+
+		if (containers->len > 0)
+			g_string_append_c(containers, ',');
+		g_string_append_c(containers, '"');
+		oio_str_gstring_append_json_blob(containers,
+				key + sizeof(COUNTERS_PREFIX) - 1,
+				keylen - sizeof(COUNTERS_PREFIX) + 1);
+		g_string_append_static(containers, "\":{");
+		oio_str_gstring_append_json_pair_int(containers,
+				"total", counter.total);
+		if (counter.to_rebuild > 0) {
+			g_string_append_c(containers, ',');
+			oio_str_gstring_append_json_pair_int(containers,
+					"to_rebuild", counter.to_rebuild);
 		}
+		g_string_append_c(containers, '}');
 	}
 	leveldb_iter_destroy(it);
+	_write_end(&w);
 
 	/* pack the answer */
 	g_string_append_c(value, '{');
@@ -762,7 +1659,7 @@ _db_vol_status(const char *volid, GString *value)
 	oio_str_gstring_append_json_quote(value, "container");
 	g_string_append_c(value, ':');
 	g_string_append_c(value, '{');
-	_dump_vol_status(value, tree_containers, tree_to_rebuild);
+	g_string_append_len(value, containers->str, containers->len);
 	g_string_append_c(value, '}');
 	if (incident_date > 0) {
 		g_string_append_c(value, ',');
@@ -775,8 +1672,7 @@ _db_vol_status(const char *volid, GString *value)
 	}
 	g_string_append_c(value, '}');
 
-	g_tree_destroy(tree_containers);
-	g_tree_destroy(tree_to_rebuild);
+	g_string_free(containers, TRUE);
 	return NULL;
 }
 
@@ -809,6 +1705,18 @@ _db_admin_show(const char *volid, GString *value)
 				0 != memcmp(key, ADMIN_PREFIX, sizeof(ADMIN_PREFIX)-1))
 			break;
 
+		/* the counters are exposed by the status, the format and the
+		 * state of the index are internal details */
+		if (keylen >= sizeof(KEY_COUNTERS)-1 &&
+				!memcmp(key, KEY_COUNTERS, sizeof(KEY_COUNTERS)-1))
+			continue;
+		if (keylen == sizeof(KEY_FORMAT)-1 &&
+				!memcmp(key, KEY_FORMAT, sizeof(KEY_FORMAT)-1))
+			continue;
+		if (keylen == sizeof(KEY_MTIME_INDEX)-1 &&
+				!memcmp(key, KEY_MTIME_INDEX, sizeof(KEY_MTIME_INDEX)-1))
+			continue;
+
 		/* dump it as a field of the JSON object */
 		const char *val = leveldb_iter_value(it, &vallen);
 		if (!first)
@@ -902,8 +1810,6 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 {
 	struct rdir_base_s *base = NULL;
 	GError *err = NULL;
-	char *errmsg = NULL;
-	int errsav = 0;
 	gint64 nb_removed = 0;
 	gint64 nb_repaired = 0;
 	gint64 errors = 0;
@@ -917,7 +1823,16 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 	if ((err = _db_get(volid, FALSE, &base)))
 		return err;
 
-	leveldb_writebatch_t *batch = leveldb_writebatch_create();
+	struct rdir_write_s w;
+	if ((err = _write_begin(&w, base, TRUE))) {
+		_write_end(&w);
+		return err;
+	}
+
+	/* The incident is cleared by the batch, so are the chunks to rebuild */
+	w.incident = 0;
+	w.drop_rebuild = TRUE;
+	w.drop_all = all;
 
 	if (all || (before_incident && incident > 0) || repair) {
 		leveldb_readoptions_t *roptions = leveldb_readoptions_create();
@@ -932,7 +1847,7 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 				break;
 
 			if (all) {
-				leveldb_writebatch_delete(batch, key, keylen);
+				leveldb_writebatch_delete(w.batch, key, keylen);
 				nb_removed++;
 				continue;
 			}
@@ -940,10 +1855,8 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 			size_t vallen = 0;
 			const char *val = leveldb_iter_value(it, &vallen);
 
-			/* TODO(jfs): we parse the whole object, but we just need the rtime
-				* so there is maybe a small room for a lean improvement. */
 			struct rdir_record_s rec = {0};
-			err = _record_parse(&rec, val, vallen);
+			err = _record_parse(&rec, key, keylen, val, vallen);
 			if (err) {
 				GRID_INFO("Malformed record at [%.*s]", (int)keylen, key);
 				g_clear_error(&err);
@@ -951,19 +1864,18 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 				continue;
 			}
 
-			if (before_incident && incident > 0 && rec.mtime <= incident) {
-				leveldb_writebatch_delete(batch, key, keylen);
+			if (before_incident && _is_to_rebuild(rec.mtime, incident)) {
+				leveldb_writebatch_delete(w.batch, key, keylen);
+				_write_account(&w, rec.container, NULL,
+						TRUE, rec.mtime, FALSE, 0);
+				if (w.indexed)
+					_write_index(&w, key, keylen, rec.mtime, FALSE);
 				nb_removed++;
 				continue;
 			}
 
 			if (repair) {
-				GString *repaired_key = _record_to_key(&rec);
-				GString *repaired_val = g_string_sized_new(1024);
-				_record_encode(&rec, repaired_val);
-				err = _db_vol_push(volid, FALSE, repaired_key, repaired_val);
-				g_string_free(repaired_key, TRUE);
-				g_string_free(repaired_val, TRUE);
+				err = _write_chunk_put(&w, &rec);
 				if (err) {
 					GRID_INFO("Push failed at [%.*s]: %s", (int)keylen, key,
 							err->message);
@@ -974,21 +1886,171 @@ _db_admin_clear(const char *volid, gboolean all, gboolean before_incident,
 				nb_repaired++;
 			}
 		}
+
+		/* The index of an empty volume is complete, keep it */
+		if (all && w.indexed) {
+			leveldb_iter_seek(it, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1);
+			for (; leveldb_iter_valid(it) ; leveldb_iter_next(it)) {
+				size_t keylen = 0;
+				const char *key = leveldb_iter_key(it, &keylen);
+				if (keylen < sizeof(MTIME_PREFIX)-1
+						|| memcmp(key, MTIME_PREFIX, sizeof(MTIME_PREFIX)-1))
+					break;
+				leveldb_writebatch_delete(w.batch, key, keylen);
+			}
+		}
 		leveldb_iter_destroy(it);
 	}
 
-	leveldb_writebatch_delete(batch, KEY_INCIDENT, sizeof(KEY_INCIDENT)-1);
+	leveldb_writebatch_delete(w.batch, KEY_INCIDENT, sizeof(KEY_INCIDENT)-1);
+	err = _write_commit(&w);
+	_write_end(&w);
+
+	*p_nb_removed = nb_removed;
+	*p_nb_repaired = nb_repaired;
+	*p_errors = errors;
+	return err;
+}
+
+static GError *
+_base_check_format(struct rdir_base_s *base)
+{
+	if (base->format_checked)
+		return NULL;
+
+	char *errmsg = NULL;
+	size_t length = 0;
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	char *value = leveldb_get(base->base, options,
+			KEY_FORMAT, sizeof(KEY_FORMAT)-1, &length, &errmsg);
+	leveldb_readoptions_destroy(options);
+	if (errmsg)
+		return _map_errno_to_gerror(errno, errmsg);
+
+	if (value) {
+		base->format_ready = length == 1 && value[0] == '0' + RECORD_VERSION;
+		free(value);
+	}
+	base->format_checked = TRUE;
+	return NULL;
+}
+
+/* Rewrite, with the current format, the legacy records among the next <max>
+ * chunk records of the volume, starting after the position reached by the
+ * previous call. Sets <*pdone> once the end of the volume is reached. */
+static GError *
+_base_migrate_next_records(struct rdir_base_s *base, guint max,
+		guint *pmigrated, gboolean *pdone)
+{
+	char *errmsg = NULL;
+	guint nb_checked = 0;
+	gboolean done = TRUE;
+
+	leveldb_writebatch_t *batch = leveldb_writebatch_create();
+	leveldb_readoptions_t *options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(options, 0);
+	leveldb_readoptions_set_verify_checksums(options, 0);
+	leveldb_iterator_t *it = leveldb_create_iterator(base->base, options);
+	leveldb_readoptions_destroy(options);
+
+	if (!base->format_marker) {
+		base->format_marker = g_string_sized_new(256);
+		leveldb_iter_seek(it, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1);
+	} else {
+		leveldb_iter_seek(it, base->format_marker->str,
+				base->format_marker->len);
+		if (leveldb_iter_valid(it)) {
+			size_t keylen = 0;
+			const char *key = leveldb_iter_key(it, &keylen);
+			if (keylen == base->format_marker->len
+					&& !memcmp(key, base->format_marker->str, keylen))
+				leveldb_iter_next(it);
+		}
+	}
+
+	for (; leveldb_iter_valid(it); leveldb_iter_next(it)) {
+		size_t keylen = 0, vallen = 0;
+		const char *key = leveldb_iter_key(it, &keylen);
+		if (keylen < sizeof(CHUNK_PREFIX)-1
+				|| memcmp(key, CHUNK_PREFIX, sizeof(CHUNK_PREFIX)-1))
+			break;
+		if (nb_checked++ >= max) {
+			done = FALSE;
+			break;
+		}
+
+		g_string_truncate(base->format_marker, 0);
+		g_string_append_len(base->format_marker, key, keylen);
+
+		const char *val = leveldb_iter_value(it, &vallen);
+		if (!_record_is_legacy(val, vallen))
+			continue;
+
+		struct rdir_record_s rec = {0};
+		GError *err = _record_parse(&rec, key, keylen, val, vallen);
+		if (err) {
+			GRID_INFO("Malformed record at [%.*s]", (int)keylen, key);
+			g_clear_error(&err);
+			continue;
+		}
+		GString *value = g_string_sized_new(16);
+		_record_encode(&rec, value);
+		leveldb_writebatch_put(batch, key, keylen, value->str, value->len);
+		g_string_free(value, TRUE);
+		(*pmigrated) ++;
+	}
+	leveldb_iter_destroy(it);
+
+	if (done) {
+		const char version = '0' + RECORD_VERSION;
+		leveldb_writebatch_put(batch,
+				KEY_FORMAT, sizeof(KEY_FORMAT)-1, &version, 1);
+	}
 
 	leveldb_writeoptions_t *woptions = leveldb_writeoptions_create();
 	leveldb_write(base->base, woptions, batch, &errmsg);
-	errsav = errno;
+	const int errsav = errno;
 	leveldb_writeoptions_destroy(woptions);
 	leveldb_writebatch_destroy(batch);
 
-	*p_nb_removed = nb_removed;
-	*p_nb_repaired = nb_repaired;
-	*p_errors = errors;
-	return errmsg ? _map_errno_to_gerror(errsav, errmsg) : NULL;
+	if (errmsg)
+		return _map_errno_to_gerror(errsav, errmsg);
+	*pdone = done;
+	return NULL;
+}
+
+/* Migrate a slice of the volume to the current format of records. The base
+ * is locked meanwhile, so that no write happens between the read of a legacy
+ * record and its rewrite. */
+static void
+_base_migrate_records(struct rdir_base_s *base, const char *volid, guint max)
+{
+	guint nb_migrated = 0;
+	gboolean done = FALSE;
+
+	g_mutex_lock(&base->lock);
+	GError *err = _base_check_format(base);
+	if (!err && !base->format_ready) {
+		err = _base_migrate_next_records(base, max, &nb_migrated, &done);
+		/* Restart from the beginning after an error */
+		if (err || done) {
+			base->format_ready = done;
+			g_string_free(base->format_marker, TRUE);
+			base->format_marker = NULL;
+		}
+	}
+	g_mutex_unlock(&base->lock);
+
+	if (err) {
+		GRID_WARN("Records migration failed on [%s]: (%d) %s",
+				volid, err->code, err->message);
+		g_clear_error(&err);
+	} else {
+		if (nb_migrated > 0)
+			GRID_DEBUG("%u records migrated on [%s]", nb_migrated, volid);
+		if (done)
+			GRID_INFO("All the records migrated on [%s]", volid);
+	}
 }
 
 /* ------------------------------------------------------------------------- *
@@ -1002,15 +2064,106 @@ struct req_args_s
 	struct oio_requri_s ruri;
 };
 
+/* Adds the operation described by one record of a batch request to the
+ * write batch, or tells why the record is invalid. */
+typedef GError* (*batch_record_f) (struct rdir_write_s *w,
+		struct json_object *jrecord);
+
+typedef GError* (*batch_base_f) (const char *id, gboolean autocreate,
+		struct rdir_base_s **pbase);
+
+static enum http_rc_e
+_reply_batch_report(struct req_args_s *args, gint64 succeeded, GString *failed)
+{
+	GString *value = g_string_sized_new(failed->len + 64);
+	g_string_append_c(value, '{');
+	oio_str_gstring_append_json_pair_int(value, "succeeded", succeeded);
+	g_string_append_static(value, ",\"failed\":[");
+	g_string_append_len(value, failed->str, failed->len);
+	g_string_append_static(value, "]}");
+	g_string_free(failed, TRUE);
+	return _reply_ok(args->rp, value);
+}
+
+/* Apply all the valid records of the array <jbody> with a single leveldb
+ * write. The invalid records are skipped and reported in the reply, with
+ * their position in the array. An error on the write itself fails the whole
+ * batch. */
+static enum http_rc_e
+_route_batch(struct req_args_s *args, struct json_object *jbody,
+		const char *id, gboolean autocreate, gboolean counted,
+		batch_base_f get_base, batch_record_f hook)
+{
+	const int count = json_object_array_length(jbody);
+	if (count > (int)rdir_batch_max)
+		return _reply_format_error(args->rp,
+				BADREQ("Too many records (%d > %u)", count, rdir_batch_max));
+
+	/* Nothing to write, the base is not even needed */
+	if (count <= 0)
+		return _reply_batch_report(args, 0, g_string_new(""));
+
+	struct rdir_base_s *base = NULL;
+	GError *err = get_base(id, autocreate, &base);
+	if (err)
+		return _reply_common_error(args->rp, err);
+
+	struct rdir_write_s w;
+	if ((err = _write_begin(&w, base, counted))) {
+		_write_end(&w);
+		return _reply_common_error(args->rp, err);
+	}
+
+	gint64 succeeded = 0;
+	GString *failed = g_string_sized_new(128);
+	for (int i = 0; i < count; i++) {
+		struct json_object *jrecord = json_object_array_get_idx(jbody, i);
+		if (!(err = hook(&w, jrecord))) {
+			succeeded++;
+			continue;
+		}
+		if (failed->len > 0)
+			g_string_append_c(failed, ',');
+		g_string_append_c(failed, '{');
+		oio_str_gstring_append_json_pair_int(failed, "index", i);
+		g_string_append_c(failed, ',');
+		oio_str_gstring_append_json_pair_int(failed, "status", err->code);
+		g_string_append_c(failed, ',');
+		oio_str_gstring_append_json_pair(failed, "message", err->message);
+		g_string_append_c(failed, '}');
+		g_clear_error(&err);
+	}
+
+	if (succeeded > 0)
+		err = _write_commit(&w);
+	_write_end(&w);
+
+	if (err) {
+		g_string_free(failed, TRUE);
+		return _reply_common_error(args->rp, err);
+	}
+
+	return _reply_batch_report(args, succeeded, failed);
+}
+
 static GError *
-_request_to_key(struct json_object *jbody, GString **pkey)
+_batch_vol_push(struct rdir_write_s *w, struct json_object *jrecord)
 {
 	struct rdir_record_s rec = {0};
-	GError *err = _record_extract(&rec, jbody);
+	GError *err = _record_extract(&rec, jrecord);
 	if (err)
 		return err;
-	*pkey = _record_to_key(&rec);
-	return NULL;
+	return _write_chunk_put(w, &rec);
+}
+
+static GError *
+_batch_vol_delete(struct rdir_write_s *w, struct json_object *jrecord)
+{
+	struct rdir_record_s rec = {0};
+	GError *err = _record_extract(&rec, jrecord);
+	if (err)
+		return err;
+	return _write_chunk_delete(w, &rec);
 }
 
 
@@ -1047,6 +2200,17 @@ _request_to_key(struct json_object *jbody, GString **pkey)
 //    Connection: Close
 //    Content-Length: 0
 //
+// The body may also be an array of such records (at most
+// ``rdir.batch_max``). All the valid records are then removed in a single
+// write, and the invalid ones are reported with their position:
+//
+// .. code-block:: json
+//
+//    {
+//      "succeeded":2,
+//      "failed":[{"index":1,"status":400,"message":"Missing field [chunk_id]"}]
+//    }
+//
 // }}RDIR
 static enum http_rc_e
 _route_vol_delete(struct req_args_s *args, struct json_object *jbody,
@@ -1056,15 +2220,18 @@ _route_vol_delete(struct req_args_s *args, struct json_object *jbody,
 	if (!volid)
 		return _reply_format_error(args->rp, BADREQ("no volume id"));
 
+	if (jbody && json_object_is_type(jbody, json_type_array))
+		return _route_batch(args, jbody, volid, FALSE, TRUE,
+				_db_get, _batch_vol_delete);
+
 	/* extraction of the parameters */
 	GError *err = NULL;
-	GString *key = NULL;
-	if ((err = _request_to_key(jbody, &key)))
+	struct rdir_record_s rec = {0};
+	if ((err = _record_extract(&rec, jbody)))
 		return _reply_format_error(args->rp, err);
 
 	/* Eventually remove the record from the database */
-	err = _db_vol_delete(volid, key);
-	g_string_free(key, TRUE);
+	err = _db_vol_delete(volid, &rec);
 
 	if (err)
 		return _reply_common_error(args->rp, err);
@@ -1105,18 +2272,35 @@ _route_vol_delete(struct req_args_s *args, struct json_object *jbody,
 //    Connection: Close
 //    Content-Length: 0
 //
+// The body may also be an array of such records (at most
+// ``rdir.batch_max``). All the valid records are then pushed in a single
+// write, and the invalid ones are reported with their position:
+//
+// .. code-block:: json
+//
+//    {
+//      "succeeded":2,
+//      "failed":[{"index":1,"status":400,"message":"Missing field [chunk_id]"}]
+//    }
+//
 // }}RDIR
 static enum http_rc_e
 _route_vol_push(struct req_args_s *args, struct json_object *jbody,
 		const char *volid, const char *str_autocreate)
 {
-	if (!jbody || !json_object_is_type(jbody, json_type_object))
+	if (!jbody)
 		return _reply_format_error(args->rp, BADREQ("null body"));
 	if (!volid)
 		return _reply_format_error(args->rp, BADREQ("no volume id"));
 
 	gboolean autocreate = oio_str_parse_bool(str_autocreate, FALSE);
 
+	if (json_object_is_type(jbody, json_type_array))
+		return _route_batch(args, jbody, volid, autocreate, TRUE,
+				_db_get, _batch_vol_push);
+	if (!json_object_is_type(jbody, json_type_object))
+		return _reply_format_error(args->rp, BADREQ("invalid body"));
+
 	/* extract all the record's fields */
 	GError *err = NULL;
 	struct rdir_record_s rec = {0};
@@ -1124,14 +2308,11 @@ _route_vol_push(struct req_args_s *args, struct json_object *jbody,
 		return _reply_format_error(args->rp, err);
 
 	GString *key = _record_to_key(&rec);
-	GString *value = g_string_sized_new(1024);
 	args->rp->subject(key->str);
-	_record_encode(&rec, value);
+	g_string_free(key, TRUE);
 
 	/* Eventually push the record in the database */
-	err = _db_vol_push(volid, autocreate, key, value);
-	g_string_free(key, TRUE);
-	g_string_free(value, TRUE);
+	err = _db_vol_push(volid, autocreate, &rec);
 
 	if (err)
 		return _reply_common_error(args->rp, err);
@@ -1160,6 +2341,21 @@ _route_vol_push(struct req_args_s *args, struct json_object *jbody,
 //    Connection: Close
 //    Content-Length: 2
 //
+// With ``"mtime_index": true`` in the body, the chunks are listed by
+// increasing mtime, up to ``max_mtime`` (or the incident date with
+// ``"rebuild": true``), thanks to a secondary index of the volume.
+// ``container_id`` is then not allowed. To get the next page, set
+// ``start_after`` and ``start_after_mtime`` to the last chunk received
+// and its mtime.
+//
+// Whatever the mode, ``limit`` defaults to 4096 records, and a greater
+// value is clamped to 4096.
+//
+// .. code-block:: json
+//
+//    {"mtime_index": true, "rebuild": true, "limit": 1000,
+//     "start_after": "<cid>|<content>|<chunk>", "start_after_mtime": 1504000000}
+//
 // }}RDIR
 static enum http_rc_e
 _route_vol_fetch(struct req_args_s *args, struct json_object *jbody,
@@ -1173,26 +2369,45 @@ _route_vol_fetch(struct req_args_s *args, struct json_object *jbody,
 	/* extract the optional (push-specific) fields */
 	GError *err = NULL;
 	struct json_object *jstart = NULL, *jlimit = NULL,
-					   *jrebuild = NULL, *jcid = NULL;
+					   *jrebuild = NULL, *jcid = NULL,
+					   *jindex = NULL, *jmax = NULL, *jstart_mtime = NULL;
 	if (jbody) {
 		struct oio_ext_json_mapping_s map[] = {
 			{"start_after",  &jstart,   json_type_string,  0},
 			{"limit",        &jlimit,   json_type_int,     0},
 			{"rebuild",      &jrebuild, json_type_boolean, 0},
 			{"container_id", &jcid,     json_type_string,  0},
+			{"mtime_index",  &jindex,   json_type_boolean, 0},
+			{"max_mtime",    &jmax,     json_type_int,     0},
+			{"start_after_mtime", &jstart_mtime, json_type_int, 0},
 			{NULL, NULL, 0, 0}
 		};
 		if ((err = oio_ext_extract_json(jbody, map)))
 			return _reply_format_error(args->rp, err);
 	}
 
+	const char *start = jstart ? json_object_get_string(jstart) : NULL;
+	const gint64 limit = jlimit ? json_object_get_int64(jlimit) : G_MAXINT64;
+	const gboolean rebuild = jrebuild && json_object_get_boolean(jrebuild);
+
 	GString *value = g_string_sized_new(1024);
 	g_string_append_c(value, '[');
-	err = _db_vol_fetch(volid, value,
-			jstart ? json_object_get_string(jstart) : NULL,
-			jlimit ? json_object_get_int64(jlimit) : G_MAXINT64,
-			jrebuild ? json_object_get_boolean(jrebuild) : FALSE,
-			jcid ? json_object_get_string(jcid) : NULL);
+	if (jindex && json_object_get_boolean(jindex)) {
+		gint64 max_mtime = jmax ? json_object_get_int64(jmax) : G_MAXINT64;
+		gint64 incident = 0;
+		if (jcid)
+			err = BADREQ("container_id not allowed with mtime_index");
+		else if (rebuild)
+			err = _db_admin_get_incident(volid, &incident);
+		/* Nothing to rebuild without an incident */
+		if (!err && (!rebuild || incident > 0))
+			err = _db_vol_fetch_by_mtime(volid, value, start,
+					jstart_mtime ? json_object_get_int64(jstart_mtime) : -1,
+					limit, rebuild ? MIN(max_mtime, incident) : max_mtime);
+	} else {
+		err = _db_vol_fetch(volid, value, start, limit, rebuild,
+				jcid ? json_object_get_string(jcid) : NULL);
+	}
 	g_string_append_c(value, ']');
 
 	if (err) {
@@ -1921,6 +3136,43 @@ _meta2_db_delete(const gchar *meta2_address, GString *key)
 	return _db_vol_delete_generic(base, key);
 }
 
+static GError *
+_batch_meta2_push(struct rdir_write_s *w, struct json_object *jrecord)
+{
+	struct rdir_meta2_record_s rec = {0};
+	GError *err = _meta2_record_extract(&rec, jrecord);
+	if (err)
+		return err;
+
+	GString *key = g_string_new("");
+	if (!(err = _meta2_record_to_key(&rec, key))) {
+		GString *value = g_string_sized_new(1024);
+		_meta2_record_encode(&rec, value);
+		leveldb_writebatch_put(w->batch, key->str, key->len,
+				value->str, value->len);
+		g_string_free(value, TRUE);
+	}
+	g_string_free(key, TRUE);
+	_meta2_record_free(&rec);
+	return err;
+}
+
+static GError *
+_batch_meta2_delete(struct rdir_write_s *w, struct json_object *jrecord)
+{
+	struct rdir_meta2_record_s rec = {0};
+	GError *err = _meta2_record_extract(&rec, jrecord);
+	if (err)
+		return err;
+
+	GString *key = g_string_new("");
+	if (!(err = _meta2_record_to_key(&rec, key)))
+		leveldb_writebatch_delete(w->batch, key->str, key->len);
+	g_string_free(key, TRUE);
+	_meta2_record_free(&rec);
+	return err;
+}
+
 // RDIR{{
 // POST /v1/rdir/meta2/fetch?vol=<volume ip>%3A<volume port>
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -2082,18 +3334,29 @@ _route_meta2_create(struct req_args_s *args, const char *meta2_address)
 //    Connection: Close
 //    Content-Length: 0
 //
+// The body may also be an array of such records (at most
+// ``rdir.batch_max``), pushed in a single write. The reply then tells
+// how many records succeeded, and lists the invalid ones with their
+// position, as for the ``/v1/rdir/push`` route.
+//
 // }}RDIR
 static enum http_rc_e
 _route_meta2_push(struct req_args_s *args, struct json_object *jbody,
 		const char *meta2_address, const char *str_autocreate)
 {
-	if (!jbody || !json_object_is_type(jbody, json_type_object))
+	if (!jbody)
 		return _reply_format_error(args->rp, BADREQ("null body"));
 	if (!meta2_address)
 		return _reply_format_error(args->rp, BADREQ("no meta2 id"));
 
 	gboolean autocreate = oio_str_parse_bool(str_autocreate, TRUE);
 
+	if (json_object_is_type(jbody, json_type_array))
+		return _route_batch(args, jbody, meta2_address, autocreate, FALSE,
+				_meta2_db_get, _batch_meta2_push);
+	if (!json_object_is_type(jbody, json_type_object))
+		return _reply_format_error(args->rp, BADREQ("invalid body"));
+
 	GError *err = NULL;
 	struct rdir_meta2_record_s rec = {0};
 	if ((err = _meta2_record_extract(&rec, jbody)))
@@ -2155,16 +3418,27 @@ _route_meta2_push(struct req_args_s *args, struct json_object *jbody,
 //    Connection: Close
 //    Content-Length: 0
 //
+// The body may also be an array of such records (at most
+// ``rdir.batch_max``), removed in a single write. The reply then tells
+// how many records succeeded, and lists the invalid ones with their
+// position, as for the ``/v1/rdir/delete`` route.
+//
 // }}RDIR
 static enum http_rc_e
 _route_meta2_delete(struct req_args_s *args, struct json_object *jbody,
 				  const char *meta2_address)
 {
-	if (!jbody || !json_object_is_type(jbody, json_type_object))
+	if (!jbody)
 		return _reply_format_error(args->rp, BADREQ("null body"));
 	if (!meta2_address)
 		return _reply_format_error(args->rp, BADREQ("no meta2 id"));
 
+	if (json_object_is_type(jbody, json_type_array))
+		return _route_batch(args, jbody, meta2_address, FALSE, FALSE,
+				_meta2_db_get, _batch_meta2_delete);
+	if (!json_object_is_type(jbody, json_type_object))
+		return _reply_format_error(args->rp, BADREQ("invalid body"));
+
 	GError *err = NULL;
 	struct rdir_meta2_record_s rec = {0};
 	if ((err = _meta2_record_extract(&rec, jbody)))
@@ -2212,21 +3486,56 @@ _route_meta2_delete(struct req_args_s *args, struct json_object *jbody,
 //    HTTP/1.1 200 OK
 //    Connection: Close
 //    Content-Type: application/json
-//    Content-Length: 21
+//    Content-Length: 139
+//
+//    {"opened_db_count":6,"db_memory_usage":1052672,
+//     "db_cache_size":67108864,"db_bloom_bits_per_key":10,
+//     "db_write_buffer_size":4194304}
 //
-//    {"opened_db_count":6}
+// ``db_memory_usage`` sums the write buffers of the opened databases, that
+// share a block cache of ``db_cache_size`` bytes.
 //
 // }}RDIR
 static enum http_rc_e
 _route_srv_status(struct req_args_s *args)
 {
+	/* The memtables of the bases, i.e. their write buffers */
+	gint64 memory = 0;
+	gboolean _on_base(gpointer k UNUSED, gpointer v, gpointer i UNUSED) {
+		struct rdir_base_s *base = v;
+		if (base->base) {
+			char *usage = leveldb_property_value(base->base,
+					"leveldb.approximate-memory-usage");
+			if (usage)
+				memory += g_ascii_strtoll(usage, NULL, 10);
+			free(usage);
+		}
+		return FALSE;
+	}
+
 	g_mutex_lock(&lock_bases);
 	guint count = g_tree_nnodes(tree_bases);
+	g_tree_foreach(tree_bases, _on_base, NULL);
 	g_mutex_unlock(&lock_bases);
 
-	GString *gstr = g_string_sized_new(128);
+	g_mutex_lock(&meta2_db_lock);
+	g_tree_foreach(meta2_db_tree, _on_base, NULL);
+	g_mutex_unlock(&meta2_db_lock);
+
+	GString *gstr = g_string_sized_new(256);
 	g_string_append_c(gstr, '{');
 	oio_str_gstring_append_json_pair_int(gstr, "opened_db_count", count);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "db_memory_usage", memory);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "db_cache_size",
+			db_cache_size);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "db_bloom_bits_per_key",
+			db_bloom_bits_per_key);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "db_write_buffer_size",
+			rdir_write_buffer_size);
 	if (service_id) {
 		g_string_append_c(gstr, ',');
 		oio_str_gstring_append_json_pair(gstr, "service_id", service_id);
@@ -2553,10 +3862,50 @@ grid_main_specific_fini(void)
 	g_cond_clear(&meta2_db_cond);
 	g_mutex_clear(&meta2_db_lock);
 
+	/* After the bases, that use them */
+	if (db_cache) {
+		leveldb_cache_destroy(db_cache);
+		db_cache = NULL;
+	}
+	if (db_filter) {
+		leveldb_filterpolicy_destroy(db_filter);
+		db_filter = NULL;
+	}
+
 	oio_str_clean(&basedir);
 	oio_str_clean(&service_id);
 }
 
+/* Migrate progressively the records of the opened volumes to the current
+ * format, so that the legacy records eventually disappear even from the
+ * volumes that are rarely written. */
+static void
+_task_migrate_records(gpointer p UNUSED)
+{
+	if (!rdir_migrate_batch)
+		return;
+
+	/* pairs of <volume id>, <base> */
+	GPtrArray *bases = g_ptr_array_new();
+	gboolean _on_base(gpointer k, gpointer v, gpointer i UNUSED) {
+		struct rdir_base_s *base = v;
+		if (base->base && !base->format_ready) {
+			g_ptr_array_add(bases, k);
+			g_ptr_array_add(bases, base);
+		}
+		return FALSE;
+	}
+	g_mutex_lock(&lock_bases);
+	g_tree_foreach(tree_bases, _on_base, NULL);
+	g_mutex_unlock(&lock_bases);
+
+	/* The opened bases are only closed at the exit */
+	for (guint i = 0; i + 1 < bases->len; i += 2)
+		_base_migrate_records(bases->pdata[i+1], bases->pdata[i],
+				rdir_migrate_batch);
+	g_ptr_array_free(bases, TRUE);
+}
+
 static void
 _task_malloc_trim(gpointer p UNUSED)
 {
@@ -2688,6 +4037,15 @@ grid_main_configure(int argc, char **argv)
 		network_server_bind_host(server, lu->data, handler_action,
 				(network_transport_factory) transport_http_factory0);
 
+	if (rdir_cache_size > 0) {
+		db_cache_size = rdir_cache_size;
+		db_cache = leveldb_cache_create_lru(db_cache_size);
+	}
+	if (rdir_bloom_bits_per_key > 0) {
+		db_bloom_bits_per_key = rdir_bloom_bits_per_key;
+		db_filter = leveldb_filterpolicy_create_bloom(db_bloom_bits_per_key);
+	}
+
 	g_cond_init(&cond_bases);
 	g_mutex_init(&lock_bases);
 	tree_bases = g_tree_new_full(metautils_strcmp3, NULL,
@@ -2701,6 +4059,7 @@ grid_main_configure(int argc, char **argv)
 	/* Ask for a periodic release of the memory slices kept by the process */
 	gtq_admin = grid_task_queue_create("admin");
 	grid_task_queue_register(gtq_admin, 1, _task_malloc_trim, NULL, NULL);
+	grid_task_queue_register(gtq_admin, 1, _task_migrate_records, NULL, NULL);
 	return TRUE;
 }
 
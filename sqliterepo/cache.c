@@ -31,12 +31,16 @@ License along with this library.
 
 #define GET(R,I) ((R)->bases + (I))
 
-#define BEACON_RESET(B) do { (B)->first = (B)->last = -1; } while (0)
+#define BEACON_RESET(B) do { \
+	(B)->first = (B)->last = (B)->maintained = -1; \
+} while (0)
 
 struct beacon_s
 {
 	gint first;
 	gint last;
+	gint maintained; /*!< The most recent of the maintained bases. They
+					   all sit at the oldest end of the idle lists. */
 };
 
 enum sqlx_base_status_e
@@ -52,14 +56,31 @@ enum sqlx_base_status_e
 	SQLX_BASE_CLOSING_FOR_DELETION, // base about to be deleted
 };
 
+/* A thread waiting for a base, allocated on its own stack. Queued in the
+ * base it waits for, in the order of arrival. */
+struct sqlx_waiter_s
+{
+	struct sqlx_waiter_s *prev;
+	struct sqlx_waiter_s *next;
+	GThread *thread;
+	GCond cond;
+	enum sqlx_cache_class_e klass;
+	gboolean queued;  /*!< still in the queue of the base */
+	gboolean granted; /*!< the base has been handed off to the waiter */
+};
+
 struct sqlx_base_s
 {
 	hashstr_t *name; /*!< This is registered in the DB */
 
 	GThread *owner; /*!< The current owner of the database. Changed under the
 					  global lock */
-	GCond cond;
-	GCond cond_prio;
+
+	/* FIFO of the threads waiting for the base, changed under the global
+	 * lock. When the owner releases the base, it is directly given to the
+	 * first waiter of the most urgent class. */
+	struct sqlx_waiter_s *waiters_head;
+	struct sqlx_waiter_s *waiters_tail;
 
 	gpointer handle;
 
@@ -78,9 +99,15 @@ struct sqlx_base_s
 	guint32 count_waiting; /*!< Counts the number of threads waiting for the
 							base to become avaible. */
 
+	guint32 count_waiting_class[SQLX_CACHE_CLASS_MAX]; /*!< The same, by
+														 class of request */
+
 	gint index; /*!< self reference */
 
 	enum sqlx_base_status_e status; /*!< Changed under the global lock */
+
+	gboolean maintained; /*!< The maintenance hook has been called since the
+						   last time the base has been used */
 };
 
 typedef struct sqlx_base_s sqlx_base_t;
@@ -199,6 +226,8 @@ SQLX_REMOVE(sqlx_cache_t *cache, sqlx_base_t *base,
 		beacon->first = sqlx_base_get_id(sqlx_next_by_id(cache, beacon->first));
 	if (beacon->last == base->index)
 		beacon->last = sqlx_base_get_id(sqlx_prev_by_id(cache, beacon->last));
+	if (beacon->maintained == base->index)
+		beacon->maintained = base->link.next;
 
 	/* Update the previous and next */
 	next = sqlx_get_by_id(cache, base->link.next);
@@ -236,6 +265,33 @@ SQLX_UNSHIFT(sqlx_cache_t *cache, sqlx_base_t *base,
 	base->last_update = oio_ext_monotonic_time ();
 }
 
+/* Like SQLX_UNSHIFT(), but <base> keeps its <last_update> and is inserted
+ * just before the maintained bases, then becomes the most recent of them.
+ * The bases are maintained from the oldest, so that this is also its place
+ * in the list ordered from the most recent (first) to the oldest (last). */
+static void
+SQLX_INSERT_MAINTAINED(sqlx_cache_t *cache, sqlx_base_t *base,
+		struct beacon_s *beacon, enum sqlx_base_status_e status)
+{
+	sqlx_base_t *after = sqlx_get_by_id(cache, beacon->maintained);
+	sqlx_base_t *before = after
+		? sqlx_get_by_id(cache, after->link.prev)
+		: sqlx_get_by_id(cache, beacon->last);
+
+	base->link.prev = sqlx_base_get_id(before);
+	base->link.next = sqlx_base_get_id(after);
+	if (before)
+		before->link.next = base->index;
+	else
+		beacon->first = base->index;
+	if (after)
+		after->link.prev = base->index;
+	else
+		beacon->last = base->index;
+	beacon->maintained = base->index;
+	base->status = status;
+}
+
 static void
 sqlx_save_id(sqlx_cache_t *cache, sqlx_base_t *base)
 {
@@ -353,6 +409,7 @@ sqlx_base_reserve(sqlx_cache_t *cache, const hashstr_t *hs,
 	base->name = hashstr_dup(hs);
 	base->count_open = 1;
 	base->handle = NULL;
+	base->maintained = FALSE;
 	base->owner = g_thread_self();
 	sqlx_base_move_to_list(cache, base, SQLX_BASE_USED);
 	sqlx_save_id(cache, base);
@@ -362,12 +419,100 @@ sqlx_base_reserve(sqlx_cache_t *cache, const hashstr_t *hs,
 	return NULL;
 }
 
+static void
+_waiter_push(sqlx_base_t *base, struct sqlx_waiter_s *w)
+{
+	w->prev = base->waiters_tail;
+	w->next = NULL;
+	if (base->waiters_tail)
+		base->waiters_tail->next = w;
+	else
+		base->waiters_head = w;
+	base->waiters_tail = w;
+	w->queued = TRUE;
+	base->count_waiting ++;
+	base->count_waiting_class[w->klass] ++;
+}
+
+static void
+_waiter_remove(sqlx_base_t *base, struct sqlx_waiter_s *w)
+{
+	EXTRA_ASSERT(w->queued);
+	if (w->prev)
+		w->prev->next = w->next;
+	else
+		base->waiters_head = w->next;
+	if (w->next)
+		w->next->prev = w->prev;
+	else
+		base->waiters_tail = w->prev;
+	w->prev = w->next = NULL;
+	w->queued = FALSE;
+	EXTRA_ASSERT(base->count_waiting > 0);
+	base->count_waiting --;
+	base->count_waiting_class[w->klass] --;
+}
+
+static int
+_class_priority(enum sqlx_cache_class_e klass)
+{
+	switch (klass) {
+		case SQLX_CACHE_CLASS_REPLICATION:
+			return 0;
+		case SQLX_CACHE_CLASS_READ:
+		case SQLX_CACHE_CLASS_WRITE:
+			return 1;
+		default:
+			return 2;
+	}
+}
+
+/* The first waiter of the most urgent class. Client reads and writes are
+ * served in their order of arrival. */
+static struct sqlx_waiter_s *
+_waiter_pick(sqlx_base_t *base)
+{
+	struct sqlx_waiter_s *best = NULL;
+	for (struct sqlx_waiter_s *w = base->waiters_head; w ; w = w->next) {
+		if (!best || _class_priority(w->klass) < _class_priority(best->klass))
+			best = w;
+	}
+	return best;
+}
+
+/* The base must be USED by the current thread, without any other reference.
+ * Gives it to the next waiter, if any, without releasing it in between. */
+static gboolean
+_handoff_base(sqlx_base_t *base)
+{
+	EXTRA_ASSERT(base->status == SQLX_BASE_USED);
+	EXTRA_ASSERT(base->count_open == 0);
+
+	struct sqlx_waiter_s *w = _waiter_pick(base);
+	if (!w)
+		return FALSE;
+
+	_waiter_remove(base, w);
+	w->granted = TRUE;
+	base->owner = w->thread;
+	base->count_open = 1;
+	base->maintained = FALSE;
+	g_cond_signal(&w->cond);
+	return TRUE;
+}
+
+/* Wakes all the waiters up, so that they check again the state of the base.
+ * They are also removed from the queue of the base, because the base might
+ * be recycled for another name before they retry. */
 static void
 _signal_base(sqlx_base_t *base)
 {
 	EXTRA_ASSERT(base != NULL);
-	g_cond_signal(&(base->cond_prio));
-	g_cond_signal(&(base->cond));
+	while (base->waiters_head) {
+		struct sqlx_waiter_s *w = base->waiters_head;
+		_waiter_remove(base, w);
+		g_cond_signal(&w->cond);
+	}
 }
 
 /**
@@ -397,7 +542,7 @@ _expire_base(sqlx_cache_t *cache, sqlx_base_t *b, gboolean deleted)
 	/* the base is for the given thread, it is time to REALLY close it.
 	 * But this can take a lot of time. So we can release the pool,
 	 * free the handle and unlock the cache */
-	_signal_base(b),
+	_signal_base(b);
 	g_mutex_unlock(&cache->lock);
 	if (cache->close_hook)
 		cache->close_hook(handle);
@@ -414,6 +559,9 @@ _expire_base(sqlx_cache_t *cache, sqlx_base_t *b, gboolean deleted)
 
 	g_tree_remove(cache->bases_by_name, n);
 	g_free(n);
+
+	/* The threads that queued while the base was being closed must retry */
+	_signal_base(b);
 }
 
 static gint
@@ -513,8 +661,6 @@ sqlx_cache_init(void)
 		sqlx_base_t *base = cache->bases + i;
 		base->index = i;
 		base->link.prev = base->link.next = -1;
-		g_cond_init(&base->cond);
-		g_cond_init(&base->cond_prio);
 	}
 
 	/* stack all the bases in the FREE list, so that the first bases are
@@ -553,8 +699,7 @@ sqlx_cache_clean(sqlx_cache_t *cache)
 					break;
 			}
 
-			g_cond_clear(&base->cond);
-			g_cond_clear(&base->cond_prio);
+			EXTRA_ASSERT(base->waiters_head == NULL);
 			g_free0 (base->name);
 			base->name = NULL;
 		}
@@ -568,9 +713,51 @@ sqlx_cache_clean(sqlx_cache_t *cache)
 	g_free(cache);
 }
 
+static guint32
+_class_max_waiting(enum sqlx_cache_class_e klass)
+{
+	switch (klass) {
+		case SQLX_CACHE_CLASS_REPLICATION:
+			return 0;
+		case SQLX_CACHE_CLASS_WRITE:
+			return _cache_max_waiting_write ?: _cache_max_waiting;
+		case SQLX_CACHE_CLASS_READ:
+			return _cache_max_waiting_read ?: _cache_max_waiting;
+		default:
+			return _cache_max_waiting_background ?: _cache_max_waiting;
+	}
+}
+
+/* Queues the current thread on the base, then waits for the base to be
+ * handed off, or for a notification to check its state again, or for the
+ * deadline. The waiter keeps its rank in the queue across the unit waits.
+ * Returns TRUE if the base has been given to the current thread. */
+static gboolean
+_wait_for_base(sqlx_cache_t *cache, sqlx_base_t *base,
+		enum sqlx_cache_class_e klass, const gint64 deadline)
+{
+	struct sqlx_waiter_s waiter = {0};
+	waiter.thread = g_thread_self();
+	waiter.klass = klass;
+	g_cond_init(&waiter.cond);
+	_waiter_push(base, &waiter);
+
+	while (!waiter.granted && waiter.queued
+			&& oio_ext_monotonic_time() <= deadline) {
+		/* Do not use oio_ext_monotonic_time() because it can be a fake clock */
+		g_cond_wait_until(&waiter.cond, &cache->lock,
+				g_get_monotonic_time() + _cache_period_cond_wait);
+	}
+
+	if (waiter.queued)
+		_waiter_remove(base, &waiter);
+	g_cond_clear(&waiter.cond);
+	return waiter.granted;
+}
+
 GError *
 sqlx_cache_open_and_lock_base(sqlx_cache_t *cache, const hashstr_t *hname,
-		gboolean urgent, gint *result, gint64 deadline)
+		enum sqlx_cache_class_e klass, gint *result, gint64 deadline)
 {
 	gint bd;
 	GError *err = NULL;
@@ -609,8 +796,6 @@ retry:
 	else {
 		base = GET(cache, bd);
 
-		GCond *wait_cond = urgent? &base->cond_prio : &base->cond;
-
 		const gint64 now = oio_ext_monotonic_time ();
 
 		if (now > deadline) {
@@ -635,6 +820,7 @@ retry:
 				sqlx_base_move_to_list(cache, base, SQLX_BASE_USED);
 				base->count_open ++;
 				base->owner = g_thread_self();
+				base->maintained = FALSE;
 				*result = base->index;
 				break;
 
@@ -645,30 +831,29 @@ retry:
 					GRID_DEBUG("Base [%s] in use by another thread (%X), waiting...",
 							hashstr_str(hname), oio_log_thread_id(base->owner));
 
-					if (!urgent && _cache_max_waiting > 0 &&
-							base->count_waiting >= _cache_max_waiting) {
+					const guint32 max_waiting = _class_max_waiting(klass);
+					const guint32 waiting = base->count_waiting_class[klass];
+					if (max_waiting > 0 && waiting >= max_waiting) {
 						if (_cache_fail_on_heavy_load) {
 							err = NEWERROR(CODE_EXCESSIVE_LOAD, "Load too high "
 									"(%"G_GUINT32_FORMAT"/%"G_GUINT32_FORMAT")",
-									base->count_waiting, _cache_max_waiting);
+									waiting, max_waiting);
 							break;
 						} else if (_cache_alert_on_heavy_load) {
 							GRID_WARN("Load too high on [%s] "
 									"(%"G_GUINT32_FORMAT"/%"G_GUINT32_FORMAT")"
 									" reqid=%s", hashstr_str(hname),
-									base->count_waiting, _cache_max_waiting,
+									waiting, max_waiting,
 									oio_ext_get_reqid());
 						}
 					}
 
-					base->count_waiting ++;
-
-					/* The lock is held by another thread/request.
-					   Do not use 'now' because it can be a fake clock */
-					g_cond_wait_until(wait_cond, &cache->lock,
-							g_get_monotonic_time() + _cache_period_cond_wait);
-
-					base->count_waiting --;
+					/* The lock is held by another thread/request. */
+					if (_wait_for_base(cache, base, klass, deadline)) {
+						EXTRA_ASSERT(base->owner == g_thread_self());
+						*result = base->index;
+						break;
+					}
 					goto retry;
 				}
 				base->owner = g_thread_self();
@@ -678,10 +863,9 @@ retry:
 
 			case SQLX_BASE_CLOSING:
 				EXTRA_ASSERT(base->owner != NULL);
-				/* Just wait for a notification then retry
-				   Do not use 'now' because it can be a fake clock */
-				g_cond_wait_until(wait_cond, &cache->lock,
-						g_get_monotonic_time() + _cache_period_cond_wait);
+				/* Just wait for a notification then retry. A closing base
+				 * is never handed off. */
+				(void) _wait_for_base(cache, base, klass, deadline);
 				goto retry;
 
 			case SQLX_BASE_CLOSING_FOR_DELETION:
@@ -692,13 +876,10 @@ retry:
 		}
 	}
 
-	if (base) {
-		if (!err) {
-			sqlx_base_debug(__FUNCTION__, base);
-			EXTRA_ASSERT(base->owner == g_thread_self());
-			EXTRA_ASSERT(base->count_open > 0);
-		}
-		_signal_base(base);
+	if (base && !err) {
+		sqlx_base_debug(__FUNCTION__, base);
+		EXTRA_ASSERT(base->owner == g_thread_self());
+		EXTRA_ASSERT(base->count_open > 0);
 	}
 	g_mutex_unlock(&cache->lock);
 	return err;
@@ -739,6 +920,8 @@ sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd, guint32 flags)
 			if (!(-- base->count_open)) {  /* to be closed */
 				if (flags & (SQLX_CLOSE_IMMEDIATELY|SQLX_CLOSE_FOR_DELETION)) {
 					_expire_base(cache, base, flags & SQLX_CLOSE_FOR_DELETION);
+				} else if (_handoff_base(base)) {
+					sqlx_base_debug("HANDOFF", base);
 				} else {
 					sqlx_base_debug("CLOSING", base);
 					base->owner = NULL;
@@ -760,7 +943,6 @@ sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd, guint32 flags)
 
 	if (base && !err)
 		sqlx_base_debug(__FUNCTION__, base);
-	_signal_base(base),
 	g_mutex_unlock(&cache->lock);
 	return err;
 }
@@ -831,6 +1013,79 @@ sqlx_cache_expire(sqlx_cache_t *cache, guint max, gint64 duration)
 	return nb;
 }
 
+/* The base to maintain is the one just more recent than the maintained
+ * bases. A base without handle has nothing to maintain, it is directly
+ * counted among the maintained. */
+static sqlx_base_t *
+_first_base_to_maintain(sqlx_cache_t *cache)
+{
+	struct beacon_s *beacons[] = {
+		&cache->beacon_idle, &cache->beacon_idle_hot, NULL
+	};
+	for (struct beacon_s **pb=beacons; *pb ;++pb) {
+		for (;;) {
+			sqlx_base_t *base = (*pb)->maintained < 0
+				? sqlx_get_by_id(cache, (*pb)->last)
+				: sqlx_prev_by_id(cache, (*pb)->maintained);
+			if (!base)
+				break;
+			if (base->handle)
+				return base;
+			base->maintained = TRUE;
+			(*pb)->maintained = base->index;
+		}
+	}
+	return NULL;
+}
+
+guint
+sqlx_cache_maintain_idle(sqlx_cache_t *cache, guint max, gint64 duration,
+		sqlx_cache_maintenance_hook hook, gpointer udata)
+{
+	guint nb = 0;
+	const gint64 deadline = oio_ext_monotonic_time () + duration;
+
+	EXTRA_ASSERT(cache != NULL);
+	EXTRA_ASSERT(hook != NULL);
+
+	g_mutex_lock(&cache->lock);
+	for (; !max || nb < max ; nb++) {
+		sqlx_base_t *base = NULL;
+		if (oio_ext_monotonic_time () > deadline
+				|| !(base = _first_base_to_maintain(cache)))
+			break;
+
+		/* Make the base USED by the current thread, like a request would,
+		 * so that nobody touches it during the maintenance. But keep its
+		 * timestamp, so that it expires as if it had remained idle. */
+		const enum sqlx_base_status_e status = base->status;
+		const gint64 last_update = base->last_update;
+		EXTRA_ASSERT(base->count_open == 0);
+		EXTRA_ASSERT(base->owner == NULL);
+		base->owner = g_thread_self();
+		base->count_open = 1;
+		sqlx_base_move_to_list(cache, base, SQLX_BASE_USED);
+
+		g_mutex_unlock(&cache->lock);
+		hook(base->handle, udata);
+		g_mutex_lock(&cache->lock);
+
+		/* Requests may have queued during the maintenance */
+		base->count_open = 0;
+		if (!_handoff_base(base)) {
+			base->owner = NULL;
+			base->maintained = TRUE;
+			sqlx_base_remove_from_list(cache, base);
+			base->last_update = last_update;
+			SQLX_INSERT_MAINTAINED(cache, base, status == SQLX_BASE_IDLE_HOT
+					? &(cache->beacon_idle_hot) : &(cache->beacon_idle), status);
+		}
+	}
+	g_mutex_unlock(&cache->lock);
+
+	return nb;
+}
+
 gpointer
 sqlx_cache_get_handle(sqlx_cache_t *cache, gint bd)
 {
@@ -45,11 +45,25 @@ void sqlx_cache_clean(sqlx_cache_t *cache);
 
 void sqlx_cache_debug(sqlx_cache_t *cache);
 
+/** The classes of requests competing for a base. When a base is released,
+ * it is handed off to the oldest waiter of the most urgent class: the
+ * replication first, then the client reads and writes in their order of
+ * arrival, then the background tasks. Each class has its own limit of
+ * waiters per base. */
+enum sqlx_cache_class_e
+{
+	SQLX_CACHE_CLASS_REPLICATION = 0,
+	SQLX_CACHE_CLASS_WRITE,
+	SQLX_CACHE_CLASS_READ,
+	SQLX_CACHE_CLASS_BACKGROUND,
+	SQLX_CACHE_CLASS_MAX
+};
+
 /** Similar to sqlx_cache_open_base2() and sqlx_cache_lock_base()
  * but in the same critical section. */
 GError * sqlx_cache_open_and_lock_base(sqlx_cache_t *cache,
-		const struct hashstr_s *key, gboolean urgent, gint *result,
-		gint64 deadline);
+		const struct hashstr_s *key, enum sqlx_cache_class_e klass,
+		gint *result, gint64 deadline);
 
 /** The invert of sqlx_cache_open_and_lock_base() */
 GError * sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd,
@@ -60,6 +74,15 @@ guint sqlx_cache_expire_all(sqlx_cache_t *cache);
 /** Check for expired bases, then close them */
 guint sqlx_cache_expire(sqlx_cache_t *cache, guint max, gint64 duration);
 
+typedef void (*sqlx_cache_maintenance_hook)(gpointer handle, gpointer udata);
+
+/** Calls the hook on at most `max` idle bases (0 means no limit) that have
+ * not been maintained since they have been used, for at most `duration`.
+ * Each base is reserved for the current thread during its maintenance.
+ * Returns how many bases have been maintained. */
+guint sqlx_cache_maintain_idle(sqlx_cache_t *cache, guint max, gint64 duration,
+		sqlx_cache_maintenance_hook hook, gpointer udata);
+
 /** One statistics for each possible base's status */
 struct cache_counts_s
 {
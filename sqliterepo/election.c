@@ -38,7 +38,7 @@ License along with this library.
 #define MEMBER_NAME(n, m) NAME2CONST(n, m->inline_name)
 
 #ifdef HAVE_EXTRA_DEBUG
-#define TRACE_EXECUTION(M) _manager_record_activity((M), __FUNCTION__, __LINE__)
+#define TRACE_EXECUTION(S) _shard_record_activity((S), __FUNCTION__, __LINE__)
 #else
 #define TRACE_EXECUTION(...)
 #endif
@@ -101,6 +101,27 @@ struct activity_trace_element_s
 	int line;
 };
 
+/* @private */
+struct election_shard_s
+{
+	struct election_manager_s *manager;
+
+	GMutex lock;
+
+	/* GTree<gchar*,GCond*> */
+	GTree *conditions;
+
+	/* GTree<gchar*,struct election_member_s*> */
+	GTree *members_by_key;
+
+	/* Trace of actions while the lock was held */
+	GArray *activity_trace;
+
+	gboolean deferred_peering_notify;
+
+	struct deque_beacon_s members_by_state[STEP_MAX];
+};
+
 /* @private */
 struct election_manager_s
 {
@@ -114,26 +135,22 @@ struct election_manager_s
 	/* do not free or change the fields below */
 	const struct replication_config_s *config;
 
-	/* GTree<gchar*,GCond*> */
-	GTree *conditions;
-
 	GThreadPool *completions;
 
 	GThreadPool *tasks_getpeers;
 
-	/* GTree<gchar*,struct election_member_s*> */
-	GTree *members_by_key;
+	/* The elections are spread over independent shards, each one with its
+	 * own lock, so that unrelated elections do not contend. */
+	struct election_shard_s *shards;
+	guint shards_nb;
 
-	GMutex lock;
-
-	/* Trace of actions while the lock was held */
-	GArray *activity_trace;
+	/* Read and written with g_atomic_int_*(), it spans all the shards */
+	gint exiting;
 
-	gboolean exiting;
-
-	gboolean deferred_peering_notify;
-
-	struct deque_beacon_s members_by_state[STEP_MAX];
+	/* The shard where the next balancing starts, so that each shard takes
+	 * its turn at giving up its masters first. Read and written with
+	 * g_atomic_int_*(). */
+	gint balance_next;
 };
 
 /* @private */
@@ -152,6 +169,7 @@ struct election_member_s
 	struct election_member_s *next;
 
 	struct election_manager_s *manager;
+	struct election_shard_s *shard;
 	struct sqlx_sync_s *sync;
 
 	/* Weak pointer to the condition, do not free! */
@@ -388,30 +406,30 @@ _cond_clean (gpointer p)
 #define _ELECTION_MANAGER_LOCKED 0x02
 
 static inline void
-_manager_record_activity(struct election_manager_s *M, const char *fn, int ln)
+_shard_record_activity(struct election_shard_s *S, const char *fn, int ln)
 {
-	if (M->exiting) return;
+	if (g_atomic_int_get(&S->manager->exiting)) return;
 
 	struct activity_trace_element_s item = {};
 	item.when = oio_ext_monotonic_time();
 	item.func = fn;
 	item.line = ln;
-	g_array_append_vals(M->activity_trace, &item, 1);
+	g_array_append_vals(S->activity_trace, &item, 1);
 }
 
 #ifdef HAVE_EXTRA_DEBUG
 
-#define _manager_save_locked(M) do { \
-	g_array_set_size(M->activity_trace, 0); \
-	TRACE_EXECUTION(M); \
+#define _shard_save_locked(S) do { \
+	g_array_set_size(S->activity_trace, 0); \
+	TRACE_EXECUTION(S); \
 } while (0)
 
 static void
-_manage_dump_activity(struct election_manager_s *M)
+_shard_dump_activity(struct election_shard_s *S)
 {
-	if (M->exiting) return;
+	if (g_atomic_int_get(&S->manager->exiting)) return;
 
-	const GArray *ga = M->activity_trace;
+	const GArray *ga = S->activity_trace;
 	EXTRA_ASSERT(ga->len > 0);
 	gint64 _in = g_array_index(ga, struct activity_trace_element_s, 0).when;
 	const gint64 _out = g_array_index(ga, struct activity_trace_element_s, ga->len - 1).when;
@@ -430,26 +448,32 @@ _manage_dump_activity(struct election_manager_s *M)
 	}
 }
 #else
-#define _manager_save_locked(...)
-#define _manage_dump_activity(...)
+#define _shard_save_locked(...)
+#define _shard_dump_activity(...)
 #endif
 
-#define _manager_lock(M) do { \
-	g_mutex_lock(&(M)->lock); \
-	_manager_save_locked(M); \
+#define _shard_lock(S) do { \
+	g_mutex_lock(&(S)->lock); \
+	_shard_save_locked(S); \
 } while (0)
 
-#define _manager_unlock(M) do { \
-	TRACE_EXECUTION(M); \
-	_manage_dump_activity(M); \
-	const gboolean _peering_notify = (M)->deferred_peering_notify; \
-	(M)->deferred_peering_notify = FALSE; \
-	g_mutex_unlock(&M->lock); \
+#define _shard_unlock(S) do { \
+	TRACE_EXECUTION(S); \
+	_shard_dump_activity(S); \
+	const gboolean _peering_notify = (S)->deferred_peering_notify; \
+	(S)->deferred_peering_notify = FALSE; \
+	g_mutex_unlock(&(S)->lock); \
 	if (_peering_notify) { \
-		sqlx_peering__notify((M)->peering); \
+		sqlx_peering__notify((S)->manager->peering); \
 	} \
 } while (0)
 
+static inline struct election_shard_s *
+_manager_get_shard(struct election_manager_s *M, const char *key)
+{
+	return M->shards + (g_str_hash(key) % M->shards_nb);
+}
+
 static void _completion_router(gpointer p, struct election_manager_s *M);
 static void _worker_getpeers(struct election_member_s *m, struct election_manager_s *M);
 
@@ -460,7 +484,7 @@ _DEQUE_remove (struct election_member_s *m)
 {
 	EXTRA_ASSERT(m != NULL);
 	EXTRA_ASSERT(m->step < STEP_MAX);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
+	struct deque_beacon_s *beacon = m->shard->members_by_state + m->step;
 	EXTRA_ASSERT(beacon->count > 0);
 
 	struct election_member_s *prev = m->prev, *next = m->next;
@@ -479,7 +503,7 @@ _DEQUE_add (struct election_member_s *m)
 	EXTRA_ASSERT(m->step < STEP_MAX);
 	EXTRA_ASSERT(m->prev == NULL);
 	EXTRA_ASSERT(m->next == NULL);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
+	struct deque_beacon_s *beacon = m->shard->members_by_state + m->step;
 
 	if (beacon->back) {
 		m->prev = beacon->back;
@@ -587,13 +611,19 @@ election_manager_create(struct replication_config_s *config,
 	manager->vtable = &VTABLE;
 	manager->config = config;
 
-	g_mutex_init(&manager->lock);
-
-	manager->members_by_key =
-		g_tree_new_full(metautils_strcmp3, NULL, NULL, NULL);
-
-	manager->conditions =
-		g_tree_new_full(metautils_strcmp3, NULL, g_free, _cond_clean);
+	manager->shards_nb = MAX(1, sqliterepo_election_shards);
+	manager->shards = g_malloc0(manager->shards_nb * sizeof(struct election_shard_s));
+	for (guint i=0; i<manager->shards_nb ;++i) {
+		struct election_shard_s *shard = manager->shards + i;
+		shard->manager = manager;
+		g_mutex_init(&shard->lock);
+		shard->members_by_key =
+			g_tree_new_full(metautils_strcmp3, NULL, NULL, NULL);
+		shard->conditions =
+			g_tree_new_full(metautils_strcmp3, NULL, g_free, _cond_clean);
+		shard->activity_trace =
+			g_array_sized_new(FALSE, FALSE, sizeof(struct activity_trace_element_s), 32);
+	}
 
 	manager->completions =
 		g_thread_pool_new((GFunc)_completion_router, manager, 8, FALSE, NULL);
@@ -601,9 +631,6 @@ election_manager_create(struct replication_config_s *config,
 	manager->tasks_getpeers =
 		g_thread_pool_new((GFunc)_worker_getpeers, manager, 8, FALSE, NULL);
 
-	manager->activity_trace =
-		g_array_sized_new(FALSE, FALSE, sizeof(struct activity_trace_element_s), 32);
-
 	*result = manager;
 	return NULL;
 }
@@ -689,29 +716,35 @@ election_manager_get_mode (const struct election_manager_s *m)
 	return ((struct abstract_election_manager_s*)m)->vtable->get_mode(m);
 }
 
-static struct election_counts_s
-_NOLOCK_count (struct election_manager_s *manager)
+static void
+_NOLOCK_count (struct election_shard_s *shard, struct election_counts_s *pcount)
 {
 	struct election_counts_s count = {0};
-	count.none = manager->members_by_state[STEP_NONE].count;
-	count.pending += manager->members_by_state[STEP_CREATING].count;
-	count.pending += manager->members_by_state[STEP_WATCHING].count;
-	count.pending += manager->members_by_state[STEP_LISTING].count;
-	count.pending += manager->members_by_state[STEP_ASKING].count;
-	count.pending += manager->members_by_state[STEP_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_DELAYED_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_DELAYED_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_REFRESH_CHECKING_MASTER].count;
-	count.pending += manager->members_by_state[STEP_REFRESH_CHECKING_SLAVES].count;
-	count.pending += manager->members_by_state[STEP_SYNCING].count;
-	count.pending += manager->members_by_state[STEP_LEAVING].count;
-	count.pending += manager->members_by_state[STEP_LEAVING_FAILING].count;
-	count.failed = manager->members_by_state[STEP_FAILED].count;
-	count.slave = manager->members_by_state[STEP_SLAVE].count;
-	count.master = manager->members_by_state[STEP_MASTER].count;
+	count.none = shard->members_by_state[STEP_NONE].count;
+	count.pending += shard->members_by_state[STEP_CREATING].count;
+	count.pending += shard->members_by_state[STEP_WATCHING].count;
+	count.pending += shard->members_by_state[STEP_LISTING].count;
+	count.pending += shard->members_by_state[STEP_ASKING].count;
+	count.pending += shard->members_by_state[STEP_CHECKING_MASTER].count;
+	count.pending += shard->members_by_state[STEP_CHECKING_SLAVES].count;
+	count.pending += shard->members_by_state[STEP_DELAYED_CHECKING_MASTER].count;
+	count.pending += shard->members_by_state[STEP_DELAYED_CHECKING_SLAVES].count;
+	count.pending += shard->members_by_state[STEP_REFRESH_CHECKING_MASTER].count;
+	count.pending += shard->members_by_state[STEP_REFRESH_CHECKING_SLAVES].count;
+	count.pending += shard->members_by_state[STEP_SYNCING].count;
+	count.pending += shard->members_by_state[STEP_LEAVING].count;
+	count.pending += shard->members_by_state[STEP_LEAVING_FAILING].count;
+	count.failed = shard->members_by_state[STEP_FAILED].count;
+	count.slave = shard->members_by_state[STEP_SLAVE].count;
+	count.master = shard->members_by_state[STEP_MASTER].count;
 	count.total = count.none + count.pending + count.master + count.slave + count.failed;
-	return count;
+
+	pcount->none += count.none;
+	pcount->pending += count.pending;
+	pcount->failed += count.failed;
+	pcount->slave += count.slave;
+	pcount->master += count.master;
+	pcount->total += count.total;
 }
 
 struct election_counts_s
@@ -720,14 +753,88 @@ election_manager_count(struct election_manager_s *manager)
 	MANAGER_CHECK(manager);
 	EXTRA_ASSERT (manager->vtable == &VTABLE);
 
-	_manager_lock(manager);
-	struct election_counts_s count = _NOLOCK_count (manager);
-	_manager_unlock(manager);
+	struct election_counts_s count = {0};
+	for (guint i=0; i<manager->shards_nb ;++i) {
+		struct election_shard_s *shard = manager->shards + i;
+		_shard_lock(shard);
+		_NOLOCK_count (shard, &count);
+		_shard_unlock(shard);
+	}
 	return count;
 }
 
+void
+election_hint_free (struct election_hint_s *hint)
+{
+	if (!hint)
+		return;
+	oio_str_clean(&hint->ns);
+	oio_str_clean(&hint->base);
+	oio_str_clean(&hint->type);
+	oio_str_clean(&hint->master_url);
+	if (hint->peers)
+		g_strfreev(hint->peers);
+	g_free(hint);
+}
+
+static gint
+_hint_cmp_atime(gconstpointer p0, gconstpointer p1)
+{
+	const struct election_hint_s *h0 = *(struct election_hint_s**)p0;
+	const struct election_hint_s *h1 = *(struct election_hint_s**)p1;
+	return CMP(h1->atime, h0->atime);
+}
+
+GPtrArray *
+election_manager_collect_hints(struct election_manager_s *manager, guint max)
+{
+	MANAGER_CHECK(manager);
+	EXTRA_ASSERT (manager->vtable == &VTABLE);
+
+	GPtrArray *out = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)election_hint_free);
+	const char *local = election_manager_get_local(manager);
+
+	gboolean _collect(gpointer k, gpointer v, gpointer u) {
+		(void) k, (void) u;
+		struct election_member_s *m = v;
+		if (!m->peers || !*m->peers)
+			return FALSE;
+		struct election_hint_s *hint = g_malloc0(sizeof(*hint));
+		hint->ns = g_strdup(m->inline_name.ns);
+		hint->base = g_strdup(m->inline_name.base);
+		hint->type = g_strdup(m->inline_name.type);
+		hint->peers = g_strdupv(m->peers);
+		hint->atime = m->last_atime;
+		if (m->step == STEP_MASTER)
+			hint->master_url = g_strdup(local);
+		else if (m->step == STEP_SLAVE && m->master_url)
+			hint->master_url = g_strdup(m->master_url);
+		g_ptr_array_add(out, hint);
+		return FALSE;
+	}
+
+	for (guint i=0; i<manager->shards_nb ;++i) {
+		struct election_shard_s *shard = manager->shards + i;
+		_shard_lock(shard);
+		g_tree_foreach(shard->members_by_key, _collect, NULL);
+		_shard_unlock(shard);
+	}
+
+	g_ptr_array_sort(out, _hint_cmp_atime);
+	if (max > 0 && out->len > max)
+		g_ptr_array_remove_range(out, max, out->len - max);
+	return out;
+}
+
 static struct election_member_s *
-_LOCKED_get_member (struct election_manager_s *ma, const char *k);
+_LOCKED_get_member (struct election_shard_s *shard, const char *k);
+
+static struct election_member_s *
+_LOCKED_init_member(struct election_manager_s *manager,
+		struct election_shard_s *shard,
+		const struct sqlx_name_s *n, const char *key,
+		gboolean autocreate);
 
 #define member_reset_peers(m) do { \
 	if (m->peers) { \
@@ -742,13 +849,11 @@ _LOCKED_get_member (struct election_manager_s *ma, const char *k);
 } while (0)
 
 static gboolean
-_LOCKED_get_cached_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar ***result)
+_LOCKED_get_cached_peers(struct election_shard_s *shard, const char *key,
+		gchar ***result)
 {
 	gboolean success = FALSE;
-	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
-	sqliterepo_hash_name(n, key, sizeof(key));
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->peers && *(member->peers)) {
 			*result = g_strdupv(member->peers);
@@ -760,12 +865,10 @@ _LOCKED_get_cached_peers(struct election_manager_s *manager,
 }
 
 static void
-_LOCKED_cache_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar **peers)
+_LOCKED_cache_peers(struct election_shard_s *shard, const char *key,
+		gchar **peers)
 {
-	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
-	sqliterepo_hash_name(n, key, sizeof(key));
-	struct election_member_s *member = _LOCKED_get_member(manager, key);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->peers)
 			member_reset_peers(member);
@@ -776,22 +879,48 @@ _LOCKED_cache_peers(struct election_manager_s *manager,
 }
 
 static gboolean
-_get_cached_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar ***result)
+_get_cached_peers(struct election_shard_s *shard, const char *key,
+		gchar ***result)
 {
-	_manager_lock(manager);
-	gboolean rc = _LOCKED_get_cached_peers(manager, n, result);
-	_manager_unlock(manager);
+	_shard_lock(shard);
+	gboolean rc = _LOCKED_get_cached_peers(shard, key, result);
+	_shard_unlock(shard);
 	return rc;
 }
 
 static void
-_cache_peers(struct election_manager_s *manager,
-		const struct sqlx_name_s *n, gchar **peers)
+_cache_peers(struct election_shard_s *shard, const char *key, gchar **peers)
+{
+	_shard_lock(shard);
+	_LOCKED_cache_peers(shard, key, peers);
+	_shard_unlock(shard);
+}
+
+void
+election_manager_seed_hint(struct election_manager_s *manager,
+		const struct election_hint_s *hint)
 {
-	_manager_lock(manager);
-	_LOCKED_cache_peers(manager, n, peers);
-	_manager_unlock(manager);
+	MANAGER_CHECK(manager);
+	EXTRA_ASSERT (manager->vtable == &VTABLE);
+	EXTRA_ASSERT(hint != NULL);
+
+	if (!hint->peers || !*hint->peers)
+		return;
+
+	const struct sqlx_name_s n = {hint->ns, hint->base, hint->type};
+	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
+	sqliterepo_hash_name(&n, key, sizeof(key));
+
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
+	_shard_lock(shard);
+	struct election_member_s *member =
+		_LOCKED_init_member(manager, shard, &n, key, TRUE);
+	if (!member->peers || !*member->peers) {
+		member_reset_peers(member);
+		member->peers = g_strdupv(hint->peers);
+	}
+	member_unref(member);
+	_shard_unlock(shard);
 }
 
 static GError *
@@ -810,11 +939,16 @@ _election_get_peers(struct election_manager_s *manager,
 	gchar **peers = NULL;
 	gboolean nocache = flags & SQLX_REPO_NOCACHE;
 	gboolean peers_from_election = FALSE;
+
+	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
+	sqliterepo_hash_name(n, key, sizeof(key));
+	struct election_shard_s *shard = _manager_get_shard(manager, key);
+
 	if (!nocache) {
 		if (flags & _ELECTION_MANAGER_LOCKED)
-			peers_from_election = _LOCKED_get_cached_peers(manager, n, &peers);
+			peers_from_election = _LOCKED_get_cached_peers(shard, key, &peers);
 		else
-			peers_from_election = _get_cached_peers(manager, n, &peers);
+			peers_from_election = _get_cached_peers(shard, key, &peers);
 	}
 	if (!peers_from_election) {
 		/* Member does not exist yet
@@ -827,9 +961,9 @@ _election_get_peers(struct election_manager_s *manager,
 		if (!peers_from_election) {
 			/* Peers did not come from election, we can cache them. */
 			if (flags & _ELECTION_MANAGER_LOCKED)
-				_LOCKED_cache_peers(manager, n, peers);
+				_LOCKED_cache_peers(shard, key, peers);
 			else
-				_cache_peers(manager, n, peers);
+				_cache_peers(shard, key, peers);
 		}
 		*result = peers;
 	} else {
@@ -846,17 +980,14 @@ _manager_clean(struct election_manager_s *manager)
 	if (!manager)
 		return;
 
-	struct election_counts_s count = _NOLOCK_count(manager);
+	struct election_counts_s count = {0};
+	for (guint i=0; i<manager->shards_nb ;++i)
+		_NOLOCK_count(manager->shards + i, &count);
 	GRID_DEBUG("%d elections still alive at manager shutdown: %d masters, "
 			"%d slaves, %d pending, %d failed, %d exited",
 			count.total, count.master, count.slave, count.pending,
 			count.failed, count.none);
 
-	if (manager->activity_trace) {
-		g_array_free(manager->activity_trace, TRUE);
-		manager->activity_trace = NULL;
-	}
-
 	if (manager->completions) {
 		g_thread_pool_free(manager->completions, FALSE, TRUE);
 		manager->completions = NULL;
@@ -867,30 +998,40 @@ _manager_clean(struct election_manager_s *manager)
 		manager->tasks_getpeers = NULL;
 	}
 
-	if (manager->members_by_key) {
-		g_tree_destroy (manager->members_by_key);
-		manager->members_by_key = NULL;
-	}
+	for (guint s=0; s<manager->shards_nb ;++s) {
+		struct election_shard_s *shard = manager->shards + s;
 
-	/* Ensure all the items are unlinked */
-	for (int i=STEP_NONE; i<STEP_MAX ;++i) {
-		struct deque_beacon_s *beacon = manager->members_by_state + i;
-		while (beacon->front != NULL) {
-			struct election_member_s *m = beacon->front;
-			_DEQUE_remove(m);
-			m->refcount = 0; /* ugly quirk that cope with an assert on refcount */
-			member_destroy (m);
+		if (shard->members_by_key) {
+			g_tree_destroy (shard->members_by_key);
+			shard->members_by_key = NULL;
 		}
-		g_assert (beacon->count == 0);
-	}
 
-	if (manager->conditions) {
-		g_tree_destroy(manager->conditions);
-		manager->conditions = NULL;
-	}
+		/* Ensure all the items are unlinked */
+		for (int i=STEP_NONE; i<STEP_MAX ;++i) {
+			struct deque_beacon_s *beacon = shard->members_by_state + i;
+			while (beacon->front != NULL) {
+				struct election_member_s *m = beacon->front;
+				_DEQUE_remove(m);
+				m->refcount = 0; /* ugly quirk that cope with an assert on refcount */
+				member_destroy (m);
+			}
+			g_assert (beacon->count == 0);
+		}
+
+		if (shard->conditions) {
+			g_tree_destroy(shard->conditions);
+			shard->conditions = NULL;
+		}
+
+		if (shard->activity_trace) {
+			g_array_free(shard->activity_trace, TRUE);
+			shard->activity_trace = NULL;
+		}
 
-	g_mutex_clear(&manager->lock);
+		g_mutex_clear(&shard->lock);
+	}
 
+	g_free(manager->shards);
 	g_free(manager->sync_tab);
 	g_free(manager);
 }
@@ -1004,15 +1145,15 @@ member_get_cond(struct election_member_s *m)
 static GMutex*
 member_get_lock(struct election_member_s *m)
 {
-	return &(MMANAGER(m)->lock);
+	return &(m->shard->lock);
 }
 
 #define member_lock(m) do { \
-	_manager_lock(m->manager); \
+	_shard_lock(m->shard); \
 } while (0)
 
 #define member_unlock(m) do { \
-	_manager_unlock(m->manager); \
+	_shard_unlock(m->shard); \
 } while (0)
 
 #define member_signal(m) do { \
@@ -1163,36 +1304,38 @@ member_destroy(struct election_member_s *member)
 }
 
 static struct election_member_s *
-_LOCKED_get_member (struct election_manager_s *M, const char *k)
+_LOCKED_get_member (struct election_shard_s *S, const char *k)
 {
-	struct election_member_s *m = g_tree_lookup (M->members_by_key, k);
+	struct election_member_s *m = g_tree_lookup (S->members_by_key, k);
 	if (m)
 		member_ref (m);
-	TRACE_EXECUTION(M);
+	TRACE_EXECUTION(S);
 	return m;
 }
 
 static GCond *
-_manager_get_condition (struct election_manager_s *m, const char *k)
+_shard_get_condition (struct election_shard_s *S, const char *k)
 {
-	GCond *cond = g_tree_lookup (m->conditions, k);
+	GCond *cond = g_tree_lookup (S->conditions, k);
 	if (!cond) {
 		cond = g_malloc0 (sizeof(GCond));
 		g_cond_init (cond);
-		g_tree_replace (m->conditions, g_strdup(k), cond);
+		g_tree_replace (S->conditions, g_strdup(k), cond);
 	}
 	return cond;
 }
 
 static struct election_member_s *
 _LOCKED_init_member(struct election_manager_s *manager,
+		struct election_shard_s *shard,
 		const struct sqlx_name_s *n, const char *key,
 		gboolean autocreate)
 {
 	MANAGER_CHECK(manager);
 	NAME_CHECK(n);
+	EXTRA_ASSERT(shard == _manager_get_shard(manager, key));
 
-	struct election_member_s *member = _LOCKED_get_member (manager, key);
+	struct election_member_s *member = _LOCKED_get_member (shard, key);
 	if (!member && autocreate) {
 		member = g_malloc0 (sizeof(*member));
 		member->generation_id = oio_ext_rand_int();
@@ -1209,19 +1352,20 @@ _LOCKED_init_member(struct election_manager_s *manager,
 		}
 
 		member->manager = manager;
+		member->shard = shard;
 		member->last_status = oio_ext_monotonic_time ();
 		g_strlcpy(member->key, key, sizeof(member->key));
 		g_strlcpy(member->inline_name.base, n->base, sizeof(member->inline_name.base));
 		g_strlcpy(member->inline_name.type, n->type, sizeof(member->inline_name.type));
 		g_strlcpy(member->inline_name.ns, n->ns, sizeof(member->inline_name.ns));
 		member->refcount = 2;
-		member->cond = _manager_get_condition(manager, member->key);
+		member->cond = _shard_get_condition(shard, member->key);
 
 		_DEQUE_add (member);
-		g_tree_replace(manager->members_by_key, member->key, member);
+		g_tree_replace(shard->members_by_key, member->key, member);
 	}
 
-	TRACE_EXECUTION(manager);
+	TRACE_EXECUTION(shard);
 	return member;
 }
 
@@ -1251,7 +1395,7 @@ election_manager_is_operational(struct election_manager_s *manager)
 			manager->vtable != NULL &&
 			manager->peering != NULL &&
 			manager->config != NULL &&
-			manager->members_by_key != NULL);
+			manager->shards != NULL);
 }
 
 void
@@ -1264,10 +1408,13 @@ election_manager_exit_all(struct election_manager_s *manager, gint64 duration,
 	gint64 pivot = oio_ext_monotonic_time () + duration;
 
 	/* Order the nodes to exit */
-	_manager_lock(manager);
-	manager->exiting = TRUE;
-	g_tree_foreach (manager->members_by_key, _run_exit, NULL);
-	_manager_unlock(manager);
+	g_atomic_int_set(&manager->exiting, TRUE);
+	for (guint i=0; i<manager->shards_nb ;++i) {
+		struct election_shard_s *shard = manager->shards + i;
+		_shard_lock(shard);
+		g_tree_foreach (shard->members_by_key, _run_exit, NULL);
+		_shard_unlock(shard);
+	}
 
 	guint count = manager_count_active(manager);
 	if (duration <= 0) {
@@ -1286,7 +1433,7 @@ election_manager_exit_all(struct election_manager_s *manager, gint64 duration,
 	}
 
 	if (!persist)
-		manager->exiting = FALSE;
+		g_atomic_int_set(&manager->exiting, FALSE);
 }
 
 static void
@@ -1362,9 +1509,10 @@ election_manager_whatabout (struct election_manager_s *m,
 
 	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
 	sqliterepo_hash_name(n, key, sizeof(key));
+	struct election_shard_s *shard = _manager_get_shard(m, key);
 
-	_manager_lock(m);
-	struct election_member_s *member = _LOCKED_get_member(m, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		member_json (member, out);
 		member_unref (member);
@@ -1374,7 +1522,7 @@ election_manager_whatabout (struct election_manager_s *m,
 		else
 			g_string_append_static (out, "null");
 	}
-	_manager_unlock (m);
+	_shard_unlock (shard);
 }
 
 /* --- Zookeeper callbacks ----------------------------------------------------
@@ -1435,7 +1583,7 @@ deferred_completion_CREATING(struct exec_later_CREATING_context_s *d)
 	member_lock(d->member);
 	member_log_completion("CREATE", d->zrc, d->member);
 	_thlocal_set_manager (d->member->manager);
-	TRACE_EXECUTION(d->member->manager);
+	TRACE_EXECUTION(d->member->shard);
 
 	if (d->zrc != ZOK) {
 		transition_error(d->member, EVT_CREATE_KO, d->zrc);
@@ -1553,14 +1701,14 @@ deferred_completion_ASKING(struct exec_later_ASKING_context_s *d)
 				int zrc2 = sqlx_sync_adelete(d->member->sync,
 						member_masterpath(d->member, path, sizeof(path)), -1,
 						completion_DeleteRogueNode, NULL);
-				TRACE_EXECUTION(d->member->manager);
+				TRACE_EXECUTION(d->member->shard);
 
 				if (zrc2 != ZOK) {
 					GRID_WARN("Failed to delete Rogue ZK node %s: %s", path, zerror(zrc2));
 				} else {
 					GRID_WARN("Rogue ZK node being deleted %s", path);
 				}
-				TRACE_EXECUTION(d->member->manager);
+				TRACE_EXECUTION(d->member->shard);
 
 				transition(d->member, EVT_MASTER_BAD, NULL);
 			} else if (!oio_strv_has(peers, d->master)) {
@@ -1738,17 +1886,19 @@ _find_member (struct election_manager_s *M, const char *path, guint gen)
 	memcpy(key, slash, len);
 	key[len] = 0;
 
-	_manager_lock(M);
-	struct election_member_s *member = _LOCKED_get_member(M, key);
+	struct election_shard_s *shard = _manager_get_shard(M, key);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	if (member) {
 		if (member->generation_id == gen)
 			return member;
 		GRID_DEBUG("watcher: [%s] obsolete w=%u gen=%u",
 				member->key, gen, member->generation_id);
+		member_unref(member);
 	} else {
 		GRID_WARN("watcher: [%s] no election found", key);
 	}
-	_manager_unlock(M);
+	_shard_unlock(shard);
 	return NULL;
 }
 
@@ -1779,6 +1929,8 @@ deferred_watch_COMMON(struct deferred_watcher_context_s *d,
 			member_reset(member);
 			member_log_change(member, EVT_DISCONNECTED,
 					member_set_status(member, STEP_NONE));
+			member_unref(member);
+			member_unlock(member);
 		}
 		/* We cannot run all the election and reset everything, because we
 		 * introduced a sharding of the elections across several ZK clusters
@@ -1881,7 +2033,7 @@ _worker_getpeers(struct election_member_s *m, struct election_manager_s *M)
 		transition(m, EVT_GETPEERS_DONE, peers);
 	}
 	member_unref(m);
-	TRACE_EXECUTION(m->manager);
+	TRACE_EXECUTION(m->shard);
 	member_unlock(m);
 
 	if (peers)
@@ -1964,8 +2116,10 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 	gchar key[OIO_ELECTION_KEY_LIMIT_LENGTH];
 	sqliterepo_hash_name(n, key, sizeof(key));
 
-	_manager_lock(m);
-	struct election_member_s *member = _LOCKED_init_member(m, n, key, op != ELOP_EXIT);
+	struct election_shard_s *shard = _manager_get_shard(m, key);
+	_shard_lock(shard);
+	struct election_member_s *member =
+		_LOCKED_init_member(m, shard, n, key, op != ELOP_EXIT);
 	switch (op) {
 		case ELOP_NONE:
 			_election_atime(member);
@@ -1988,7 +2142,7 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 			*out_status = member->step;
 		member_unref(member);
 	}
-	_manager_unlock(m);
+	_shard_unlock(shard);
 
 	return NULL;
 }
@@ -2054,11 +2208,11 @@ wait_for_final_status(struct election_member_s *m, const gint64 deadline)
 				m->when_unstable / G_TIME_SPAN_SECOND, now / G_TIME_SPAN_SECOND);
 
 		/* perform the real WAIT on the real clock. */
-		TRACE_EXECUTION(m->manager);
-		_manage_dump_activity(m->manager);
+		TRACE_EXECUTION(m->shard);
+		_shard_dump_activity(m->shard);
 		g_cond_wait_until(member_get_cond(m), member_get_lock(m),
 				g_get_monotonic_time() + oio_election_period_cond_wait);
-		_manager_save_locked(m->manager);
+		_shard_save_locked(m->shard);
 	}
 
 	m->last_atime = oio_ext_monotonic_time ();
@@ -2083,8 +2237,9 @@ _election_get_status(struct election_manager_s *mgr,
 	const gint64 local_deadline = start + oio_election_delay_wait;
 	deadline = (deadline <= 0) ? local_deadline : MIN(deadline, local_deadline);
 
-	_manager_lock(mgr);
-	struct election_member_s *m = _LOCKED_init_member(mgr, n, key, TRUE);
+	struct election_shard_s *shard = _manager_get_shard(mgr, key);
+	_shard_lock(shard);
+	struct election_member_s *m = _LOCKED_init_member(mgr, shard, n, key, TRUE);
 
 	if (!wait_for_final_status(m, deadline)) {  /* TIMEOUT! */
 		rc = STEP_FAILED;
@@ -2099,7 +2254,7 @@ _election_get_status(struct election_manager_s *mgr,
 	member_unref(m);
 	if (rc == STEP_NONE || STATUS_FINAL(rc))
 		member_signal(m);
-	_manager_unlock(mgr);
+	_shard_unlock(shard);
 
 	GRID_TRACE("STEP=%s/%d master=%s", _step2str(rc), rc, url);
 	switch (rc) {
@@ -2140,10 +2295,10 @@ defer_USE(struct election_member_s *member, const gboolean master)
 	if (member->peers) {
 		member->last_USE = oio_ext_monotonic_time();
 		for (gchar **p = member->peers; *p; p++) {
-			member->manager->deferred_peering_notify |= sqlx_peering__use(
+			member->shard->deferred_peering_notify |= sqlx_peering__use(
 					member->manager->peering, *p, &member->inline_name,
 					master);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 		}
 	}
 
@@ -2321,7 +2476,7 @@ _common_action_to_LEAVE(struct election_member_s *member,
 	int zrc = sqlx_sync_adelete(member->sync,
 			member_fullpath(member, path, sizeof(path)), -1,
 			completion_LEAVING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK))
 		return member_fail_on_error(member, zrc);
@@ -2371,7 +2526,7 @@ member_action_to_CREATING(struct election_member_s *member)
 	if (member->when_unstable <= 0)
 		member->when_unstable = oio_ext_monotonic_time();
 
-	if (member->manager->exiting)
+	if (g_atomic_int_get(&member->manager->exiting))
 		return member_action_to_NONE(member);
 
 	if (!defer_USE(member, FALSE))
@@ -2384,7 +2539,7 @@ member_action_to_CREATING(struct election_member_s *member)
 			myurl, strlen(myurl),
 			ZOO_EPHEMERAL|ZOO_SEQUENCE,
 			completion_CREATING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "CREATE");
@@ -2416,7 +2571,7 @@ member_action_to_WATCHING(struct election_member_s *member)
 			member_fullpath(member, path, sizeof(path)),
 			watch_SELF, GUINT_TO_POINTER(member->generation_id),
 			completion_WATCHING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "WATCH");
@@ -2441,7 +2596,7 @@ member_action_to_LISTING(struct election_member_s *member)
 	int zrc = sqlx_sync_awget_siblings(member->sync,
 			member_fullpath(member, path, sizeof(path)),
 			NULL, NULL, completion_LISTING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "LIST");
@@ -2471,7 +2626,7 @@ member_action_to_ASKING(struct election_member_s *member)
 			member_masterpath(member, path, sizeof(path)),
 			watch_MASTER, GUINT_TO_POINTER(member->generation_id),
 			completion_ASKING, member);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	if (unlikely(zrc != ZOK)) {
 		member_warn_failed_action(member, zrc, "ASK");
@@ -2504,10 +2659,10 @@ member_action_to_SYNCING(struct election_member_s *member)
 	member->when_unstable = oio_ext_monotonic_time();
 
 	member_ref(member);
-	member->manager->deferred_peering_notify |= sqlx_peering__pipefrom(
+	member->shard->deferred_peering_notify |= sqlx_peering__pipefrom(
 			member->manager->peering, target, &member->inline_name, source,
 			member, 0, _result_PIPEFROM);
-	TRACE_EXECUTION(member->manager);
+	TRACE_EXECUTION(member->shard);
 
 	return member_set_status(member, STEP_SYNCING);
 }
@@ -2575,9 +2730,9 @@ member_action_to_CHECKING_MASTER(struct election_member_s *m)
 	m->errors_GETVERS = 0;
 
 	member_ref(m);
-	m->manager->deferred_peering_notify |= sqlx_peering__getvers(
+	m->shard->deferred_peering_notify |= sqlx_peering__getvers(
 			m->manager->peering, m->master_url, &m->inline_name, m, 0, _result_GETVERS);
-	TRACE_EXECUTION(m->manager);
+	TRACE_EXECUTION(m->shard);
 
 	return member_set_status(m, STEP_CHECKING_MASTER);
 }
@@ -2608,9 +2763,9 @@ member_action_to_CHECKING_SLAVES(struct election_member_s *m)
 
 	for (gchar **p=m->peers; *p; p++) {
 		member_ref(m);
-		m->manager->deferred_peering_notify |= sqlx_peering__getvers(
+		m->shard->deferred_peering_notify |= sqlx_peering__getvers(
 				m->manager->peering, *p, &m->inline_name, m, 0, _result_GETVERS);
-		TRACE_EXECUTION(m->manager);
+		TRACE_EXECUTION(m->shard);
 	}
 
 	return member_set_status(m, STEP_CHECKING_SLAVES);
@@ -3079,7 +3234,7 @@ _member_react_NONE(struct election_member_s *member, enum event_type_e evt)
 	switch (evt) {
 		case EVT_NONE:
 			member->requested_USE = 0;
-			if (member->manager->exiting)
+			if (g_atomic_int_get(&member->manager->exiting))
 				return;
 			/* Right now, we start an election cycle. We consider this point
 			 * as the real start of the "unstable" phasis of the election. */
@@ -3133,12 +3288,12 @@ _member_react_PEERING(struct election_member_s *member,
 		case EVT_GETPEERS_DONE:
 			member_reset_peers(member);
 			member->peers = g_strdupv(peers);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 			if (!member->peers)
 				member_action_to_FAILED(member);
 			else
 				member_action_to_CREATING(member);
-			TRACE_EXECUTION(member->manager);
+			TRACE_EXECUTION(member->shard);
 			return;
 
 			/* Abnormal events */
@@ -3464,7 +3619,7 @@ _member_react_LEAVING(struct election_member_s *member,
 	_member_assert_LEAVING (member);
 	switch (evt) {
 		case EVT_NONE:
-			member->requested_USE = (0 == member->manager->exiting);
+			member->requested_USE = (0 == g_atomic_int_get(&member->manager->exiting));
 			return;
 
 			/* Interruptions */
@@ -3963,16 +4118,16 @@ transition(struct election_member_s *member, enum event_type_e evt,
 {
 	member_log_change(member, evt,
 			_member_react(member, evt, evt_arg);
-			TRACE_EXECUTION(member->manager));
+			TRACE_EXECUTION(member->shard));
 
 	/* re-kickoff elections marked as to be restarted, but only if without
 	 * activity and if the manager if not being exited. */
 	if (member->step == STEP_NONE
 			&& BOOL(member->requested_USE)
-			&& !member->manager->exiting) {
+			&& !g_atomic_int_get(&member->manager->exiting)) {
 		member_log_change(member, EVT_NONE,
 			_member_react(member, EVT_NONE, NULL);
-			TRACE_EXECUTION(member->manager));
+			TRACE_EXECUTION(member->shard));
 	}
 }
 
@@ -3996,7 +4151,7 @@ _DEQUE_extract (struct deque_beacon_s *beacon)
 }
 
 static guint
-_play_exit_on_state(struct election_manager_s *M, struct deque_beacon_s *beacon)
+_play_exit_on_state(struct election_shard_s *S, struct deque_beacon_s *beacon)
 {
 	if (beacon->front == NULL)
 		return 0;
@@ -4018,7 +4173,7 @@ _play_exit_on_state(struct election_manager_s *M, struct deque_beacon_s *beacon)
 		/* ... but not referenced by anyone */
 		count ++;
 		_DEQUE_remove (m);
-		g_tree_remove (M->members_by_key, m->key);
+		g_tree_remove (S->members_by_key, m->key);
 		member_unref (m);
 		member_destroy (m);
 	}
@@ -4030,23 +4185,26 @@ guint
 election_manager_play_exits (struct election_manager_s *manager)
 {
 	guint count = 0;
-	struct deque_beacon_s *beacon = manager->members_by_state + STEP_NONE;
-	if (beacon->front) {
-		_manager_lock(manager);
-		count += _play_exit_on_state(manager, beacon);
-		_manager_unlock(manager);
+	for (guint i=0; i<manager->shards_nb ;++i) {
+		struct election_shard_s *shard = manager->shards + i;
+		struct deque_beacon_s *beacon = shard->members_by_state + STEP_NONE;
+		if (beacon->front) {
+			_shard_lock(shard);
+			count += _play_exit_on_state(shard, beacon);
+			_shard_unlock(shard);
+		}
 	}
 	return count;
 }
 
 static guint
-_send_NONE_to_step(struct election_manager_s *M, struct deque_beacon_s *beacon)
+_send_NONE_to_step(struct election_shard_s *S, struct deque_beacon_s *beacon)
 {
 	gboolean stop = FALSE;
 	guint count = 0;
 
 	while (grid_main_is_running() && beacon->front && !stop) {
-		_manager_lock(M);
+		_shard_lock(S);
 		struct election_member_s *m = beacon->front;
 		if (!m) {
 			/* The queue emptied before the lock */
@@ -4069,7 +4227,7 @@ _send_NONE_to_step(struct election_manager_s *M, struct deque_beacon_s *beacon)
 				}
 			}
 		}
-		_manager_unlock(M);
+		_shard_unlock(S);
 	}
 	return count;
 }
@@ -4077,7 +4235,12 @@ _send_NONE_to_step(struct election_manager_s *M, struct deque_beacon_s *beacon)
 static inline guint
 _send_NONE_to_step2 (struct election_manager_s *M, enum election_step_e step)
 {
-	return _send_NONE_to_step(M, M->members_by_state + step);
+	guint count = 0;
+	for (guint i=0; i<M->shards_nb ;++i) {
+		struct election_shard_s *shard = M->shards + i;
+		count += _send_NONE_to_step(shard, shard->members_by_state + step);
+	}
+	return count;
 }
 
 guint
@@ -4116,27 +4279,34 @@ election_manager_balance_masters(struct election_manager_s *M,
 {
 	guint count = 0;
 
-	_manager_lock(M);
-
 	const guint bias = 64;
-	const guint nb_master = M->members_by_state[STEP_MASTER].count;
-	const guint nb_slave = M->members_by_state[STEP_SLAVE].count;
+	struct election_counts_s counts = election_manager_count(M);
+	const guint nb_master = counts.master;
+	const guint nb_slave = counts.slave;
 	const guint ideal = nb_slave / ratio;
 
 	if (nb_master > 0 && nb_master > ideal + bias) {
 		max = MIN(max, nb_master);
 		max = MIN(max, ideal);
-		struct election_member_s *current = M->members_by_state[STEP_MASTER].front;
-		while (max-- > 0 && current) {
-			struct election_member_s *next = current->next;
-			/* Tell the first base to leave its MASTER position but to re-join
-			 * immediately after. */
-			current->requested_USE = 1;
-			transition(current, EVT_LEAVE_REQ, NULL);
-			current = next;
+		const guint first = g_atomic_int_add(&M->balance_next, 1);
+		for (guint i=0; max > 0 && i<M->shards_nb ;++i) {
+			struct election_shard_s *shard =
+				M->shards + ((first + i) % M->shards_nb);
+			_shard_lock(shard);
+			struct election_member_s *current =
+				shard->members_by_state[STEP_MASTER].front;
+			while (max > 0 && current) {
+				struct election_member_s *next = current->next;
+				/* Tell the first base to leave its MASTER position but to
+				 * re-join immediately after. */
+				current->requested_USE = 1;
+				transition(current, EVT_LEAVE_REQ, NULL);
+				current = next;
+				max --;
+			}
+			_shard_unlock(shard);
 		}
 	}
-	_manager_unlock(M);
 
 	return count;
 }
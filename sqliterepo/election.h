@@ -198,6 +198,30 @@ void election_manager_dump_delays(void);
 
 struct election_counts_s election_manager_count (struct election_manager_s *m);
 
+/* What is worth remembering about an election, to warm the service up
+ * after a restart. */
+struct election_hint_s
+{
+	gchar *ns;
+	gchar *base;
+	gchar *type;
+	gchar *master_url; /* NULL if unknown */
+	gchar **peers;
+	gint64 atime;
+};
+
+void election_hint_free (struct election_hint_s *hint);
+
+/* Collects the hints about the elections that have known peers, the most
+ * recently accessed first. 0 means no limit on the number of hints. */
+GPtrArray * election_manager_collect_hints (struct election_manager_s *m,
+		guint max);
+
+/* Ensures the election exists in memory, with its peers already cached, so
+ * that its first start does not need to resolve them. */
+void election_manager_seed_hint (struct election_manager_s *m,
+		const struct election_hint_s *hint);
+
 /* Make some elections leave their MASTER state if they are inactive since
  * longer than `inactivity`, as long as there are more than `ratio` MASTER
  * bases more than SLAVE bases. But do not leave more than `max` elections
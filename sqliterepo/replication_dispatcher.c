@@ -1449,6 +1449,101 @@ _handler_GETVERS(struct gridd_reply_ctx_s *reply,
 	return TRUE;
 }
 
+static GError *
+_getvers_one(struct sqlx_repository_s *repo,
+		const struct sqlx_name_inline_s *name, GByteArray **out)
+{
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	GTree *version = NULL;
+	NAME2CONST(n0, *name);
+
+	GError *err = sqlx_repository_open_and_lock(repo, &n0,
+			SQLX_OPEN_CREATE|SQLX_OPEN_LOCAL|SQLX_OPEN_URGENT, &sq3, NULL);
+	if (NULL != err) {
+		g_prefix_error(&err, "Open/lock: ");
+		return err;
+	}
+
+	err = sqlx_repository_get_version(sq3, &version);
+	sqlx_repository_unlock_and_close_noerror(sq3);
+	if (!err) {
+		if (!(*out = version_encode(version)))
+			err = NEWERROR(CODE_INTERNAL_ERROR, "Encoding error (version)");
+	}
+	if (version)
+		g_tree_destroy(version);
+	return err;
+}
+
+/* Checks a name of a GETVERS_MANY batch as _load_sqlx_name() checks the
+ * name of a single request: all the bases share the namespace of the
+ * request. */
+static GError *
+_check_sqlx_name(const struct sqlx_name_inline_s *n, const char *ns)
+{
+	if (!*n->ns || !*n->base || !*n->type)
+		return BADREQ("Invalid base name");
+	if (strcmp(n->ns, ns))
+		return BADREQ("Namespace mismatch (%s)", n->ns);
+	return NULL;
+}
+
+/* The batched variant of DB_VERS, used by the elections to check many bases
+ * with the same peer at once. Each base gets its own status in the reply,
+ * a failure on a base does not fail the whole request. Once the deadline
+ * is reached, the remaining bases are answered with a timeout so that the
+ * peer still gets the versions already collected. */
+static gboolean
+_handler_GETVERS_MANY(struct gridd_reply_ctx_s *reply,
+		struct sqlx_repository_s *repo, gpointer ignored UNUSED)
+{
+	gchar ns[LIMIT_LENGTH_NSNAME];
+
+	reply->no_access();
+
+	GError *err = metautils_message_extract_string(reply->request,
+			NAME_MSGKEY_NAMESPACE, ns, sizeof(ns));
+	if (err) {
+		reply->send_error(0, err);
+		return TRUE;
+	}
+
+	gsize bsize = 0;
+	void *b = metautils_message_get_BODY(reply->request, &bsize);
+	GArray *names = g_array_new(FALSE, TRUE, sizeof(struct sqlx_name_inline_s));
+	err = sqlx_unpack_GETVERS_MANY(b, bsize, names);
+	if (!err && names->len > SQLX_GETVERS_MANY_MAX)
+		err = BADREQ("Too many bases (%u > %u)",
+				names->len, SQLX_GETVERS_MANY_MAX);
+	if (err) {
+		g_array_free(names, TRUE);
+		reply->send_error(0, err);
+		return TRUE;
+	}
+
+	reply->subject("bases=%u", names->len);
+	GByteArray *body = g_byte_array_sized_new(names->len * 64);
+	for (guint i=0; i<names->len ;++i) {
+		const struct sqlx_name_inline_s *n =
+			&g_array_index(names, struct sqlx_name_inline_s, i);
+		GByteArray *encoded = NULL;
+		if (oio_ext_monotonic_time() > reply->deadline)
+			err = NEWERROR(CODE_GATEWAY_TIMEOUT, "Deadline reached");
+		else if (!(err = _check_sqlx_name(n, ns)))
+			err = _getvers_one(repo, n, &encoded);
+		sqlx_getvers_many_append(body, err, encoded);
+		if (encoded)
+			g_byte_array_unref(encoded);
+		if (err)
+			g_clear_error(&err);
+	}
+	g_array_free(names, TRUE);
+
+	reply->add_body(body);
+	reply->send_reply(CODE_FINAL_OK, "OK");
+	return TRUE;
+}
+
 static gboolean
 _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		struct sqlx_repository_s *repo, gpointer ignored UNUSED)
@@ -2296,6 +2391,29 @@ _info_sqlite(GString *gstr)
 		oio_str_gstring_append_json_quote(gstr, s);
 	}
 	g_string_append_c(gstr, ']');
+
+	/* The profile applied to each base at open time */
+	g_string_append_static(gstr, ",\"sqlite_profile\":{");
+	oio_str_gstring_append_json_pair(gstr, "journal_mode",
+			sqliterepo_sqlite_journal_mode);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair(gstr, "auto_vacuum",
+			sqliterepo_sqlite_auto_vacuum);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "wal_autocheckpoint",
+			sqliterepo_sqlite_wal_autocheckpoint);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "cache_size",
+			sqliterepo_sqlite_cache_size);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "mmap_size",
+			sqliterepo_sqlite_mmap_size);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair(gstr, "temp_store",
+			sqliterepo_sqlite_temp_store);
+	g_string_append_c(gstr, ',');
+	oio_str_gstring_append_json_pair_int(gstr, "page_size", _page_size);
+	g_string_append_c(gstr, '}');
 }
 
 static void
@@ -2544,6 +2662,7 @@ sqlx_repli_gridd_get_requests(void)
 		{NAME_MSGNAME_SQLX_RESTORE,      (hook) _handler_RESTORE,   NULL},
 		{NAME_MSGNAME_SQLX_REPLICATE,    (hook) _handler_REPLICATE, NULL},
 		{NAME_MSGNAME_SQLX_GETVERS,      (hook) _handler_GETVERS,   NULL},
+		{NAME_MSGNAME_SQLX_GETVERS_MANY, (hook) _handler_GETVERS_MANY, NULL},
 		{NAME_MSGNAME_SQLX_RESYNC,       (hook) _handler_RESYNC,    NULL},
 
 		{NAME_MSGNAME_SQLX_INFO,    (hook) _handler_INFO,      NULL},
@@ -554,7 +554,7 @@ struct open_args_s
 
 	gboolean create : 1;
 	gboolean no_refcheck : 1;
-	gboolean urgent : 1;
+	enum sqlx_cache_class_e klass;
 	gboolean is_replicated : 1;
 };
 
@@ -630,6 +630,102 @@ _get_pragma_sync(register const int mode)
 	}
 }
 
+static const gchar *
+_get_pragma_value(const gchar *configured, const gchar * const *allowed)
+{
+	for (const gchar * const *pv=allowed; *pv ;++pv) {
+		if (!g_ascii_strcasecmp(*pv, configured))
+			return *pv;
+	}
+	return allowed[0];
+}
+
+static const gchar *
+_get_journal_mode(void)
+{
+	static const gchar * const modes[] = {
+		"MEMORY", "WAL", "DELETE", "TRUNCATE", "PERSIST", NULL
+	};
+	return _get_pragma_value(sqliterepo_sqlite_journal_mode, modes);
+}
+
+static const gchar *
+_get_auto_vacuum(void)
+{
+	static const gchar * const modes[] = {"NONE", "INCREMENTAL", "FULL", NULL};
+	return _get_pragma_value(sqliterepo_sqlite_auto_vacuum, modes);
+}
+
+static const gchar *
+_get_temp_store(void)
+{
+	static const gchar * const stores[] = {"MEMORY", "FILE", "DEFAULT", NULL};
+	return _get_pragma_value(sqliterepo_sqlite_temp_store, stores);
+}
+
+/* Apply the sqlite profile of the current service. Must be called out of
+ * any transaction, and after the page size of a new base has been set,
+ * because the page size cannot be changed anymore in WAL mode. */
+static void
+_apply_sqlite_profile(sqlite3 *handle)
+{
+	gchar line[128];
+	const gchar *journal_mode = _get_journal_mode();
+
+	g_snprintf(line, sizeof(line), "PRAGMA journal_mode = %s", journal_mode);
+	sqlx_exec(handle, line);
+	if (!strcmp(journal_mode, "WAL")) {
+		g_snprintf(line, sizeof(line), "PRAGMA wal_autocheckpoint = %"
+				G_GINT32_FORMAT, sqliterepo_sqlite_wal_autocheckpoint);
+		sqlx_exec(handle, line);
+	}
+	if (sqliterepo_sqlite_cache_size != 0) {
+		g_snprintf(line, sizeof(line), "PRAGMA cache_size = %"
+				G_GINT32_FORMAT, sqliterepo_sqlite_cache_size);
+		sqlx_exec(handle, line);
+	}
+	/* Always explicit, sqlite may have been built with a default mmap size */
+	g_snprintf(line, sizeof(line), "PRAGMA mmap_size = %" G_GINT64_FORMAT,
+			sqliterepo_sqlite_mmap_size);
+	sqlx_exec(handle, line);
+	g_snprintf(line, sizeof(line), "PRAGMA temp_store = %s", _get_temp_store());
+	sqlx_exec(handle, line);
+}
+
+static void
+_maintain_base(gpointer handle, gpointer udata UNUSED)
+{
+	struct sqlx_sqlite3_s *sq3 = handle;
+	if (!sq3 || !sq3->db || sq3->deleted || sq3->corrupted)
+		return;
+
+	if (!strcmp(_get_journal_mode(), "WAL"))
+		sqlx_exec(sq3->db, "PRAGMA wal_checkpoint(TRUNCATE)");
+
+	/* No-op on the bases not created in INCREMENTAL auto_vacuum mode */
+	if (sqliterepo_maintenance_vacuum_pages > 0) {
+		gchar line[64];
+		g_snprintf(line, sizeof(line), "PRAGMA incremental_vacuum(%u)",
+				sqliterepo_maintenance_vacuum_pages);
+		sqlx_exec(sq3->db, line);
+	}
+}
+
+guint
+sqlx_repository_maintain_idle_bases(struct sqlx_repository_s *repo,
+		guint max, gint64 duration)
+{
+	EXTRA_ASSERT(repo != NULL);
+	if (!repo->cache)
+		return 0;
+	if (strcmp(_get_journal_mode(), "WAL")
+			&& (!sqliterepo_maintenance_vacuum_pages
+				|| !strcmp(_get_auto_vacuum(), "NONE")))
+		return 0;
+	return sqlx_cache_maintain_idle(repo->cache, max, duration,
+			_maintain_base, NULL);
+}
+
 /* XXX this should not be called during a transaction */
 void
 sqlx_admin_reload(struct sqlx_sqlite3_s *sq3)
@@ -728,8 +824,9 @@ __open_not_cached(struct open_args_s *args, struct sqlx_sqlite3_s **result)
 	sqlx_exec(handle, "PRAGMA foreign_keys = OFF");
 
 	/* We chose to check this call especially because it is able to detect
-	 * a wrong/corrupted database file. */
-	int rc = sqlx_exec(handle, "PRAGMA journal_mode = MEMORY");
+	 * a wrong/corrupted database file: it reads the header of the base
+	 * whatever its journal mode. */
+	int rc = sqlx_exec(handle, "PRAGMA schema_version");
 	if (rc != SQLITE_OK) {
 		if (rc == SQLITE_NOTADB || rc == SQLITE_CORRUPT) {
 			error = NEWERROR(CODE_CORRUPT_DATABASE,
@@ -745,14 +842,20 @@ __open_not_cached(struct open_args_s *args, struct sqlx_sqlite3_s **result)
 		return error;
 	}
 
-	sqlx_exec(handle, "PRAGMA temp_store = MEMORY");
-	if (!_schema_has(sq3->db)) {
-		if (_page_size >= 512) {
-			gchar line[128] = {0};
-			snprintf(line, sizeof(line),
-					"PRAGMA page_size = %u;", _page_size);
-			sqlx_exec(sq3->db, line);
-		}
+	const gboolean is_new = !_schema_has(sq3->db);
+	if (is_new && _page_size >= 512) {
+		gchar line[128] = {0};
+		snprintf(line, sizeof(line),
+				"PRAGMA page_size = %u;", _page_size);
+		sqlx_exec(sq3->db, line);
+	}
+	_apply_sqlite_profile(handle);
+
+	if (is_new) {
+		gchar line[128] = {0};
+		snprintf(line, sizeof(line),
+				"PRAGMA auto_vacuum = %s;", _get_auto_vacuum());
+		sqlx_exec(sq3->db, line);
 		sqlx_exec(sq3->db, "PRAGMA synchronous = OFF;");
 		sqlx_exec(sq3->db, "BEGIN");
 		_schema_apply (sq3->db, args->schema);
@@ -784,7 +887,7 @@ __open_maybe_cached(struct open_args_s *args, struct sqlx_sqlite3_s **result)
 	gint bd = -1;
 
 	e0 = sqlx_cache_open_and_lock_base(args->repo->cache, args->realname,
-		   args->urgent, &bd, args->deadline);
+		   args->klass, &bd, args->deadline);
 	if (e0 != NULL) {
 		g_prefix_error(&e0, "cache error: ");
 		return e0;
@@ -820,7 +923,8 @@ _db_raw_creation(struct open_args_s *args)
 {
 	gint bd = -1;
 	GError *err = sqlx_cache_open_and_lock_base(
-			args->repo->cache, args->realname, TRUE, &bd, args->deadline);
+			args->repo->cache, args->realname, SQLX_CACHE_CLASS_REPLICATION,
+			&bd, args->deadline);
 	if (err) {
 		g_prefix_error(&err, "DB autocreation failed: ");
 		return err;
@@ -1008,6 +1112,19 @@ sqlx_repository_unlock_and_close_noerror(struct sqlx_sqlite3_s *sq3)
 	return sqlx_repository_unlock_and_close_noerror2(sq3, 0);
 }
 
+/* Tells which class of waiters an open belongs to, in the cache */
+static enum sqlx_cache_class_e
+_open_class(enum sqlx_open_type_e how)
+{
+	if (how & SQLX_OPEN_URGENT)
+		return SQLX_CACHE_CLASS_REPLICATION;
+	if (how & SQLX_OPEN_BACKGROUND)
+		return SQLX_CACHE_CLASS_BACKGROUND;
+	if ((how & SQLX_OPEN_REPLIMODE) == SQLX_OPEN_MASTERONLY)
+		return SQLX_CACHE_CLASS_WRITE;
+	return SQLX_CACHE_CLASS_READ;
+}
+
 const char *
 sqlx_opentype_to_str (enum sqlx_open_type_e type, char *buf)
 {
@@ -1033,6 +1150,8 @@ sqlx_opentype_to_str (enum sqlx_open_type_e type, char *buf)
 		append('C');
 	if (type & SQLX_OPEN_NOREFCHECK)
 		append('N');
+	if (type & SQLX_OPEN_BACKGROUND)
+		append('B');
 
 	if (!(type & SQLX_OPEN_STATUS))
 		append('E'), append('F'), append('D');
@@ -1076,7 +1195,7 @@ sqlx_repository_timed_open_and_lock(sqlx_repository_t *repo,
 		return err;
 	args.no_refcheck = BOOL(how & SQLX_OPEN_NOREFCHECK);
 	args.create = BOOL(how & SQLX_OPEN_CREATE);
-	args.urgent = BOOL(how & SQLX_OPEN_URGENT);
+	args.klass = _open_class(how);
 	args.deadline = deadline;
 
 	switch (how & SQLX_OPEN_REPLIMODE) {
@@ -1181,12 +1300,12 @@ sqlx_repository_remove_from_cache(sqlx_repository_t *repo,
 		goto end_sqlx_cache_close;
 	args.no_refcheck = BOOL(SQLX_OPEN_NOREFCHECK);
 	args.create = BOOL(0);
-	args.urgent = BOOL(0);
+	args.klass = SQLX_CACHE_CLASS_WRITE;
 	args.deadline = oio_ext_get_deadline();
 
 	gint bd = -1;
 	err = sqlx_cache_open_and_lock_base(args.repo->cache, args.realname,
-		   args.urgent, &bd, args.deadline);
+		   args.klass, &bd, args.deadline);
 	if (err) {
 		g_prefix_error(&err, "cache error: ");
 		goto end_sqlx_cache_close;
@@ -1376,7 +1495,10 @@ _backup_main(sqlite3 *src, sqlite3 *dst)
 	if (!backup)
 		err = NEWERROR(sqlite3_errcode(dst), "%s", sqlite3_errmsg(dst));
 	else {
-		while (SQLITE_OK == (rc = sqlite3_backup_step(backup, 1))) {}
+		/* Copying one page per step costs one lock/unlock and one call per
+		 * page, that is prohibitive on large bases. */
+		const int step = sqliterepo_dump_step_pages ?: 1;
+		while (SQLITE_OK == (rc = sqlite3_backup_step(backup, step))) {}
 		if (rc != SQLITE_DONE)
 			err = NEWERROR(CODE_INTERNAL_ERROR, "backup error: (%d) %s", rc,
 					sqlite_strerror(rc));
@@ -1392,19 +1514,25 @@ _read_file_chunk(int fd, guint64 chunk_size, GByteArray *gba)
 {
 	ssize_t r;
 	guint64 tot = 0;
-	guint8 d[SQLX_DUMP_BUFFER_SIZE];
 	GError *err = NULL;
 
+	/* Read straight into the array to spare a copy through a local buffer.
+	 * <chunk_size> is what remains to be read, not a mere upper bound. */
+	const guint offset = gba->len;
+	g_byte_array_set_size(gba, offset + chunk_size);
+
 	do {
-		r = read(fd, d, MIN(chunk_size - tot, SQLX_DUMP_BUFFER_SIZE));
+		r = read(fd, gba->data + offset + tot, chunk_size - tot);
 		if (r < 0) {
+			if (errno == EINTR)
+				continue;
 			err = NEWERROR(errno, "read error: %s", strerror(errno));
 		} else if (r > 0) {
 			tot += r;
-			g_byte_array_append(gba, d, r);
 		}
-	} while (r > 0 && tot < chunk_size && !err);
+	} while (r != 0 && tot < chunk_size && !err);
 
+	g_byte_array_set_size(gba, offset + tot);
 	return err;
 }
 
@@ -1422,9 +1550,6 @@ _read_file(int fd, GByteArray *gba)
 	if (0 > rc)
 		return NEWERROR(errno, "Failed to stat the temporary base");
 
-	g_byte_array_set_size(gba, st.st_size);
-	g_byte_array_set_size(gba, 0);
-
 	err = _read_file_chunk(fd, (guint64)st.st_size, gba);
 	return err;
 }
@@ -1474,6 +1599,10 @@ sqlx_repository_dump_base_fd(struct sqlx_sqlite3_s *sq3,
 						sqlite_strerror(rc), errno, strerror(errno));
 			} else {
 				err = _backup_main(sq3->db, dst);
+				/* The backup copies the header of a WAL base as is, but the
+				 * dump must be readable alone, without its WAL. */
+				if (!err && !strcmp(_get_journal_mode(), "WAL"))
+					sqlx_exec(dst, "PRAGMA journal_mode = DELETE");
 			}
 			_close_handle(&dst);
 			unlink(path);
@@ -1504,7 +1633,7 @@ sqlx_repository_dump_base_gba(struct sqlx_sqlite3_s *sq3, GByteArray **dump)
 	{
 		GError *_err = NULL;
 		GByteArray **dump2 = arg;
-		GByteArray *_dump = g_byte_array_sized_new(128 * 1024);
+		GByteArray *_dump = g_byte_array_new();
 		_err = _read_file(fd, _dump);
 		if (!_err)
 			*dump2 = _dump;
@@ -1531,9 +1660,16 @@ sqlx_repository_dump_base_chunked(struct sqlx_sqlite3_s *sq3,
 		if (0 > rc)
 			return NEWERROR(errno, "Failed to stat the temporary base");
 		do {
-			GByteArray *gba = g_byte_array_sized_new(128 * 1024);
-			err = _read_file_chunk(fd, chunk_size, gba);
-			if (!err) {
+			const gint64 to_read = MIN(chunk_size, st.st_size - bytes_read);
+			GByteArray *gba = g_byte_array_sized_new(to_read);
+			err = _read_file_chunk(fd, to_read, gba);
+			if (err) {
+				g_byte_array_free(gba, TRUE);
+			} else if (gba->len <= 0) {
+				g_byte_array_free(gba, TRUE);
+				err = NEWERROR(CODE_INTERNAL_ERROR,
+						"Temporary base truncated");
+			} else {
 				bytes_read += gba->len;
 				err = callback(gba, st.st_size - bytes_read, callback_arg);
 			}
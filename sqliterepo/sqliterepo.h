@@ -60,6 +60,8 @@ enum sqlx_open_type_e
 	SQLX_OPEN_CREATE      = 0x10,
 	SQLX_OPEN_NOREFCHECK  = 0x20,
 	SQLX_OPEN_URGENT      = 0x40,
+	// The open is issued by a background task, it yields to the clients
+	SQLX_OPEN_BACKGROUND  = 0x80,
 #define SQLX_OPEN_FLAGS     0x0F0
 
 	// Set an OR'ed combination of the following flags to require
@@ -160,6 +162,11 @@ void sqlx_repository_clean(sqlx_repository_t *repo);
 
 struct sqlx_cache_s* sqlx_repository_get_cache(struct sqlx_repository_s *r);
 
+/** Checkpoints the WAL and incrementally vacuums at most `max` bases idle in
+ * the cache, for at most `duration`. Returns how many bases were handled. */
+guint sqlx_repository_maintain_idle_bases(struct sqlx_repository_s *repo,
+		guint max, gint64 duration);
+
 struct election_manager_s* sqlx_repository_get_elections_manager(
 		struct sqlx_repository_s *repo);
 
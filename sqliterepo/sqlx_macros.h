@@ -36,6 +36,7 @@ License along with this library.
 
 #define NAME_MSGNAME_SQLX_USE                "DB_USE"
 #define NAME_MSGNAME_SQLX_GETVERS            "DB_VERS"
+#define NAME_MSGNAME_SQLX_GETVERS_MANY       "DB_VERSN"
 #define NAME_MSGNAME_SQLX_REPLICATE          "DB_REPLI"
 #define NAME_MSGNAME_SQLX_PIPETO             "DB_PIPETO"
 #define NAME_MSGNAME_SQLX_PIPEFROM           "DB_PIPEFROM"
@@ -18,6 +18,7 @@ License along with this library.
 */
 
 #include <stddef.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <metautils/lib/metautils.h>
@@ -197,6 +198,112 @@ sqlx_pack_GETVERS(const struct sqlx_name_s *name, gint64 deadline)
 	return message_marshall_gba_and_clean(req);
 }
 
+GByteArray*
+sqlx_pack_GETVERS_MANY(const struct sqlx_name_inline_s * const *names,
+		guint count, gint64 deadline)
+{
+	EXTRA_ASSERT(names != NULL);
+	EXTRA_ASSERT(count > 0);
+
+	GByteArray *body = g_byte_array_sized_new(count * 128);
+	for (guint i=0; i<count ;++i) {
+		const struct sqlx_name_inline_s *n = names[i];
+		gchar *line = g_strdup_printf("%s\t%s\t%s\n", n->ns, n->base, n->type);
+		g_byte_array_append(body, (guint8*)line, strlen(line));
+		g_free(line);
+	}
+
+	MESSAGE req = metautils_message_create_named(
+			NAME_MSGNAME_SQLX_GETVERS_MANY, deadline);
+	metautils_message_add_field_str(req, NAME_MSGKEY_NAMESPACE, names[0]->ns);
+	metautils_message_add_body_unref(req, body);
+	return message_marshall_gba_and_clean(req);
+}
+
+GError*
+sqlx_unpack_GETVERS_MANY(const guint8 *b, gsize len, GArray *out)
+{
+	EXTRA_ASSERT(out != NULL);
+	if (!b || !len)
+		return BADREQ("No base");
+
+	GError *err = NULL;
+	gchar *raw = g_strndup((const gchar*)b, len);
+	gchar **lines = g_strsplit(raw, "\n", -1);
+	for (gchar **pl = lines; !err && *pl ;++pl) {
+		if (!**pl)
+			continue;
+		gchar **tokens = g_strsplit(*pl, "\t", 3);
+		if (g_strv_length(tokens) != 3
+				|| !*tokens[0] || !*tokens[1] || !*tokens[2]) {
+			err = BADREQ("Invalid base name");
+		} else if (strlen(tokens[0]) >= LIMIT_LENGTH_NSNAME
+				|| strlen(tokens[1]) >= LIMIT_LENGTH_BASENAME
+				|| strlen(tokens[2]) >= LIMIT_LENGTH_BASETYPE) {
+			err = BADREQ("Base name too long");
+		} else {
+			struct sqlx_name_inline_s n = {{0}};
+			g_strlcpy(n.ns, tokens[0], sizeof(n.ns));
+			g_strlcpy(n.base, tokens[1], sizeof(n.base));
+			g_strlcpy(n.type, tokens[2], sizeof(n.type));
+			g_array_append_val(out, n);
+		}
+		g_strfreev(tokens);
+	}
+	g_strfreev(lines);
+	g_free(raw);
+	return err;
+}
+
+static void
+_append_u32(GByteArray *out, guint32 u)
+{
+	u = GUINT32_TO_BE(u);
+	g_byte_array_append(out, (guint8*)&u, sizeof(u));
+}
+
+void
+sqlx_getvers_many_append(GByteArray *out, GError *err, GByteArray *encoded)
+{
+	EXTRA_ASSERT(out != NULL);
+	EXTRA_ASSERT((err != NULL) ^ (encoded != NULL));
+	if (err) {
+		const gsize len = strlen(err->message);
+		_append_u32(out, err->code);
+		_append_u32(out, len);
+		g_byte_array_append(out, (guint8*)err->message, len);
+	} else {
+		_append_u32(out, CODE_FINAL_OK);
+		_append_u32(out, encoded->len);
+		g_byte_array_append(out, encoded->data, encoded->len);
+	}
+}
+
+GError*
+sqlx_getvers_many_decode(guint8 *b, gsize len,
+		sqlx_getvers_many_f hook, gpointer udata)
+{
+	EXTRA_ASSERT(hook != NULL);
+	guint idx = 0;
+	while (len > 0) {
+		guint32 code, size;
+		if (len < 2 * sizeof(guint32))
+			return BADREQ("Truncated record header");
+		memcpy(&code, b, sizeof(code));
+		memcpy(&size, b + sizeof(code), sizeof(size));
+		code = GUINT32_FROM_BE(code);
+		size = GUINT32_FROM_BE(size);
+		b += 2 * sizeof(guint32);
+		len -= 2 * sizeof(guint32);
+		if (len < size)
+			return BADREQ("Truncated record payload");
+		hook(idx++, code, b, size, udata);
+		b += size;
+		len -= size;
+	}
+	return NULL;
+}
+
 GByteArray*
 sqlx_pack_QUERY(const struct sqlx_name_s *name, const gchar *query,
 		struct TableSequence *params, gboolean autocreate, gint64 deadline)
@@ -96,6 +96,29 @@ GByteArray* sqlx_pack_DESCR(const struct sqlx_name_s *name, gint64 deadline);
 GByteArray* sqlx_pack_STATUS(const struct sqlx_name_s *name, gint64 deadline);
 GByteArray* sqlx_pack_GETVERS(const struct sqlx_name_s *name, gint64 deadline);
 
+/* Version exchange for several bases at once, with the same peer.
+ * The request body holds one "NS\tBASE\tTYPE\n" line per base.
+ * The reply body holds one record per base, in the order of the request:
+ * the status code and the size of the payload, both as 32-bit big-endian
+ * integers, then the payload (the encoded version, or the error message). */
+GByteArray* sqlx_pack_GETVERS_MANY(
+		const struct sqlx_name_inline_s * const *names, guint count,
+		gint64 deadline);
+
+#define SQLX_GETVERS_MANY_MAX 1024
+
+/* @param out a GArray of struct sqlx_name_inline_s */
+GError* sqlx_unpack_GETVERS_MANY(const guint8 *b, gsize len, GArray *out);
+
+void sqlx_getvers_many_append(GByteArray *out, GError *err,
+		GByteArray *encoded);
+
+typedef void (*sqlx_getvers_many_f) (guint idx, gint code,
+		guint8 *payload, gsize len, gpointer udata);
+
+GError* sqlx_getvers_many_decode(guint8 *b, gsize len,
+		sqlx_getvers_many_f hook, gpointer udata);
+
 GByteArray* sqlx_pack_SNAPSHOT(const struct sqlx_name_s *name, const gchar *source,
 		const gchar *cid, const gchar *seq_num, gint64 deadline);
 GByteArray* sqlx_pack_PIPEFROM(const struct sqlx_name_s *name, const gchar *source, gint64 deadline);
@@ -70,8 +70,36 @@ struct sqlx_sync_s
 	guint hash_depth;
 
 	struct grid_single_rrd_s *conn_attempts;
+
+	/* Listings of ZK directories currently in flight, with all the callers
+	 * waiting for their result. The table owns the batches.
+	 * GHashTable<gchar*, struct listing_batch_s*> */
+	GMutex listings_lock;
+	GHashTable *listings;
+};
+
+/* @private */
+struct listing_waiter_s
+{
+	strings_completion_t completion;
+	const void *data;
+};
+
+/* @private */
+struct listing_batch_s
+{
+	struct sqlx_sync_s *ss;
+	GArray *waiters; /* of struct listing_waiter_s */
+	gchar path[];
 };
 
+static void
+_listing_batch_free(struct listing_batch_s *batch)
+{
+	g_array_free(batch->waiters, TRUE);
+	g_free(batch);
+}
+
 static void _clear(struct sqlx_sync_s *ss);
 
 static GError* _open(struct sqlx_sync_s *ss);
@@ -154,6 +182,9 @@ sqlx_sync_create(const char *url)
 	ss->zk_url = shuffled;
 	ss->conn_attempts = grid_single_rrd_create(
 			oio_ext_monotonic_seconds(), disconnection_rrd_window + 1);
+	g_mutex_init(&ss->listings_lock);
+	ss->listings = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, (GDestroyNotify) _listing_batch_free);
 	return ss;
 }
 
@@ -345,6 +376,9 @@ _clear(struct sqlx_sync_s *ss)
 	oio_str_clean (&ss->zk_prefix);
 	oio_str_clean (&ss->zk_url);
 	grid_single_rrd_destroy(ss->conn_attempts);
+	/* The listings still pending won't complete anymore */
+	g_hash_table_destroy(ss->listings);
+	g_mutex_clear(&ss->listings_lock);
 	memset(ss, 0, sizeof(*ss));
 	g_free(ss);
 }
@@ -433,6 +467,27 @@ _awget_children (struct sqlx_sync_s *ss, const char *path,
 	return rc;
 }
 
+static void
+_completion_siblings(int zrc, const struct String_vector *sv, const void *d)
+{
+	struct listing_batch_s *batch = (struct listing_batch_s *) d;
+	struct sqlx_sync_s *ss = batch->ss;
+
+	g_mutex_lock(&ss->listings_lock);
+	g_hash_table_steal(ss->listings, batch->path);
+	g_mutex_unlock(&ss->listings_lock);
+
+	GRID_TRACE("LIST %s shared by %u elections",
+			batch->path, batch->waiters->len);
+	for (guint i=0; i<batch->waiters->len ;++i) {
+		struct listing_waiter_s *w =
+			&g_array_index(batch->waiters, struct listing_waiter_s, i);
+		w->completion(zrc, sv, w->data);
+	}
+
+	_listing_batch_free(batch);
+}
+
 static int
 _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 		watcher_fn watcher, void* watcherCtx,
@@ -445,8 +500,41 @@ _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 		return ZOPERATIONTIMEOUT;
 #endif
 	gchar p[PATH_MAXLEN];
-	int rc = zoo_awget_children(ss->zh, _realdirname(ss, path, p, sizeof(p)),
-			watcher, watcherCtx, completion, data);
+	_realdirname(ss, path, p, sizeof(p));
+
+	if (watcher || !sqliterepo_zk_coalesce_listings)
+		return zoo_awget_children(ss->zh, p,
+				watcher, watcherCtx, completion, data);
+
+	/* When a listing of the same directory is already pending, the caller
+	 * just waits for its result. ZK serves the requests of a session in
+	 * order and the caller's node has been created by a request whose
+	 * completion has already been called, thus that pending listing has been
+	 * sent after that creation and it will show the caller's node. */
+	const struct listing_waiter_s waiter = {completion, data};
+	int rc = ZOK;
+
+	g_mutex_lock(&ss->listings_lock);
+	struct listing_batch_s *batch = g_hash_table_lookup(ss->listings, p);
+	if (batch) {
+		g_array_append_vals(batch->waiters, &waiter, 1);
+	} else {
+		const size_t len = strlen(p);
+		batch = g_malloc0(sizeof(*batch) + len + 1);
+		batch->ss = ss;
+		batch->waiters = g_array_new(FALSE, FALSE,
+				sizeof(struct listing_waiter_s));
+		memcpy(batch->path, p, len);
+		g_array_append_vals(batch->waiters, &waiter, 1);
+		g_hash_table_insert(ss->listings, batch->path, batch);
+
+		rc = zoo_awget_children(ss->zh, batch->path,
+				NULL, NULL, _completion_siblings, batch);
+		if (rc != ZOK)
+			g_hash_table_remove(ss->listings, batch->path);
+	}
+	g_mutex_unlock(&ss->listings_lock);
+
 	return rc;
 }
 
@@ -605,8 +693,35 @@ struct sqlx_peering_direct_s
 	/* Some requests may be sent over a UDP channel. We just need a file
 	 * descriptor from the application */
 	int fd_udp;
+
+	/* The GETVERS are batched by peer until the next notify(), then sent
+	 * as a few DB_VERSN requests instead of one DB_VERS per base. */
+	GMutex lock_getvers;
+	GHashTable *getvers_batches; /* <gchar*,GPtrArray<getvers_item_s*>> */
+	GHashTable *getvers_no_batch; /* peers that do not manage DB_VERSN */
+};
+
+/* @private */
+struct getvers_item_s
+{
+	struct sqlx_name_inline_s name;
+	struct election_member_s *m;
+	guint reqid;
+	sqlx_peering_getvers_end_f hook;
 };
 
+static void
+_getvers_batch_free(GPtrArray *batch)
+{
+	if (!batch)
+		return;
+	for (guint i=0; i<batch->len ;++i)
+		g_free(batch->pdata[i]);
+	g_ptr_array_free(batch, TRUE);
+}
+
+static void _direct_flush_getvers(struct sqlx_peering_direct_s *p);
+
 /* @private */
 struct use_request_s {
 	gint64 deadline;
@@ -647,6 +762,11 @@ sqlx_peering_factory__create_direct (struct gridd_client_pool_s *pool)
 	self->pool = pool;
 	self->fd_udp = -1;
 	self->pool_udp_use = g_thread_pool_new((GFunc)_use_by_udp, self, 8, FALSE, NULL);
+	g_mutex_init(&self->lock_getvers);
+	self->getvers_batches = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)_getvers_batch_free);
+	self->getvers_no_batch = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, NULL);
 	return (struct sqlx_peering_s*) self;
 }
 
@@ -667,6 +787,11 @@ _direct_destroy (struct sqlx_peering_s *self)
 	g_assert(p->vtable == &vtable_peering_DIRECT);
 	if (p->pool_udp_use)
 		g_thread_pool_free(p->pool_udp_use, FALSE, TRUE);
+	/* The batches still pending are dropped, as the deferred requests of the
+	 * client pool, there is nobody to notify anymore. */
+	g_hash_table_destroy(p->getvers_batches);
+	g_hash_table_destroy(p->getvers_no_batch);
+	g_mutex_clear(&p->lock_getvers);
 	g_free (p);
 }
 
@@ -676,6 +801,7 @@ _direct_notify (struct sqlx_peering_s *self)
 	if (!self) return;
 	struct sqlx_peering_direct_s *p = (struct sqlx_peering_direct_s*) self;
 	EXTRA_ASSERT(p->vtable == &vtable_peering_DIRECT);
+	_direct_flush_getvers(p);
 	gridd_client_pool_notify(p->pool);
 }
 
@@ -879,7 +1005,7 @@ on_reply_GETVERS (gpointer ctx, MESSAGE reply)
 }
 
 static gboolean
-_direct_getvers (struct sqlx_peering_s *self,
+_direct_getvers_single (struct sqlx_peering_direct_s *p,
 		/* in */
 		const char *url,
 		const struct sqlx_name_inline_s *n,
@@ -888,11 +1014,6 @@ _direct_getvers (struct sqlx_peering_s *self,
 		guint reqid,
 		sqlx_peering_getvers_end_f result)
 {
-	struct sqlx_peering_direct_s *p = (struct sqlx_peering_direct_s*) self;
-	EXTRA_ASSERT(p != NULL && p->vtable == &vtable_peering_DIRECT);
-	EXTRA_ASSERT(url != NULL);
-	EXTRA_ASSERT(m != NULL);
-
 	struct evtclient_GETVERS_s *mc =
 		g_slice_alloc0(sizeof(struct evtclient_GETVERS_s));
 	mc->ec.struct_size = sizeof(struct evtclient_GETVERS_s);
@@ -930,6 +1051,238 @@ _direct_getvers (struct sqlx_peering_s *self,
 	}
 }
 
+struct evtclient_GETVERS_MANY_s
+{
+	struct event_client_s ec;
+
+	struct sqlx_peering_direct_s *peering;
+	gchar *url;
+	GPtrArray *items; /* <struct getvers_item_s*> */
+	GByteArray *body;
+};
+
+static void
+on_end_GETVERS_MANY(struct evtclient_GETVERS_MANY_s *mc)
+{
+	EXTRA_ASSERT(mc != NULL);
+	EXTRA_ASSERT(mc->ec.client != NULL);
+	struct sqlx_peering_direct_s *p = mc->peering;
+
+	GError *err = gridd_client_error(mc->ec.client);
+	if (err && err->code == CODE_NOT_FOUND) {
+		/* No handler found: the peer runs an older release. Fall back to
+		 * one DB_VERS per base, for now and for the next rounds. */
+		GRID_INFO("DB_VERSN not managed by [%s], fallback to DB_VERS",
+				mc->url);
+		g_mutex_lock(&p->lock_getvers);
+		g_hash_table_add(p->getvers_no_batch, g_strdup(mc->url));
+		g_mutex_unlock(&p->lock_getvers);
+		for (guint i=0; i<mc->items->len ;++i) {
+			struct getvers_item_s *item = mc->items->pdata[i];
+			_direct_getvers_single(p, mc->url, &item->name,
+					item->m, item->reqid, item->hook);
+		}
+		gridd_client_pool_notify(p->pool);
+		g_clear_error(&err);
+		goto exit;
+	}
+
+	/* Fan the replies out to the members, in the order of the request */
+	gboolean *done = g_malloc0(mc->items->len * sizeof(gboolean));
+	void _on_record(guint idx, gint code, guint8 *b, gsize len, gpointer u UNUSED) {
+		if (idx >= mc->items->len || done[idx])
+			return;
+		struct getvers_item_s *item = mc->items->pdata[idx];
+		done[idx] = TRUE;
+		if (CODE_IS_OK(code)) {
+			GTree *version = version_decode(b, len);
+			if (version) {
+				item->hook(NULL, item->m, item->reqid, version);
+				g_tree_destroy(version);
+			} else {
+				GError *e = SYSERR("Invalid encoded version in reply");
+				item->hook(e, item->m, item->reqid, NULL);
+				g_error_free(e);
+			}
+		} else {
+			GError *e = NEWERROR(code, "%.*s", (int)len, (gchar*)b);
+			item->hook(e, item->m, item->reqid, NULL);
+			g_error_free(e);
+		}
+	}
+	if (!err && mc->body)
+		err = sqlx_getvers_many_decode(mc->body->data, mc->body->len,
+				_on_record, NULL);
+
+	for (guint i=0; i<mc->items->len ;++i) {
+		if (done[i])
+			continue;
+		struct getvers_item_s *item = mc->items->pdata[i];
+		GError *e = err ? g_error_copy(err) : SYSERR("BUG: no version replied");
+		item->hook(e, item->m, item->reqid, NULL);
+		g_error_free(e);
+	}
+	g_free(done);
+	if (err)
+		g_error_free(err);
+
+exit:
+	_getvers_batch_free(mc->items);
+	if (mc->body)
+		g_byte_array_unref(mc->body);
+	g_free(mc->url);
+}
+
+static gboolean
+on_reply_GETVERS_MANY (gpointer ctx, MESSAGE reply)
+{
+	EXTRA_ASSERT(reply != NULL);
+	struct evtclient_GETVERS_MANY_s *mc = ctx;
+	EXTRA_ASSERT(mc != NULL);
+
+	gsize bsize = 0;
+	void *b = metautils_message_get_BODY(reply, &bsize);
+	if (b && bsize) {
+		if (!mc->body)
+			mc->body = g_byte_array_sized_new(bsize);
+		g_byte_array_append(mc->body, b, bsize);
+	}
+	return TRUE;
+}
+
+/* Takes the ownership of the items */
+static void
+_direct_getvers_many (struct sqlx_peering_direct_s *p, const char *url,
+		GPtrArray *items)
+{
+	EXTRA_ASSERT(items != NULL && items->len > 0);
+
+	if (items->len == 1) {
+		struct getvers_item_s *item = items->pdata[0];
+		_direct_getvers_single(p, url, &item->name,
+				item->m, item->reqid, item->hook);
+		return _getvers_batch_free(items);
+	}
+
+	struct evtclient_GETVERS_MANY_s *mc =
+		g_slice_alloc0(sizeof(struct evtclient_GETVERS_MANY_s));
+	mc->ec.struct_size = sizeof(struct evtclient_GETVERS_MANY_s);
+	mc->ec.client = gridd_client_create_empty ();
+	mc->ec.on_end = (gridd_client_end_f) on_end_GETVERS_MANY;
+	mc->peering = p;
+	mc->url = g_strdup(url);
+	mc->items = items;
+
+	/* The single-base timeout is granted to each base of the batch, up to a
+	 * configured maximum. The peer answers the bases it had no time for with
+	 * a timeout, and the client waits for one more base so that it gets
+	 * that partial reply. */
+	const gdouble timeout = MIN(oio_election_getvers_timeout_req * items->len,
+			MAX(oio_election_getvers_timeout_req,
+				oio_election_getvers_timeout_batch));
+	const gint64 now = oio_ext_monotonic_time();
+	const gint64 deadline = now + (G_TIME_SPAN_SECOND * timeout);
+
+	gridd_client_set_timeout(mc->ec.client,
+			timeout + oio_election_getvers_timeout_req);
+	gridd_client_set_timeout_cnx(mc->ec.client, oio_election_getvers_timeout_cnx);
+
+	GError *err = gridd_client_connect_url (mc->ec.client, url);
+	if (NULL != err) {
+		gridd_client_fail(mc->ec.client, err);
+		return event_client_free(&mc->ec);
+	}
+
+	const struct sqlx_name_inline_s *names[items->len];
+	for (guint i=0; i<items->len ;++i)
+		names[i] = &((struct getvers_item_s*)items->pdata[i])->name;
+	GByteArray *req = sqlx_pack_GETVERS_MANY(names, items->len, deadline);
+	err = gridd_client_request (mc->ec.client, req, mc, on_reply_GETVERS_MANY);
+	g_byte_array_unref(req);
+	if (NULL != err) {
+		gridd_client_fail(mc->ec.client, err);
+		return event_client_free(&mc->ec);
+	}
+	gridd_client_pool_defer(p->pool, &mc->ec);
+}
+
+/* Sends the GETVERS batched since the last call. Must be called out of any
+ * election lock, because a failed request immediately calls the hooks. */
+static void
+_direct_flush_getvers(struct sqlx_peering_direct_s *p)
+{
+	g_mutex_lock(&p->lock_getvers);
+	if (!g_hash_table_size(p->getvers_batches)) {
+		g_mutex_unlock(&p->lock_getvers);
+		return;
+	}
+	GHashTable *batches = p->getvers_batches;
+	p->getvers_batches = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)_getvers_batch_free);
+	g_mutex_unlock(&p->lock_getvers);
+
+	const guint max = MAX(1, MIN(oio_election_getvers_batch_max,
+				SQLX_GETVERS_MANY_MAX));
+	GHashTableIter iter;
+	gpointer k, v;
+	g_hash_table_iter_init(&iter, batches);
+	while (g_hash_table_iter_next(&iter, &k, &v)) {
+		GPtrArray *batch = v;
+		g_hash_table_iter_steal(&iter);
+		for (guint i=0; i<batch->len ;i+=max) {
+			const guint count = MIN(max, batch->len - i);
+			GPtrArray *items = g_ptr_array_sized_new(count);
+			for (guint j=0; j<count ;++j)
+				g_ptr_array_add(items, batch->pdata[i+j]);
+			_direct_getvers_many(p, k, items);
+		}
+		g_ptr_array_free(batch, TRUE);
+		g_free(k);
+	}
+	g_hash_table_destroy(batches);
+}
+
+static gboolean
+_direct_getvers (struct sqlx_peering_s *self,
+		/* in */
+		const char *url,
+		const struct sqlx_name_inline_s *n,
+		/* out */
+		struct election_member_s *m,
+		guint reqid,
+		sqlx_peering_getvers_end_f result)
+{
+	struct sqlx_peering_direct_s *p = (struct sqlx_peering_direct_s*) self;
+	EXTRA_ASSERT(p != NULL && p->vtable == &vtable_peering_DIRECT);
+	EXTRA_ASSERT(url != NULL);
+	EXTRA_ASSERT(m != NULL);
+
+	if (oio_election_getvers_batch_max > 1) {
+		gboolean batched = FALSE;
+		g_mutex_lock(&p->lock_getvers);
+		if (!g_hash_table_contains(p->getvers_no_batch, url)) {
+			GPtrArray *batch = g_hash_table_lookup(p->getvers_batches, url);
+			if (!batch) {
+				batch = g_ptr_array_new();
+				g_hash_table_insert(p->getvers_batches, g_strdup(url), batch);
+			}
+			struct getvers_item_s *item = g_malloc0(sizeof(*item));
+			memcpy(&item->name, n, sizeof(item->name));
+			item->m = m;
+			item->reqid = reqid;
+			item->hook = result;
+			g_ptr_array_add(batch, item);
+			batched = TRUE;
+		}
+		g_mutex_unlock(&p->lock_getvers);
+		/* The batch will be sent by the notify() */
+		if (batched)
+			return TRUE;
+	}
+
+	return _direct_getvers_single(p, url, n, m, reqid, result);
+}
+
 /* -------------------------------------------------------------------------- */
 
 #define PEER_CALL(self,F) VTABLE_CALL(self,struct sqlx_peering_abstract_s*,F)
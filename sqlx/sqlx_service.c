@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string.h>
 #include <malloc.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 
 #include <metautils/lib/metautils.h>
 #include <metautils/lib/common_variables.h>
@@ -66,16 +67,23 @@ static void sqlx_service_specific_stop(void);
 static void _task_probe_repository(gpointer p);
 static void _task_malloc_trim(gpointer p);
 static void _task_expire_bases(gpointer p);
+static void _task_maintain_bases(gpointer p);
 static void _task_expire_resolver(gpointer p);
 static void _task_react_NONE(gpointer p);
 static void _task_react_TIMERS(gpointer p);
 static void _task_reload_nsinfo(gpointer p);
 static void _task_reload_peers(gpointer p);
+static void _task_save_warm_restart(gpointer p);
 static void _task_update_stats(gpointer p);
 static GQuark gq_events_health = 0;
+static GQuark gq_events_coalesced = 0;
 
 static gpointer _worker_queue (gpointer p);
 static gpointer _worker_clients (gpointer p);
+static gpointer _worker_warmup (gpointer p);
+
+static void _warm_restart_save(struct sqlx_service_s *ss);
+static GPtrArray * _warm_restart_load(struct sqlx_service_s *ss);
 
 static const struct gridd_request_descr_s * _get_service_requests (void);
 
@@ -324,10 +332,46 @@ _patch_configuration_fd(void)
 			maxfd);
 }
 
+/* Some sqlite tunables deserve different values for different kinds of
+ * bases, e.g. small read-mostly meta1 bases vs. large meta2 bases. Like the
+ * ZK URL, each of them may be overridden for a given service type, with the
+ * same key suffixed by the service type. */
+static void
+_patch_configuration_sqlite_profile(void)
+{
+	static const char * const keys[] = {
+		"sqliterepo.page_size",
+		"sqliterepo.sqlite.journal_mode",
+		"sqliterepo.sqlite.auto_vacuum",
+		"sqliterepo.sqlite.wal_autocheckpoint",
+		"sqliterepo.sqlite.cache_size",
+		"sqliterepo.sqlite.mmap_size",
+		"sqliterepo.sqlite.temp_store",
+		NULL
+	};
+
+	if (!SRV.service_config || !SRV.ns_name[0])
+		return;
+
+	for (const char * const *pk=keys; *pk ;++pk) {
+		gchar k[128];
+		g_snprintf(k, sizeof(k), "%s.%s", *pk, SRV.service_config->srvtype);
+		gchar *str = oio_cfg_get_value(SRV.ns_name, k);
+		if (!str)
+			continue;
+		if (oio_var_value_one(*pk, str))
+			GRID_INFO("%s <- [%s] (at %s)", *pk, str, k);
+		else
+			GRID_WARN("Invalid value [%s] at %s", str, k);
+		g_free(str);
+	}
+}
+
 static gboolean
 _patch_and_apply_configuration(void)
 {
 	_patch_configuration_fd();
+	_patch_configuration_sqlite_profile();
 
 	if (SRV.server)
 		network_server_reconfigure(SRV.server);
@@ -667,11 +711,13 @@ _configure_tasks(struct sqlx_service_s *ss)
 	grid_task_queue_register(ss->gtq_reload, 5, _task_probe_repository, NULL, ss);
 
 	grid_task_queue_register(ss->gtq_admin, 1, _task_expire_bases, NULL, ss);
+	grid_task_queue_register(ss->gtq_admin, 1, _task_maintain_bases, NULL, ss);
 	grid_task_queue_register(ss->gtq_admin, 1, _task_expire_resolver, NULL, ss);
 	grid_task_queue_register(ss->gtq_admin, 1, _task_react_NONE, NULL, ss);
 	grid_task_queue_register(ss->gtq_admin, 1, _task_react_TIMERS, NULL, ss);
 	grid_task_queue_register(ss->gtq_admin, 1, _task_malloc_trim, NULL, ss);
 	grid_task_queue_register(ss->gtq_admin, 5, _task_update_stats, NULL, ss);
+	grid_task_queue_register(ss->gtq_admin, 1, _task_save_warm_restart, NULL, ss);
 
 	return TRUE;
 }
@@ -789,6 +835,18 @@ sqlx_service_action(void)
 		sqlx_peering_direct__set_udp(SRV.peering, fd_udp);
 	}
 
+	/* Pre-elect and pre-open the bases that were hot before the restart,
+	 * now that the peers can reach us. */
+	if (sqlx_warm_restart_enabled
+			&& election_manager_is_operational(SRV.election_manager)) {
+		SRV.thread_warmup = g_thread_try_new("warmup", _worker_warmup, &SRV, &err);
+		if (!SRV.thread_warmup) {
+			GRID_WARN("Failed to start the WARMUP thread: (%d) %s",
+					err->code, err->message);
+			g_clear_error(&err);
+		}
+	}
+
 	/* SERVER/GRIDD main run loop */
 	if (NULL != (err = network_server_run(SRV.server, _reconfigure_on_SIGHUP)))
 		return _action_report_error(err, "GRIDD run failure");
@@ -842,6 +900,7 @@ sqlx_service_set_defaults(void)
 		SRV.service_config->set_defaults(&SRV);
 
 	gq_events_health = g_quark_from_static_string("gauge event.health");
+	gq_events_coalesced = g_quark_from_static_string("counter event.coalesced");
 }
 
 static void
@@ -865,6 +924,11 @@ sqlx_service_specific_fini(void)
 		g_thread_join(SRV.thread_client);
 	if (SRV.thread_queue)
 		g_thread_join(SRV.thread_queue);
+	if (SRV.thread_warmup)
+		g_thread_join(SRV.thread_warmup);
+
+	/* Save the snapshot while the elections still know their master */
+	_warm_restart_save(&SRV);
 
 	if (SRV.repository) {
 		sqlx_repository_stop(SRV.repository);
@@ -1036,6 +1100,64 @@ _worker_queue (gpointer p)
 	return p;
 }
 
+struct warmup_ctx_s
+{
+	struct sqlx_service_s *ss;
+	gint64 deadline;
+};
+
+static void
+_warmup_base(gpointer data, gpointer udata)
+{
+	struct election_hint_s *hint = data;
+	struct warmup_ctx_s *ctx = udata;
+
+	if (!grid_main_is_running() || oio_ext_monotonic_time() > ctx->deadline)
+		return;
+
+	/* Opening in MASTERSLAVE mode waits for the election to resolve, then
+	 * leaves the base idle in the cache. */
+	const struct sqlx_name_s n = {hint->ns, hint->base, hint->type};
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	oio_ext_set_deadline(ctx->deadline);
+	GError *err = sqlx_repository_open_and_lock(ctx->ss->repository, &n,
+			SQLX_OPEN_MASTERSLAVE|SQLX_OPEN_BACKGROUND, &sq3, NULL);
+	if (err) {
+		GRID_DEBUG("Warm up of [%s][%s] failed: (%d) %s",
+				n.base, n.type, err->code, err->message);
+		g_clear_error(&err);
+	} else {
+		sqlx_repository_unlock_and_close_noerror(sq3);
+	}
+	oio_ext_set_deadline(0);
+}
+
+static gpointer
+_worker_warmup(gpointer p)
+{
+	struct sqlx_service_s *ss = PSRV(p);
+	const gint64 start = oio_ext_monotonic_time();
+
+	GPtrArray *hints = _warm_restart_load(ss);
+	if (hints->len > 0) {
+		for (guint i=0; i<hints->len ;++i)
+			election_manager_seed_hint(ss->election_manager, hints->pdata[i]);
+
+		GRID_INFO("Warming %u bases up", hints->len);
+		struct warmup_ctx_s ctx = {ss, start + sqlx_warm_restart_max_delay};
+		GThreadPool *pool = g_thread_pool_new(_warmup_base, &ctx,
+				sqlx_warm_restart_workers, FALSE, NULL);
+		for (guint i=0; i<hints->len ;++i)
+			g_thread_pool_push(pool, hints->pdata[i], NULL);
+		g_thread_pool_free(pool, FALSE, TRUE);
+		GRID_INFO("Warm up done in %" G_GINT64_FORMAT "ms",
+				(oio_ext_monotonic_time() - start) / G_TIME_SPAN_MILLISECOND);
+	}
+
+	g_ptr_array_free(hints, TRUE);
+	return p;
+}
+
 static gpointer
 _worker_clients(gpointer p)
 {
@@ -1125,6 +1247,157 @@ _task_expire_bases(gpointer p)
 	}
 }
 
+static void
+_task_maintain_bases(gpointer p)
+{
+	if (!grid_main_is_running ())
+		return;
+
+	VARIABLE_PERIOD_DECLARE();
+	if (VARIABLE_PERIOD_SKIP(sqlx_periodic_maintenance_period))
+		return;
+
+	/* The maintenance is never urgent, leave the I/O to the requests */
+	const gdouble io_idle = oio_sys_io_idle(PSRV(p)->volume);
+	if (io_idle < sqlx_periodic_maintenance_io_idle) {
+		GRID_TRACE("Maintenance skipped, I/O idle %.2f < %.2f",
+				io_idle, sqlx_periodic_maintenance_io_idle);
+		return;
+	}
+
+	guint count = sqlx_repository_maintain_idle_bases(PSRV(p)->repository,
+			sqlx_periodic_maintenance_max_bases,
+			sqlx_periodic_maintenance_max_delay);
+	if (count)
+		GRID_DEBUG("Maintained %u idle bases", count);
+}
+
+#define WARM_RESTART_FILE ".warm_restart"
+
+static gchar *
+_warm_restart_path(struct sqlx_service_s *ss)
+{
+	return g_strconcat(ss->volume, G_DIR_SEPARATOR_S, WARM_RESTART_FILE, NULL);
+}
+
+/* One line per base: NS, base, type, master (or '-') and the comma-separated
+ * list of peers, separated by tabs. The hottest bases come first. */
+static void
+_warm_restart_save(struct sqlx_service_s *ss)
+{
+	if (!sqlx_warm_restart_enabled || !ss->volume
+			|| !election_manager_is_operational(ss->election_manager))
+		return;
+
+	GPtrArray *hints = election_manager_collect_hints(ss->election_manager,
+			sqlx_warm_restart_max_bases);
+	GString *gs = g_string_sized_new(128 * (1 + hints->len));
+	for (guint i=0; i<hints->len ;++i) {
+		struct election_hint_s *hint = hints->pdata[i];
+		gchar *peers = g_strjoinv(",", hint->peers);
+		g_string_append_printf(gs, "%s\t%s\t%s\t%s\t%s\n",
+				hint->ns, hint->base, hint->type,
+				hint->master_url ? hint->master_url : "-", peers);
+		g_free(peers);
+	}
+
+	GError *err = NULL;
+	gchar *path = _warm_restart_path(ss);
+	if (!g_file_set_contents(path, gs->str, gs->len, &err)) {
+		GRID_WARN("Failed to save the warm restart snapshot [%s]: (%d) %s",
+				path, err->code, err->message);
+		g_clear_error(&err);
+	} else {
+		GRID_DEBUG("Saved %u election hints in [%s]", hints->len, path);
+	}
+
+	g_free(path);
+	g_string_free(gs, TRUE);
+	g_ptr_array_free(hints, TRUE);
+}
+
+static GPtrArray *
+_warm_restart_load(struct sqlx_service_s *ss)
+{
+	GPtrArray *hints = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)election_hint_free);
+
+	GError *err = NULL;
+	gchar *content = NULL;
+	gchar *path = _warm_restart_path(ss);
+
+	/* A snapshot left by a service stopped for long is not worth trusting:
+	 * seeding outdated peers would only delay the real elections. */
+	struct stat st = {0};
+	if (0 == stat(path, &st)) {
+		const time_t age = oio_ext_real_seconds() - st.st_mtime;
+		if (age > sqlx_warm_restart_max_age) {
+			GRID_NOTICE("Ignoring the warm restart snapshot [%s]: "
+					"%ld s old", path, (long) age);
+			g_free(path);
+			return hints;
+		}
+	}
+
+	if (!g_file_get_contents(path, &content, NULL, &err)) {
+		if (err->code != G_FILE_ERROR_NOENT)
+			GRID_WARN("Failed to load the warm restart snapshot [%s]: (%d) %s",
+					path, err->code, err->message);
+		g_clear_error(&err);
+		g_free(path);
+		return hints;
+	}
+
+	gchar **lines = g_strsplit(content, "\n", -1);
+	for (gchar **pl=lines; *pl && hints->len < sqlx_warm_restart_max_bases ;++pl) {
+		gchar **tokens = g_strsplit(*pl, "\t", 5);
+		if (g_strv_length(tokens) == 5 && !strcmp(tokens[0], ss->ns_name)
+				&& *tokens[1] && *tokens[2] && *tokens[4]) {
+			struct election_hint_s *hint = g_malloc0(sizeof(*hint));
+			hint->ns = g_strdup(tokens[0]);
+			hint->base = g_strdup(tokens[1]);
+			hint->type = g_strdup(tokens[2]);
+			if (strcmp(tokens[3], "-"))
+				hint->master_url = g_strdup(tokens[3]);
+			hint->peers = g_strsplit(tokens[4], ",", -1);
+			g_ptr_array_add(hints, hint);
+		}
+		g_strfreev(tokens);
+	}
+	g_strfreev(lines);
+	g_free(content);
+
+	/* The bases we were master of come first: they are the ones the clients
+	 * will write to as soon as the service is back. The sort is stable so
+	 * that the heat order is kept among each category. */
+	const char *local = election_manager_get_local(ss->election_manager);
+	gint _master_first(gconstpointer p0, gconstpointer p1) {
+		const struct election_hint_s *h0 = *(struct election_hint_s**)p0;
+		const struct election_hint_s *h1 = *(struct election_hint_s**)p1;
+		const gboolean m0 = !g_strcmp0(h0->master_url, local);
+		const gboolean m1 = !g_strcmp0(h1->master_url, local);
+		return CMP(m1, m0);
+	}
+	g_ptr_array_sort(hints, _master_first);
+
+	GRID_DEBUG("Loaded %u election hints from [%s]", hints->len, path);
+	g_free(path);
+	return hints;
+}
+
+static void
+_task_save_warm_restart(gpointer p)
+{
+	if (!grid_main_is_running ())
+		return;
+
+	VARIABLE_PERIOD_DECLARE();
+	if (VARIABLE_PERIOD_SKIP(sqlx_warm_restart_period))
+		return;
+
+	_warm_restart_save(PSRV(p));
+}
+
 static void
 _task_expire_resolver(gpointer p)
 {
@@ -1203,6 +1476,10 @@ _task_update_stats(gpointer p)
 	gint64 health = oio_events_queue__get_health(PSRV(p)->events_queue);
 	network_server_stat_push2(PSRV(p)->server, FALSE,
 			gq_events_health, health, 0, 0);
+
+	guint64 coalesced = oio_events_queue__get_coalesced(PSRV(p)->events_queue);
+	network_server_stat_push2(PSRV(p)->server, FALSE,
+			gq_events_coalesced, coalesced, 0, 0);
 }
 
 static gboolean
@@ -121,6 +121,9 @@ struct sqlx_service_s
 	struct gridd_client_pool_s *clients_pool;
 	GThread *thread_client;
 
+	/* Pre-elects and pre-opens the bases hot before a restart */
+	GThread *thread_warmup;
+
 	//-------------------------------------------------------------------
 	// Variables used during the startup time of the server, but not used
 	// anymore after that.
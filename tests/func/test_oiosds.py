@@ -113,11 +113,21 @@ def test_get(lib):
         (("/0000000000000000000000000000000000000000000000000000000000000007",
             {"Range": "bytes=0-15"}, ""),
          (200, {"Content-Range": "bytes=0-15/16"}, "0"*16)),
+
+        (("/0000000000000000000000000000000000000000000000000000000000000008",
+            {"Range": "bytes=0-63"}, ""),
+         (200, {"Content-Range": "bytes=0-63/64"}, "0"*64)),
+        (("/0000000000000000000000000000000000000000000000000000000000000009",
+            {"Range": "bytes=0-63"}, ""),
+         (200, {"Content-Range": "bytes=0-63/64"}, "0"*64)),
     ]
     for h in http[1:]:
         h.expectations = rawx_expectations
     czero = "000000000000000000000000000000000000000000000000000000000000000"
     hash_zero = "00000000000000000000000000000000"
+    # Chunks uploaded by the Python SDK with other algorithms
+    hash_xxh64 = "0" * 16
+    hash_sha256 = "0" * 64
     http[0].expectations = [
         (("/v3.0/NS/content/show?acct=ACCT&ref=JFS&path=plop", {}, ""),
             (503, {}, "")),
@@ -151,6 +161,14 @@ def test_get(lib):
              {"url": "http://%s/%s%d" % (urls[3], czero, 7),
               "pos": "3.0", "size": 16, "hash": hash_zero},
              ]))),
+
+        (("/v3.0/NS/content/show?acct=ACCT&ref=JFS&path=plop", {}, ""),
+            (200, {"x-oio-content-meta-chunk-method": "plain"}, json.dumps([
+             {"url": "http://%s/%s%d" % (urls[1], czero, 8),
+              "pos": "0", "size": 64, "hash": hash_xxh64},
+             {"url": "http://%s/%s%d" % (urls[2], czero, 9),
+              "pos": "1", "size": 64, "hash": hash_sha256},
+             ]))),
     ]
     for s in services:
         s.start()
@@ -163,6 +181,7 @@ def test_get(lib):
         lib.test_get_success(cfg, "NS", "NS/ACCT/JFS//plop", 64)
         lib.test_get_success(cfg, "NS", "NS/ACCT/JFS//plop", 64)
         lib.test_get_success(cfg, "NS", "NS/ACCT/JFS//plop", 64)
+        lib.test_get_success(cfg, "NS", "NS/ACCT/JFS//plop", 128)
     finally:
         for h in http:
             assert(0 == len(h.expectations))
@@ -15,11 +15,13 @@
 
 import random
 import shutil
+import struct
 from hashlib import sha256
 
 from oio.common.constants import chunk_xattr_keys, \
-    CHUNK_XATTR_CONTENT_FULLPATH_PREFIX
-from oio.common.xattr import xattr
+    CHUNK_XATTR_CONTENT_FULLPATH_PREFIX, CHUNK_XATTR_PACKED_PREFIX
+from oio.common.xattr import xattr, read_user_xattr
+from oio.blob.utils import packed_xattr_keys, PACKED_FULLPATH
 from oio.common.fullpath import encode_old_fullpath
 from oio.common.utils import cid_from_name
 
@@ -57,6 +59,36 @@ def convert_to_old_chunk(chunk_path, account, container, path, version,
             pass
 
 
+def convert_to_packed_chunk(chunk_path, oio_version=None):
+    """
+    Move the attributes of the chunk in a single packed xattr, the way a rawx
+    with grid_packed_xattr enabled stores them.
+    """
+    chunk_id = chunk_path.rsplit('/', 1)[1]
+    tags = {v: k for k, v in packed_xattr_keys.items() if v}
+    fullpath_key = CHUNK_XATTR_CONTENT_FULLPATH_PREFIX + chunk_id
+    with open(chunk_path) as fd:
+        meta = read_user_xattr(fd)
+        if oio_version is not None:
+            meta[chunk_xattr_keys['oio_version']] = oio_version
+        fields = list()
+        if fullpath_key in meta:
+            fields.append((PACKED_FULLPATH, meta[fullpath_key]))
+        for key, tag in tags.items():
+            if key in meta:
+                fields.append((tag, meta[key]))
+        packed = '\x01'
+        for tag, value in sorted(fields):
+            packed += struct.pack('>BH', tag, len(value)) + value
+        xattr.setxattr(
+            fd, 'user.' + CHUNK_XATTR_PACKED_PREFIX + chunk_id, packed)
+        for key in [fullpath_key] + tags.keys():
+            try:
+                xattr.removexattr(fd, 'user.' + key)
+            except IOError:
+                pass
+
+
 def random_buffer(dictionary, n):
     slot = 512
     pattern = ''.join(random.choice(dictionary) for _ in range(slot))
@@ -16,15 +16,18 @@
 # License along with this library.
 
 import string
+from os import stat
 from os.path import isfile
-from hashlib import md5
+from hashlib import md5, sha256
 from urlparse import urlparse
 from urllib import unquote
 from oio.common.http import headers_from_object_metadata
 from oio.common.http_eventlet import http_connect
-from oio.common.constants import OIO_VERSION, CHUNK_HEADERS
+from oio.common.constants import OIO_VERSION, CHUNK_HEADERS, \
+    CHUNK_XATTR_PACKED_PREFIX, chunk_xattr_keys
 from oio.common.fullpath import encode_fullpath
 from oio.common.utils import cid_from_name
+from oio.common.xattr import read_user_xattr, xattr
 from oio.blob.utils import read_chunk_metadata
 from tests.utils import CommonTestCase, random_id
 from tests.functional.blob import convert_to_old_chunk, random_buffer, \
@@ -270,6 +273,56 @@ class RawxTestSuite(CommonTestCase):
 
         self._check_not_present(chunkurl)
 
+    def _rawx_stats(self):
+        resp, body = self._http_request(self.rawx + '/stat', 'GET', '', {})
+        self.assertEqual(200, resp.status)
+        stats = dict()
+        for line in body.splitlines():
+            tokens = line.split()
+            if len(tokens) == 3 and tokens[0] == 'counter':
+                stats[tokens[1]] = int(tokens[2])
+        return stats
+
+    def test_stat_histograms(self):
+        if self._cls_conf['go_rawx']:
+            self.skipTest('Rawx V2 has its own statistics')
+        length = 1024
+        chunkid = random_chunk_id()
+        chunkdata = random_buffer(string.printable, length)
+        chunkurl = self._rawx_url(chunkid)
+        headers = self._chunk_attr(chunkid, chunkdata)
+        trailers = {'x-oio-chunk-meta-metachunk-size': length,
+                    'x-oio-chunk-meta-metachunk-hash': md5().hexdigest()}
+
+        stats0 = self._rawx_stats()
+        resp, _ = self._http_request(chunkurl, 'PUT', chunkdata, headers,
+                                     trailers)
+        self.assertEqual(201, resp.status)
+        # One connection per request, so that several children serve them
+        nb_get = 32
+        for _ in range(nb_get):
+            resp, _ = self._http_request(chunkurl, 'GET', '', {})
+            self.assertEqual(200, resp.status)
+        resp, _ = self._http_request(chunkurl, 'DELETE', '', {})
+        self.assertEqual(204, resp.status)
+        stats1 = self._rawx_stats()
+
+        # The counters of all the children are summed, and never decrease
+        for k, v in stats0.items():
+            self.assertGreaterEqual(stats1[k], v, k)
+
+        bounds = ('1000', '5000', '10000', '50000', '100000', '500000',
+                  '1000000', '5000000', 'inf')
+        for op, nb in (('get', nb_get), ('put', 1), ('del', 1)):
+            names = ['req.hist.%s.%s' % (op, b) for b in bounds]
+            for name in names:
+                self.assertIn(name, stats1)
+            hist0 = sum(stats0.get(name, 0) for name in names)
+            hist1 = sum(stats1[name] for name in names)
+            # Each request falls in exactly one bucket
+            self.assertGreaterEqual(hist1 - hist0, nb)
+            self.assertLessEqual(hist1, stats1['req.hits.' + op])
+
     def test_empty_chunk(self):
         self._cycle_put(0, 201)
 
@@ -591,6 +644,144 @@ class RawxTestSuite(CommonTestCase):
         resp, _ = self._http_request(chunkurl1, 'COPY', '', headers)
         self.assertEqual(404, resp.status)
 
+    def _check_copy_data(self):
+        if self._cls_conf['go_rawx']:
+            self.skipTest('Rawx V2 only links the chunks')
+        if not self._cls_conf.get('copy_data'):
+            self.skipTest('grid_copy_data disabled')
+
+    def _put_sha256_chunk(self, length):
+        chunkid = random_chunk_id()
+        chunkdata = random_buffer(string.printable, length)
+        chunkurl = self._rawx_url(chunkid)
+        headers = self._chunk_attr(chunkid, chunkdata)
+        headers[CHUNK_HEADERS['chunk_hash']] = sha256(chunkdata).hexdigest()
+        headers[CHUNK_HEADERS['chunk_hash_algo']] = 'sha256'
+        trailers = {'x-oio-chunk-meta-metachunk-size': length,
+                    'x-oio-chunk-meta-metachunk-hash': md5().hexdigest()}
+        self._check_not_present(chunkurl)
+        resp, _ = self._http_request(chunkurl, 'PUT', chunkdata, headers,
+                                     trailers)
+        self.assertEqual(201, resp.status)
+        return chunkid, chunkdata, headers
+
+    def _copy_headers(self, copyid):
+        headers = {}
+        headers["Destination"] = self._rawx_url(copyid)
+        headers['x-oio-chunk-meta-full-path'] = encode_fullpath(
+                "account-snapshot", "container-snapshot", "content-snapshot",
+                1456938361143741, random_id(32))
+        return headers
+
+    def test_copy_data(self):
+        self._check_copy_data()
+        chunkid, chunkdata, headers1 = self._put_sha256_chunk(64 * 1024)
+        chunkpath = self._chunk_path(chunkid)
+        copyid = random_chunk_id()
+        copyurl = self._rawx_url(copyid)
+        copypath = self._chunk_path(copyid)
+
+        headers2 = self._copy_headers(copyid)
+        resp, _ = self._http_request(self._rawx_url(chunkid), 'COPY', '',
+                                     headers2)
+        self.assertEqual(201, resp.status)
+
+        # An independent file, holding the same data
+        self.assertNotEqual(stat(chunkpath).st_ino, stat(copypath).st_ino)
+        self.assertEqual(1, stat(copypath).st_nlink)
+        resp, body = self._http_request(copyurl, 'GET', '', {})
+        self.assertEqual(200, resp.status)
+        self.assertEqual(chunkdata, body)
+        self.assertEqual(headers1[CHUNK_HEADERS['chunk_hash']].upper(),
+                         resp.getheader(CHUNK_HEADERS['chunk_hash']))
+        self.assertEqual('sha256',
+                         resp.getheader(CHUNK_HEADERS['chunk_hash_algo']))
+
+        # The attributes of the source, but those naming the chunk, in the
+        # same layout (packed or not)
+        with open(chunkpath, 'r') as fd:
+            meta1, _ = read_chunk_metadata(fd, chunkid)
+            packed1 = CHUNK_XATTR_PACKED_PREFIX + chunkid in \
+                read_user_xattr(fd)
+        with open(copypath, 'r') as fd:
+            meta2, _ = read_chunk_metadata(fd, copyid)
+            packed2 = CHUNK_XATTR_PACKED_PREFIX + copyid in \
+                read_user_xattr(fd)
+        self.assertEqual(packed1, packed2)
+        self.assertEqual(headers2['x-oio-chunk-meta-full-path'],
+                         meta2['full_path'])
+        self.assertEqual(copyid, meta2['chunk_id'])
+        self.assertEqual({}, meta1['links'])
+        self.assertEqual({}, meta2['links'])
+        for k in ('chunk_hash', 'chunk_hash_algo', 'chunk_size',
+                  'chunk_pos', 'content_chunkmethod', 'content_policy',
+                  'metachunk_size', 'metachunk_hash', 'oio_version'):
+            self.assertEqual(meta1[k], meta2[k])
+        self.assertEqual('sha256', meta2['chunk_hash_algo'])
+
+        # The copy outlives the source
+        resp, _ = self._http_request(self._rawx_url(chunkid), 'DELETE', '',
+                                     {})
+        self.assertEqual(204, resp.status)
+        resp, body = self._http_request(copyurl, 'GET', '', {})
+        self.assertEqual(200, resp.status)
+        self.assertEqual(chunkdata, body)
+        resp, _ = self._http_request(copyurl, 'DELETE', '', {})
+        self.assertEqual(204, resp.status)
+
+    def test_copy_data_hash_mismatch(self):
+        self._check_copy_data()
+        chunkid, chunkdata, _ = self._put_sha256_chunk(64 * 1024)
+        chunkpath = self._chunk_path(chunkid)
+        copyid = random_chunk_id()
+        copypath = self._chunk_path(copyid)
+
+        # Same size, another content
+        with open(chunkpath, 'r+') as fd:
+            fd.seek(len(chunkdata) / 2)
+            fd.write('#' if chunkdata[len(chunkdata) / 2] != '#' else '%')
+
+        resp, _ = self._http_request(self._rawx_url(chunkid), 'COPY', '',
+                                     self._copy_headers(copyid))
+        self.assertEqual(409, resp.status)
+        self.assertFalse(isfile(copypath))
+        self.assertFalse(isfile(copypath + '.pending'))
+        self._check_not_present(self._rawx_url(copyid))
+
+    def test_copy_data_unknown_hash_algo(self):
+        self._check_copy_data()
+        chunkid, _, _ = self._put_sha256_chunk(64 * 1024)
+        copyid = random_chunk_id()
+        copypath = self._chunk_path(copyid)
+        with open(self._chunk_path(chunkid)) as fd:
+            xattr.setxattr(fd, 'user.' + chunk_xattr_keys['chunk_hash_algo'],
+                           'sha0')
+
+        # The hash cannot be checked, the copy is refused
+        resp, _ = self._http_request(self._rawx_url(chunkid), 'COPY', '',
+                                     self._copy_headers(copyid))
+        self.assertEqual(501, resp.status)
+        self.assertFalse(isfile(copypath))
+        self.assertFalse(isfile(copypath + '.pending'))
+
+    def test_direct_io(self):
+        if self._cls_conf['go_rawx']:
+            self.skipTest('Rawx V2 has no O_DIRECT')
+        if not self._cls_conf.get('direct_io'):
+            self.skipTest('grid_direct_io disabled')
+        # Aligned or not on the blocks, below or over the write-behind
+        write_behind = self._cls_conf.get('write_behind', 0)
+        for length in (1, 3 * 4096 + 123, 4 * 4096,
+                       3 * write_behind + 1234):
+            chunkid, chunkdata, headers = self._put_sha256_chunk(length)
+            self.assertEqual(length, stat(self._chunk_path(chunkid)).st_size)
+            resp, body = self._http_request(self._rawx_url(chunkid), 'GET',
+                                            '', {})
+            self.assertEqual(200, resp.status)
+            self.assertEqual(chunkdata, body)
+            self.assertEqual(headers[CHUNK_HEADERS['chunk_hash']].upper(),
+                             resp.getheader(CHUNK_HEADERS['chunk_hash']))
+
     def test_wrong_fullpath(self):
         metachunk_hash = md5().hexdigest()
         trailers = {'x-oio-chunk-meta-metachunk-size': 1,
@@ -19,12 +19,14 @@ from oio.api.object_storage import ObjectStorageApi
 from oio.common.utils import cid_from_name
 from oio.common.fullpath import encode_fullpath
 from oio.common.constants import chunk_xattr_keys, \
-    CHUNK_XATTR_CONTENT_FULLPATH_PREFIX, OIO_VERSION
+    CHUNK_XATTR_CONTENT_FULLPATH_PREFIX, CHUNK_XATTR_PACKED_PREFIX, \
+    OIO_VERSION
 from oio.blob.converter import BlobConverter
 from oio.blob.utils import read_chunk_metadata
 from oio.crawler.integrity import Checker, Target
 from tests.utils import BaseTestCase, random_str
-from tests.functional.blob import convert_to_old_chunk
+from tests.functional.blob import convert_to_old_chunk, \
+    convert_to_packed_chunk
 
 
 class TestBlobConverter(BaseTestCase):
@@ -138,6 +140,28 @@ class TestBlobConverter(BaseTestCase):
             {chunk_id: (self.account, self.container, self.path, self.version,
                         self.content_id)})
 
+    def test_converter_packed_chunk(self):
+        chunk = random.choice(self.chunks)
+        chunk_volume = chunk['url'].split('/')[2]
+        chunk_id = chunk['url'].split('/')[3]
+        chunk_path = self._chunk_path(chunk)
+        meta, _ = read_chunk_metadata(chunk_path, chunk_id)
+
+        # an old version in the packed xattr triggers the conversion
+        convert_to_packed_chunk(chunk_path, oio_version='4.0')
+
+        self._converter_and_check(
+            chunk_volume, chunk_path,
+            {chunk_id: (self.account, self.container, self.path, self.version,
+                        self.content_id)})
+
+        # the packed xattr no longer shadows the converted attributes
+        _, raw_meta = read_chunk_metadata(chunk_path, chunk_id)
+        self.assertNotIn(CHUNK_XATTR_PACKED_PREFIX + chunk_id, raw_meta)
+        for key in ('chunk_hash', 'chunk_size', 'chunk_pos',
+                    'content_policy'):
+            self.assertEqual(raw_meta[chunk_xattr_keys[key]], meta[key])
+
     def test_converter_old_chunk_with_wrong_path(self):
         for c in self.chunks:
             convert_to_old_chunk(
@@ -118,3 +118,33 @@ class TestBlobMover(BaseTestCase):
         del chunk_headers['oio_version']
         del new_chunk_headers['oio_version']
         self.assertEqual(chunk_headers, new_chunk_headers)
+
+    def test_move_sha256_chunk(self):
+        path = random_str(16)
+        self.api.object_create(
+            self.account, self.container, obj_name=path, data="chunk",
+            chunk_checksum_algo='sha256')
+        _, chunks = self.api.object_locate(
+            self.account, self.container, path)
+        chunk = random.choice(chunks)
+        chunk_volume = chunk['url'].split('/')[2]
+        chunk_id = chunk['url'].split('/')[3]
+
+        mover = BlobMoverWorker(self.conf, None,
+                                self.rawx_volumes[chunk_volume])
+        mover.chunk_move(self._chunk_path(chunk), chunk_id)
+
+        _, new_chunks = self.api.object_locate(
+            self.account, self.container, path)
+        url_kept = [c['url'] for c in chunks]
+        new_chunks = [c for c in new_chunks if c['url'] not in url_kept]
+        self.assertEqual(1, len(new_chunks))
+        new_chunk = new_chunks[0]
+        self.assertEqual(64, len(new_chunk['hash']))
+        self.assertEqual(chunk['hash'], new_chunk['hash'])
+
+        # The copy is hashed the same way, and says so
+        headers, stream = self.blob_client.chunk_get(new_chunk['url'])
+        self.assertEqual('chunk', stream.read())
+        self.assertEqual('sha256', headers['chunk_hash_algo'])
+        self.assertEqual(chunk['hash'].upper(), headers['chunk_hash'].upper())
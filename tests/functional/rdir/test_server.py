@@ -19,7 +19,8 @@ from shutil import rmtree
 import simplejson as json
 import subprocess
 import uuid
-from os import remove
+from os import remove, path
+import plyvel
 from oio.common.http_urllib3 import get_pool_manager
 
 from tests.utils import CommonTestCase, random_str, random_id
@@ -37,6 +38,24 @@ map_cfg = {'host': 'bind_addr', 'port': 'bind_port',
            'service_id': 'service_id'}
 
 
+def _chunk_key(rec):
+    return 'chunk|' + _key(rec)
+
+
+def _binary_record(mtime):
+    """Encode a chunk record the way the rdir does: a version byte, then
+    the mtime as a LEB128 varint."""
+    out = bytearray([1])
+    while True:
+        b = mtime & 0x7F
+        mtime >>= 7
+        if mtime:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
 def _write_config(path, config):
     with open(path, 'w') as f:
         f.write("[rdir-server]\n")
@@ -230,6 +249,61 @@ class TestRdirServer(RdirTestCase):
             self.assertListEqual(self.json_loads(resp.data), [])
             rec[k] = save
 
+    def test_push_delete_many(self):
+        recs = [self._record() for _ in range(8)]
+        bad = dict(recs[3])
+        del bad['chunk_id']
+
+        # an empty array on an unknown volume does nothing
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol},
+                data=json.dumps([]))
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'succeeded': 0, 'failed': []})
+
+        # an array on an unknown volume
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol},
+                data=json.dumps(recs))
+        self.assertEqual(resp.status, 404)
+
+        # the invalid records are reported, the others are pushed
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol, 'create': True},
+                data=json.dumps(recs[:3] + [bad, 'junk'] + recs[3:]))
+        self.assertEqual(resp.status, 200)
+        body = self.json_loads(resp.data)
+        self.assertEqual(body['succeeded'], len(recs))
+        self.assertListEqual([f['index'] for f in body['failed']], [3, 4])
+        self.assertTrue(all(f['status'] == 400 for f in body['failed']))
+
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        self.assertListEqual(
+            self.json_loads(resp.data),
+            sorted([_key(r), {'mtime': r['mtime']}] for r in recs))
+
+        # an empty array does nothing
+        resp = self._delete(
+                "/v1/rdir/delete", params={'vol': self.vol},
+                data=json.dumps([]))
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'succeeded': 0, 'failed': []})
+
+        resp = self._delete(
+                "/v1/rdir/delete", params={'vol': self.vol},
+                data=json.dumps(recs[1:]))
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'succeeded': len(recs) - 1, 'failed': []})
+
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        self.assertListEqual(self.json_loads(resp.data),
+                             [[_key(recs[0]), {'mtime': recs[0]['mtime']}]])
+
     def test_lock_unlock(self):
         who = random_str(64)
 
@@ -277,6 +351,157 @@ class TestRdirServer(RdirTestCase):
         resp = self._post("/v1/rdir/admin/unlock", params={'vol': self.vol})
         self.assertEqual(resp.status, 204)
 
+    def test_status_counters(self):
+        rec = self._record()
+        rec2 = self._record()
+        rec2['container_id'] = rec['container_id']
+
+        def _check(expected):
+            resp = self._get("/v1/rdir/status", params={'vol': self.vol})
+            self.assertEqual(resp.status, 200)
+            self.assertDictEqual(self.json_loads(resp.data), expected)
+
+        # pushing twice the same chunk counts it once
+        for _ in range(2):
+            resp = self._post(
+                    "/v1/rdir/push", params={'vol': self.vol, 'create': True},
+                    data=json.dumps(rec))
+            self.assertEqual(resp.status, 204)
+        _check({'chunk': {'total': 1},
+                'container': {rec['container_id']: {'total': 1}}})
+
+        # so does a batch holding the same chunk twice
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol},
+                data=json.dumps([rec2, rec, rec2]))
+        self.assertEqual(resp.status, 200)
+        _check({'chunk': {'total': 2},
+                'container': {rec['container_id']: {'total': 2}}})
+
+        # the chunks pushed before the incident are to be rebuilt
+        incident_date = int(time.time())
+        resp = self._post("/v1/rdir/admin/incident", params={'vol': self.vol},
+                          data=json.dumps({'date': incident_date}))
+        self.assertEqual(resp.status, 204)
+        _check({'chunk': {'total': 2, 'to_rebuild': 2},
+                'container': {rec['container_id']: {'total': 2,
+                                                    'to_rebuild': 2}},
+                'rebuild': {'incident_date': incident_date}})
+
+        # until they are pushed again
+        rec2['mtime'] = incident_date + 1
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol},
+                data=json.dumps(rec2))
+        self.assertEqual(resp.status, 204)
+        _check({'chunk': {'total': 2, 'to_rebuild': 1},
+                'container': {rec['container_id']: {'total': 2,
+                                                    'to_rebuild': 1}},
+                'rebuild': {'incident_date': incident_date}})
+
+        # deleting twice the same chunk only counts once
+        for _ in range(2):
+            resp = self._delete(
+                    "/v1/rdir/delete", params={'vol': self.vol},
+                    data=json.dumps(rec))
+            self.assertEqual(resp.status, 204)
+        _check({'chunk': {'total': 1},
+                'container': {rec['container_id']: {'total': 1}},
+                'rebuild': {'incident_date': incident_date}})
+
+        # the counters are not part of the admin keys
+        resp = self._get("/v1/rdir/admin/show", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'incident_date': str(incident_date)})
+
+        # the containers without chunks disappear
+        resp = self._post("/v1/rdir/admin/clear",
+                          params={'vol': self.vol, 'all': True})
+        self.assertEqual(resp.status, 200)
+        _check({'chunk': {'total': 0}, 'container': {}})
+
+    def test_status_counters_without_mtime(self):
+        rec = self._record()
+        rec2 = self._record()
+        rec2['container_id'] = rec['container_id']
+        del rec2['mtime']
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol, 'create': True},
+                data=json.dumps([rec, rec2]))
+        self.assertEqual(resp.status, 200)
+
+        incident_date = rec['mtime'] - 1
+        resp = self._post("/v1/rdir/admin/incident", params={'vol': self.vol},
+                          data=json.dumps({'date': incident_date}))
+        self.assertEqual(resp.status, 204)
+
+        # a chunk without mtime (0) might predate the incident
+        resp = self._get("/v1/rdir/status", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(
+            self.json_loads(resp.data),
+            {'chunk': {'total': 2, 'to_rebuild': 1},
+             'container': {rec['container_id']: {'total': 2,
+                                                 'to_rebuild': 1}},
+             'rebuild': {'incident_date': incident_date}})
+
+        # and the rebuild fetches exactly the chunks counted
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol},
+                          data=json.dumps({'rebuild': True}))
+        self.assertEqual(resp.status, 200)
+        self.assertListEqual(self.json_loads(resp.data),
+                             [[_key(rec2), {'mtime': 0}]])
+
+    def test_fetch_mtime_index(self):
+        recs = [self._record() for _ in range(5)]
+        for i, rec in enumerate(recs):
+            rec['mtime'] = 1000 + (5 - i) * 10
+        resp = self._post(
+                "/v1/rdir/push", params={'vol': self.vol, 'create': True},
+                data=json.dumps(recs))
+        self.assertEqual(resp.status, 200)
+
+        def _fetch(**kwargs):
+            kwargs['mtime_index'] = True
+            resp = self._post("/v1/rdir/fetch", params={'vol': self.vol},
+                              data=json.dumps(kwargs))
+            self.assertEqual(resp.status, 200)
+            return self.json_loads(resp.data)
+
+        by_mtime = [[_key(r), {'mtime': r['mtime']}] for r in reversed(recs)]
+        self.assertListEqual(_fetch(), by_mtime)
+        self.assertListEqual(_fetch(max_mtime=1030), by_mtime[:3])
+
+        # page with the last chunk received and its mtime
+        page = _fetch(limit=2)
+        self.assertListEqual(page, by_mtime[:2])
+        page = _fetch(limit=2, start_after=page[-1][0],
+                      start_after_mtime=page[-1][1]['mtime'])
+        self.assertListEqual(page, by_mtime[2:4])
+
+        # a new mtime moves the chunk in the index
+        recs[4]['mtime'] = 2000
+        resp = self._post("/v1/rdir/push", params={'vol': self.vol},
+                          data=json.dumps(recs[4]))
+        self.assertEqual(resp.status, 204)
+        resp = self._delete("/v1/rdir/delete", params={'vol': self.vol},
+                            data=json.dumps(recs[3]))
+        self.assertEqual(resp.status, 204)
+        by_mtime = by_mtime[2:] + [[_key(recs[4]), {'mtime': 2000}]]
+        self.assertListEqual(_fetch(), by_mtime)
+
+        # the rebuild stops at the incident date
+        resp = self._post("/v1/rdir/admin/incident", params={'vol': self.vol},
+                          data=json.dumps({'date': 1500}))
+        self.assertEqual(resp.status, 204)
+        self.assertListEqual(_fetch(rebuild=True), by_mtime[:-1])
+
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol},
+                          data=json.dumps({'mtime_index': True,
+                                           'container_id': 'AA'}))
+        self.assertEqual(resp.status, 400)
+
     def test_rdir_clear_and_lock(self):
         rec = self._record()
         who = random_id(32)
@@ -510,21 +735,28 @@ class TestRdirServer2(RdirTestCase):
     def test_status(self):
         vol = self._volume()
 
+        def _status():
+            resp = self._get('/status')
+            self.assertEqual(resp.status, 200)
+            status = self.json_loads(resp.data)
+            self.assertEqual(status.pop('service_id'), self.service_id)
+            # the tuning of leveldb, with the default values
+            self.assertEqual(status.pop('db_cache_size'), 64 * 1024 * 1024)
+            self.assertEqual(status.pop('db_bloom_bits_per_key'), 10)
+            self.assertEqual(status.pop('db_write_buffer_size'),
+                             4 * 1024 * 1024)
+            self.assertGreaterEqual(status.pop('db_memory_usage'), 0)
+            return status
+
         # check the service has no opened DB
-        resp = self._get('/status')
-        self.assertEqual(resp.status, 200)
-        self.assertEqual(self.json_loads(resp.data),
-                         {'opened_db_count': 0, 'service_id': self.service_id})
+        self.assertEqual(_status(), {'opened_db_count': 0})
 
         # DB creation
         resp = self._post("/v1/rdir/create", params={'vol': vol})
         self.assertEqual(resp.status, 201)
 
         # The base remains open after it has been created
-        resp = self._get('/status')
-        self.assertEqual(resp.status, 200)
-        self.assertEqual(self.json_loads(resp.data),
-                         {'opened_db_count': 1, 'service_id': self.service_id})
+        self.assertEqual(_status(), {'opened_db_count': 1})
 
     def test_bad_routes(self):
         routes = ('/status', '/config',
@@ -593,6 +825,124 @@ class TestRdirServer2(RdirTestCase):
             self.assertEqual(resp.status, 405)
 
 
+class TestRdirServerFormat(RdirTestCase):
+    """Test the migration of the chunk records to the binary format"""
+
+    def setUp(self):
+        super(TestRdirServerFormat, self).setUp()
+        self.host, self.port = '127.0.0.1', 5999
+        self.cfg_path = tempfile.mktemp()
+        self.db_path = tempfile.mkdtemp()
+        self.garbage_files.extend((self.cfg_path, self.db_path))
+        _write_config(self.cfg_path, {'host': self.host, 'port': self.port,
+                                      'ns': self.ns, 'db': self.db_path})
+        self.vol = self._volume()
+        self.proc = None
+
+    def _start(self):
+        self.proc = subprocess.Popen(['oio-rdir-server', self.cfg_path],
+                                     close_fds=True)
+        self.garbage_procs.append(self.proc)
+        if not wait_for_slow_startup(self.port):
+            raise Exception("The rdir server is too long to start")
+
+    def _stop(self):
+        self.proc.terminate()
+        self.proc.wait()
+        self.garbage_procs.remove(self.proc)
+        self.proc = None
+
+    def _base(self):
+        """Open the volume directly, while the rdir is stopped"""
+        return plyvel.DB(path.join(self.db_path, self.vol),
+                         create_if_missing=True)
+
+    def _records(self):
+        cid = random_id(64)
+        recs = list()
+        for mtime in (1000, 1010, 1020, 1030):
+            rec = self._record()
+            rec['container_id'] = cid
+            rec['mtime'] = mtime
+            recs.append(rec)
+        return recs
+
+    def _fetch(self, **kwargs):
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol},
+                          data=json.dumps(kwargs))
+        self.assertEqual(resp.status, 200)
+        return self.json_loads(resp.data)
+
+    def _status(self):
+        resp = self._get("/v1/rdir/status", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        return self.json_loads(resp.data)
+
+    def test_migration(self):
+        # two legacy records and two binary records in the same volume
+        recs = self._records()
+        base = self._base()
+        with base.write_batch() as batch:
+            for rec in recs[:2]:
+                batch.put(_chunk_key(rec), json.dumps(rec))
+            for rec in recs[2:]:
+                batch.put(_chunk_key(rec), _binary_record(rec['mtime']))
+            batch.put('admin|incident_date', '1015')
+        base.close()
+
+        cid = recs[0]['container_id']
+        reference = sorted([_key(r), {'mtime': r['mtime']}] for r in recs)
+        status = {'chunk': {'total': 4, 'to_rebuild': 2},
+                  'container': {cid: {'total': 4, 'to_rebuild': 2}},
+                  'rebuild': {'incident_date': 1015}}
+
+        # both formats are readable together
+        self._start()
+        self.assertListEqual(self._fetch(), reference)
+        self.assertListEqual(
+            self._fetch(rebuild=True),
+            [r for r in reference if r[1]['mtime'] <= 1015])
+        self.assertDictEqual(self._status(), status)
+
+        # let the background task migrate the opened volume
+        time.sleep(3)
+        self._stop()
+        base = self._base()
+        for key, value in base.iterator(prefix='chunk|'):
+            self.assertEqual(value[0], '\x01')
+        self.assertEqual(base.get('admin|format'), '1')
+        base.close()
+
+        # the migration changes nothing for the clients
+        self._start()
+        self.assertListEqual(self._fetch(), reference)
+        self.assertListEqual(
+            self._fetch(rebuild=True),
+            [r for r in reference if r[1]['mtime'] <= 1015])
+        self.assertDictEqual(self._status(), status)
+
+        # the format marker is not an admin key
+        resp = self._get("/v1/rdir/admin/show", params={'vol': self.vol})
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'incident_date': '1015'})
+
+    def test_unknown_format(self):
+        rec = self._record()
+        base = self._base()
+        base.put(_chunk_key(rec), _binary_record(rec['mtime']))
+        base.put('admin|format', '9')
+        base.close()
+
+        # a volume migrated by a more recent rdir is refused, not served
+        # without its records
+        self._start()
+        resp = self._post("/v1/rdir/fetch", params={'vol': self.vol})
+        self.assertEqual(resp.status, 500)
+        resp = self._get("/v1/rdir/status", params={'vol': self.vol})
+        self.assertEqual(resp.status, 500)
+
+
 class TestRdirServer3(RdirTestCase):
     """Test the oio-rdir-server with invalid configuration"""
 
@@ -790,6 +1140,38 @@ class TestRdirServer4(RdirTestCase):
         }
         self.assertEqual(self.json_loads(resp.data), reference)
 
+    def test_meta2_push_delete_many(self):
+        recs = [self._meta2_record() for _ in range(4)]
+        bad = dict(recs[0])
+        del bad['container_url']
+
+        resp = self._post(
+            "/v1/rdir/meta2/push", params={'vol': self.vol},
+            data=json.dumps([bad] + recs))
+        self.assertEqual(resp.status, 200)
+        body = self.json_loads(resp.data)
+        self.assertEqual(body['succeeded'], len(recs))
+        self.assertListEqual([f['index'] for f in body['failed']], [0])
+
+        resp = self._post("/v1/rdir/meta2/fetch", params={'vol': self.vol},
+                          data=json.dumps({}))
+        self.assertEqual(resp.status, 200)
+        self.assertEqual(len(self.json_loads(resp.data)['records']),
+                         len(recs))
+
+        resp = self._post(
+            "/v1/rdir/meta2/delete", params={'vol': self.vol},
+            data=json.dumps(recs))
+        self.assertEqual(resp.status, 200)
+        self.assertDictEqual(self.json_loads(resp.data),
+                             {'succeeded': len(recs), 'failed': []})
+
+        resp = self._post("/v1/rdir/meta2/fetch", params={'vol': self.vol},
+                          data=json.dumps({}))
+        self.assertEqual(resp.status, 200)
+        self.assertEqual(self.json_loads(resp.data), {"records": [],
+                                                      "truncated": False})
+
     def test_meta2_delete(self):
         rec = self._meta2_record()
 
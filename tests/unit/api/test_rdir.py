@@ -102,6 +102,47 @@ class TestRdirClient(unittest.TestCase):
         self.assertRaises(StopIteration, gen.next)
         self.assertEqual(self.rdir_client._direct_request.call_count, 3)
 
+    def _chunks(self):
+        return ({'container_id': self.container_id_1,
+                 'content_id': self.content_id_1,
+                 'chunk_id': self.chunk_id_1,
+                 'mtime': 10},
+                {'container_id': self.container_id_2,
+                 'content_id': self.content_id_2,
+                 'chunk_id': self.chunk_id_2,
+                 'mtime': 20})
+
+    def test_push_many(self):
+        report = {'succeeded': 1,
+                  'failed': [{'index': 1, 'status': 400,
+                              'message': 'Invalid body'}]}
+        self.rdir_client._direct_request = Mock(
+            return_value=(Mock(), report))
+        # Any iterable of chunks is sent as a single JSON array
+        chunks = self._chunks()
+        body = self.rdir_client.chunk_push_many("volume", iter(chunks))
+        self.assertEqual(report, body)
+        self.assertEqual(self.rdir_client._direct_request.call_count, 1)
+        args, kwargs = self.rdir_client._direct_request.call_args
+        self.assertEqual('POST', args[0])
+        self.assertEqual('http://0.1.2.3:4567/v1/rdir/push', args[1])
+        self.assertEqual({'vol': 'volume', 'create': '1'}, kwargs['params'])
+        self.assertEqual(list(chunks), kwargs['json'])
+
+    def test_delete_many(self):
+        report = {'succeeded': 2, 'failed': []}
+        self.rdir_client._direct_request = Mock(
+            return_value=(Mock(), report))
+        chunks = self._chunks()
+        body = self.rdir_client.chunk_delete_many("volume", iter(chunks))
+        self.assertEqual(report, body)
+        self.assertEqual(self.rdir_client._direct_request.call_count, 1)
+        args, kwargs = self.rdir_client._direct_request.call_args
+        self.assertEqual('DELETE', args[0])
+        self.assertEqual('http://0.1.2.3:4567/v1/rdir/delete', args[1])
+        self.assertEqual({'vol': 'volume'}, kwargs['params'])
+        self.assertEqual(list(chunks), kwargs['json'])
+
 
 class TestRdirMeta2Client(unittest.TestCase):
     def setUp(self):
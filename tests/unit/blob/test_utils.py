@@ -0,0 +1,51 @@
+# Copyright (C) 2018 OpenIO SAS
+
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 3.0 of the License, or (at your option) any later version.
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library.
+
+
+import struct
+import unittest
+
+from oio.blob.utils import decode_packed_xattr
+from oio.common.constants import CHUNK_XATTR_CONTENT_FULLPATH_PREFIX
+from oio.common.exceptions import FaultyChunk
+
+
+def _pack(*fields):
+    out = '\x01'
+    for tag, value in fields:
+        out += struct.pack('>BH', tag, len(value)) + value
+    return out
+
+
+class PackedXattrTest(unittest.TestCase):
+
+    def test_decode(self):
+        chunk_id = '0' * 64
+        packed = _pack((1, 'acct/ref/obj/1/' + 'A' * 32),
+                       (4, 'SINGLE'),
+                       (11, '0'),
+                       (15, 'xxh64'),
+                       (200, 'from a later version'))
+        self.assertDictEqual(
+            decode_packed_xattr(packed, chunk_id),
+            {CHUNK_XATTR_CONTENT_FULLPATH_PREFIX + chunk_id:
+                'acct/ref/obj/1/' + 'A' * 32,
+             'grid.content.storage_policy': 'SINGLE',
+             'grid.chunk.position': '0',
+             'grid.chunk.hash_algo': 'xxh64'})
+
+    def test_decode_invalid(self):
+        self.assertRaises(FaultyChunk, decode_packed_xattr, '', 'A')
+        self.assertRaises(FaultyChunk, decode_packed_xattr, '\x02', 'A')
+        self.assertRaises(FaultyChunk, decode_packed_xattr,
+                          _pack((4, 'SINGLE'))[:-1], 'A')
@@ -0,0 +1,102 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <metautils/lib/metautils.h>
+#include <rawx-lib/src/checksum.h>
+
+static void
+test_xxh64_vectors(void)
+{
+	static const struct {
+		const char *input;
+		guint64 expected;
+	} vectors[] = {
+		{"", 0xEF46DB3751D8E999ULL},
+		{"a", 0xD24EC4F1A98C6E5BULL},
+		{"abc", 0x44BC2CF5AD770999ULL},
+		/* Longer than a stripe */
+		{"Nobody inspects the spammish repetition", 0xFBCEA83C8A378BF1ULL},
+		{NULL, 0}
+	};
+	for (guint i = 0; vectors[i].input; i++) {
+		const char *s = vectors[i].input;
+		g_assert_cmpuint(oio_xxh64((guint8*)s, strlen(s), 0),
+				==, vectors[i].expected);
+	}
+}
+
+/* Feeding the input in pieces of any size gives the one-shot result */
+static void
+test_streaming(void)
+{
+	guint8 buf[8192];
+	for (guint i = 0; i < sizeof(buf); i++)
+		buf[i] = i * 7 + 3;
+
+	for (guint a = 0; chunk_checksum_algo_name(a); a++) {
+		const char *name = chunk_checksum_algo_name(a);
+		struct chunk_checksum_s *whole = chunk_checksum_new(name);
+		chunk_checksum_update(whole, buf, sizeof(buf));
+
+		struct chunk_checksum_s *pieces = chunk_checksum_new(name);
+		for (gsize off = 0, len = 1; off < sizeof(buf); off += len, len += 3)
+			chunk_checksum_update(pieces, buf + off,
+					MIN(len, sizeof(buf) - off));
+
+		g_assert_cmpstr(chunk_checksum_get_string(whole), ==,
+				chunk_checksum_get_string(pieces));
+		chunk_checksum_free(whole);
+		chunk_checksum_free(pieces);
+	}
+}
+
+static void
+test_algos(void)
+{
+	g_assert_true(chunk_checksum_algo_is_known(CHUNK_CHECKSUM_DEFAULT));
+	g_assert_true(chunk_checksum_algo_is_known("XXH64"));
+	g_assert_false(chunk_checksum_algo_is_known("crc32"));
+	g_assert_false(chunk_checksum_algo_is_known(NULL));
+	g_assert(NULL == chunk_checksum_new("crc32"));
+
+	struct chunk_checksum_s *cs = chunk_checksum_new("MD5");
+	g_assert_cmpstr(chunk_checksum_get_name(cs), ==, "md5");
+	chunk_checksum_update(cs, (guint8*)"abc", 3);
+	g_assert_cmpstr(chunk_checksum_get_string(cs), ==,
+			"900150983CD24FB0D6963F7D28E17F72");
+	chunk_checksum_free(cs);
+
+	cs = chunk_checksum_new("xxh64");
+	chunk_checksum_update(cs, (guint8*)"abc", 3);
+	g_assert_cmpstr(chunk_checksum_get_string(cs), ==, "44BC2CF5AD770999");
+	chunk_checksum_free(cs);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc, argv);
+	g_test_add_func("/rawx/checksum/xxh64", test_xxh64_vectors);
+	g_test_add_func("/rawx/checksum/streaming", test_streaming);
+	g_test_add_func("/rawx/checksum/algos", test_algos);
+	return g_test_run();
+}
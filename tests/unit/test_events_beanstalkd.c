@@ -232,6 +232,7 @@ test_with_check (void)
 	}
 
 	oio_events_beanstalkd_check_period = G_TIME_SPAN_SECOND; /* != 0 */
+	oio_events_beanstalkd_window = 1;
 	_wrap_with_beanstalkd(requests, replies, t);
 }
 
@@ -289,15 +290,122 @@ test_without_check (void)
 	}
 
 	oio_events_beanstalkd_check_period = 0;
+	oio_events_beanstalkd_window = 1;
 	_wrap_with_beanstalkd(requests, replies, t);
 }
 
+static void
+test_pipelined (void)
+{
+	/* All the jobs are sent before the first reply is read */
+	gchar *requests[] = {
+		"use [A-Za-z0-9]+\\R",
+		"put [[:digit:]]+ [[:digit:]]+ [[:digit:]]+ [[:digit:]]+\\R", "1\\R",
+		"put [[:digit:]]+ [[:digit:]]+ [[:digit:]]+ [[:digit:]]+\\R", "2\\R",
+		"put [[:digit:]]+ [[:digit:]]+ [[:digit:]]+ [[:digit:]]+\\R", "3\\R",
+		"put [[:digit:]]+ [[:digit:]]+ [[:digit:]]+ [[:digit:]]+\\R", "4\\R",
+
+		"use [A-Za-z0-9]+\\R",
+		"put [[:digit:]]+ [[:digit:]]+ [[:digit:]]+ [[:digit:]]+\\R", "3\\R",
+		NULL
+	};
+	gchar *replies[] = {
+		"USING oio\r\n",
+
+		"", "INSERTED 1\r\n",
+		"", "INSERTED 2\r\n",
+		"", "OUT_OF_MEMORY\r\n",
+		"", "INSERTED 4\r\n",
+		/* only the job without a positive reply is retried */
+		"USING oio\r\n",
+		"", "INSERTED 3\r\n",
+		NULL
+	};
+
+	void check_return (GError *err) {
+		static volatile guint i = 0;
+		gboolean expected[] = {
+			TRUE,
+			TRUE, TRUE, FALSE, TRUE,
+			TRUE,
+			TRUE,
+		};
+		if (expected[i++])
+			g_assert_no_error(err);
+		else
+			g_assert_nonnull(err);
+	}
+	void t(struct oio_events_queue_s *q) {
+		intercept_errors = check_return;
+		oio_events_queue__send(q, g_strdup("1"));
+		oio_events_queue__send(q, g_strdup("2"));
+		oio_events_queue__send(q, g_strdup("3"));
+		oio_events_queue__send(q, g_strdup("4"));
+	}
+
+	oio_events_beanstalkd_check_period = 0;
+	oio_events_beanstalkd_window = 4;
+	_wrap_with_beanstalkd(requests, replies, t);
+}
+
+static gpointer
+_drain_socket (gpointer p)
+{
+	int fd = GPOINTER_TO_INT(p);
+	GByteArray *gba = g_byte_array_new();
+	guint8 buf[512];
+	for (;;) {
+		g_usleep(100);
+		ssize_t r = read(fd, buf, sizeof(buf));
+		if (r <= 0)
+			break;
+		g_byte_array_append(gba, buf, r);
+	}
+	return gba;
+}
+
+static void
+test_short_writes (void)
+{
+	int fds[2] = {-1, -1};
+	g_assert_cmpint(0, ==, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	int opt = 1024;
+	g_assert_cmpint(0, ==, setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF,
+				&opt, sizeof(opt)));
+	sock_set_non_blocking(fds[0], TRUE);
+
+	/* Several buffers large enough to be sent in many partial writes */
+	guint8 data[3][20000];
+	for (guint i=0; i<3 ;++i) {
+		for (guint j=0; j<sizeof(data[i]) ;++j)
+			data[i][j] = (guint8) (i * 7 + j * 13 + j / 251);
+	}
+	struct iovec iov[3];
+	for (guint i=0; i<3 ;++i) {
+		iov[i].iov_base = data[i];
+		iov[i].iov_len = sizeof(data[i]);
+	}
+
+	GThread *th = g_thread_new("drain", _drain_socket, GINT_TO_POINTER(fds[1]));
+	g_assert_cmpint(1, ==, _send(fds[0], iov, 3));
+	shutdown(fds[0], SHUT_WR);
+	GByteArray *gba = g_thread_join(th);
+
+	g_assert_cmpuint(gba->len, ==, sizeof(data));
+	g_assert_cmpint(0, ==, memcmp(gba->data, data, sizeof(data)));
+	g_byte_array_free(gba, TRUE);
+	close(fds[0]);
+	close(fds[1]);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc, argv);
 	g_test_add_func("/event/beanstalkd/with_check", test_with_check);
 	g_test_add_func("/event/beanstalkd/without_check", test_without_check);
+	g_test_add_func("/event/beanstalkd/pipelined", test_pipelined);
+	g_test_add_func("/event/beanstalkd/short_writes", test_short_writes);
 	server_fd_max_passive = metautils_syscall_count_maxfd();
 	return g_test_run();
 }
@@ -17,11 +17,14 @@ License along with this library.
 */
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <zmq.h>
 
 #include <core/oio_core.h>
+#include <core/internals.h>
 #include <events/events_variables.h>
 #include <events/oio_events_queue.h>
+#include <events/oio_events_queue_spill.h>
 
 static gboolean immediately_done (gboolean p) { (void) p; return FALSE; }
 
@@ -64,11 +67,179 @@ test_queue_init (void)
 	g_slist_free_full (l, (GDestroyNotify)oio_events_queue__destroy);
 }
 
+static void
+test_queue_coalesce (void)
+{
+	struct oio_events_queue_s *q = NULL;
+	GError *err = oio_events_queue_factory__create ("inproc://coalesce", &q);
+	g_assert_no_error (err);
+	g_assert_nonnull (q);
+
+	g_strlcpy(oio_events_common_coalesce,
+			"storage.container.new,storage.container.state",
+			sizeof(oio_events_common_coalesce));
+	oio_events_queue__set_buffering (q, G_TIME_SPAN_HOUR);
+
+	static const char *evt =
+		"{\"event\":\"storage.container.state\",\"when\":%u,"
+		"\"url\":{\"ns\":\"NS\",\"id\":\"%s\"},\"data\":{}}";
+	const char *id0 = "0123456789ABCDEF0123456789ABCDEF"
+		"0123456789ABCDEF0123456789ABCDEF";
+	const char *id1 = "FEDCBA9876543210FEDCBA9876543210"
+		"FEDCBA9876543210FEDCBA9876543210";
+	for (guint i=0; i<3 ;++i)
+		oio_events_queue__send (q, g_strdup_printf (evt, i, id0));
+	oio_events_queue__send (q, g_strdup_printf (evt, 3, id1));
+	/* not listed in the rules, never coalesced */
+	oio_events_queue__send (q, g_strdup ("{\"event\":\"content.new\"}"));
+	oio_events_queue__send (q, g_strdup ("{\"event\":\"content.new\"}"));
+	g_assert_cmpuint (2, ==, oio_events_queue__get_coalesced (q));
+
+	/* The events about objects only collapse with the events about the
+	 * same object */
+	g_strlcpy(oio_events_common_coalesce, "storage.content.new",
+			sizeof(oio_events_common_coalesce));
+	static const char *evt_content =
+		"{\"event\":\"storage.content.new\",\"when\":%u,"
+		"\"url\":{\"ns\":\"NS\",\"path\":\"%s\",\"id\":\"%s\"},"
+		"\"data\":[]}";
+	oio_events_queue__send (q, g_strdup_printf (evt_content, 4, "a", id0));
+	oio_events_queue__send (q, g_strdup_printf (evt_content, 5, "b", id0));
+	g_assert_cmpuint (2, ==, oio_events_queue__get_coalesced (q));
+	oio_events_queue__send (q, g_strdup_printf (evt_content, 6, "a", id0));
+	g_assert_cmpuint (3, ==, oio_events_queue__get_coalesced (q));
+
+	/* The explicit overwrites are not counted */
+	for (guint i=0; i<2 ;++i)
+		oio_events_queue__send_overwritable (q, g_strdup ("key"),
+				g_strdup ("{}"));
+	g_assert_cmpuint (3, ==, oio_events_queue__get_coalesced (q));
+
+	oio_events_common_coalesce[0] = '\0';
+	oio_events_queue__run (q, immediately_done);
+	oio_events_queue__destroy (q);
+}
+
+static void
+test_event_hash_container (void)
+{
+	guint32 h0 = 0, h1 = 0;
+	struct oio_url_s *url = oio_url_empty ();
+	oio_url_set (url, OIOURL_NS, "NS");
+	oio_url_set (url, OIOURL_ACCOUNT, "ACCT");
+	/* A user that looks like the end of the "url" object */
+	oio_url_set (url, OIOURL_USER, "JFS}\"id\":\"X\"}");
+	oio_url_set (url, OIOURL_HEXID,
+			"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF");
+
+	GString *gs = oio_event__create ("storage.container.new", url);
+	g_assert_true (oio_event__hash_container (gs->str, &h0));
+	g_string_free (gs, TRUE);
+
+	oio_url_set (url, OIOURL_PATH, "content");
+	gs = oio_event__create ("storage.content.new", url);
+	g_assert_true (oio_event__hash_container (gs->str, &h1));
+	g_assert_cmpuint (h0, ==, h1);
+	g_string_free (gs, TRUE);
+
+	/* Only the "id" of the "url" object counts */
+	oio_url_unset (url, OIOURL_HEXID);
+	gs = oio_event__create ("storage.content.new", url);
+	g_string_append_static (gs, ",\"data\":{\"id\":\"X\"}}");
+	g_assert_false (oio_event__hash_container (gs->str, &h1));
+	g_string_free (gs, TRUE);
+
+	gs = oio_event__create ("storage.content.new", NULL);
+	g_assert_false (oio_event__hash_container (gs->str, &h1));
+	g_string_free (gs, TRUE);
+
+	oio_url_pclean (&url);
+}
+
+static void
+_check_replay(struct oio_events_queue_spill_s *spill, GAsyncQueue *queue,
+		guint first, guint last)
+{
+	for (guint i=first; i<=last ;++i) {
+		gchar *msg = g_async_queue_try_pop (queue);
+		if (!msg) {
+			oio_events_queue_spill_replay (spill, queue);
+			msg = g_async_queue_try_pop (queue);
+		}
+		g_assert_nonnull (msg);
+		gchar expected[16];
+		g_snprintf (expected, sizeof(expected), "%u", i);
+		g_assert_cmpstr (msg, ==, expected);
+		g_free (msg);
+	}
+	g_assert_cmpuint (0, ==, oio_events_queue_spill_replay (spill, queue));
+	g_assert_cmpint (0, ==, g_async_queue_length (queue));
+}
+
+static void
+test_queue_spill (void)
+{
+	gchar *dir = g_dir_make_tmp ("oio-events-spill-XXXXXX", NULL);
+	g_assert_nonnull (dir);
+	g_strlcpy (oio_events_common_spill_dir, dir,
+			sizeof(oio_events_common_spill_dir));
+	oio_events_common_spill_watermark = 4;
+	oio_events_common_spill_segment_size = 32;
+
+	GAsyncQueue *queue = g_async_queue_new ();
+	struct oio_events_queue_spill_s spill, other;
+	oio_events_queue_spill_init (&spill);
+	oio_events_queue_spill_init (&other);
+
+	GError *err = oio_events_queue_spill_open (&spill, "beanstalk://[::1]:1");
+	g_assert_no_error (err);
+	err = oio_events_queue_spill_open (&other, "beanstalk://[::1]:1");
+	g_assert_nonnull (err);
+	g_assert_cmpint (err->code, ==, CODE_UNAVAILABLE);
+	g_clear_error (&err);
+	oio_events_queue_spill_clean (&other);
+
+	/* Beyond the watermark, the events go to the disk and come back in
+	 * order, across several segments */
+	for (guint i=0; i<32 ;++i)
+		oio_events_queue_spill_push (&spill, queue, g_strdup_printf ("%u", i));
+	g_assert_cmpint (4, ==, g_async_queue_length (queue));
+	g_assert_cmpint (0, <, oio_events_queue_spill_size (&spill));
+	_check_replay (&spill, queue, 0, 31);
+	g_assert_cmpint (0, ==, oio_events_queue_spill_size (&spill));
+
+	/* The events left on the disk are replayed by the next queue */
+	for (guint i=0; i<10 ;++i)
+		oio_events_queue_spill_push (&spill, queue, g_strdup_printf ("%u", i));
+	for (gchar *msg; (msg = g_async_queue_try_pop (queue));)
+		g_free (msg);
+	oio_events_queue_spill_clean (&spill);
+
+	oio_events_queue_spill_init (&spill);
+	err = oio_events_queue_spill_open (&spill, "beanstalk://[::1]:1");
+	g_assert_no_error (err);
+	_check_replay (&spill, queue, 4, 9);
+	g_assert_cmpint (0, ==, oio_events_queue_spill_size (&spill));
+
+	gchar *sub = g_build_filename (dir, "beanstalk______1__1", NULL);
+	oio_events_queue_spill_clean (&spill);
+	g_assert_cmpint (0, ==, g_rmdir (sub));
+	g_assert_cmpint (0, ==, g_rmdir (dir));
+	g_free (sub);
+
+	oio_events_common_spill_dir[0] = '\0';
+	g_async_queue_unref (queue);
+	g_free (dir);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/events/queue/init", test_queue_init);
 	g_test_add_func("/events/queue/clogged", test_queue_stalled);
+	g_test_add_func("/events/queue/coalesce", test_queue_coalesce);
+	g_test_add_func("/events/queue/spill", test_queue_spill);
+	g_test_add_func("/events/hash/container", test_event_hash_container);
 	return g_test_run();
 }
@@ -0,0 +1,152 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <metautils/lib/metautils.h>
+#include <rawx-lib/src/rawx.h>
+
+#define CHUNK_ID \
+	"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"
+
+static void
+_fill(struct chunk_textinfo_s *cti)
+{
+	cti->content_fullpath = g_strdup("ACCT/JFS/plop/1/0123456789ABCDEF");
+	cti->chunk_id = g_strdup(CHUNK_ID);
+	cti->chunk_size = g_strdup("1234");
+	cti->chunk_hash = g_strdup("0123456789ABCDEF0123456789ABCDEF");
+	cti->chunk_position = g_strdup("0");
+	cti->content_storage_policy = g_strdup("SINGLE");
+}
+
+/* Writes an empty chunk with the attributes of <cti> in the given layout.
+ * Returns NULL if the xattr are not supported. */
+static gchar *
+_make_chunk(struct chunk_textinfo_s *cti, gboolean packed)
+{
+	GError *err = NULL;
+	gchar *dir = g_build_filename(g_get_tmp_dir(),
+			"test-rawx-attr.XXXXXX", NULL);
+	g_assert_nonnull(g_mkdtemp(dir));
+	gchar *path = g_build_filename(dir, CHUNK_ID, NULL);
+	g_free(dir);
+
+	g_assert_true(g_file_set_contents(path, "", 0, &err));
+	g_assert_no_error(err);
+
+	gboolean ok = (packed ? set_rawx_info_to_file_packed :
+			set_rawx_info_to_file)(path, &err, cti);
+	if (!ok && err->code == ENOTSUP) {
+		g_clear_error(&err);
+		g_remove(path);
+		g_free(path);
+		g_test_skip("xattr not supported");
+		return NULL;
+	}
+	g_assert_no_error(err);
+	return path;
+}
+
+static void
+_remove_chunk(gchar *path)
+{
+	gchar *dir = g_path_get_dirname(path);
+	g_remove(path);
+	g_rmdir(dir);
+	g_free(dir);
+	g_free(path);
+}
+
+static void
+test_compression_packed(void)
+{
+	GError *err = NULL;
+	struct chunk_textinfo_s cti = {0};
+	_fill(&cti);
+	cti.compression_metadata = g_strdup("compression_algorithm=ZLIB");
+	gchar *path = _make_chunk(&cti, TRUE);
+	chunk_textinfo_free_content(&cti);
+	if (!path)
+		return;
+
+	GHashTable *table = g_hash_table_new_full(
+			g_str_hash, g_str_equal, g_free, g_free);
+	g_assert_true(get_compression_info_in_attr(path, &err, table));
+	g_assert_no_error(err);
+	g_assert_cmpstr(g_hash_table_lookup(table, "compression_algorithm"),
+			==, "ZLIB");
+	g_hash_table_destroy(table);
+	_remove_chunk(path);
+}
+
+static void
+test_update(gconstpointer p)
+{
+	const gboolean from_packed = GPOINTER_TO_INT(p) & 1;
+	const gboolean to_packed = GPOINTER_TO_INT(p) & 2;
+	GError *err = NULL;
+	struct chunk_textinfo_s cti = {0};
+	_fill(&cti);
+	gchar *path = _make_chunk(&cti, from_packed);
+	chunk_textinfo_free_content(&cti);
+	if (!path)
+		return;
+
+	/* Only the size is sent again */
+	struct chunk_textinfo_s update = {0};
+	update.chunk_size = g_strdup("4321");
+	int fd = open(path, O_RDONLY);
+	g_assert_cmpint(fd, >=, 0);
+	g_assert_true(update_rawx_info_to_fd(fd, &err, CHUNK_ID,
+				&update, to_packed));
+	g_assert_no_error(err);
+	chunk_textinfo_free_content(&update);
+
+	g_assert_true(get_rawx_info_from_fd(fd, &err, CHUNK_ID, &cti));
+	g_assert_no_error(err);
+	g_assert_cmpstr(cti.chunk_size, ==, "4321");
+	g_assert_cmpstr(cti.chunk_hash, ==, "0123456789ABCDEF0123456789ABCDEF");
+	g_assert_cmpstr(cti.chunk_position, ==, "0");
+	g_assert_cmpstr(cti.content_storage_policy, ==, "SINGLE");
+	g_assert_cmpstr(cti.content_path, ==, "plop");
+	chunk_textinfo_free_content(&cti);
+	close(fd);
+	_remove_chunk(path);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc, argv);
+	g_test_add_func("/rawx/attr/compression/packed", test_compression_packed);
+	g_test_add_data_func("/rawx/attr/update/legacy",
+			GINT_TO_POINTER(0), test_update);
+	g_test_add_data_func("/rawx/attr/update/legacy_to_packed",
+			GINT_TO_POINTER(2), test_update);
+	g_test_add_data_func("/rawx/attr/update/packed",
+			GINT_TO_POINTER(3), test_update);
+	g_test_add_data_func("/rawx/attr/update/packed_to_legacy",
+			GINT_TO_POINTER(1), test_update);
+	return g_test_run();
+}
@@ -0,0 +1,279 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <metautils/lib/metautils.h>
+#include <rawx-lib/src/rawx.h>
+#include <rawx-lib/src/compression.h>
+
+#define BLOCK_SIZE 4096
+
+/* 5 full blocks, then a partial one */
+#define DATA_SIZE (5 * BLOCK_SIZE + 1234)
+
+#define CHUNK_ID \
+	"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"
+
+/* The magic, the count, then one entry per block and one for the EOF */
+#define INDEX_LEN(count) ((count) * 2 * sizeof(guint64) + sizeof(guint32) + 8)
+
+static guint8 data[DATA_SIZE];
+
+static const struct {
+	gsize offset;
+	gsize len;
+} ranges[] = {
+	{0, 10},
+	{BLOCK_SIZE - 1, 2},             /* across the 1st boundary */
+	{2 * BLOCK_SIZE, BLOCK_SIZE},    /* exactly the 3rd block */
+	{3 * BLOCK_SIZE + 100, 50},      /* inside the 4th block */
+	{4 * BLOCK_SIZE - 10, BLOCK_SIZE + 20}, /* across 2 boundaries */
+	{DATA_SIZE - 1, 1},              /* the last byte */
+	{0, 0}
+};
+
+static void
+_init_data(void)
+{
+	/* Compressible blocks first, then random ones stored as is */
+	for (guint i = 0; i < DATA_SIZE / 2; i++)
+		data[i] = "Nobody inspects the spammish repetition"[i % 39];
+	GRand *r = g_rand_new_with_seed(42);
+	for (guint i = DATA_SIZE / 2; i < DATA_SIZE; i++)
+		data[i] = g_rand_int(r);
+	g_rand_free(r);
+}
+
+/* Writes the test data as a chunk in a new directory, with the attributes
+ * the compression needs. Returns NULL if the xattr are not supported. */
+static gchar *
+_make_chunk(void)
+{
+	GError *err = NULL;
+	gchar *dir = g_build_filename(g_get_tmp_dir(),
+			"test-rawx-compression.XXXXXX", NULL);
+	g_assert_nonnull(g_mkdtemp(dir));
+	gchar *path = g_build_filename(dir, CHUNK_ID, NULL);
+	g_free(dir);
+
+	g_assert_true(g_file_set_contents(path, (gchar*)data, DATA_SIZE, &err));
+	g_assert_no_error(err);
+
+	struct chunk_textinfo_s cti = {0};
+	cti.content_fullpath = g_strdup("ACCT/JFS/plop/1/0123456789ABCDEF");
+	cti.chunk_id = g_strdup(CHUNK_ID);
+	cti.chunk_size = g_strdup_printf("%u", DATA_SIZE);
+	cti.chunk_position = g_strdup("0");
+	gboolean ok = set_rawx_info_to_file(path, &err, &cti);
+	chunk_textinfo_free_content(&cti);
+	if (!ok && err->code == ENOTSUP) {
+		g_clear_error(&err);
+		g_remove(path);
+		g_free(path);
+		return NULL;
+	}
+	g_assert_no_error(err);
+	return path;
+}
+
+static void
+_remove_chunk(gchar *path)
+{
+	gchar *dir = g_path_get_dirname(path);
+	g_remove(path);
+	g_rmdir(dir);
+	g_free(dir);
+	g_free(path);
+}
+
+static guint32
+_index_count(const gchar *path)
+{
+	gchar *raw = NULL;
+	gsize len = 0;
+	guint32 count = 0;
+	g_assert_true(g_file_get_contents(path, &raw, &len, NULL));
+	g_assert_cmpuint(len, >, sizeof(count) + 8);
+	memcpy(&count, raw + len - 8 - sizeof(count), sizeof(count));
+	g_free(raw);
+	return GUINT32_FROM_LE(count);
+}
+
+/* Cuts the block index to get a chunk as written before it existed */
+static void
+_strip_index(const gchar *path)
+{
+	const guint32 count = _index_count(path);
+	GStatBuf st = {0};
+	g_assert_cmpint(g_stat(path, &st), ==, 0);
+	g_assert_cmpint(truncate(path, st.st_size - INDEX_LEN(count)), ==, 0);
+}
+
+/* Breaks the monotony of the offsets of the 3rd index entry */
+static void
+_corrupt_index(const gchar *path)
+{
+	const guint32 count = _index_count(path);
+	g_assert_cmpuint(count, >, 3);
+	FILE *f = fopen(path, "r+");
+	g_assert_nonnull(f);
+	guint64 entries[3][2];
+	g_assert_cmpint(fseeko(f, -(off_t)INDEX_LEN(count), SEEK_END), ==, 0);
+	g_assert_cmpuint(fread(entries, sizeof(entries), 1, f), ==, 1);
+	entries[2][1] = entries[1][1];
+	g_assert_cmpint(fseeko(f, -(off_t)INDEX_LEN(count), SEEK_END), ==, 0);
+	g_assert_cmpuint(fwrite(entries, sizeof(entries), 1, f), ==, 1);
+	g_assert_cmpint(fclose(f), ==, 0);
+}
+
+/* Reads the ranges in a row with the same handle, each one skipping
+ * forward from the end of the previous one, then each one alone. */
+static void
+_check_ranges(const gchar *path, const gchar *algo, gboolean indexed)
+{
+	struct compression_ctx_s ctx = {0};
+	struct compressed_chunk_s ck = {0};
+	guint8 buf[2 * BLOCK_SIZE];
+	g_assert_true(init_compression_ctx(&ctx, algo));
+
+	for (int shared = 1; shared >= 0; shared--) {
+		gsize pos = 0;
+		for (guint i = 0; ranges[i].len; i++) {
+			if (!shared || !i) {
+				memset(&ck, 0, sizeof(ck));
+				g_assert_cmpint(ctx.chunk_initiator(&ck, path), ==, 0);
+				g_assert_cmpint(indexed, ==, ck.index != NULL);
+				pos = 0;
+			}
+			g_assert_cmpuint(ranges[i].offset, >=, pos);
+			gsize skip = ranges[i].offset - pos, got = 0;
+			while (got < ranges[i].len) {
+				int r = ctx.data_uncompressor(&ck, skip,
+						buf + got, ranges[i].len - got, NULL);
+				g_assert_cmpint(r, >, 0);
+				got += r;
+				skip = 0;
+			}
+			g_assert_cmpint(memcmp(buf, data + ranges[i].offset, got), ==, 0);
+			pos = ranges[i].offset + got;
+			if (!shared || !ranges[i+1].len)
+				block_compressed_chunk_clean(&ck);
+		}
+	}
+}
+
+static void
+_check_roundtrip(const gchar *path)
+{
+	GError *err = NULL;
+	gchar *raw = NULL;
+	gsize len = 0;
+	g_assert_true(uncompress_chunk(path, FALSE, &err));
+	g_assert_no_error(err);
+	g_assert_true(g_file_get_contents(path, &raw, &len, NULL));
+	g_assert_cmpuint(len, ==, DATA_SIZE);
+	g_assert_cmpint(memcmp(raw, data, len), ==, 0);
+	g_free(raw);
+}
+
+static gchar *
+_compressed_chunk(const gchar *algo)
+{
+	struct compression_ctx_s ctx = {0};
+	if (!init_compression_ctx(&ctx, algo)) {
+		g_test_skip("codec not built in");
+		return NULL;
+	}
+	gchar *path = _make_chunk();
+	if (!path) {
+		g_test_skip("xattr not supported");
+		return NULL;
+	}
+	GError *err = NULL;
+	g_assert_true(compress_chunk(path, algo, BLOCK_SIZE, FALSE, &err));
+	g_assert_no_error(err);
+	GStatBuf st = {0};
+	g_assert_cmpint(g_stat(path, &st), ==, 0);
+	g_assert_cmpint(st.st_size, <, DATA_SIZE);
+	/* One entry per block, then one for the EOF */
+	g_assert_cmpuint(_index_count(path), ==, 6 + 1);
+	return path;
+}
+
+static void
+test_indexed(gconstpointer algo)
+{
+	gchar *path = _compressed_chunk(algo);
+	if (!path)
+		return;
+	_check_ranges(path, algo, TRUE);
+	_check_roundtrip(path);
+	_remove_chunk(path);
+}
+
+static void
+test_not_indexed(gconstpointer algo)
+{
+	gchar *path = _compressed_chunk(algo);
+	if (!path)
+		return;
+	_strip_index(path);
+	_check_ranges(path, algo, FALSE);
+	_check_roundtrip(path);
+	_remove_chunk(path);
+}
+
+static void
+test_corrupted_index(gconstpointer algo)
+{
+	gchar *path = _compressed_chunk(algo);
+	if (!path)
+		return;
+	_corrupt_index(path);
+	_check_ranges(path, algo, FALSE);
+	_check_roundtrip(path);
+	_remove_chunk(path);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char *algos[] = {"ZLIB", "LZ4", "ZSTD", NULL};
+
+	HC_TEST_INIT(argc, argv);
+	_init_data();
+	for (const char **palgo = algos; *palgo; palgo++) {
+		gchar name[128];
+		g_snprintf(name, sizeof(name),
+				"/rawx/compression/%s/indexed", *palgo);
+		g_test_add_data_func(name, *palgo, test_indexed);
+		g_snprintf(name, sizeof(name),
+				"/rawx/compression/%s/not_indexed", *palgo);
+		g_test_add_data_func(name, *palgo, test_not_indexed);
+		g_snprintf(name, sizeof(name),
+				"/rawx/compression/%s/corrupted_index", *palgo);
+		g_test_add_data_func(name, *palgo, test_corrupted_index);
+	}
+	return g_test_run();
+}
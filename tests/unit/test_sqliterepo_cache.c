@@ -48,12 +48,12 @@ _round_lock(sqlx_cache_t *cache)
 	HASHSTR_ALLOCA(hn1, name1);
 
 	gint id0;
-	GError *err = sqlx_cache_open_and_lock_base(cache, hn0, FALSE, &id0, 0);
+	GError *err = sqlx_cache_open_and_lock_base(cache, hn0, SQLX_CACHE_CLASS_WRITE, &id0, 0);
 	g_assert_no_error (err);
 
 	for (int i=0; i<5 ;i++) {
 		gint id = oio_ext_rand_int();
-		err = sqlx_cache_open_and_lock_base(cache, hn0, FALSE, &id, 0);
+		err = sqlx_cache_open_and_lock_base(cache, hn0, SQLX_CACHE_CLASS_WRITE, &id, 0);
 		g_assert_no_error (err);
 		g_assert_cmpint(id0, ==, id);
 	}
@@ -67,7 +67,7 @@ _round_lock(sqlx_cache_t *cache)
 
 	for (int i=0; i<5 ;i++) {
 		gint id = oio_ext_rand_int ();
-		err = sqlx_cache_open_and_lock_base(cache, hn1, FALSE, &id, 0);
+		err = sqlx_cache_open_and_lock_base(cache, hn1, SQLX_CACHE_CLASS_WRITE, &id, 0);
 		g_assert_no_error (err);
 		err = sqlx_cache_unlock_and_close_base(cache, id, 0);
 		g_assert_no_error (err);
@@ -120,7 +120,7 @@ _test_cache_limit (sqlx_cache_t *cache, guint max)
 		g_snprintf(name, sizeof(name), "base-%u", i);
 		hashstr_t *hname = hashstr_create(name);
 		GError *err = sqlx_cache_open_and_lock_base (
-				cache, hname, FALSE, ids+i, 0);
+				cache, hname, SQLX_CACHE_CLASS_WRITE, ids+i, 0);
 		g_assert_no_error(err);
 		g_assert_cmpint(ids[i], >=, 0);
 		g_free(hname);
@@ -130,7 +130,7 @@ _test_cache_limit (sqlx_cache_t *cache, guint max)
 	do {
 		gint id0 = -1;
 		hashstr_t *hn = hashstr_create("X");
-		GError *err = sqlx_cache_open_and_lock_base (cache, hn, FALSE, &id0, 0);
+		GError *err = sqlx_cache_open_and_lock_base (cache, hn, SQLX_CACHE_CLASS_WRITE, &id0, 0);
 		g_assert_error (err, GQ(), CODE_UNAVAILABLE);
 		g_clear_error (&err);
 		g_free(hn);
@@ -168,6 +168,267 @@ test_limit (void)
 	}
 }
 
+static void
+_maintain_count (gpointer handle, gpointer udata)
+{
+	g_assert_nonnull (handle);
+	(*(guint*)udata) ++;
+}
+
+static void
+test_maintain (void)
+{
+	sqlx_cache_t *cache = sqlx_cache_init();
+	g_assert_nonnull(cache);
+	sqlx_cache_set_close_hook(cache, sqlite_close);
+
+	gint ids[4];
+	for (guint i=0; i<4 ;++i) {
+		gchar name[16];
+		g_snprintf(name, sizeof(name), "base-%u", i);
+		hashstr_t *hname = hashstr_create(name);
+		GError *err = sqlx_cache_open_and_lock_base (
+				cache, hname, SQLX_CACHE_CLASS_WRITE, ids+i, 0);
+		g_assert_no_error(err);
+		sqlx_cache_set_handle(cache, ids[i], GUINT_TO_POINTER(i+1));
+		err = sqlx_cache_unlock_and_close_base(cache, ids[i], 0);
+		g_assert_no_error(err);
+		g_free(hname);
+	}
+
+	guint count = 0;
+	g_assert_cmpuint (2, ==, sqlx_cache_maintain_idle (cache, 2,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (2, ==, count);
+	g_assert_cmpuint (2, ==, sqlx_cache_maintain_idle (cache, 0,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (0, ==, sqlx_cache_maintain_idle (cache, 0,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (4, ==, count);
+
+	/* Once used again, the base must be maintained again */
+	do {
+		gint id = -1;
+		hashstr_t *hname = hashstr_create("base-0");
+		GError *err = sqlx_cache_open_and_lock_base (
+				cache, hname, SQLX_CACHE_CLASS_WRITE, &id, 0);
+		g_assert_no_error(err);
+		g_assert_cmpint(id, ==, ids[0]);
+		err = sqlx_cache_unlock_and_close_base(cache, id, 0);
+		g_assert_no_error(err);
+		g_free(hname);
+	} while (0);
+	g_assert_cmpuint (1, ==, sqlx_cache_maintain_idle (cache, 0,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+
+	struct cache_counts_s counts = sqlx_cache_count(cache);
+	g_assert_cmpuint (0, ==, counts.used);
+	g_assert_cmpuint (4, ==, counts.cold + counts.hot);
+
+	sqlx_cache_expire(cache, 0, 0);
+	sqlx_cache_clean(cache);
+}
+
+static GArray *closed_handles = NULL;
+
+static void
+_record_close (gpointer handle)
+{
+	guint h = GPOINTER_TO_UINT(handle);
+	g_array_append_val(closed_handles, h);
+}
+
+static void
+test_maintain_expiry_order (void)
+{
+	sqlx_cache_t *cache = sqlx_cache_init();
+	g_assert_nonnull(cache);
+	closed_handles = g_array_new(FALSE, FALSE, sizeof(guint));
+	sqlx_cache_set_close_hook(cache, _record_close);
+
+	for (guint i=0; i<4 ;++i) {
+		gchar name[16];
+		g_snprintf(name, sizeof(name), "base-%u", i);
+		hashstr_t *hname = hashstr_create(name);
+		gint id = -1;
+		GError *err = sqlx_cache_open_and_lock_base (
+				cache, hname, SQLX_CACHE_CLASS_WRITE, &id, 0);
+		g_assert_no_error(err);
+		sqlx_cache_set_handle(cache, id, GUINT_TO_POINTER(i+1));
+		err = sqlx_cache_unlock_and_close_base(cache, id, 0);
+		g_assert_no_error(err);
+		g_free(hname);
+		g_usleep(1000);
+	}
+
+	/* Maintain the two oldest bases, they must not be pushed back */
+	guint count = 0;
+	g_assert_cmpuint (2, ==, sqlx_cache_maintain_idle (cache, 2,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (2, ==, count);
+
+	const gint64 cool = _cache_grace_delay_cool, hot = _cache_grace_delay_hot;
+	_cache_grace_delay_cool = _cache_grace_delay_hot = 1;
+	g_usleep(1000);
+
+	for (guint i=0; i<4 ;++i) {
+		g_assert_cmpuint (1, ==, sqlx_cache_expire(cache, 1, G_TIME_SPAN_SECOND));
+		g_assert_cmpuint (i+1, ==, closed_handles->len);
+		g_assert_cmpuint (i+1, ==, g_array_index(closed_handles, guint, i));
+	}
+
+	_cache_grace_delay_cool = cool;
+	_cache_grace_delay_hot = hot;
+	sqlx_cache_clean(cache);
+	g_array_free(closed_handles, TRUE);
+	closed_handles = NULL;
+}
+
+static void
+test_maintain_reuse (void)
+{
+	sqlx_cache_t *cache = sqlx_cache_init();
+	g_assert_nonnull(cache);
+	closed_handles = g_array_new(FALSE, FALSE, sizeof(guint));
+	sqlx_cache_set_close_hook(cache, _record_close);
+
+	gint ids[4];
+	for (guint i=0; i<4 ;++i) {
+		gchar name[16];
+		g_snprintf(name, sizeof(name), "base-%u", i);
+		hashstr_t *hname = hashstr_create(name);
+		GError *err = sqlx_cache_open_and_lock_base (
+				cache, hname, SQLX_CACHE_CLASS_WRITE, ids+i, 0);
+		g_assert_no_error(err);
+		sqlx_cache_set_handle(cache, ids[i], GUINT_TO_POINTER(i+1));
+		err = sqlx_cache_unlock_and_close_base(cache, ids[i], 0);
+		g_assert_no_error(err);
+		g_free(hname);
+		g_usleep(1000);
+	}
+
+	guint count = 0;
+	g_assert_cmpuint (2, ==, sqlx_cache_maintain_idle (cache, 2,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+
+	/* Use the most recent of the maintained bases, it becomes the most
+	 * recent idle base and must be maintained again, after the others */
+	do {
+		gint id = -1;
+		hashstr_t *hname = hashstr_create("base-1");
+		GError *err = sqlx_cache_open_and_lock_base (
+				cache, hname, SQLX_CACHE_CLASS_WRITE, &id, 0);
+		g_assert_no_error(err);
+		g_assert_cmpint(id, ==, ids[1]);
+		err = sqlx_cache_unlock_and_close_base(cache, id, 0);
+		g_assert_no_error(err);
+		g_free(hname);
+	} while (0);
+	g_assert_cmpuint (3, ==, sqlx_cache_maintain_idle (cache, 0,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (0, ==, sqlx_cache_maintain_idle (cache, 0,
+				G_TIME_SPAN_SECOND, _maintain_count, &count));
+	g_assert_cmpuint (5, ==, count);
+
+	const gint64 cool = _cache_grace_delay_cool, hot = _cache_grace_delay_hot;
+	_cache_grace_delay_cool = _cache_grace_delay_hot = 1;
+	g_usleep(1000);
+
+	static const guint order[] = {1, 3, 4, 2};
+	for (guint i=0; i<4 ;++i) {
+		g_assert_cmpuint (1, ==, sqlx_cache_expire(cache, 1, G_TIME_SPAN_SECOND));
+		g_assert_cmpuint (i+1, ==, closed_handles->len);
+		g_assert_cmpuint (order[i], ==, g_array_index(closed_handles, guint, i));
+	}
+
+	_cache_grace_delay_cool = cool;
+	_cache_grace_delay_hot = hot;
+	sqlx_cache_clean(cache);
+	g_array_free(closed_handles, TRUE);
+	closed_handles = NULL;
+}
+
+struct handoff_ctx_s
+{
+	sqlx_cache_t *cache;
+	GMutex lock;
+	enum sqlx_cache_class_e order[SQLX_CACHE_CLASS_MAX];
+	guint count;
+};
+
+struct handoff_arg_s
+{
+	struct handoff_ctx_s *ctx;
+	enum sqlx_cache_class_e klass;
+};
+
+static gpointer
+_handoff_worker (gpointer p)
+{
+	struct handoff_arg_s *arg = p;
+	hashstr_t *hname = NULL;
+	HASHSTR_ALLOCA(hname, name0);
+
+	gint id = -1;
+	GError *err = sqlx_cache_open_and_lock_base (
+			arg->ctx->cache, hname, arg->klass, &id, 0);
+	g_assert_no_error(err);
+	g_mutex_lock(&arg->ctx->lock);
+	arg->ctx->order[arg->ctx->count++] = arg->klass;
+	g_mutex_unlock(&arg->ctx->lock);
+	g_usleep(10 * G_TIME_SPAN_MILLISECOND);
+	err = sqlx_cache_unlock_and_close_base(arg->ctx->cache, id, 0);
+	g_assert_no_error(err);
+	return NULL;
+}
+
+static void
+test_handoff (void)
+{
+	struct handoff_ctx_s ctx = {0};
+	g_mutex_init(&ctx.lock);
+	ctx.cache = sqlx_cache_init();
+	g_assert_nonnull(ctx.cache);
+	sqlx_cache_set_close_hook(ctx.cache, sqlite_close);
+
+	hashstr_t *hname = NULL;
+	HASHSTR_ALLOCA(hname, name0);
+	gint id = -1;
+	GError *err = sqlx_cache_open_and_lock_base (
+			ctx.cache, hname, SQLX_CACHE_CLASS_WRITE, &id, 0);
+	g_assert_no_error(err);
+
+	/* The waiters arrive from the least to the most urgent */
+	struct handoff_arg_s args[3] = {
+		{&ctx, SQLX_CACHE_CLASS_BACKGROUND},
+		{&ctx, SQLX_CACHE_CLASS_READ},
+		{&ctx, SQLX_CACHE_CLASS_REPLICATION},
+	};
+	GThread *th[3];
+	for (guint i=0; i<3 ;++i) {
+		th[i] = g_thread_new("waiter", _handoff_worker, args+i);
+		g_usleep(50 * G_TIME_SPAN_MILLISECOND);
+	}
+
+	err = sqlx_cache_unlock_and_close_base(ctx.cache, id, 0);
+	g_assert_no_error(err);
+	for (guint i=0; i<3 ;++i)
+		g_thread_join(th[i]);
+
+	/* ... and they are served from the most to the least urgent */
+	g_assert_cmpuint (3, ==, ctx.count);
+	g_assert_cmpint (SQLX_CACHE_CLASS_REPLICATION, ==, ctx.order[0]);
+	g_assert_cmpint (SQLX_CACHE_CLASS_READ, ==, ctx.order[1]);
+	g_assert_cmpint (SQLX_CACHE_CLASS_BACKGROUND, ==, ctx.order[2]);
+
+	struct cache_counts_s counts = sqlx_cache_count(ctx.cache);
+	g_assert_cmpuint (0, ==, counts.used);
+
+	sqlx_cache_expire(ctx.cache, 0, 0);
+	sqlx_cache_clean(ctx.cache);
+	g_mutex_clear(&ctx.lock);
+}
+
 int
 main(int argc, char ** argv)
 {
@@ -175,6 +436,12 @@ main(int argc, char ** argv)
 	g_test_add_func("/sqliterepo/cache/init", test_init);
 	g_test_add_func("/sqliterepo/cache/lock", test_lock);
 	g_test_add_func("/sqliterepo/cache/limit", test_limit);
+	g_test_add_func("/sqliterepo/cache/maintain", test_maintain);
+	g_test_add_func("/sqliterepo/cache/maintain/order",
+			test_maintain_expiry_order);
+	g_test_add_func("/sqliterepo/cache/maintain/reuse",
+			test_maintain_reuse);
+	g_test_add_func("/sqliterepo/cache/handoff", test_handoff);
 	return g_test_run();
 }
 
@@ -42,9 +42,10 @@ static gint64 _get_real (void) { return CLOCK; }
 static struct election_member_s *
 manager_get_member (struct election_manager_s *m, const char *k)
 {
-	_manager_lock(m);
-	struct election_member_s *member = _LOCKED_get_member (m, k);
-	_manager_unlock(m);
+	struct election_shard_s *shard = _manager_get_shard (m, k);
+	_shard_lock(shard);
+	struct election_member_s *member = _LOCKED_get_member (shard, k);
+	_shard_unlock(shard);
 	return member;
 }
 
@@ -540,6 +541,75 @@ test_create_ok(void)
 	sqlx_sync_clear(sync); sync = NULL; \
 	sqlx_peering__destroy(peering); peering = NULL;
 
+static void test_shards (void) {
+	TEST_HEAD();
+
+	g_assert_cmpuint (manager->shards_nb, >=, 1);
+	g_assert_true (m->shard == _manager_get_shard (manager, _k));
+	member_unref (m);
+
+	for (int i=0; i<64 ;++i) {
+		struct sqlx_name_inline_s n0 = {.ns="NS", .base="", .type="type"};
+		g_snprintf(n0.base, sizeof(n0.base), "base-%d", i);
+		NAME2CONST(n, n0);
+		g_assert_no_error (_election_init (manager, &n, NULL, NULL));
+
+		gchar k[OIO_ELECTION_KEY_LIMIT_LENGTH];
+		sqliterepo_hash_name(&n, k, sizeof(k));
+		struct election_member_s *member = manager_get_member (manager, k);
+		g_assert_nonnull (member);
+		g_assert_true (member->shard == _manager_get_shard (manager, k));
+		member_unref (member);
+	}
+
+	struct election_counts_s count = election_manager_count (manager);
+	g_assert_cmpuint (count.total, ==, 65);
+	g_assert_cmpuint (count.none, ==, 65);
+
+	TEST_TAIL();
+}
+
+static void test_hints (void) {
+	TEST_HEAD();
+	member_unref (m);
+
+	gchar *peers[] = {"127.0.0.1:6001", "127.0.0.1:6002", NULL};
+	struct election_hint_s hint = {
+		.ns = "NS", .base = "hinted", .type = "type", .peers = peers,
+	};
+	election_manager_seed_hint (manager, &hint);
+
+	const struct sqlx_name_s n = {hint.ns, hint.base, hint.type};
+	gchar k[OIO_ELECTION_KEY_LIMIT_LENGTH];
+	sqliterepo_hash_name(&n, k, sizeof(k));
+	struct election_member_s *member = manager_get_member (manager, k);
+	g_assert_nonnull (member);
+	g_assert_cmpuint (g_strv_length (member->peers), ==, 2);
+	member_unref (member);
+
+	GPtrArray *hints = election_manager_collect_hints (manager, 0);
+	g_assert_nonnull (hints);
+	gboolean found = FALSE;
+	for (guint i=0; i<hints->len ;++i) {
+		struct election_hint_s *h = hints->pdata[i];
+		g_assert_cmpuint (g_strv_length (h->peers), >, 0);
+		if (!strcmp (h->base, "hinted")) {
+			found = TRUE;
+			g_assert_null (h->master_url);
+			g_assert_cmpstr (h->peers[0], ==, peers[0]);
+			g_assert_cmpstr (h->peers[1], ==, peers[1]);
+		}
+	}
+	g_assert_true (found);
+	g_ptr_array_free (hints, TRUE);
+
+	hints = election_manager_collect_hints (manager, 1);
+	g_assert_cmpuint (hints->len, <=, 1);
+	g_ptr_array_free (hints, TRUE);
+
+	TEST_TAIL();
+}
+
 static void test_STEP_NONE (void) {
 	TEST_HEAD();
 
@@ -1941,6 +2011,8 @@ main(int argc, char **argv)
 	g_test_add_func("/sqlx/election/create_bad_config", test_create_bad_config);
 	g_test_add_func("/sqlx/election/create_ok", test_create_ok);
 	g_test_add_func("/sqlx/election/election_init", test_election_init);
+	g_test_add_func("/sqlx/election/shards", test_shards);
+	g_test_add_func("/sqlx/election/hints", test_hints);
 	g_test_add_func("/sqlx/election/step/NONE", test_STEP_NONE);
 	g_test_add_func("/sqlx/election/step/PEERING", test_STEP_PEERING);
 	g_test_add_func("/sqlx/election/step/CREATING", test_STEP_CREATING);
@@ -20,6 +20,8 @@ License along with this library.
 #include <unistd.h>
 #include <stdio.h>
 
+#include <sqlite3.h>
+
 #include <metautils/lib/metautils.h>
 
 #include <sqliterepo/sqliterepo.h>
@@ -132,12 +134,108 @@ test_open_close (void)
 		_round_open_close ();
 }
 
+static gint64
+_pragma_i64 (sqlite3 *db, const char *sql)
+{
+	sqlite3_stmt *stmt = NULL;
+	g_assert_cmpint (SQLITE_OK, ==, sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL));
+	g_assert_cmpint (SQLITE_ROW, ==, sqlite3_step (stmt));
+	gint64 v = sqlite3_column_int64 (stmt, 0);
+	sqlite3_finalize (stmt);
+	return v;
+}
+
+static void
+test_open_profile (void)
+{
+	struct sqlx_repo_config_s cfg = {0};
+	sqlx_repository_t *repo = NULL;
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	struct sqlx_name_s n = { .base = name, .type = type, .ns = nsname, };
+	GError *err;
+
+	g_assert_true (oio_var_value_one ("sqliterepo.sqlite.cache_size", "-4096"));
+	g_assert_true (oio_var_value_one ("sqliterepo.sqlite.temp_store", "file"));
+
+	err = sqlx_repository_init("/tmp", &cfg, &repo);
+	g_assert_no_error (err);
+	err = sqlx_repository_configure_type(repo, type, SCHEMA);
+	g_assert_no_error (err);
+	sqlx_repository_set_locator (repo, _locator, NULL);
+
+	err = sqlx_repository_open_and_lock(repo, &n, SQLX_OPEN_LOCAL, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_cmpint (-4096, ==, _pragma_i64 (sq3->db, "PRAGMA cache_size"));
+	/* 1 stands for FILE */
+	g_assert_cmpint (1, ==, _pragma_i64 (sq3->db, "PRAGMA temp_store"));
+	err = sqlx_repository_unlock_and_close(sq3);
+	g_assert_no_error (err);
+
+	sqlx_repository_clean(repo);
+	oio_var_reset_all ();
+}
+
+static void
+test_dump_restore (void)
+{
+	struct sqlx_repo_config_s cfg = {0};
+	sqlx_repository_t *repo = NULL;
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	struct sqlx_name_s n = { .base = name, .type = type, .ns = nsname, };
+	GError *err;
+
+	err = sqlx_repository_init("/tmp", &cfg, &repo);
+	g_assert_no_error (err);
+	err = sqlx_repository_configure_type(repo, type, SCHEMA);
+	g_assert_no_error (err);
+	sqlx_repository_set_locator (repo, _locator, NULL);
+
+	err = sqlx_repository_open_and_lock(repo, &n, SQLX_OPEN_LOCAL, &sq3, NULL);
+	g_assert_no_error (err);
+	sqlx_admin_set_i64 (sq3, "plop", 5345);
+	sqlx_admin_save_lazy_tnx (sq3);
+
+	GByteArray *dump = NULL;
+	err = sqlx_repository_dump_base_gba (sq3, &dump);
+	g_assert_no_error (err);
+	g_assert_cmpuint (dump->len, >, 0);
+
+	/* The chunks, whatever their size, are the whole dump */
+	GByteArray *chunks = g_byte_array_new ();
+	GError *_append (GByteArray *gba, gint64 remaining, gpointer arg) {
+		(void) arg;
+		g_assert_cmpuint (gba->len, <=, 1000);
+		g_byte_array_append (chunks, gba->data, gba->len);
+		g_assert_cmpint (remaining, ==, dump->len - chunks->len);
+		g_byte_array_free (gba, TRUE);
+		return NULL;
+	}
+	err = sqlx_repository_dump_base_chunked (sq3, 1000, _append, NULL);
+	g_assert_no_error (err);
+	g_assert_cmpuint (chunks->len, ==, dump->len);
+	g_byte_array_free (chunks, TRUE);
+
+	sqlx_admin_set_i64 (sq3, "plop", 5346);
+	sqlx_admin_save_lazy_tnx (sq3);
+
+	err = sqlx_repository_restore_base (sq3, dump->data, dump->len);
+	g_assert_no_error (err);
+	g_assert_cmpint (5345, ==, sqlx_admin_get_i64 (sq3, "plop", 0));
+
+	g_byte_array_free (dump, TRUE);
+	err = sqlx_repository_unlock_and_close(sq3);
+	g_assert_no_error (err);
+	sqlx_repository_clean(repo);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/sqliterepo/init", test_init);
 	g_test_add_func("/sqliterepo/open", test_open_close);
+	g_test_add_func("/sqliterepo/open/profile", test_open_profile);
+	g_test_add_func("/sqliterepo/dump", test_dump_restore);
 	return g_test_run();
 }
 
@@ -0,0 +1,147 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <glib.h>
+
+/* The listings are captured instead of being sent to a ZK server */
+#define zoo_awget_children _fake_awget_children
+#include "../../sqliterepo/synchro.c"
+#undef zoo_awget_children
+
+struct fake_listing_s {
+	gchar *path;
+	strings_completion_t completion;
+	const void *data;
+};
+
+static GPtrArray *listings = NULL;
+
+int
+_fake_awget_children(zhandle_t *zh UNUSED, const char *path,
+		watcher_fn watcher UNUSED, void *watcherCtx UNUSED,
+		strings_completion_t completion, const void *data)
+{
+	struct fake_listing_s *l = g_malloc0(sizeof(*l));
+	l->path = g_strdup(path);
+	l->completion = completion;
+	l->data = data;
+	g_ptr_array_add(listings, l);
+	return ZOK;
+}
+
+static void
+_fake_listing_free(struct fake_listing_s *l)
+{
+	g_free(l->path);
+	g_free(l);
+}
+
+/* Replies to the <i>th listing sent */
+static void
+_reply(guint i, const struct String_vector *sv)
+{
+	struct fake_listing_s *l = listings->pdata[i];
+	l->completion(ZOK, sv, l->data);
+}
+
+static guint completed[8];
+
+static void
+_completion(int zrc, const struct String_vector *sv, const void *data)
+{
+	g_assert_cmpint(zrc, ==, ZOK);
+	g_assert_cmpint(sv->count, ==, 1);
+	completed[GPOINTER_TO_UINT(data)] ++;
+}
+
+static struct sqlx_sync_s *
+_sync(void)
+{
+	listings = g_ptr_array_new_with_free_func(
+			(GDestroyNotify) _fake_listing_free);
+	memset(completed, 0, sizeof(completed));
+	struct sqlx_sync_s *ss = sqlx_sync_create("127.0.0.1:2181");
+	sqlx_sync_set_prefix(ss, "/hc/NS/el/meta2");
+	sqlx_sync_set_hash(ss, 2, 1);
+	return ss;
+}
+
+static void
+_list(struct sqlx_sync_s *ss, guint i)
+{
+	gchar path[64];
+	g_snprintf(path, sizeof(path), "%s-%010u", i < 7 ? "AB01" : "CD01", i);
+	g_assert_cmpint(ZOK, ==, sqlx_sync_awget_siblings(ss, path,
+				NULL, NULL, _completion, GUINT_TO_POINTER(i)));
+}
+
+static void
+test_coalesce(void)
+{
+	char *names[] = {"AB01-0000000000"};
+	const struct String_vector sv = {1, names};
+	struct sqlx_sync_s *ss = _sync();
+
+	/* 7 elections in the same directory, 1 in another */
+	for (guint i=0; i<8 ;++i)
+		_list(ss, i);
+	g_assert_cmpuint(listings->len, ==, 2);
+	struct fake_listing_s *l = listings->pdata[0];
+	g_assert_cmpstr(l->path, ==, "/hc/NS/el/meta2/AB");
+	l = listings->pdata[1];
+	g_assert_cmpstr(l->path, ==, "/hc/NS/el/meta2/CD");
+
+	/* The reply is fanned out to all the waiters */
+	_reply(0, &sv);
+	for (guint i=0; i<7 ;++i)
+		g_assert_cmpuint(completed[i], ==, 1);
+	g_assert_cmpuint(completed[7], ==, 0);
+
+	/* Once replied, the directory is listed again */
+	_list(ss, 0);
+	g_assert_cmpuint(listings->len, ==, 3);
+	_reply(2, &sv);
+	g_assert_cmpuint(completed[0], ==, 2);
+
+	/* The listing of CD is still pending and freed with the sync */
+	sqlx_sync_clear(ss);
+	g_ptr_array_free(listings, TRUE);
+}
+
+static void
+test_no_coalesce(void)
+{
+	g_assert_true(oio_var_value_one("sqliterepo.zk.coalesce_listings",
+				"false"));
+	struct sqlx_sync_s *ss = _sync();
+	for (guint i=0; i<7 ;++i)
+		_list(ss, i);
+	g_assert_cmpuint(listings->len, ==, 7);
+	sqlx_sync_clear(ss);
+	g_ptr_array_free(listings, TRUE);
+	oio_var_reset_all();
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/sqliterepo/sync/listing/coalesce", test_coalesce);
+	g_test_add_func("/sqliterepo/sync/listing/no_coalesce", test_no_coalesce);
+	return g_test_run();
+}
@@ -20,6 +20,7 @@ License along with this library.
 #include <metautils/lib/metautils.h>
 
 #include <sqliterepo/version.h>
+#include <sqliterepo/sqlx_remote.h>
 
 #undef GQ
 #define GQ() g_quark_from_static_string("oio.sqlite")
@@ -207,6 +208,90 @@ test_schema_concurrent(void)
 	test_concurrent_version(cfg1, cfg0);
 }
 
+static void
+test_many_names(void)
+{
+	static const char raw[] = "NS\tb0\tmeta2\nNS\tb1\tmeta2.v2\n";
+	GArray *names = g_array_new(FALSE, TRUE, sizeof(struct sqlx_name_inline_s));
+	GError *err = sqlx_unpack_GETVERS_MANY((guint8*)raw, sizeof(raw)-1, names);
+	g_assert_no_error(err);
+	g_assert_cmpuint(2, ==, names->len);
+	struct sqlx_name_inline_s *n = &g_array_index(names,
+			struct sqlx_name_inline_s, 1);
+	g_assert_cmpstr("NS", ==, n->ns);
+	g_assert_cmpstr("b1", ==, n->base);
+	g_assert_cmpstr("meta2.v2", ==, n->type);
+	g_array_free(names, TRUE);
+
+	static const char bad[] = "NS\tb0\n";
+	names = g_array_new(FALSE, TRUE, sizeof(struct sqlx_name_inline_s));
+	err = sqlx_unpack_GETVERS_MANY((guint8*)bad, sizeof(bad)-1, names);
+	g_assert_error(err, GQ(), CODE_BAD_REQUEST);
+	g_clear_error(&err);
+	g_array_free(names, TRUE);
+
+	/* A name is never truncated to fit */
+	gchar *base = g_strnfill(LIMIT_LENGTH_BASENAME, 'b');
+	gchar *longer = g_strdup_printf("NS\t%s\tmeta2\n", base);
+	names = g_array_new(FALSE, TRUE, sizeof(struct sqlx_name_inline_s));
+	err = sqlx_unpack_GETVERS_MANY((guint8*)longer, strlen(longer), names);
+	g_assert_error(err, GQ(), CODE_BAD_REQUEST);
+	g_clear_error(&err);
+	g_array_free(names, TRUE);
+	g_free(longer);
+	g_free(base);
+}
+
+static void
+test_many_replies(void)
+{
+	struct cfg_s cfg[] = {
+		{"main.admin", 1, 1},
+		{"main.content", 2, 2},
+		{NULL, -1, -1}
+	};
+	GTree *v0 = build_version(cfg);
+	GByteArray *encoded = version_encode(v0);
+	GError *e = NEWERROR(CODE_CONTAINER_NOTFOUND, "not found");
+
+	GByteArray *body = g_byte_array_new();
+	sqlx_getvers_many_append(body, NULL, encoded);
+	sqlx_getvers_many_append(body, e, NULL);
+	sqlx_getvers_many_append(body, NULL, encoded);
+
+	guint count = 0;
+	void _check(guint idx, gint code, guint8 *b, gsize len, gpointer u) {
+		g_assert_null(u);
+		g_assert_cmpuint(idx, ==, count++);
+		if (idx == 1) {
+			g_assert_cmpint(code, ==, CODE_CONTAINER_NOTFOUND);
+			g_assert_cmpuint(len, ==, strlen("not found"));
+		} else {
+			g_assert_cmpint(code, ==, CODE_FINAL_OK);
+			GTree *v1 = version_decode(b, len);
+			g_assert_nonnull(v1);
+			gint64 worst = 0;
+			GError *err = version_validate_diff(v0, v1, &worst);
+			g_assert_no_error(err);
+			g_tree_destroy(v1);
+		}
+	}
+	GError *err = sqlx_getvers_many_decode(body->data, body->len, _check, NULL);
+	g_assert_no_error(err);
+	g_assert_cmpuint(3, ==, count);
+
+	/* A truncated reply is detected */
+	count = 0;
+	err = sqlx_getvers_many_decode(body->data, body->len - 1, _check, NULL);
+	g_assert_error(err, GQ(), CODE_BAD_REQUEST);
+	g_clear_error(&err);
+
+	g_byte_array_unref(body);
+	g_byte_array_unref(encoded);
+	g_error_free(e);
+	g_tree_destroy(v0);
+}
+
 /* -------------------------------------------------------------------------- */
 
 int
@@ -221,6 +306,8 @@ main(int argc, char **argv)
 	g_test_add_func("/sqliterepo/version/schema/diff", test_schema_diff);
 	g_test_add_func("/sqliterepo/version/schema/concurrent",
 			test_schema_concurrent);
+	g_test_add_func("/sqliterepo/version/many/names", test_many_names);
+	g_test_add_func("/sqliterepo/version/many/replies", test_many_replies);
 	return g_test_run();
 }
 
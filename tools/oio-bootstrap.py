@@ -256,6 +256,18 @@ grid_fsync_dir         disabled
 # Preallocate space for the chunk file (enabled by default)
 #grid_fallocate enabled
 
+# Store the attributes of the chunks in a single xattr (disabled by default)
+#grid_packed_xattr disabled
+
+# Write the chunks with O_DIRECT (disabled by default)
+grid_direct_io ${DIRECT_IO}
+
+# Start the writeback of the chunks every N bytes (0 disables it)
+grid_write_behind ${WRITE_BEHIND}
+
+# COPY the data of the chunks instead of hard linking them (disabled by default)
+grid_copy_data ${COPY_DATA}
+
 # Triggers Access Control List (acl)
 # DO NOT USE, this is broken
 #grid_acl disabled
@@ -1054,6 +1066,9 @@ PORT_START = 'port_start'
 ACCOUNT_ID = 'account_id'
 BUCKET_NAME = 'bucket_name'
 COMPRESSION = 'compression'
+COPY_DATA = 'copy_data'
+DIRECT_IO = 'direct_io'
+WRITE_BEHIND = 'write_behind'
 APPLICATION_KEY = 'application_key'
 KEY_FILE = 'key_file'
 META_HEADER = 'x-oio-chunk-meta'
@@ -1439,12 +1454,18 @@ def generate(options):
     srvtype = 'rawx'
     nb_rawx = getint(options[srvtype].get(SVC_NB), defaults['NB_RAWX'])
     compression = options[srvtype].get(COMPRESSION, "off")
+    copy_data = options[srvtype].get(COPY_DATA, False)
+    direct_io = options[srvtype].get(DIRECT_IO, False)
+    write_behind = getint(options[srvtype].get(WRITE_BEHIND), 0)
     if nb_rawx:
         for i in range(nb_rawx):
             env = subenv({'SRVTYPE': srvtype,
                           'SRVNUM': i + 1,
                           'PORT': next(ports),
                           'COMPRESSION': compression,
+                          'COPY_DATA': 'enabled' if copy_data else 'disabled',
+                          'DIRECT_IO': 'enabled' if direct_io else 'disabled',
+                          'WRITE_BEHIND': write_behind,
                           'SERVICE_ID': str(uuid.uuid4()),
                           'EXTRASLOT': ('rawx-even' if i % 2 else 'rawx-odd')
                           })
@@ -1659,6 +1680,9 @@ def generate(options):
     final_conf['config'] = options['config']
     final_conf['with_service_id'] = options['with_service_id']
     final_conf['random_service_id'] = bool(options['random_service_id'])
+    final_conf[COPY_DATA] = bool(options['rawx'].get(COPY_DATA, False))
+    final_conf[DIRECT_IO] = bool(options['rawx'].get(DIRECT_IO, False))
+    final_conf[WRITE_BEHIND] = getint(options['rawx'].get(WRITE_BEHIND), 0)
     with open('{CFGDIR}/test.yml'.format(**ENV), 'w+') as f:
         f.write(yaml.dump(final_conf))
     return final_conf
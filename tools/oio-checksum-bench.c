@@ -0,0 +1,165 @@
+/*
+OpenIO SDS oio-checksum-bench
+Copyright (C) 2018 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <core/oiolog.h>
+#include <metautils/lib/metautils.h>
+#include <rawx-lib/src/checksum.h>
+
+/* Measures the throughput of each chunk hash algorithm, on a 1MiB and on a
+ * 100MiB buffer fed in pieces of the size of the rawx upload blocks, as the
+ * upload path does. */
+
+static const gsize buffer_sizes[] = {1024 * 1024, 100 * 1024 * 1024, 0};
+
+static GPtrArray *algos = NULL;
+static guint piece_size = 0;
+static gint64 min_bytes = 0;
+
+static volatile gboolean running = FALSE;
+
+/* Returns the throughput in MiB/s */
+static gdouble
+_bench(const char *algo, const guint8 *buf, gsize len, gchar **hex)
+{
+	gint64 total = 0;
+	guint rounds = 0;
+	const gint64 pre = oio_ext_monotonic_time();
+
+	while (running && (!rounds || total < min_bytes)) {
+		struct chunk_checksum_s *cs = chunk_checksum_new(algo);
+		for (gsize off = 0; off < len; off += piece_size)
+			chunk_checksum_update(cs, buf + off, MIN(piece_size, len - off));
+		if (!rounds)
+			*hex = g_strdup(chunk_checksum_get_string(cs));
+		chunk_checksum_free(cs);
+		total += len;
+		rounds ++;
+	}
+
+	const gint64 elapsed = MAX(1, oio_ext_monotonic_time() - pre);
+	return ((gdouble)total / (1024.0 * 1024.0))
+		/ ((gdouble)elapsed / G_TIME_SPAN_SECOND);
+}
+
+static void
+cli_action(void)
+{
+	const gsize max_size = buffer_sizes[G_N_ELEMENTS(buffer_sizes) - 2];
+	guint8 *buf = g_malloc(max_size);
+	for (gsize i = 0; i < max_size; i++)
+		buf[i] = (guint8)g_random_int();
+
+	g_print("%-8s %12s %12s %s\n", "algo", "size", "MiB/s", "hash");
+	for (guint i = 0; running && i < algos->len; i++) {
+		const char *algo = algos->pdata[i];
+		for (const gsize *psize = buffer_sizes; running && *psize; psize++) {
+			gchar *hex = NULL;
+			const gdouble mibps = _bench(algo, buf, *psize, &hex);
+			g_print("%-8s %12" G_GSIZE_FORMAT " %12.1f %s\n",
+					algo, *psize, mibps, hex);
+			g_free(hex);
+		}
+	}
+
+	g_free(buf);
+}
+
+static struct grid_main_option_s *
+cli_get_options(void)
+{
+	static struct grid_main_option_s cli_options[] = {
+		{"PieceSize", OT_UINT, {.u=&piece_size},
+			"size of the pieces the buffers are fed with"},
+		{"MinBytes", OT_INT64, {.i64=&min_bytes},
+			"bytes hashed at least for each measure, the buffer being hashed as many times as necessary"},
+		{NULL, 0, {.i=0}, NULL}
+	};
+
+	return cli_options;
+}
+
+static void
+cli_set_defaults(void)
+{
+	algos = g_ptr_array_new_with_free_func(g_free);
+	piece_size = 1024 * 1024;
+	min_bytes = G_GINT64_CONSTANT(1024 * 1024 * 1024);
+	running = TRUE;
+}
+
+static void
+cli_specific_fini(void)
+{
+	if (algos)
+		g_ptr_array_free(algos, TRUE);
+	algos = NULL;
+}
+
+static void
+cli_specific_stop(void)
+{
+	running = FALSE;
+}
+
+static const gchar *
+cli_usage(void)
+{
+	return "[ALGO...]\n";
+}
+
+static gboolean
+cli_configure(int argc, char **argv)
+{
+	if (piece_size < 1) {
+		GRID_ERROR("PieceSize must be positive");
+		return FALSE;
+	}
+	for (int i = 0; i < argc; i++) {
+		if (!chunk_checksum_algo_is_known(argv[i])) {
+			GRID_ERROR("Unknown algorithm [%s]", argv[i]);
+			return FALSE;
+		}
+		g_ptr_array_add(algos, g_strdup(argv[i]));
+	}
+	if (!algos->len) {
+		for (guint i = 0; chunk_checksum_algo_name(i); i++)
+			g_ptr_array_add(algos, g_strdup(chunk_checksum_algo_name(i)));
+	}
+	return TRUE;
+}
+
+struct grid_main_callbacks cli_callbacks =
+{
+	.options = cli_get_options,
+	.action = cli_action,
+	.set_defaults = cli_set_defaults,
+	.specific_fini = cli_specific_fini,
+	.configure = cli_configure,
+	.usage = cli_usage,
+	.specific_stop = cli_specific_stop,
+};
+
+int
+main(int argc, char **args)
+{
+	return grid_main_cli(argc, args, &cli_callbacks);
+}
@@ -0,0 +1,544 @@
+/*
+OpenIO SDS oio-events-bench
+Copyright (C) 2017 OpenIO SAS, as part of OpenIO SDS
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <zmq.h>
+
+#include <core/oiolog.h>
+#include <metautils/lib/metautils.h>
+#include <events/oio_events_queue.h>
+
+/* Drives an events queue against in-process fake brokers, speaking the
+ * beanstalkd text protocol or the ZMQ ACK protocol of the event-agent.
+ * Each event carries its enqueue time, so that the broker computes the
+ * enqueue-to-ACK latency. */
+
+#define BROKERS_MAX 16
+
+struct fake_broker_s
+{
+	int fd;
+	void *zsock;
+	GThread *th;
+	gchar url[128];
+};
+
+static GString *kind = NULL;
+static guint nb_events = 0;
+static guint nb_pending = 0;
+static guint nb_outputs = 0;
+static guint event_size = 0;
+static guint broker_delay = 0;
+
+static void *zctx = NULL;
+static struct fake_broker_s brokers[BROKERS_MAX];
+static guint nb_brokers = 0;
+static volatile gboolean brokers_running = FALSE;
+static volatile gboolean queue_running = FALSE;
+
+static volatile gint acked = 0;
+static volatile gint latencies_count = 0;
+static gint64 *latencies = NULL;
+
+static gboolean _queue_running (gboolean pending UNUSED) { return queue_running; }
+
+static gint64
+_rss(void)
+{
+	long pages = 0, resident = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (!f)
+		return 0;
+	if (2 != fscanf(f, "%ld %ld", &pages, &resident))
+		resident = 0;
+	fclose(f);
+	return (gint64)resident * sysconf(_SC_PAGESIZE);
+}
+
+static void
+_record_ack(const char *body, gsize len)
+{
+	g_atomic_int_inc(&acked);
+	if (broker_delay)
+		g_usleep(broker_delay);
+
+	static const char field[] = "\"when\":";
+	const char *p = g_strstr_len(body, len, field);
+	if (!p)
+		return;
+	const gint64 when = g_ascii_strtoll(p + sizeof(field) - 1, NULL, 10);
+	if (when <= 0)
+		return;
+	const gint idx = g_atomic_int_add(&latencies_count, 1);
+	if (idx < (gint)nb_events)
+		latencies[idx] = oio_ext_monotonic_time() - when;
+}
+
+/* Beanstalkd ---------------------------------------------------------------- */
+
+static gboolean
+_line_has_prefix(const char *line, gsize len, const char *prefix)
+{
+	const gsize plen = strlen(prefix);
+	return len >= plen && !memcmp(line, prefix, plen);
+}
+
+/* Consume the complete commands in `b`, write the replies in `out` and
+ * return how many bytes have been consumed. */
+static gsize
+_beanstalkd_consume(const guint8 *b, gsize len, GString *out, guint64 *jobid)
+{
+	gsize done = 0;
+	while (done < len) {
+		const char *line = (const char*) b + done;
+		const char *eol = g_strstr_len(line, len - done, "\r\n");
+		if (!eol)
+			break;
+		const gsize line_len = eol - line;
+		gsize consumed = line_len + 2;
+
+		if (_line_has_prefix(line, line_len, "put ")) {
+			const char *last = g_strrstr_len(line, line_len, " ");
+			const gsize body_len = g_ascii_strtoull(last + 1, NULL, 10);
+			if (done + consumed + body_len + 2 > len)
+				break;
+			_record_ack(eol + 2, body_len);
+			consumed += body_len + 2;
+			g_string_append_printf(out, "INSERTED %" G_GUINT64_FORMAT "\r\n",
+					++ *jobid);
+		} else if (_line_has_prefix(line, line_len, "use ")) {
+			g_string_append_printf(out, "USING %.*s\r\n",
+					(int)(line_len - 4), line + 4);
+		} else if (_line_has_prefix(line, line_len, "stats-tube ")) {
+			g_string_append_static(out, "NOT_FOUND\r\n");
+		} else {
+			g_string_append_static(out, "UNKNOWN_COMMAND\r\n");
+		}
+		done += consumed;
+	}
+	return done;
+}
+
+static gpointer
+_beanstalkd_worker(gpointer p)
+{
+	struct fake_broker_s *broker = p;
+	GByteArray *in = g_byte_array_new();
+	GString *out = g_string_sized_new(1024);
+	guint64 jobid = 0;
+	int cli = -1;
+
+	metautils_ignore_signals();
+	while (brokers_running) {
+		struct pollfd pfd = {.fd = cli >= 0 ? cli : broker->fd, .events = POLLIN};
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		if (cli < 0) {
+			cli = accept(broker->fd, NULL, NULL);
+			g_byte_array_set_size(in, 0);
+			continue;
+		}
+
+		guint8 buf[65536];
+		const ssize_t r = read(cli, buf, sizeof(buf));
+		if (r <= 0) {
+			metautils_pclose(&cli);
+			continue;
+		}
+		g_byte_array_append(in, buf, r);
+
+		g_string_set_size(out, 0);
+		const gsize done = _beanstalkd_consume(in->data, in->len, out, &jobid);
+		g_byte_array_remove_range(in, 0, done);
+		for (gsize sent = 0; sent < out->len ;) {
+			const ssize_t w = write(cli, out->str + sent, out->len - sent);
+			if (w < 0 && errno == EINTR)
+				continue;
+			if (w <= 0) {
+				metautils_pclose(&cli);
+				break;
+			}
+			sent += w;
+		}
+	}
+
+	metautils_pclose(&cli);
+	g_string_free(out, TRUE);
+	g_byte_array_free(in, TRUE);
+	return broker;
+}
+
+static gboolean
+_beanstalkd_start(struct fake_broker_s *broker)
+{
+	struct sockaddr_in sin = {};
+	socklen_t sinlen = sizeof(sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	broker->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (broker->fd < 0
+			|| 0 != bind(broker->fd, (struct sockaddr*)&sin, sizeof(sin))
+			|| 0 != listen(broker->fd, 8)
+			|| 0 != getsockname(broker->fd, (struct sockaddr*)&sin, &sinlen)) {
+		GRID_ERROR("Fake beanstalkd error: (%d) %s", errno, strerror(errno));
+		return FALSE;
+	}
+	g_snprintf(broker->url, sizeof(broker->url), "beanstalk://127.0.0.1:%u",
+			(guint) ntohs(sin.sin_port));
+	broker->th = g_thread_new("beanstalkd", _beanstalkd_worker, broker);
+	return TRUE;
+}
+
+/* ZMQ ----------------------------------------------------------------------- */
+
+static gpointer
+_zmq_worker(gpointer p)
+{
+	struct fake_broker_s *broker = p;
+
+	metautils_ignore_signals();
+	while (brokers_running) {
+		zmq_pollitem_t pi = {broker->zsock, -1, ZMQ_POLLIN, 0};
+		if (zmq_poll(&pi, 1, 100) <= 0)
+			continue;
+
+		/* The event-agent receives the identity of the peer, an empty
+		 * delimiter, the header of the event and the event itself. It
+		 * replies with the header alone. */
+		for (;;) {
+			zmq_msg_t frames[4], extra;
+			int nb = 0, more = 0;
+			do {
+				zmq_msg_t *f = nb < 4 ? frames + nb : &extra;
+				zmq_msg_init(f);
+				if (0 > zmq_msg_recv(f, broker->zsock, nb ? 0 : ZMQ_DONTWAIT)) {
+					zmq_msg_close(f);
+					break;
+				}
+				more = zmq_msg_more(f);
+				if (f == &extra)
+					zmq_msg_close(f);
+				else
+					nb ++;
+			} while (more);
+			if (!nb)
+				break;
+
+			if (nb == 4) {
+				_record_ack(zmq_msg_data(frames + 3), zmq_msg_size(frames + 3));
+				zmq_send(broker->zsock, zmq_msg_data(frames),
+						zmq_msg_size(frames), ZMQ_SNDMORE);
+				zmq_send(broker->zsock, "", 0, ZMQ_SNDMORE);
+				zmq_send(broker->zsock, zmq_msg_data(frames + 2),
+						zmq_msg_size(frames + 2), 0);
+			}
+			for (int i=0; i<nb ;++i)
+				zmq_msg_close(frames + i);
+		}
+	}
+
+	return broker;
+}
+
+static gboolean
+_zmq_start(struct fake_broker_s *broker)
+{
+	size_t len = sizeof(broker->url);
+	broker->zsock = zmq_socket(zctx, ZMQ_ROUTER);
+	if (!broker->zsock
+			|| 0 != zmq_bind(broker->zsock, "tcp://127.0.0.1:*")
+			|| 0 != zmq_getsockopt(broker->zsock, ZMQ_LAST_ENDPOINT,
+				broker->url, &len)) {
+		GRID_ERROR("Fake event-agent error: %s", zmq_strerror(zmq_errno()));
+		return FALSE;
+	}
+	broker->th = g_thread_new("event-agent", _zmq_worker, broker);
+	return TRUE;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static gchar *
+_event(guint i, gint64 when, const char *padding)
+{
+	return g_strdup_printf(
+			"{\"event\":\"bench.event\",\"when\":%" G_GINT64_FORMAT ","
+			"\"url\":{\"ns\":\"BENCH\",\"id\":\"%064X\"},\"data\":\"%s\"}",
+			when, i, padding);
+}
+
+static int
+_cmp_gint64(gconstpointer a, gconstpointer b)
+{
+	const gint64 a0 = *(const gint64*)a, b0 = *(const gint64*)b;
+	return (a0 > b0) - (a0 < b0);
+}
+
+static gboolean
+_wait_acks(struct oio_events_queue_s *q, guint expected, gboolean buffered)
+{
+	const gint64 deadline = oio_ext_monotonic_time() + G_TIME_SPAN_MINUTE;
+	while (grid_main_is_running()) {
+		guint64 done = (guint) g_atomic_int_get(&acked);
+		if (buffered)
+			done += oio_events_queue__get_coalesced(q);
+		if (done >= expected)
+			return TRUE;
+		if (oio_ext_monotonic_time() > deadline) {
+			GRID_ERROR("Timeout: %" G_GUINT64_FORMAT "/%u events acknowledged",
+					done, expected);
+			return FALSE;
+		}
+		g_usleep(G_TIME_SPAN_MILLISECOND);
+	}
+	return FALSE;
+}
+
+static void
+_measure(struct oio_events_queue_s *q, const char *padding, gboolean buffered)
+{
+	const gint64 start = oio_ext_monotonic_time();
+	for (guint i=0; i<nb_events && grid_main_is_running() ;++i) {
+		while (oio_events_queue__is_stalled(q) && grid_main_is_running())
+			g_usleep(100);
+		/* Groups of 4 consecutive events are about the same container, so
+		 * that each one may be coalesced with the previous while still in
+		 * the buffer */
+		gchar *evt = _event(buffered ? i / 4 : i,
+				oio_ext_monotonic_time(), padding);
+		oio_events_queue__send(q, evt);
+	}
+	const gint64 enqueued = oio_ext_monotonic_time();
+	if (!_wait_acks(q, nb_pending + nb_events, buffered))
+		return;
+	const gint64 end = oio_ext_monotonic_time();
+
+	const guint nb = MIN((guint) g_atomic_int_get(&latencies_count), nb_events);
+	qsort(latencies, nb, sizeof(gint64), _cmp_gint64);
+	const gdouble elapsed = (end - start) / (gdouble) G_TIME_SPAN_SECOND;
+
+	g_print("events %u\n", nb_events);
+	g_print("coalesced %" G_GUINT64_FORMAT "\n",
+			oio_events_queue__get_coalesced(q));
+	g_print("enqueue.rate %.0f/s\n",
+			nb_events / ((enqueued - start) / (gdouble) G_TIME_SPAN_SECOND));
+	g_print("ack.rate %.0f/s\n", nb / elapsed);
+	if (nb > 0) {
+		g_print("latency.p50 %" G_GINT64_FORMAT "us\n", latencies[nb / 2]);
+		g_print("latency.p99 %" G_GINT64_FORMAT "us\n",
+				latencies[MIN(nb - 1, (nb * 99) / 100)]);
+		g_print("latency.max %" G_GINT64_FORMAT "us\n", latencies[nb - 1]);
+	}
+}
+
+static void
+_bench(struct oio_events_queue_s *q, gboolean buffered)
+{
+	gchar *padding = g_malloc(event_size + 1);
+	memset(padding, 'x', event_size);
+	padding[event_size] = '\0';
+
+	/* Memory used by the events pending in the queue, before it runs */
+	const gint64 rss0 = _rss();
+	for (guint i=0; i<nb_pending ;++i)
+		oio_events_queue__send(q, _event(i, 0, padding));
+	const gint64 rss1 = _rss();
+	if (nb_pending > 0)
+		g_print("memory.pending %" G_GINT64_FORMAT "B/event\n",
+				(rss1 - rss0) / nb_pending);
+
+	gpointer _run(gpointer p) {
+		metautils_ignore_signals();
+		oio_events_queue__run(p, _queue_running);
+		return p;
+	}
+
+	queue_running = TRUE;
+	GThread *th = g_thread_new("queue", _run, q);
+
+	/* Throughput and latency, under the backpressure of the queue */
+	if (_wait_acks(q, nb_pending, FALSE))
+		_measure(q, padding, buffered);
+
+	queue_running = FALSE;
+	g_thread_join(th);
+	g_free(padding);
+}
+
+static void
+cli_action (void)
+{
+	GError *err = NULL;
+	struct oio_events_queue_s *q = NULL;
+	const gboolean zmq = !strcmp(kind->str, "zmq");
+	const gboolean buffered = !strcmp(kind->str, "buffered");
+
+	brokers_running = TRUE;
+	nb_brokers = !strcmp(kind->str, "fanout") ? nb_outputs : 1;
+	GString *cfg = g_string_sized_new(256);
+	for (guint i=0; i<nb_brokers ;++i) {
+		struct fake_broker_s *broker = brokers + i;
+		if (!(zmq ? _zmq_start(broker) : _beanstalkd_start(broker)))
+			goto exit;
+		if (cfg->len)
+			g_string_append_c(cfg, OIO_CSV_SEP2_C);
+		g_string_append(cfg, broker->url);
+	}
+
+	if ((err = oio_events_queue_factory__create(cfg->str, &q))) {
+		GRID_ERROR("Queue creation error: (%d) %s", err->code, err->message);
+		g_clear_error(&err);
+		goto exit;
+	}
+	oio_events_queue__set_buffering(q,
+			buffered ? 10 * G_TIME_SPAN_MILLISECOND : 0);
+	if (buffered)
+		oio_var_value_one("events.common.coalesce", "bench.event");
+	GRID_NOTICE("Benchmarking %s towards [%s]", kind->str, cfg->str);
+	g_print("kind %s\n", kind->str);
+	_bench(q, buffered);
+
+exit:
+	brokers_running = FALSE;
+	for (guint i=0; i<nb_brokers ;++i) {
+		if (brokers[i].th)
+			g_thread_join(brokers[i].th);
+		brokers[i].th = NULL;
+	}
+	oio_events_queue__destroy(q);
+	g_string_free(cfg, TRUE);
+}
+
+static struct grid_main_option_s *
+cli_get_options(void)
+{
+	static struct grid_main_option_s cli_options[] = {
+		{"NbEvents", OT_UINT, {.u=&nb_events},
+			"number of events sent to measure the throughput and the latency"},
+		{"NbPending", OT_UINT, {.u=&nb_pending},
+			"number of events queued before the queue runs, to measure the memory"},
+		{"NbOutputs", OT_UINT, {.u=&nb_outputs},
+			"number of fake brokers behind the fanout queue"},
+		{"EventSize", OT_UINT, {.u=&event_size},
+			"size of the payload of each event"},
+		{"BrokerDelay", OT_UINT, {.u=&broker_delay},
+			"time (microseconds) spent by the fake brokers on each event"},
+		{NULL, 0, {.i=0}, NULL}
+	};
+
+	return cli_options;
+}
+
+static void
+cli_set_defaults(void)
+{
+	kind = NULL;
+	nb_events = 100000;
+	nb_pending = 10000;
+	nb_outputs = 2;
+	event_size = 256;
+	broker_delay = 0;
+	memset(brokers, 0, sizeof(brokers));
+	for (guint i=0; i<BROKERS_MAX ;++i)
+		brokers[i].fd = -1;
+}
+
+static void
+cli_specific_fini(void)
+{
+	for (guint i=0; i<BROKERS_MAX ;++i) {
+		metautils_pclose(&(brokers[i].fd));
+		if (brokers[i].zsock)
+			zmq_close(brokers[i].zsock);
+		brokers[i].zsock = NULL;
+	}
+	if (zctx)
+		zmq_term(zctx);
+	zctx = NULL;
+	g_free(latencies);
+	latencies = NULL;
+	if (kind)
+		g_string_free(kind, TRUE);
+	kind = NULL;
+}
+
+static void
+cli_specific_stop(void)
+{
+	queue_running = FALSE;
+}
+
+static const gchar *
+cli_usage(void)
+{
+	return "beanstalkd|zmq|fanout|buffered\n";
+}
+
+static gboolean
+cli_configure(int argc, char **argv)
+{
+	if (argc != 1) {
+		GRID_ERROR("Expected the kind of queue");
+		return FALSE;
+	}
+	if (strcmp(argv[0], "beanstalkd") && strcmp(argv[0], "zmq")
+			&& strcmp(argv[0], "fanout") && strcmp(argv[0], "buffered")) {
+		GRID_ERROR("Unknown kind of queue [%s]", argv[0]);
+		return FALSE;
+	}
+	if (nb_outputs < 1 || nb_outputs > BROKERS_MAX) {
+		GRID_ERROR("NbOutputs must be between 1 and %d", BROKERS_MAX);
+		return FALSE;
+	}
+
+	kind = g_string_new(argv[0]);
+	latencies = g_malloc0(MAX(1, nb_events) * sizeof(gint64));
+	if (!strcmp(argv[0], "zmq") && !(zctx = zmq_init(1))) {
+		GRID_ERROR("ZMQ context init error");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+struct grid_main_callbacks cli_callbacks =
+{
+	.options = cli_get_options,
+	.action = cli_action,
+	.set_defaults = cli_set_defaults,
+	.specific_fini = cli_specific_fini,
+	.configure = cli_configure,
+	.usage = cli_usage,
+	.specific_stop = cli_specific_stop,
+};
+
+int
+main(int argc, char **args)
+{
+	return grid_main_cli(argc, args, &cli_callbacks);
+}
@@ -261,6 +261,34 @@ test_meta2_filters () {
 	sleep 0.5
 }
 
+test_rawx_copy_data () {
+	randomize_env
+	$OIO_RESET -N $OIO_NS $@
+
+	cd $SRCDIR
+	tox -e coverage
+	${PYTHON} $(which nosetests) \
+		tests.functional.blob.test_blob:RawxTestSuite.test_copy_data \
+		tests.functional.blob.test_blob:RawxTestSuite.test_copy_data_hash_mismatch \
+		tests.functional.blob.test_blob:RawxTestSuite.test_copy_data_unknown_hash_algo
+
+	gridinit_cmd -S $HOME/.oio/sds/run/gridinit.sock stop
+	sleep 0.5
+}
+
+test_rawx_direct_io () {
+	randomize_env
+	$OIO_RESET -N $OIO_NS $@
+
+	cd $SRCDIR
+	tox -e coverage
+	${PYTHON} $(which nosetests) \
+		tests.functional.blob.test_blob:RawxTestSuite.test_direct_io
+
+	gridinit_cmd -S $HOME/.oio/sds/run/gridinit.sock stop
+	sleep 0.5
+}
+
 test_cli () {
 	randomize_env
 	$OIO_RESET -N $OIO_NS $@
@@ -330,6 +358,18 @@ if is_running_test_suite "cli" ; then
 		-f "${SRCDIR}/etc/bootstrap-option-cache.yml"
 fi
 
+if is_running_test_suite "copy-data" ; then
+	echo -e "\n### Rawx COPY of the data"
+	test_rawx_copy_data -f "${SRCDIR}/etc/bootstrap-preset-SINGLE.yml" \
+		-f "${SRCDIR}/etc/bootstrap-option-copy-data.yml"
+fi
+
+if is_running_test_suite "direct-io" ; then
+	echo -e "\n### Rawx O_DIRECT and write-behind"
+	test_rawx_direct_io -f "${SRCDIR}/etc/bootstrap-preset-SINGLE.yml" \
+		-f "${SRCDIR}/etc/bootstrap-option-direct-io.yml"
+fi
+
 if is_running_test_suite "small-cache" ; then
 	echo -e "\n### Small Cache tests"
 	func_tests -f "${SRCDIR}/etc/bootstrap-preset-SINGLE.yml" \